@@ -24,7 +24,22 @@ import (
 //
 // List of changes:
 // • version 1: initial version released with Clear Containers 2.1
-const Version = 1
+// • version 2: hello, attach and allocateIO advertise the maximum I/O frame
+//              size and allocateIO can negotiate it with the client.
+// • version 3: hello can register a VM restored from a checkpoint.
+// • version 4: exec attaches, allocates I/O and starts a process in a single
+//              request.
+// • version 5: hyper returns the payload of the hyperstart reply.
+const Version = 5
+
+// DefaultFrameSize is the maximum size, header included, of the I/O stream
+// frames written to clients that don't negotiate a frame size in allocateIO.
+// This is the size of the hyperstart I/O buffers.
+const DefaultFrameSize = 10240
+
+// MaxFrameSize is the largest I/O stream frame size, header included, the
+// proxy can write to clients.
+const MaxFrameSize = 1024 * 1024
 
 // The Hello payload is issued first after connecting to the proxy socket.
 // It is used to let the proxy know about a new container on the system along
@@ -33,6 +48,12 @@ const Version = 1
 // Console can be used to indicate the path of a socket linked to the VM
 // console. The proxy can output this data when asked for verbose output.
 //
+// Restored indicates the VM was restored from a checkpoint rather than
+// booted: hyperstart announced it was ready before the checkpoint was taken
+// and won't do so again. IoBase is then the first I/O sequence number
+// allocateIO should hand out so the processes still running in the VM keep
+// their streams.
+//
 //  {
 //    "id": "hello",
 //    "data": {
@@ -46,19 +67,28 @@ type Hello struct {
 	CtlSerial   string `json:"ctlSerial"`
 	IoSerial    string `json:"ioSerial"`
 	Console     string `json:"console,omitempty"`
+	Restored    bool   `json:"restored,omitempty"`
+	IoBase      uint64 `json:"ioBase,omitempty"`
 }
 
 // HelloResult is the result from a successful Hello.
 //
+// MaxFrameSize is the largest I/O stream frame the proxy can send and can be
+// used by clients to size the allocateIO maxFrameSize request.
+//
 //  {
 //    "success": true,
 //    "data": {
-//      "version": 1
+//      "version": 2,
+//      "maxFrameSize": 1048576
 //    }
 //  }
 type HelloResult struct {
 	// The version of the proxy protocol
 	Version int `json:"version"`
+
+	// The largest I/O frame size the proxy supports
+	MaxFrameSize int `json:"maxFrameSize"`
 }
 
 // The Attach payload can be used to associate clients to an already known VM.
@@ -80,12 +110,16 @@ type Attach struct {
 //  {
 //    "success": true,
 //    "data": {
-//      "version": 1
+//      "version": 2,
+//      "maxFrameSize": 1048576
 //    }
 //  }
 type AttachResult struct {
 	// The version of the proxy protocol
 	Version int `json:"version"`
+
+	// The largest I/O frame size the proxy supports
+	MaxFrameSize int `json:"maxFrameSize"`
 }
 
 // The Bye payload does the opposite of what hello does, indicating to the
@@ -116,16 +150,23 @@ type Bye struct {
 // data. If wanting stderr as its own stream, a second sequence number needs to
 // be allocated.
 //
+// maxFrameSize is the largest I/O stream frame, header included, the client
+// is willing to read on the I/O file descriptor. The proxy will coalesce
+// consecutive data chunks sent by hyperstart for a stream into frames up to
+// that size. It's optional and defaults to DefaultFrameSize.
+//
 // The result of an allocateIO operation is encoded as an AllocateIoResult.
 //
 //  {
 //    "id": "allocateIO",
 //    "data": {
-//      "nStreams": 2
+//      "nStreams": 2,
+//      "maxFrameSize": 1048576
 //    }
 //  }
 type AllocateIo struct {
-	NStreams int `json:"nStreams"`
+	NStreams     int `json:"nStreams"`
+	MaxFrameSize int `json:"maxFrameSize,omitempty"`
 }
 
 // AllocateIoResult is the result from a successful allocateIO.
@@ -143,14 +184,19 @@ type AllocateIo struct {
 // The proxy will route the I/O streams with the sequence numbers allocated by
 // this operation between that file descriptor and hyperstart.
 //
+// maxFrameSize is the negotiated frame size: the proxy will never write I/O
+// frames bigger than this value on the file descriptor.
+//
 //  {
 //    "success": true,
 //    "data": {
-//      "ioBase": 1234
+//      "ioBase": 1234,
+//      "maxFrameSize": 1048576
 //    }
 //  }
 type AllocateIoResult struct {
-	IoBase uint64 `json:"ioBase"`
+	IoBase       uint64 `json:"ioBase"`
+	MaxFrameSize int    `json:"maxFrameSize"`
 }
 
 // The Hyper payload will forward an hyperstart command to hyperstart.
@@ -170,3 +216,52 @@ type Hyper struct {
 	HyperName string          `json:"hyperName"`
 	Data      json.RawMessage `json:"data,omitempty"`
 }
+
+// HyperResult is the result from a successful hyper command.
+//
+// data is the payload of the hyperstart reply. It is empty for most
+// commands, but holds the file contents for "readfile".
+//
+//  {
+//    "success": true,
+//    "data": {
+//      "data": "1\n42\n"
+//    }
+//  }
+type HyperResult struct {
+	Data string `json:"data"`
+}
+
+// The Exec payload starts a new process in the VM running containerId in a
+// single round trip. It is equivalent to an attach, an allocateIO and a hyper
+// "execcmd" request: the client is attached to the VM, nStreams I/O streams
+// are allocated and the execcmd hyperstart command is forwarded after its
+// process "stdio" and "stderr" sequence numbers have been filled in with the
+// allocated ones ("stderr" is 0 when a single stream is asked for, the
+// process then using a terminal).
+//
+// The result of an exec operation is encoded as an AllocateIoResult and is
+// followed by the I/O file descriptor, as for allocateIO.
+//
+//  {
+//    "id": "exec",
+//    "data": {
+//      "containerId": "756535dc6e9ab9b560f84c8...",
+//      "nStreams": 2,
+//      "maxFrameSize": 1048576,
+//      "execcmd": {
+//        "container": "756535dc6e9ab9b560f84c8...",
+//        "process": {
+//          "terminal": false,
+//          "args": [ "/bin/true" ],
+//          "workdir": "/"
+//        }
+//      }
+//    }
+//  }
+type Exec struct {
+	ContainerID  string          `json:"containerId"`
+	NStreams     int             `json:"nStreams"`
+	MaxFrameSize int             `json:"maxFrameSize,omitempty"`
+	ExecCmd      json.RawMessage `json:"execcmd"`
+}
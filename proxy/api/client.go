@@ -17,6 +17,7 @@ package api
 import (
 	"encoding/json"
 	"errors"
+	"fmt"
 	"net"
 	"os"
 )
@@ -81,13 +82,16 @@ func errorFromResponse(resp *Response) error {
 // HelloOptions holds extra arguments one can pass to the Hello function. See
 // the Hello payload for more details.
 type HelloOptions struct {
-	Console string
+	Console  string
+	Restored bool
+	IoBase   uint64
 }
 
 // HelloReturn contains the return values from Hello. See the Hello and
 // HelloResult payloads.
 type HelloReturn struct {
-	Version int
+	Version      int
+	MaxFrameSize int
 }
 
 // Hello wraps the Hello payload (see payload description for more details)
@@ -101,6 +105,8 @@ func (client *Client) Hello(containerID, ctlSerial, ioSerial string,
 
 	if options != nil {
 		hello.Console = options.Console
+		hello.Restored = options.Restored
+		hello.IoBase = options.IoBase
 	}
 
 	resp, err := client.sendPayload("hello", &hello)
@@ -116,6 +122,11 @@ func (client *Client) Hello(containerID, ctlSerial, ioSerial string,
 	}
 	ret.Version = int(val.(float64))
 
+	// Older proxies don't advertise a frame size
+	if val, ok := resp.Data["maxFrameSize"]; ok {
+		ret.MaxFrameSize = int(val.(float64))
+	}
+
 	return ret, errorFromResponse(resp)
 }
 
@@ -127,7 +138,8 @@ type AttachOptions struct {
 // AttachReturn contains the return values from Hello. See the Hello and
 // AttachResult payloads.
 type AttachReturn struct {
-	Version int
+	Version      int
+	MaxFrameSize int
 }
 
 // Attach wraps the Attach payload (see payload description for more details)
@@ -149,13 +161,29 @@ func (client *Client) Attach(containerID string, options *AttachOptions) (*Attac
 	}
 	ret.Version = int(val.(float64))
 
+	// Older proxies don't advertise a frame size
+	if val, ok := resp.Data["maxFrameSize"]; ok {
+		ret.MaxFrameSize = int(val.(float64))
+	}
+
 	return ret, errorFromResponse(resp)
 }
 
 // AllocateIo wraps the AllocateIo payload (see payload description for more details)
 func (client *Client) AllocateIo(nStreams int) (ioBase uint64, ioFile *os.File, err error) {
+	ioBase, _, ioFile, err = client.AllocateIoWithFrameSize(nStreams, 0)
+	return
+}
+
+// AllocateIoWithFrameSize wraps the AllocateIo payload, asking the proxy for
+// I/O frames up to maxFrameSize bytes. It returns the negotiated frame size
+// along with the allocated ioBase and I/O file (see payload description for
+// more details).
+func (client *Client) AllocateIoWithFrameSize(nStreams, maxFrameSize int) (ioBase uint64,
+	frameSize int, ioFile *os.File, err error) {
 	allocate := AllocateIo{
-		NStreams: nStreams,
+		NStreams:     nStreams,
+		MaxFrameSize: maxFrameSize,
 	}
 
 	resp, err := client.sendPayload("allocateIO", &allocate)
@@ -163,6 +191,13 @@ func (client *Client) AllocateIo(nStreams int) (ioBase uint64, ioFile *os.File,
 		return
 	}
 
+	return client.readIoResult("allocateio", resp)
+}
+
+// readIoResult decodes the result of a request allocating I/O streams and
+// receives the I/O file descriptor that follows it.
+func (client *Client) readIoResult(name string, resp *Response) (ioBase uint64,
+	frameSize int, ioFile *os.File, err error) {
 	err = errorFromResponse(resp)
 	if err != nil {
 		return
@@ -170,15 +205,20 @@ func (client *Client) AllocateIo(nStreams int) (ioBase uint64, ioFile *os.File,
 
 	val, ok := resp.Data["ioBase"]
 	if !ok {
-		return 0, nil, errors.New("allocateio: no ioBase in response")
+		return 0, 0, nil, fmt.Errorf("%s: no ioBase in response", name)
 	}
 
 	ioBase = (uint64)(val.(float64))
 
+	frameSize = DefaultFrameSize
+	if val, ok := resp.Data["maxFrameSize"]; ok {
+		frameSize = int(val.(float64))
+	}
+
 	// I/O fd
 	newFd, err := ReadFd(client.conn)
 	if err != nil {
-		return 0, nil, errors.New("allocateio: couldn't read fd")
+		return 0, 0, nil, fmt.Errorf("%s: couldn't read fd", name)
 	}
 
 	ioFile = os.NewFile(uintptr(newFd), "")
@@ -186,8 +226,40 @@ func (client *Client) AllocateIo(nStreams int) (ioBase uint64, ioFile *os.File,
 	return
 }
 
+// Exec wraps the Exec payload (see payload description for more details). It
+// returns the allocated ioBase, the negotiated frame size and the I/O file.
+func (client *Client) Exec(containerID string, nStreams, maxFrameSize int,
+	execCmd interface{}) (ioBase uint64, frameSize int, ioFile *os.File, err error) {
+	data, err := json.Marshal(execCmd)
+	if err != nil {
+		return
+	}
+
+	exec := Exec{
+		ContainerID:  containerID,
+		NStreams:     nStreams,
+		MaxFrameSize: maxFrameSize,
+		ExecCmd:      data,
+	}
+
+	resp, err := client.sendPayload("exec", &exec)
+	if err != nil {
+		return
+	}
+
+	return client.readIoResult("exec", resp)
+}
+
 // Hyper wraps the Hyper payload (see payload description for more details)
 func (client *Client) Hyper(hyperName string, hyperMessage interface{}) error {
+	_, err := client.HyperWithReply(hyperName, hyperMessage)
+	return err
+}
+
+// HyperWithReply wraps the Hyper payload and returns the payload of the
+// hyperstart reply (see the Hyper and HyperResult payload descriptions for
+// more details)
+func (client *Client) HyperWithReply(hyperName string, hyperMessage interface{}) ([]byte, error) {
 	var data []byte
 
 	if hyperMessage != nil {
@@ -195,7 +267,7 @@ func (client *Client) Hyper(hyperName string, hyperMessage interface{}) error {
 
 		data, err = json.Marshal(hyperMessage)
 		if err != nil {
-			return err
+			return nil, err
 		}
 	}
 
@@ -206,10 +278,17 @@ func (client *Client) Hyper(hyperName string, hyperMessage interface{}) error {
 
 	resp, err := client.sendPayload("hyper", &hyper)
 	if err != nil {
-		return err
+		return nil, err
 	}
 
-	return errorFromResponse(resp)
+	if err := errorFromResponse(resp); err != nil {
+		return nil, err
+	}
+
+	// Older proxies don't return the reply payload
+	reply, _ := resp.Data["data"].(string)
+
+	return []byte(reply), nil
 }
 
 // Bye wraps the Bye payload (see payload description for more details)
@@ -105,10 +105,13 @@ func helloHandler(data []byte, userData interface{}, response *handlerResponse)
 		return
 	}
 
-	client.infof(1, "hello(containerId=%s,ctlSerial=%s,ioSerial=%s,console=%s)", hello.ContainerID,
-		hello.CtlSerial, hello.IoSerial, hello.Console)
+	client.infof(1, "hello(containerId=%s,ctlSerial=%s,ioSerial=%s,console=%s,restored=%v)", hello.ContainerID,
+		hello.CtlSerial, hello.IoSerial, hello.Console, hello.Restored)
 
 	vm := newVM(hello.ContainerID, hello.CtlSerial, hello.IoSerial)
+	if hello.Restored {
+		vm.setRestored(hello.IoBase)
+	}
 	proxy.vms[hello.ContainerID] = vm
 	proxy.Unlock()
 
@@ -127,6 +130,7 @@ func helloHandler(data []byte, userData interface{}, response *handlerResponse)
 	client.vm = vm
 
 	response.AddResult("version", api.Version)
+	response.AddResult("maxFrameSize", api.MaxFrameSize)
 
 	// We start one goroutine per-VM to monitor the qemu process
 	proxy.wg.Add(1)
@@ -162,6 +166,7 @@ func attachHandler(data []byte, userData interface{}, response *handlerResponse)
 	client.vm = vm
 
 	response.AddResult("version", api.Version)
+	response.AddResult("maxFrameSize", api.MaxFrameSize)
 }
 
 // "bye"
@@ -200,6 +205,20 @@ func byeHandler(data []byte, userData interface{}, response *handlerResponse) {
 }
 
 // "allocateIO"
+// negotiateFrameSize returns the I/O frame size to use with a client asking
+// for frames up to requested bytes.
+func negotiateFrameSize(requested int) int {
+	if requested == 0 {
+		return api.DefaultFrameSize
+	}
+
+	if requested > api.MaxFrameSize {
+		return api.MaxFrameSize
+	}
+
+	return requested
+}
+
 func allocateIoHandler(data []byte, userData interface{}, response *handlerResponse) {
 	client := userData.(*client)
 	vm := client.vm
@@ -215,12 +234,23 @@ func allocateIoHandler(data []byte, userData interface{}, response *handlerRespo
 			allocateIo.NStreams)
 	}
 
+	// Frames need to be able to hold at least what hyperstart sends us
+	if allocateIo.MaxFrameSize != 0 &&
+		allocateIo.MaxFrameSize < api.DefaultFrameSize {
+		response.SetErrorf("maximum frame size too small (%d < %d)",
+			allocateIo.MaxFrameSize, api.DefaultFrameSize)
+		return
+	}
+
 	if vm == nil {
 		response.SetErrorMsg("client not attached to a vm")
 		return
 	}
 
-	client.infof(1, "allocateIo(nStreams=%d)", allocateIo.NStreams)
+	frameSize := negotiateFrameSize(allocateIo.MaxFrameSize)
+
+	client.infof(1, "allocateIo(nStreams=%d,maxFrameSize=%d)",
+		allocateIo.NStreams, allocateIo.MaxFrameSize)
 
 	// We'll send c0 to the client, keep c1
 	c0, c1, err := Socketpair()
@@ -235,11 +265,13 @@ func allocateIoHandler(data []byte, userData interface{}, response *handlerRespo
 		return
 	}
 
-	ioBase := vm.AllocateIo(allocateIo.NStreams, client.id, c1)
+	ioBase := vm.AllocateIo(allocateIo.NStreams, frameSize, client.id, c1)
 
-	client.infof(1, "-> %d streams allocated, ioBase=%d", allocateIo.NStreams, ioBase)
+	client.infof(1, "-> %d streams allocated, ioBase=%d, maxFrameSize=%d",
+		allocateIo.NStreams, ioBase, frameSize)
 
 	response.AddResult("ioBase", ioBase)
+	response.AddResult("maxFrameSize", frameSize)
 	response.SetFile(f0)
 
 	// File() dups the underlying fd, so it's safe to close c0 here (will
@@ -265,8 +297,114 @@ func hyperHandler(data []byte, userData interface{}, response *handlerResponse)
 
 	client.infof(1, "hyper(cmd=%s, data=%s)", hyper.HyperName, hyper.Data)
 
-	err := vm.SendMessage(hyper.HyperName, hyper.Data)
-	response.SetError(err)
+	reply, err := vm.SendMessage(hyper.HyperName, hyper.Data)
+	if err != nil {
+		response.SetError(err)
+		return
+	}
+
+	// Commands such as readfile answer with a payload
+	response.AddResult("data", string(reply))
+}
+
+// "exec"
+func execHandler(data []byte, userData interface{}, response *handlerResponse) {
+	client := userData.(*client)
+	proxy := client.proxy
+
+	exec := api.Exec{}
+	if err := json.Unmarshal(data, &exec); err != nil {
+		response.SetError(err)
+		return
+	}
+
+	if exec.NStreams < 1 || exec.NStreams > 2 {
+		response.SetErrorf("asking for unexpected number of streams (%d)",
+			exec.NStreams)
+		return
+	}
+
+	if exec.MaxFrameSize != 0 && exec.MaxFrameSize < api.DefaultFrameSize {
+		response.SetErrorf("maximum frame size too small (%d < %d)",
+			exec.MaxFrameSize, api.DefaultFrameSize)
+		return
+	}
+
+	// Decode the command generically so fields the proxy doesn't know
+	// about are forwarded to hyperstart untouched.
+	execCmd := make(map[string]interface{})
+	if err := json.Unmarshal(exec.ExecCmd, &execCmd); err != nil {
+		response.SetError(err)
+		return
+	}
+
+	process, ok := execCmd["process"].(map[string]interface{})
+	if !ok {
+		response.SetErrorMsg("execcmd: no process")
+		return
+	}
+
+	proxy.Lock()
+	vm := proxy.vms[exec.ContainerID]
+	proxy.Unlock()
+
+	if vm == nil {
+		response.SetErrorf("unknown containerID: %s", exec.ContainerID)
+		return
+	}
+
+	client.infof(1, "exec(containerId=%s,nStreams=%d,maxFrameSize=%d)",
+		exec.ContainerID, exec.NStreams, exec.MaxFrameSize)
+
+	client.vm = vm
+
+	frameSize := negotiateFrameSize(exec.MaxFrameSize)
+
+	// We'll send c0 to the client, keep c1
+	c0, c1, err := Socketpair()
+	if err != nil {
+		response.SetError(err)
+		return
+	}
+
+	f0, err := c0.File()
+	if err != nil {
+		c0.Close()
+		c1.Close()
+		response.SetError(err)
+		return
+	}
+
+	// File() dups the underlying fd, so it's safe to close c0 here (will
+	// keep the c0 <-> c1 connection alive).
+	c0.Close()
+
+	ioBase := vm.AllocateIo(exec.NStreams, frameSize, client.id, c1)
+
+	client.infof(1, "-> %d streams allocated, ioBase=%d, maxFrameSize=%d",
+		exec.NStreams, ioBase, frameSize)
+
+	process["stdio"] = ioBase
+	process["stderr"] = 0
+	if exec.NStreams == 2 {
+		process["stderr"] = ioBase + 1
+	}
+
+	cmd, err := json.Marshal(execCmd)
+	if err == nil {
+		_, err = vm.SendMessage("execcmd", cmd)
+	}
+	if err != nil {
+		// The client will never see the I/O fd, closing it lets
+		// the I/O goroutines of the session exit.
+		f0.Close()
+		response.SetError(err)
+		return
+	}
+
+	response.AddResult("ioBase", ioBase)
+	response.AddResult("maxFrameSize", frameSize)
+	response.SetFile(f0)
 }
 
 func newProxy() *proxy {
@@ -377,6 +515,7 @@ func (proxy *proxy) serve() {
 	proto.Handle("bye", byeHandler)
 	proto.Handle("allocateIO", allocateIoHandler)
 	proto.Handle("hyper", hyperHandler)
+	proto.Handle("exec", execHandler)
 
 	glog.V(1).Info("proxy started")
 
@@ -216,8 +216,9 @@ func TestHello(t *testing.T) {
 	assert.Nil(t, err)
 	assert.NotNil(t, ret)
 
-	// Check that Hello returns the protocol version
+	// Check that Hello returns the protocol version and frame size
 	assert.Equal(t, api.Version, ret.Version)
+	assert.Equal(t, api.MaxFrameSize, ret.MaxFrameSize)
 
 	// A new Hello message with the same containerID should error out
 	_, err = rig.Client.Hello(testContainerID, "fooCtl", "fooIo", nil)
@@ -239,6 +240,41 @@ func TestHello(t *testing.T) {
 	rig.Stop()
 }
 
+func TestHelloRestored(t *testing.T) {
+	proto := newProtocol()
+	proto.Handle("hello", helloHandler)
+	proto.Handle("allocateIO", allocateIoHandler)
+
+	rig := newTestRig(t, proto)
+	rig.Start()
+
+	// Register a VM restored from a checkpoint
+	ctlSocketPath, ioSocketPath := rig.Hyperstart.GetSocketPaths()
+	_, err := rig.Client.Hello(testContainerID, ctlSocketPath, ioSocketPath,
+		&api.HelloOptions{
+			Restored: true,
+			IoBase:   5,
+		})
+	assert.Nil(t, err)
+
+	proxy := rig.proxy
+	proxy.Lock()
+	vm := proxy.vms[testContainerID]
+	proxy.Unlock()
+
+	assert.NotNil(t, vm)
+	assert.True(t, vm.restored)
+
+	// Allocations continue from the sequence numbers used before the
+	// checkpoint
+	ioBase, ioFile, err := rig.Client.AllocateIo(2)
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(5), ioBase)
+	ioFile.Close()
+
+	rig.Stop()
+}
+
 func TestBye(t *testing.T) {
 	proto := newProtocol()
 	proto.Handle("hello", helloHandler)
@@ -301,8 +337,9 @@ func TestAttach(t *testing.T) {
 	ret, err := rig.Client.Attach(testContainerID, nil)
 	assert.Nil(t, err)
 
-	// Check that Attach returns the protocol version
+	// Check that Attach returns the protocol version and frame size
 	assert.Equal(t, api.Version, ret.Version)
+	assert.Equal(t, api.MaxFrameSize, ret.MaxFrameSize)
 
 	err = rig.Client.Bye(testContainerID)
 	assert.Nil(t, err)
@@ -342,6 +379,43 @@ func TestHyperPing(t *testing.T) {
 	rig.Stop()
 }
 
+func TestHyperReadFile(t *testing.T) {
+	proto := newProtocol()
+	proto.Handle("hello", helloHandler)
+	proto.Handle("hyper", hyperHandler)
+
+	rig := newTestRig(t, proto)
+	rig.Start()
+
+	ctlSocketPath, ioSocketPath := rig.Hyperstart.GetSocketPaths()
+	_, err := rig.Client.Hello(testContainerID, ctlSocketPath, ioSocketPath, nil)
+	assert.Nil(t, err)
+
+	// readfile is forwarded to hyperstart and the payload of its reply
+	// makes it back to the client. The mock hyperstart acks with an
+	// empty payload.
+	readFile := map[string]string{
+		"container": testContainerID,
+		"file":      "/sys/fs/cgroup/pids/cgroup.procs",
+	}
+	reply, err := rig.Client.HyperWithReply("readfile", readFile)
+	assert.Nil(t, err)
+	assert.NotNil(t, reply)
+	assert.Equal(t, 0, len(reply))
+
+	msgs := rig.Hyperstart.GetLastMessages()
+	assert.Equal(t, 1, len(msgs))
+
+	msg := msgs[0]
+	assert.Equal(t, hyper.INIT_READFILE, int(msg.Code))
+	received := map[string]string{}
+	err = json.Unmarshal(msg.Message, &received)
+	assert.Nil(t, err)
+	assert.Equal(t, readFile, received)
+
+	rig.Stop()
+}
+
 func TestHyperStartpod(t *testing.T) {
 	proto := newProtocol()
 	proto.Handle("hello", helloHandler)
@@ -497,3 +571,122 @@ func TestAllocateIo(t *testing.T) {
 
 	rig.Stop()
 }
+
+func TestAllocateIoFrameSize(t *testing.T) {
+	proto := newProtocol()
+	proto.Handle("hello", helloHandler)
+	proto.Handle("allocateIO", allocateIoHandler)
+
+	rig := newTestRig(t, proto)
+	rig.Start()
+
+	ctlSocketPath, ioSocketPath := rig.Hyperstart.GetSocketPaths()
+	_, err := rig.Client.Hello(testContainerID, ctlSocketPath, ioSocketPath, nil)
+	assert.Nil(t, err)
+
+	// Frames smaller than what hyperstart sends can't be negotiated
+	_, _, _, err = rig.Client.AllocateIoWithFrameSize(1, 1024)
+	assert.NotNil(t, err)
+
+	// Asking for too big frames gives us the maximum supported size
+	_, frameSize, ioFile, err := rig.Client.AllocateIoWithFrameSize(1, 2*api.MaxFrameSize)
+	assert.Nil(t, err)
+	assert.Equal(t, api.MaxFrameSize, frameSize)
+	ioFile.Close()
+
+	// Not asking for a frame size gives us the default one
+	_, frameSize, ioFile, err = rig.Client.AllocateIoWithFrameSize(1, 0)
+	assert.Nil(t, err)
+	assert.Equal(t, api.DefaultFrameSize, frameSize)
+	ioFile.Close()
+
+	_, frameSize, ioFile, err = rig.Client.AllocateIoWithFrameSize(1, 64*1024)
+	assert.Nil(t, err)
+	assert.Equal(t, 64*1024, frameSize)
+	ioFile.Close()
+
+	rig.Stop()
+}
+
+func TestExec(t *testing.T) {
+	proto := newProtocol()
+	proto.Handle("hello", helloHandler)
+	proto.Handle("exec", execHandler)
+
+	rig := newTestRig(t, proto)
+	rig.Start()
+
+	ctlSocketPath, ioSocketPath := rig.Hyperstart.GetSocketPaths()
+	_, err := rig.Client.Hello(testContainerID, ctlSocketPath, ioSocketPath, nil)
+	assert.Nil(t, err)
+
+	// Drop the messages sent to hyperstart so far
+	rig.Hyperstart.GetLastMessages()
+
+	execCmd := hyper.ExecCommand{
+		Container: testContainerID,
+		Process: hyper.Process{
+			Args:    []string{"/bin/true"},
+			Workdir: "/",
+		},
+	}
+
+	// Unknown VM
+	_, _, _, err = rig.Client.Exec("foo", 2, 0, &execCmd)
+	assert.NotNil(t, err)
+
+	// Invalid number of streams
+	_, _, _, err = rig.Client.Exec(testContainerID, 3, 0, &execCmd)
+	assert.NotNil(t, err)
+
+	assert.Equal(t, 0, len(rig.Hyperstart.GetLastMessages()))
+
+	// A single request allocates the I/O streams and starts the process
+	ioBase, frameSize, ioFile, err := rig.Client.Exec(testContainerID, 2,
+		64*1024, &execCmd)
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(1), ioBase)
+	assert.Equal(t, 64*1024, frameSize)
+
+	msgs := rig.Hyperstart.GetLastMessages()
+	assert.Equal(t, 1, len(msgs))
+
+	msg := msgs[0]
+	assert.Equal(t, hyper.INIT_EXECCMD, int(msg.Code))
+	received := hyper.ExecCommand{}
+	err = json.Unmarshal(msg.Message, &received)
+	assert.Nil(t, err)
+	assert.Equal(t, testContainerID, received.Container)
+	assert.Equal(t, execCmd.Process.Args, received.Process.Args)
+	assert.Equal(t, execCmd.Process.Workdir, received.Process.Workdir)
+	assert.Equal(t, ioBase, received.Process.Stdio)
+	assert.Equal(t, ioBase+1, received.Process.Stderr)
+
+	// The I/O fd is routed to the streams given to the process
+	const stdoutData = "stdout\n"
+	rig.Hyperstart.SendIoString(ioBase, stdoutData)
+	seq, data := readIo(t, ioFile)
+	assert.Equal(t, ioBase, seq)
+	assert.Equal(t, stdoutData, string(data))
+
+	ioFile.Close()
+
+	// With a terminal, stdout and stderr share a single stream
+	execCmd.Process.Terminal = true
+	ioBase, _, ioFile, err = rig.Client.Exec(testContainerID, 1, 0, &execCmd)
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(3), ioBase)
+
+	msgs = rig.Hyperstart.GetLastMessages()
+	assert.Equal(t, 1, len(msgs))
+	received = hyper.ExecCommand{}
+	err = json.Unmarshal(msgs[0].Message, &received)
+	assert.Nil(t, err)
+	assert.Equal(t, ioBase, received.Process.Stdio)
+	assert.Equal(t, uint64(0), received.Process.Stderr)
+	assert.True(t, received.Process.Terminal)
+
+	ioFile.Close()
+
+	rig.Stop()
+}
@@ -16,6 +16,7 @@ package main
 
 import (
 	"bufio"
+	"encoding/binary"
 	"encoding/hex"
 	"fmt"
 	"net"
@@ -24,6 +25,19 @@ import (
 
 	"github.com/containers/virtcontainers/hyperstart"
 	"github.com/golang/glog"
+	hyper "github.com/hyperhq/runv/hyperstart/api/json"
+)
+
+const (
+	// Size of the header of an I/O stream frame
+	ioHeaderSize = 12
+
+	// Offset of the frame length in an I/O stream frame header
+	ioHeaderLengthOffset = 8
+
+	// Number of hyperstart I/O messages that can be queued for a client
+	// before ioHyperToClients blocks.
+	ioSessionQueueLength = 128
 )
 
 // Represents a single qemu/hyperstart instance on the system
@@ -43,6 +57,9 @@ type vm struct {
 	// Used to allocate globally unique IO sequence numbers
 	nextIoBase uint64
 
+	// The VM was restored from a checkpoint, hyperstart won't send READY
+	restored bool
+
 	// ios are hashed by their sequence numbers. If 2 sequence numbers are
 	// allocated for one process (stdin/stdout and stderr) both sequence
 	// numbers appear in this map.
@@ -66,8 +83,17 @@ type ioSession struct {
 	// socket connected to the fd sent over to the client
 	client net.Conn
 
-	// Used to wait for per-ioSession goroutines. Currently there's only
-	// one such goroutine, the one reading stdin data from client socket.
+	// Maximum size of the I/O frames, header included, written to client
+	maxFrameSize int
+
+	// I/O messages from hyperstart waiting to be written to client
+	out chan *hyper.TtyMessage
+
+	// Closed when the session is closed
+	done chan interface{}
+
+	// Used to wait for per-ioSession goroutines: the one reading stdin data
+	// from the client socket and the one writing hyperstart data to it.
 	wg sync.WaitGroup
 }
 
@@ -88,6 +114,15 @@ func (vm *vm) setConsole(path string) {
 	vm.console.socketPath = path
 }
 
+// setRestored() marks the VM as restored from a checkpoint. ioBase, if not 0,
+// is the next I/O sequence number to allocate.
+func (vm *vm) setRestored(ioBase uint64) {
+	vm.restored = true
+	if ioBase != 0 {
+		vm.nextIoBase = ioBase
+	}
+}
+
 func (vm *vm) shortName() string {
 	length := 8
 	if len(vm.containerID) < 8 {
@@ -145,22 +180,92 @@ func (vm *vm) ioHyperToClients() {
 			continue
 		}
 
+		select {
+		case session.out <- msg:
+		case <-session.done:
+		}
+	}
+
+	// Having an error on the IO channel read is interpreted as having lost
+	// the VM.
+	vm.signalVMLost()
+	vm.wg.Done()
+}
+
+// writeIoFrame writes a single I/O stream frame to the client.
+func (session *ioSession) writeIoFrame(seq uint64, data []byte) error {
+	frame := make([]byte, ioHeaderSize+len(data))
+	binary.BigEndian.PutUint64(frame[:], seq)
+	binary.BigEndian.PutUint32(frame[ioHeaderLengthOffset:], uint32(len(frame)))
+	copy(frame[ioHeaderSize:], data)
+
+	n, err := session.client.Write(frame)
+	if err != nil {
+		return err
+	}
+
+	if n != len(frame) {
+		return fmt.Errorf("%d bytes written out of %d expected", n, len(frame))
+	}
+
+	return nil
+}
+
+// This function runs in a goroutine, writing the data queued by
+// ioHyperToClients to the client. Data chunks already queued for the same
+// stream are coalesced into frames up to the negotiated frame size.
+//
+// Empty messages (end of stream) and the message following them (the exit
+// status) are always written on their own as clients rely on the frame
+// length to identify them.
+// There's one instance of this goroutine per client having done an allocateIO.
+func (vm *vm) ioHyperToClient(session *ioSession) {
+	var pending *hyper.TtyMessage
+	closed := make(map[uint64]bool)
+
+	defer session.wg.Done()
+
+	for {
+		msg := pending
+		pending = nil
+
+		if msg == nil {
+			select {
+			case msg = <-session.out:
+			case <-session.done:
+				return
+			}
+		}
+
+		data := msg.Message
+		standalone := len(data) == 0 || closed[msg.Session]
+		closed[msg.Session] = len(data) == 0
+
+	coalesce:
+		for !standalone {
+			select {
+			case next := <-session.out:
+				if next.Session != msg.Session || len(next.Message) == 0 ||
+					ioHeaderSize+len(data)+len(next.Message) > session.maxFrameSize {
+					pending = next
+					break coalesce
+				}
+				data = append(data, next.Message...)
+			default:
+				break coalesce
+			}
+		}
+
 		vm.infof(1, "io", "<- writing to client #%d", session.clientID)
-		vm.dump(2, msg.Message)
+		vm.dump(2, data)
 
-		err = hyperstart.SendIoMessageWithConn(session.client, msg)
-		if err != nil {
+		if err := session.writeIoFrame(msg.Session, data); err != nil {
 			// When the shim is forcefully killed, it's possible we
 			// still have data to write. Ignore errors for that case.
 			vm.infof(1, "io", "error writing I/O data to client:", err)
 			continue
 		}
 	}
-
-	// Having an error on the IO channel read is interpreted as having lost
-	// the VM.
-	vm.signalVMLost()
-	vm.wg.Done()
 }
 
 // Stream the VM console to stderr
@@ -195,9 +300,12 @@ func (vm *vm) Connect() error {
 		return err
 	}
 
-	if err := vm.hyperHandler.WaitForReady(); err != nil {
-		vm.hyperHandler.CloseSockets()
-		return err
+	// hyperstart only sends READY once, when the VM boots
+	if !vm.restored {
+		if err := vm.hyperHandler.WaitForReady(); err != nil {
+			vm.hyperHandler.CloseSockets()
+			return err
+		}
 	}
 
 	vm.wg.Add(1)
@@ -206,9 +314,12 @@ func (vm *vm) Connect() error {
 	return nil
 }
 
-func (vm *vm) SendMessage(cmd string, data []byte) error {
-	_, err := vm.hyperHandler.SendCtlMessage(cmd, data)
-	return err
+func (vm *vm) SendMessage(cmd string, data []byte) ([]byte, error) {
+	resp, err := vm.hyperHandler.SendCtlMessage(cmd, data)
+	if err != nil {
+		return nil, err
+	}
+	return resp.Message, nil
 }
 
 // This function runs in a goroutine, reading data from the client socket and
@@ -242,17 +353,20 @@ func (vm *vm) ioClientToHyper(session *ioSession) {
 	session.wg.Done()
 }
 
-func (vm *vm) AllocateIo(n int, clientID uint64, c net.Conn) uint64 {
+func (vm *vm) AllocateIo(n, maxFrameSize int, clientID uint64, c net.Conn) uint64 {
 	// Allocate ioBase
 	vm.Lock()
 	ioBase := vm.nextIoBase
 	vm.nextIoBase += uint64(n)
 
 	session := &ioSession{
-		nStreams: n,
-		ioBase:   ioBase,
-		clientID: clientID,
-		client:   c,
+		nStreams:     n,
+		ioBase:       ioBase,
+		clientID:     clientID,
+		client:       c,
+		maxFrameSize: maxFrameSize,
+		out:          make(chan *hyper.TtyMessage, ioSessionQueueLength),
+		done:         make(chan interface{}),
 	}
 
 	for i := 0; i < n; i++ {
@@ -260,14 +374,17 @@ func (vm *vm) AllocateIo(n int, clientID uint64, c net.Conn) uint64 {
 	}
 	vm.Unlock()
 
-	// Starts stdin forwarding between client and hyper
-	session.wg.Add(1)
+	// Starts stdin forwarding between client and hyper and output
+	// forwarding between hyper and client
+	session.wg.Add(2)
 	go vm.ioClientToHyper(session)
+	go vm.ioHyperToClient(session)
 
 	return ioBase
 }
 
 func (session *ioSession) Close() {
+	close(session.done)
 	session.client.Close()
 	session.wg.Wait()
 }
@@ -0,0 +1,606 @@
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Capture of the workload output to a log file.
+ *
+ * The main loop of the shim only queues the data received from the proxy,
+ * formatting and writing it to disk is done by a separate thread so that
+ * slow storage doesn't delay the forwarding of the other streams.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "logfile.h"
+
+/* Chunk of output data waiting to be written */
+struct log_chunk {
+	struct log_chunk      *next;
+	enum log_file_stream   stream;
+	struct timespec        ts;
+	size_t                 len;
+	char                   data[];
+};
+
+/* Growable buffer used to assemble the records written to the file */
+struct log_buf {
+	char    *data;
+	size_t   len;
+	size_t   size;
+};
+
+static struct {
+	struct log_file_options  options;
+	char                    *path;
+	int                      fd;
+	uint64_t                 size;
+
+	pthread_t                thread;
+	pthread_mutex_t          lock;
+	pthread_cond_t           cond;
+	bool                     running;
+
+	/* Protected by lock */
+	struct log_chunk        *head;
+	struct log_chunk        *tail;
+	size_t                   buffered;
+	uint64_t                 dropped;
+	bool                     stopping;
+
+	/* Only accessed by the writer thread */
+	struct log_buf           out;
+	struct log_buf           partial[LOG_FILE_STREAM_MAX];
+	struct timespec          partial_ts[LOG_FILE_STREAM_MAX];
+} log_file = {
+	.fd   = -1,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static const char *stream_names[LOG_FILE_STREAM_MAX] = {
+	"stdout",
+	"stderr",
+};
+
+/*!
+ * Convert a log format name to a \ref log_file_format
+ *
+ * \param str Format name, "raw" or "json"
+ * \param[out] format \ref log_file_format
+ *
+ * \return true on success, false otherwise
+ */
+bool
+log_file_format_from_str(const char *str, enum log_file_format *format)
+{
+	if (! (str && format)) {
+		return false;
+	}
+
+	if (strcmp(str, "raw") == 0) {
+		*format = LOG_FILE_FORMAT_RAW;
+	} else if (strcmp(str, "json") == 0) {
+		*format = LOG_FILE_FORMAT_JSON;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Append data to a \ref log_buf, growing it as needed
+ *
+ * \param buf \ref log_buf
+ * \param data Data to append
+ * \param len Length of \p data
+ */
+static void
+log_buf_append(struct log_buf *buf, const char *data, size_t len)
+{
+	if (buf->len + len > buf->size) {
+		size_t size = buf->size ? buf->size : BUFSIZ;
+
+		while (size < buf->len + len) {
+			size *= 2;
+		}
+
+		buf->data = realloc(buf->data, size);
+		if (! buf->data) {
+			abort();
+		}
+		buf->size = size;
+	}
+
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+/*!
+ * Open the log file, creating it if needed
+ *
+ * \param truncate Discard the current content of the file
+ *
+ * \return true on success, false otherwise
+ */
+static bool
+log_file_reopen(bool truncate)
+{
+	struct stat st;
+	int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+
+	if (truncate) {
+		flags |= O_TRUNC;
+	}
+
+	log_file.fd = open(log_file.path, flags, 0640);
+	if (log_file.fd == -1) {
+		shim_error("Error opening log file %s: %s\n",
+				log_file.path, strerror(errno));
+		return false;
+	}
+
+	if (fstat(log_file.fd, &st) == -1) {
+		shim_error("Error getting size of log file %s: %s\n",
+				log_file.path, strerror(errno));
+		close(log_file.fd);
+		log_file.fd = -1;
+		return false;
+	}
+
+	log_file.size = (uint64_t)st.st_size;
+
+	return true;
+}
+
+/*!
+ * Rotate the log file: path.N-1 is renamed to path.N, ..., path to
+ * path.1 and a new empty log file is created.
+ *
+ * \return true on success, false otherwise
+ */
+static bool
+log_file_rotate(void)
+{
+	char *from = NULL;
+	char *to = NULL;
+
+	close(log_file.fd);
+	log_file.fd = -1;
+
+	for (unsigned int i = log_file.options.max_files; i > 0; i--) {
+		if (i == 1) {
+			from = strdup(log_file.path);
+		} else if (asprintf(&from, "%s.%u", log_file.path, i - 1) == -1) {
+			from = NULL;
+		}
+
+		if (asprintf(&to, "%s.%u", log_file.path, i) == -1) {
+			to = NULL;
+		}
+
+		if (! (from && to)) {
+			abort();
+		}
+
+		if (rename(from, to) == -1 && errno != ENOENT) {
+			shim_warning("Error renaming log file %s to %s: %s\n",
+					from, to, strerror(errno));
+		}
+
+		free(from);
+		free(to);
+	}
+
+	return log_file_reopen(true);
+}
+
+/*!
+ * Write the records assembled in the output buffer to the log file
+ */
+static void
+log_file_flush(void)
+{
+	size_t  offset = 0;
+	ssize_t ret;
+
+	while (log_file.fd != -1 && offset < log_file.out.len) {
+		ret = write(log_file.fd, log_file.out.data + offset,
+				log_file.out.len - offset);
+		if (ret == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			shim_warning("Error writing to log file %s: %s\n",
+					log_file.path, strerror(errno));
+			break;
+		}
+		offset += (size_t)ret;
+	}
+
+	log_file.size += offset;
+	log_file.out.len = 0;
+}
+
+/*!
+ * Append a JSON escaped string to the output buffer
+ *
+ * \param data String to escape
+ * \param len Length of \p data
+ */
+static void
+log_file_append_json_string(const char *data, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t start = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = (unsigned char)data[i];
+		char esc[6] = { '\\', 0 };
+		size_t esc_len = 2;
+
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		log_buf_append(&log_file.out, data + start, i - start);
+		start = i + 1;
+
+		switch (c) {
+		case '"':
+		case '\\':
+			esc[1] = (char)c;
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			esc[1] = 'u';
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			esc_len = 6;
+			break;
+		}
+
+		log_buf_append(&log_file.out, esc, esc_len);
+	}
+
+	log_buf_append(&log_file.out, data + start, len - start);
+}
+
+/*!
+ * Format a log record and add it to the output buffer, rotating the
+ * log file first if the record doesn't fit.
+ *
+ * \param stream \ref log_file_stream the data was received on
+ * \param ts Time the data was received
+ * \param line Line to log (without the trailing newline)
+ * \param len Length of \p line
+ * \param newline true if \p line was terminated by a newline
+ */
+static void
+log_file_emit(enum log_file_stream stream, const struct timespec *ts,
+		const char *line, size_t len, bool newline)
+{
+	char       timestamp[64];
+	struct tm  tm;
+	size_t     ts_len;
+	uint64_t   max_size = log_file.options.max_size;
+
+	gmtime_r(&ts->tv_sec, &tm);
+	ts_len = strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+	ts_len += (size_t)snprintf(timestamp + ts_len, sizeof(timestamp) - ts_len,
+			".%09ldZ", ts->tv_nsec);
+
+	/* An estimation is good enough to decide whether to rotate */
+	if (max_size && log_file.size + log_file.out.len > 0 &&
+			log_file.size + log_file.out.len + len + ts_len + 32 > max_size) {
+		log_file_flush();
+		log_file_rotate();
+	}
+
+	if (log_file.options.format == LOG_FILE_FORMAT_JSON) {
+		log_buf_append(&log_file.out, "{\"log\":\"", 8);
+		log_file_append_json_string(line, len);
+		if (newline) {
+			log_buf_append(&log_file.out, "\\n", 2);
+		}
+		log_buf_append(&log_file.out, "\",\"stream\":\"", 12);
+		log_buf_append(&log_file.out, stream_names[stream],
+				strlen(stream_names[stream]));
+		log_buf_append(&log_file.out, "\",\"time\":\"", 10);
+		log_buf_append(&log_file.out, timestamp, ts_len);
+		log_buf_append(&log_file.out, "\"}\n", 3);
+	} else {
+		log_buf_append(&log_file.out, timestamp, ts_len);
+		log_buf_append(&log_file.out, " ", 1);
+		log_buf_append(&log_file.out, stream_names[stream],
+				strlen(stream_names[stream]));
+		log_buf_append(&log_file.out, " ", 1);
+		log_buf_append(&log_file.out, line, len);
+		log_buf_append(&log_file.out, "\n", 1);
+	}
+}
+
+/*!
+ * Split a chunk of data into lines and log them. Incomplete lines are
+ * kept until the rest of the line is received.
+ *
+ * \param chunk \ref log_chunk
+ */
+static void
+log_file_process_chunk(const struct log_chunk *chunk)
+{
+	struct log_buf  *partial = &log_file.partial[chunk->stream];
+	const char      *p = chunk->data;
+	const char      *end = chunk->data + chunk->len;
+	const char      *nl;
+
+	while (p < end) {
+		nl = memchr(p, '\n', (size_t)(end - p));
+		if (! nl) {
+			if (! partial->len) {
+				log_file.partial_ts[chunk->stream] = chunk->ts;
+			}
+			log_buf_append(partial, p, (size_t)(end - p));
+
+			if (partial->len >= LOG_FILE_MAX_LINE) {
+				log_file_emit(chunk->stream,
+						&log_file.partial_ts[chunk->stream],
+						partial->data, partial->len, false);
+				partial->len = 0;
+			}
+			break;
+		}
+
+		if (partial->len) {
+			log_buf_append(partial, p, (size_t)(nl - p));
+			log_file_emit(chunk->stream,
+					&log_file.partial_ts[chunk->stream],
+					partial->data, partial->len, true);
+			partial->len = 0;
+		} else {
+			log_file_emit(chunk->stream, &chunk->ts,
+					p, (size_t)(nl - p), true);
+		}
+
+		p = nl + 1;
+	}
+}
+
+/*!
+ * Writer thread: wait for queued chunks and write them to the log file
+ *
+ * \param arg Unused
+ *
+ * \return NULL
+ */
+static void *
+log_file_writer(void *arg)
+{
+	struct log_chunk *chunk;
+	struct log_chunk *next;
+	uint64_t          dropped;
+	bool              stopping;
+
+	(void)arg;
+
+	while (1) {
+		pthread_mutex_lock(&log_file.lock);
+		while (! (log_file.head || log_file.stopping)) {
+			pthread_cond_wait(&log_file.cond, &log_file.lock);
+		}
+
+		chunk = log_file.head;
+		log_file.head = log_file.tail = NULL;
+		log_file.buffered = 0;
+
+		dropped = log_file.dropped;
+		log_file.dropped = 0;
+
+		stopping = log_file.stopping;
+		pthread_mutex_unlock(&log_file.lock);
+
+		if (dropped) {
+			shim_warning("Log buffer full, dropped %"PRIu64" bytes\n",
+					dropped);
+		}
+
+		for (; chunk; chunk = next) {
+			next = chunk->next;
+			log_file_process_chunk(chunk);
+			free(chunk);
+		}
+
+		log_file_flush();
+
+		if (stopping) {
+			break;
+		}
+	}
+
+	/* Log what's left of incomplete lines */
+	for (int i = 0; i < LOG_FILE_STREAM_MAX; i++) {
+		if (log_file.partial[i].len) {
+			log_file_emit((enum log_file_stream)i,
+					&log_file.partial_ts[i],
+					log_file.partial[i].data,
+					log_file.partial[i].len, false);
+		}
+	}
+	log_file_flush();
+
+	return NULL;
+}
+
+/*!
+ * Open the log file and start the writer thread
+ *
+ * \param options \ref log_file_options
+ *
+ * \return true on success, false otherwise
+ */
+bool
+log_file_open(const struct log_file_options *options)
+{
+	sigset_t  all;
+	sigset_t  saved;
+	int       ret;
+
+	if (! (options && options->path) || log_file.running) {
+		return false;
+	}
+
+	log_file.options = *options;
+	log_file.path = strdup(options->path);
+	if (! log_file.path) {
+		abort();
+	}
+
+	if (! log_file_reopen(false)) {
+		return false;
+	}
+
+	/* Signals are handled by the main loop, make sure the writer
+	 * thread doesn't receive any.
+	 */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &saved);
+	ret = pthread_create(&log_file.thread, NULL, log_file_writer, NULL);
+	pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+	if (ret) {
+		shim_error("Error creating log writer thread: %s\n", strerror(ret));
+		close(log_file.fd);
+		log_file.fd = -1;
+		return false;
+	}
+
+	log_file.running = true;
+
+	return true;
+}
+
+/*!
+ * Queue output data to be written to the log file
+ *
+ * Data is dropped if the amount of data waiting to be written
+ * exceeds the configured buffer size.
+ *
+ * \param stream \ref log_file_stream the data was received on
+ * \param data Data to log
+ * \param len Length of \p data
+ *
+ * \return true if the data was queued, false otherwise
+ */
+bool
+log_file_write(enum log_file_stream stream, const char *data, size_t len)
+{
+	struct log_chunk *chunk;
+
+	if (! (log_file.running && data) || stream >= LOG_FILE_STREAM_MAX) {
+		return false;
+	}
+
+	if (! len) {
+		return true;
+	}
+
+	chunk = malloc(sizeof(struct log_chunk) + len);
+	if (! chunk) {
+		abort();
+	}
+
+	chunk->next = NULL;
+	chunk->stream = stream;
+	chunk->len = len;
+	clock_gettime(CLOCK_REALTIME, &chunk->ts);
+	memcpy(chunk->data, data, len);
+
+	pthread_mutex_lock(&log_file.lock);
+
+	if (log_file.buffered + len > log_file.options.max_buffer) {
+		log_file.dropped += len;
+		pthread_mutex_unlock(&log_file.lock);
+		free(chunk);
+		return false;
+	}
+
+	if (log_file.tail) {
+		log_file.tail->next = chunk;
+	} else {
+		log_file.head = chunk;
+	}
+	log_file.tail = chunk;
+	log_file.buffered += len;
+
+	pthread_cond_signal(&log_file.cond);
+	pthread_mutex_unlock(&log_file.lock);
+
+	return true;
+}
+
+/*!
+ * Write all the queued data, stop the writer thread and close the log file
+ */
+void
+log_file_close(void)
+{
+	if (! log_file.running) {
+		return;
+	}
+
+	pthread_mutex_lock(&log_file.lock);
+	log_file.stopping = true;
+	pthread_cond_signal(&log_file.cond);
+	pthread_mutex_unlock(&log_file.lock);
+
+	pthread_join(log_file.thread, NULL);
+	log_file.running = false;
+
+	if (log_file.fd != -1) {
+		close(log_file.fd);
+		log_file.fd = -1;
+	}
+
+	for (int i = 0; i < LOG_FILE_STREAM_MAX; i++) {
+		free(log_file.partial[i].data);
+		log_file.partial[i] = (struct log_buf) { 0 };
+	}
+	free(log_file.out.data);
+	log_file.out = (struct log_buf) { 0 };
+
+	free(log_file.path);
+	log_file.path = NULL;
+}
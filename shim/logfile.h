@@ -0,0 +1,60 @@
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Rotate the log file once it reaches this size */
+#define LOG_FILE_DEFAULT_MAX_SIZE       (10 * 1024 * 1024)
+
+/* Number of rotated log files kept */
+#define LOG_FILE_DEFAULT_MAX_FILES      1
+
+/* Maximum amount of data waiting to be written to the log file.
+ * Data received from the proxy when the limit is reached is dropped.
+ */
+#define LOG_FILE_DEFAULT_MAX_BUFFER     (4 * 1024 * 1024)
+
+/* Lines longer than this are split over several log records */
+#define LOG_FILE_MAX_LINE               (16 * 1024)
+
+enum log_file_format {
+	/* <timestamp> <stream> <line> */
+	LOG_FILE_FORMAT_RAW,
+
+	/* {"log":"<line>","stream":"<stream>","time":"<timestamp>"} */
+	LOG_FILE_FORMAT_JSON,
+};
+
+enum log_file_stream {
+	LOG_FILE_STREAM_STDOUT,
+	LOG_FILE_STREAM_STDERR,
+	LOG_FILE_STREAM_MAX,
+};
+
+struct log_file_options {
+	const char            *path;
+	enum log_file_format   format;
+	uint64_t               max_size;
+	unsigned int           max_files;
+	size_t                 max_buffer;
+};
+
+bool log_file_format_from_str(const char *str, enum log_file_format *format);
+bool log_file_open(const struct log_file_options *options);
+bool log_file_write(enum log_file_stream stream, const char *data, size_t len);
+void log_file_close(void);
@@ -32,10 +32,13 @@
 #include <limits.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <time.h>
+#include <sys/socket.h>
 
 #include "config.h"
 #include "utils.h"
 #include "log.h"
+#include "logfile.h"
 #include "shim.h"
 
 /* globals */
@@ -190,19 +193,21 @@ get_proxy_ctl_msg(const char *json, size_t *len) {
  }
 
 /*!
- * Send "hyper" payload to cc-proxy. This will be forwarded to hyperstart.
+ * Construct a "hyper" payload for cc-proxy in the proxy ctl rpc
+ * protocol format.
  *
- * \param fd File descriptor to send the message to(should be proxy ctl socket fd)
- * \param Hyperstart cmd id
+ * \param hyper_cmd Hyperstart cmd id
  * \param json Json payload
+ * \param[out] len Length of the message
+ *
+ * \return Newly allocated message on success, else \c NULL.
  */
-void
-send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
+static char*
+get_proxy_hyper_msg(const char *hyper_cmd, const char *json, size_t *len) {
 	char      *proxy_payload = NULL;
 	char      *proxy_command_id = "hyper";
 	char      *proxy_ctl_msg = NULL;
-	size_t     len = 0, offset = 0;
-	ssize_t    ret;
+	int        ret;
 
 	/* cc-proxy has the following format for "hyper" payload:
 	 * {
@@ -214,11 +219,10 @@ send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
 	 * }
 	*/
 
-	if ( !json || fd < 0) {
-		return;
+	if ( !(hyper_cmd && json && len)) {
+		return NULL;
 	}
 
-
 	ret = asprintf(&proxy_payload,
 			"{\"id\":\"%s\",\"data\":{\"hyperName\":\"%s\",\"data\":%s}}",
 			proxy_command_id, hyper_cmd, json);
@@ -227,28 +231,250 @@ send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
 		abort();
 	}
 
-	proxy_ctl_msg = get_proxy_ctl_msg(proxy_payload, &len);
+	proxy_ctl_msg = get_proxy_ctl_msg(proxy_payload, len);
 	free(proxy_payload);
 
+	return proxy_ctl_msg;
+}
+
+/*!
+ * Write a complete proxy ctl message to cc-proxy.
+ *
+ * \param fd File descriptor to send the message to(should be proxy ctl socket fd)
+ * \param msg Message in the proxy ctl rpc protocol format
+ * \param len Length of the message
+ *
+ * \return \c true on success, else \c false.
+ */
+static bool
+write_proxy_ctl_msg(int fd, const char *msg, size_t len) {
+	size_t     offset = 0;
+	ssize_t    ret;
+
 	while (offset < len) {
-		ret = write(fd, proxy_ctl_msg + offset, len-offset);
+		ret = write(fd, msg + offset, len-offset);
 		if (ret == -1 && errno == EINTR) {
 			continue;
 		}
 		if (ret <= 0 ) {
-			free(proxy_ctl_msg);
 			shim_error("Error writing to proxy: %s\n", strerror(errno));
-			return;
+			return false;
 		}
 		offset += (size_t)ret;
 	}
+
+	return true;
+}
+
+/*!
+ * Send "hyper" payload to cc-proxy. This will be forwarded to hyperstart.
+ *
+ * \param fd File descriptor to send the message to(should be proxy ctl socket fd)
+ * \param Hyperstart cmd id
+ * \param json Json payload
+ */
+void
+send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
+	char      *proxy_ctl_msg = NULL;
+	size_t     len = 0;
+
+	if ( !json || fd < 0) {
+		return;
+	}
+
+	proxy_ctl_msg = get_proxy_hyper_msg(hyper_cmd, json, &len);
+	if (! proxy_ctl_msg) {
+		return;
+	}
+
+	(void)write_proxy_ctl_msg(fd, proxy_ctl_msg, len);
 	free(proxy_ctl_msg);
 }
 
+/*!
+ * Ask cc-proxy to destroy the pod once the initial workload has exited.
+ *
+ * The request is fire-and-forget: the shim never waits for the pod to be
+ * destroyed and waits at most \ref SHIM_TEARDOWN_TIMEOUT_MS for the request
+ * to be written, so that the exit status can be reported to the container
+ * manager right away. If the request can't be sent in time, the pod is
+ * destroyed by the runtime when the container is deleted.
+ *
+ * \param shim \ref cc_shim
+ */
+static void
+request_pod_teardown(struct cc_shim *shim)
+{
+	char            *msg = NULL;
+	size_t           len = 0, offset = 0;
+	ssize_t          ret;
+	struct timespec  start;
+	struct pollfd    pfd;
+	int64_t          remaining;
+
+	if (! shim || shim->proxy_sock_fd < 0) {
+		return;
+	}
+
+	msg = get_proxy_hyper_msg("destroypod", "\"\"", &len);
+	if (! msg) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (offset < len) {
+		ret = send(shim->proxy_sock_fd, msg + offset, len - offset,
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (ret == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				shim_warning("Error sending pod teardown request: %s\n",
+						strerror(errno));
+				break;
+			}
+
+			remaining = SHIM_TEARDOWN_TIMEOUT_MS -
+				(int64_t)(elapsed_usec(&start) / 1000);
+			if (remaining <= 0) {
+				shim_warning("Timeout sending pod teardown request\n");
+				break;
+			}
+
+			pfd.fd = shim->proxy_sock_fd;
+			pfd.events = POLLOUT;
+			(void)poll(&pfd, 1, (int)remaining);
+			continue;
+		}
+		offset += (size_t)ret;
+	}
+
+	shim_debug("Pod teardown request %s in %"PRIu64" us\n",
+			offset == len ? "sent" : "not sent",
+			elapsed_usec(&start));
+
+	free(msg);
+}
+
+/*!
+ * Send the current terminal window size to the proxy.
+ *
+ * SIGWINCH only marks the window size as pending: the size is read
+ * when the message is sent, so a burst of resizes results in a single
+ * message carrying the latest size. Messages are sent at most once
+ * every \ref SHIM_WINSIZE_MIN_INTERVAL_MS and only when the size has
+ * changed since the last message.
+ *
+ * The message is built in a static buffer: the part preceding the
+ * window size only depends on the I/O sequence number and is generated
+ * once.
+ *
+ * \param shim \ref cc_shim
+ */
+static void
+send_winsize(struct cc_shim *shim)
+{
+	static char        msg[PROXY_CTL_HEADER_SIZE + WINSIZE_MSG_MAX_SIZE];
+	static size_t      prefix_len = 0;
+	struct winsize     ws;
+	size_t             json_len;
+	int                ret;
+
+	if (! (shim && shim->winsize_pending) || shim->proxy_sock_fd < 0) {
+		return;
+	}
+
+	if (shim->winsize_sent &&
+			elapsed_usec(&shim->winsize_time) <
+			SHIM_WINSIZE_MIN_INTERVAL_MS * 1000) {
+		return;
+	}
+
+	shim->winsize_pending = false;
+
+	if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == -1) {
+		shim_warning("Error getting the current window size: %s\n",
+			strerror(errno));
+		return;
+	}
+
+	if (shim->winsize_sent && ws.ws_row == shim->winsize_row &&
+			ws.ws_col == shim->winsize_col) {
+		return;
+	}
+
+	if (! prefix_len) {
+		ret = snprintf(msg + PROXY_CTL_HEADER_SIZE, WINSIZE_MSG_MAX_SIZE,
+				"{\"id\":\"hyper\",\"data\":{\"hyperName\":\"winsize\","
+				"\"data\":{\"seq\":%"PRIu64",\"row\":",
+				shim->io_seq_no);
+		if (ret < 0 || ret >= WINSIZE_MSG_MAX_SIZE) {
+			abort();
+		}
+		prefix_len = (size_t)ret;
+	}
+
+	ret = snprintf(msg + PROXY_CTL_HEADER_SIZE + prefix_len,
+			WINSIZE_MSG_MAX_SIZE - prefix_len,
+			"%u,\"column\":%u}}}", ws.ws_row, ws.ws_col);
+	if (ret < 0 || (size_t)ret >= WINSIZE_MSG_MAX_SIZE - prefix_len) {
+		abort();
+	}
+
+	json_len = prefix_len + (size_t)ret;
+	set_big_endian_32((uint8_t*)msg + PROXY_CTL_HEADER_LENGTH_OFFSET,
+			(uint32_t)json_len);
+
+	shim_debug("Sending window size for container %s (row=%d, column=%d)\n",
+		shim->container_id, ws.ws_row, ws.ws_col);
+
+	if (! write_proxy_ctl_msg(shim->proxy_sock_fd, msg,
+				PROXY_CTL_HEADER_SIZE + json_len)) {
+		return;
+	}
+
+	shim->winsize_sent = true;
+	shim->winsize_row = ws.ws_row;
+	shim->winsize_col = ws.ws_col;
+	clock_gettime(CLOCK_MONOTONIC, &shim->winsize_time);
+}
+
+/*!
+ * Compute the poll timeout needed to send a pending window size.
+ *
+ * \param shim \ref cc_shim
+ *
+ * \return Timeout in milliseconds, \c -1 if no window size is pending.
+ */
+static int
+winsize_poll_timeout(const struct cc_shim *shim)
+{
+	uint64_t elapsed_ms;
+
+	if (! (shim && shim->winsize_pending)) {
+		return -1;
+	}
+
+	if (! shim->winsize_sent) {
+		return 0;
+	}
+
+	elapsed_ms = elapsed_usec(&shim->winsize_time) / 1000;
+	if (elapsed_ms >= SHIM_WINSIZE_MIN_INTERVAL_MS) {
+		return 0;
+	}
+
+	return (int)(SHIM_WINSIZE_MIN_INTERVAL_MS - elapsed_ms);
+}
+
 /*!
  * Read signals received and send message in the hyperstart protocol
  * format to the proxy ctl socket.
  *
+ * Window size changes are coalesced and sent by \ref send_winsize.
+ *
  * \param shim \ref cc_shim
  */
 void
@@ -256,9 +482,6 @@ handle_signals(struct cc_shim *shim) {
 	int                sig;
 	char              *buf;
 	int                ret;
-	char              *cmd = NULL;
-	struct winsize     ws;
-	static char*       cmds[] = { "winsize", "killcontainer"};
 
 	if ( !(shim && shim->container_id) || shim->proxy_sock_fd < 0) {
 		return;
@@ -267,29 +490,22 @@ handle_signals(struct cc_shim *shim) {
 	while (read(signal_pipe_fd[0], &sig, sizeof(sig)) != -1) {
 		shim_debug("Handling signal : %d on fd %d\n", sig, signal_pipe_fd[0]);
 		if (sig == SIGWINCH ) {
-			cmd = cmds[0];
-			if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == -1) {
-				shim_warning("Error getting the current window size: %s\n",
-					strerror(errno));
-				continue;
-			}
-			ret = asprintf(&buf, "{\"seq\":%"PRIu64", \"row\":%d, \"column\":%d}",
-					shim->io_seq_no, ws.ws_row, ws.ws_col);
-			shim_debug("handled SIGWINCH for container %s (row=%d, column=%d)\n",
-				shim->container_id, ws.ws_row, ws.ws_col);
-		} else {
-			cmd = cmds[1];
-			ret = asprintf(&buf, "{\"container\":\"%s\", \"signal\":%d}",
-                                                        shim->container_id, sig);
-			shim_debug("Sending signal %d to container %s\n", sig, shim->container_id);
+			shim->winsize_pending = true;
+			continue;
 		}
+
+		ret = asprintf(&buf, "{\"container\":\"%s\", \"signal\":%d}",
+				shim->container_id, sig);
 		if (ret == -1) {
 			abort();
 		}
+		shim_debug("Sending signal %d to container %s\n", sig, shim->container_id);
 
-		send_proxy_hyper_message(shim->proxy_sock_fd, cmd, buf);
+		send_proxy_hyper_message(shim->proxy_sock_fd, "killcontainer", buf);
 		free(buf);
-        }
+	}
+
+	send_winsize(shim);
 }
 
 /*!
@@ -297,22 +513,33 @@ handle_signals(struct cc_shim *shim) {
  * and send it to proxy I/O channel
  * Reference : https://github.com/hyperhq/runv/blob/master/hypervisor/tty.go#L448
  *
+ * Data is read in chunks of up to \ref STDIN_READ_BUF_SIZE bytes and
+ * split into stream frames no larger than hyperstart can accept. All
+ * frame headers and payloads are then sent with a single writev call.
+ *
  * \param shim \ref cc_shim
  */
 void
 handle_stdin(struct cc_shim *shim)
 {
 	ssize_t        nread;
-	int            ret;
-	ssize_t        len;
-	static uint8_t buf[BUFSIZ+STREAM_HEADER_SIZE];
+	size_t         offset = 0;
+	size_t         payload_len;
+	int            frames = 0;
+	int            iovcnt = 0;
+	static uint8_t buf[STDIN_READ_BUF_SIZE];
+	static uint8_t headers[STDIN_MAX_FRAMES][STREAM_HEADER_SIZE];
+	struct iovec   iov[STDIN_MAX_FRAMES * 2];
 
 	if (! shim || shim->proxy_io_fd < 0) {
 		return;
 	}
 
-	nread = read(STDIN_FILENO , buf+STREAM_HEADER_SIZE, BUFSIZ);
+	nread = read(STDIN_FILENO , buf, sizeof(buf));
 	if (nread < 0) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return;
+		}
 		shim_warning("Error while reading stdin char :%s\n", strerror(errno));
 		return;
 	} else if (nread == 0) {
@@ -322,13 +549,36 @@ handle_stdin(struct cc_shim *shim)
 		poll_fds[STDIN_INDEX].fd = -1;
 	}
 
-	len = nread + STREAM_HEADER_SIZE;
-	set_big_endian_64 (buf, shim->io_seq_no);
-	set_big_endian_32 (buf + STREAM_HEADER_LENGTH_OFFSET, (uint32_t)len);
+	/* An empty read still results in a single (header only) frame
+	 * to signal EOF.
+	 */
+	do {
+		uint8_t *header = headers[frames++];
+
+		payload_len = (size_t)nread - offset;
+		if (payload_len > STDIN_MAX_FRAME_PAYLOAD) {
+			payload_len = STDIN_MAX_FRAME_PAYLOAD;
+		}
+
+		set_big_endian_64 (header, shim->io_seq_no);
+		set_big_endian_32 (header + STREAM_HEADER_LENGTH_OFFSET,
+				(uint32_t)(payload_len + STREAM_HEADER_SIZE));
+
+		iov[iovcnt].iov_base = header;
+		iov[iovcnt].iov_len = STREAM_HEADER_SIZE;
+		iovcnt++;
+
+		if (payload_len) {
+			iov[iovcnt].iov_base = buf + offset;
+			iov[iovcnt].iov_len = payload_len;
+			iovcnt++;
+		}
+
+		offset += payload_len;
+	} while (offset < (size_t)nread);
 
 	// TODO: handle write in the poll loop to account for write blocking
-	ret = (int)write(shim->proxy_io_fd, buf, (size_t)len);
-	if (ret == -1) {
+	if (! write_all_iov(shim->proxy_io_fd, iov, iovcnt)) {
 		shim_warning("Error writing from fd %d to fd %d: %s\n",
 			     STDIN_FILENO, shim->proxy_io_fd, strerror(errno));
 		return;
@@ -349,12 +599,14 @@ read_IO_message(struct cc_shim *shim, uint64_t *seq, ssize_t *stream_len) {
 	char *buf = NULL;
 	ssize_t need_read = STREAM_HEADER_SIZE;
 	ssize_t bytes_read = 0, want, ret;
-	ssize_t max_bytes = HYPERSTART_MAX_RECV_BYTES;
+	ssize_t max_bytes;
 
 	if (! (shim && seq && stream_len)) {
 		return NULL;
 	}
 
+	max_bytes = (ssize_t)shim->max_frame_size;
+
 	*stream_len = 0;
 
 	buf = calloc(STREAM_HEADER_SIZE, 1);
@@ -364,9 +616,6 @@ read_IO_message(struct cc_shim *shim, uint64_t *seq, ssize_t *stream_len) {
 
 	while (bytes_read < need_read) {
 		want = need_read - bytes_read;
-		if (want > BUFSIZ)  {
-			want = BUFSIZ;
-		}
 
 		ret = read(shim->proxy_io_fd, buf+bytes_read, (size_t)want);
 		if (ret == -1) {
@@ -392,7 +641,7 @@ read_IO_message(struct cc_shim *shim, uint64_t *seq, ssize_t *stream_len) {
 			if (*stream_len > max_bytes) {
 				shim_error("message too big (limit is %lu, but proxy returned %lu)",
 						(unsigned long int)max_bytes,
-						(unsigned long int)stream_len);
+						(unsigned long int)*stream_len);
 				goto err;
 			}
 
@@ -434,7 +683,7 @@ handle_proxy_output(struct cc_shim *shim)
 	}
 
 	buf = read_IO_message(shim, &seq, &stream_len);
-	if ((! buf) || (stream_len <= 0) || (stream_len > HYPERSTART_MAX_RECV_BYTES)) {
+	if ((! buf) || (stream_len <= 0) || (stream_len > (ssize_t)shim->max_frame_size)) {
 		shim_error("Misbehaving proxy. Exiting");
 		exit(EXIT_FAILURE);
 	}
@@ -451,18 +700,32 @@ handle_proxy_output(struct cc_shim *shim)
 
 	if (!shim->exiting && stream_len == STREAM_HEADER_SIZE) {
 		shim->exiting = true;
+		clock_gettime(CLOCK_MONOTONIC, &shim->exiting_time);
 		goto out;
 	} else if (shim->exiting && stream_len == (STREAM_HEADER_SIZE+1)) {
+		code = *(buf + STREAM_HEADER_SIZE); 	// hyperstart has sent the exit status
+		shim_debug("Exit status for container: %d (received %"PRIu64
+				" us after end of stream)\n",
+				code, elapsed_usec(&shim->exiting_time));
 		if (shim->initial_workload) {
-			send_proxy_hyper_message(shim->proxy_sock_fd, "destroypod", "\"\"");
+			request_pod_teardown(shim);
 		}
-		code = *(buf + STREAM_HEADER_SIZE); 	// hyperstart has sent the exit status
-		shim_debug("Exit status for container: %d\n", code);
 		free(buf);
 		restore_terminal();
+		shim_debug("Exiting %"PRIu64" us after end of stream\n",
+				elapsed_usec(&shim->exiting_time));
 		exit(code);
 	}
 
+	if (shim->log_to_file) {
+		/* output is written to disk by the log writer thread */
+		log_file_write(outfd == STDOUT_FILENO ?
+				LOG_FILE_STREAM_STDOUT : LOG_FILE_STREAM_STDERR,
+				buf + STREAM_HEADER_SIZE,
+				(size_t)(stream_len - STREAM_HEADER_SIZE));
+		goto out;
+	}
+
 	/* TODO: what if writing to stdout/err blocks? Add this to the poll loop
 	 * to watch out for EPOLLOUT
 	 */
@@ -551,6 +814,12 @@ print_usage(void) {
         printf("  -d,  --debug            Enable debug output\n");
         printf("  -h,  --help             Display this help message\n");
         printf("  -w,  --initial-workload This instance represents the initial workload and will destroy the VM when it finishes\n");
+        printf("  -m,  --max-frame-size   Maximum size of the I/O frames negotiated with cc-proxy\n");
+        printf("  -l,  --log-file         Write stdout and stderr to this file instead of forwarding them\n");
+        printf("  -L,  --log-format       Format of the log file: json (default) or raw\n");
+        printf("  -z,  --log-max-size     Size in bytes at which the log file is rotated (0 to disable rotation)\n");
+        printf("  -n,  --log-max-files    Number of rotated log files to keep\n");
+        printf("  -b,  --log-max-buffer   Maximum amount of output in bytes buffered in memory for the log file\n");
         printf("  -v,  --version          Show version\n");
 }
 
@@ -565,12 +834,20 @@ main(int argc, char **argv)
 		.err_seq_no       =  0,
 		.exiting          =  false,
 		.initial_workload =  false,
+		.max_frame_size   =  HYPERSTART_MAX_RECV_BYTES,
 	};
 	int                ret;
 	struct sigaction   sa;
 	int                c;
 	bool               debug = false;
 	long long          val;
+	struct log_file_options log_options = {
+		.path       = NULL,
+		.format     = LOG_FILE_FORMAT_JSON,
+		.max_size   = LOG_FILE_DEFAULT_MAX_SIZE,
+		.max_files  = LOG_FILE_DEFAULT_MAX_FILES,
+		.max_buffer = LOG_FILE_DEFAULT_MAX_BUFFER,
+	};
 
 	program_name = argv[0];
 
@@ -583,11 +860,17 @@ main(int argc, char **argv)
 		{"debug", no_argument, 0, 'd'},
 		{"help", no_argument, 0, 'h'},
 		{"initial-workload", no_argument, 0, 'w'},
+		{"max-frame-size", required_argument, 0, 'm'},
+		{"log-file", required_argument, 0, 'l'},
+		{"log-format", required_argument, 0, 'L'},
+		{"log-max-size", required_argument, 0, 'z'},
+		{"log-max-files", required_argument, 0, 'n'},
+		{"log-max-buffer", required_argument, 0, 'b'},
 		{"version", no_argument, no_argument, 'v'},
 		{ 0, 0, 0, 0},
 	};
 
-	while ((c = getopt_long(argc, argv, "c:p:o:s:e:dhwv", prog_opts, NULL))!= -1) {
+	while ((c = getopt_long(argc, argv, "c:p:o:s:e:m:l:L:z:n:b:dhwv", prog_opts, NULL))!= -1) {
 		switch (c) {
 			case 'c':
 				shim.container_id = strdup(optarg);
@@ -618,6 +901,44 @@ main(int argc, char **argv)
 				}
 				shim.err_seq_no = (uint64_t)val;
 				break;
+			case 'm':
+				val = parse_numeric_option(optarg);
+				if (val < HYPERSTART_MAX_RECV_BYTES ||
+						val > SHIM_MAX_FRAME_SIZE) {
+					err_exit("Invalid value for maximum frame size\n");
+				}
+				shim.max_frame_size = (uint32_t)val;
+				break;
+			case 'l':
+				log_options.path = optarg;
+				break;
+			case 'L':
+				if (! log_file_format_from_str(optarg,
+							&log_options.format)) {
+					err_exit("Invalid value for log format\n");
+				}
+				break;
+			case 'z':
+				val = parse_numeric_option(optarg);
+				if (val == -1) {
+					err_exit("Invalid value for log maximum size\n");
+				}
+				log_options.max_size = (uint64_t)val;
+				break;
+			case 'n':
+				val = parse_numeric_option(optarg);
+				if (val < 0 || val > UINT_MAX) {
+					err_exit("Invalid value for log maximum files\n");
+				}
+				log_options.max_files = (unsigned int)val;
+				break;
+			case 'b':
+				val = parse_numeric_option(optarg);
+				if (val <= 0) {
+					err_exit("Invalid value for log maximum buffer\n");
+				}
+				log_options.max_buffer = (size_t)val;
+				break;
 			case 'd':
 				debug = true;
 				break;
@@ -666,6 +987,19 @@ main(int argc, char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	if (log_options.path) {
+		if (! log_file_open(&log_options)) {
+			exit(EXIT_FAILURE);
+		}
+		shim.log_to_file = true;
+
+		/* flush the captured output when the workload exits */
+		ret = atexit(log_file_close);
+		if (ret) {
+			shim_debug("Could not register function for atexit");
+		}
+	}
+
 	/* Using self pipe trick to handle signals in the main loop, other strategy
 	 * would be to clock signals and use signalfd()/ to handle signals synchronously
 	 */
@@ -728,12 +1062,15 @@ main(int argc, char **argv)
 	}
 
 	while (1) {
-		ret = poll(poll_fds, MAX_POLL_FDS, -1);
+		ret = poll(poll_fds, MAX_POLL_FDS, winsize_poll_timeout(&shim));
 		if (ret == -1 && errno != EINTR) {
 			shim_error("Error in poll : %s\n", strerror(errno));
 			break;
 		}
 
+		// send a window size change held back by the rate limit
+		send_winsize(&shim);
+
 		/* check if signal was received first */
 		if (poll_fds[SIGNAL_FD_INDEX].revents != 0) {
 			handle_signals(&shim);
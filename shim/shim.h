@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <stdio.h>
+#include <time.h>
 
 /* The shim would be handling fixed number of predefined fds.
  * This would be signal fd, stdin fd, proxy socket fd and an I/O
@@ -27,7 +28,19 @@ struct cc_shim {
 	uint64_t    io_seq_no;
 	uint64_t    err_seq_no;
 	bool        exiting;
+	struct timespec exiting_time;
 	bool        initial_workload;
+	uint32_t    max_frame_size;
+	bool        log_to_file;
+
+	/* Window size change waiting to be sent to the proxy */
+	bool        winsize_pending;
+
+	/* Last window size sent to the proxy */
+	bool        winsize_sent;
+	unsigned short winsize_row;
+	unsigned short winsize_col;
+	struct timespec winsize_time;
 };
 
 /*
@@ -60,3 +73,46 @@ struct cc_shim {
  */
 #define HYPERSTART_MAX_RECV_BYTES       10240
 
+/*
+ * Maximum time the shim waits for the pod teardown request to be
+ * written to cc-proxy before exiting with the workload exit status.
+ */
+#define SHIM_TEARDOWN_TIMEOUT_MS        100
+
+/*
+ * Minimum interval between two window size messages sent to cc-proxy.
+ * Window size changes received in between are coalesced and only the
+ * latest size is sent.
+ */
+#define SHIM_WINSIZE_MIN_INTERVAL_MS    50
+
+/*
+ * Size of the buffer holding the json payload of a window size message.
+ */
+#define WINSIZE_MSG_MAX_SIZE            128
+
+/*
+ * Largest I/O frame the shim accepts from the proxy. The actual
+ * limit is negotiated by the runtime with the proxy and passed
+ * with --max-frame-size, defaulting to HYPERSTART_MAX_RECV_BYTES.
+ */
+#define SHIM_MAX_FRAME_SIZE             (1024 * 1024)
+
+/*
+ * Maximum payload carried by a single stdin stream frame.
+ */
+#define STDIN_MAX_FRAME_PAYLOAD         (HYPERSTART_MAX_RECV_BYTES - STREAM_HEADER_SIZE)
+
+/*
+ * Number of bytes read from stdin in one go. The data read is split
+ * into frames of at most STDIN_MAX_FRAME_PAYLOAD bytes which are then
+ * written to the proxy using a single writev call.
+ */
+#define STDIN_READ_BUF_SIZE             (64 * 1024)
+
+/*
+ * Number of frames needed to send STDIN_READ_BUF_SIZE bytes.
+ */
+#define STDIN_MAX_FRAMES                ((STDIN_READ_BUF_SIZE + STDIN_MAX_FRAME_PAYLOAD - 1) \
+						/ STDIN_MAX_FRAME_PAYLOAD)
+
@@ -19,6 +19,8 @@
 #include <string.h>
 #include <errno.h>
 #include <signal.h>
+#include <sys/uio.h>
+#include <time.h>
 
 #include "log.h"
 #include "utils.h"
@@ -152,3 +154,74 @@ get_big_endian_64(const uint8_t *buf)
 	val = ((uint64_t)get_big_endian_32(buf) << 32) | get_big_endian_32(buf+4);
 	return val;
 }
+
+/*!
+ * Write all the buffers described by \p iov to \p fd, retrying on
+ * partial writes and interrupted system calls.
+ *
+ * \note The contents of \p iov are modified.
+ *
+ * \param fd File descriptor to write to
+ * \param iov Array of buffers to write
+ * \param iovcnt Number of elements in \p iov
+ *
+ * \return true on success, false otherwise
+ */
+bool
+write_all_iov(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t ret;
+
+	if (fd < 0 || ! iov) {
+		return false;
+	}
+
+	while (iovcnt > 0) {
+		ret = writev(fd, iov, iovcnt);
+		if (ret == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		/* skip the buffers that were completely written */
+		while (iovcnt > 0 && (size_t)ret >= iov->iov_len) {
+			ret -= (ssize_t)iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + ret;
+			iov->iov_len -= (size_t)ret;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * Compute the time elapsed since \p start
+ *
+ * \param start Start time, read from the CLOCK_MONOTONIC clock
+ *
+ * \return Elapsed time in microseconds
+ */
+uint64_t
+elapsed_usec(const struct timespec *start)
+{
+	struct timespec now;
+	int64_t usec;
+
+	if (! start) {
+		return 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	usec = (int64_t)(now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+
+	return usec > 0 ? (uint64_t)usec : 0;
+}
@@ -15,6 +15,9 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include <time.h>
 
 extern int shim_signal_table[];
 
@@ -23,3 +26,5 @@ void set_big_endian_32(uint8_t *buf, uint32_t val);
 uint32_t get_big_endian_32(const uint8_t *buf);
 void set_big_endian_64(uint8_t *buf, uint64_t val);
 uint64_t get_big_endian_64(const uint8_t *buf);
+bool write_all_iov(int fd, struct iovec *iov, int iovcnt);
+uint64_t elapsed_usec(const struct timespec *start);
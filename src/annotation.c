@@ -18,6 +18,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <errno.h>
+#include <string.h>
+
 #include "annotation.h"
 #include "common.h"
 
@@ -77,3 +80,154 @@ cc_oci_annotations_to_json (const struct cc_oci_config *config)
         return obj;
 }
 
+
+/*!
+ * Find the value of an annotation.
+ *
+ * \param annotations List of \ref oci_cfg_annotation.
+ * \param key Annotation key.
+ *
+ * \return Annotation value (owned by \p annotations), or \c NULL if
+ * not found or if the annotation has no value.
+ */
+const gchar *
+cc_oci_annotation_get (GSList *annotations, const gchar *key)
+{
+	GSList *l;
+
+	if (! key) {
+		return NULL;
+	}
+
+	for (l = annotations; l; l = g_slist_next (l)) {
+		struct oci_cfg_annotation *a = (struct oci_cfg_annotation *)l->data;
+
+		if (a && ! g_strcmp0 (a->key, key)) {
+			return a->value;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * Find the value of an annotation holding an unsigned number.
+ *
+ * \param annotations List of \ref oci_cfg_annotation.
+ * \param key Annotation key.
+ * \param min Minimum valid value.
+ * \param max Maximum valid value.
+ *
+ * \return Annotation value (owned by \p annotations), or \c NULL if
+ * not found or if the value is not a valid number.
+ */
+private const gchar *
+cc_oci_annotation_get_number (GSList *annotations, const gchar *key,
+		guint64 min, guint64 max)
+{
+	const gchar *value;
+	gchar       *endptr = NULL;
+	guint64      num;
+
+	value = cc_oci_annotation_get (annotations, key);
+	if (! value) {
+		return NULL;
+	}
+
+	errno = 0;
+	num = g_ascii_strtoull (value, &endptr, 10);
+
+	if (! g_ascii_isdigit (*value) || errno || *endptr
+			|| num < min || num > max) {
+		g_warning ("ignoring invalid %s annotation: %s", key, value);
+		return NULL;
+	}
+
+	return value;
+}
+
+/*!
+ * Get the shim log capture options from the annotations.
+ *
+ * Invalid optional values, including numbers outside the range
+ * the shim accepts, are ignored so that the shim uses its default
+ * for them.
+ *
+ * \param annotations List of \ref oci_cfg_annotation.
+ * \param[out] options \ref cc_oci_shim_log_options.
+ *
+ * \return \c true if shim log capture is requested, else \c false.
+ */
+gboolean
+cc_oci_annotations_get_shim_log_options (GSList *annotations,
+		struct cc_oci_shim_log_options *options)
+{
+	if (! options) {
+		return false;
+	}
+
+	memset (options, 0, sizeof (*options));
+
+	options->path = cc_oci_annotation_get (annotations,
+			CC_OCI_ANNOTATION_SHIM_LOG_PATH);
+	if (! options->path) {
+		return false;
+	}
+
+	if (! g_path_is_absolute (options->path)) {
+		g_critical ("ignoring %s annotation, path must be absolute: %s",
+				CC_OCI_ANNOTATION_SHIM_LOG_PATH, options->path);
+		options->path = NULL;
+		return false;
+	}
+
+	options->format = cc_oci_annotation_get (annotations,
+			CC_OCI_ANNOTATION_SHIM_LOG_FORMAT);
+	if (options->format && g_strcmp0 (options->format, "json")
+			&& g_strcmp0 (options->format, "raw")) {
+		g_warning ("ignoring invalid %s annotation: %s",
+				CC_OCI_ANNOTATION_SHIM_LOG_FORMAT, options->format);
+		options->format = NULL;
+	}
+
+	options->max_size = cc_oci_annotation_get_number (annotations,
+			CC_OCI_ANNOTATION_SHIM_LOG_MAX_SIZE, 0, G_MAXLONG);
+	options->max_files = cc_oci_annotation_get_number (annotations,
+			CC_OCI_ANNOTATION_SHIM_LOG_MAX_FILES, 0, G_MAXUINT);
+	options->max_buffer = cc_oci_annotation_get_number (annotations,
+			CC_OCI_ANNOTATION_SHIM_LOG_MAX_BUFFER, 1, G_MAXLONG);
+
+	return true;
+}
+
+/*!
+ * Determine if poststart and poststop hooks should run asynchronously,
+ * as requested by the \ref CC_OCI_ANNOTATION_HOOKS_ASYNC annotation.
+ *
+ * \param annotations List of \ref oci_cfg_annotation.
+ *
+ * \return \c true if the hooks should not block the container
+ * lifecycle, else \c false.
+ */
+gboolean
+cc_oci_annotations_get_hooks_async (GSList *annotations)
+{
+	const gchar *value;
+
+	value = cc_oci_annotation_get (annotations,
+			CC_OCI_ANNOTATION_HOOKS_ASYNC);
+	if (! value) {
+		return false;
+	}
+
+	if (! g_strcmp0 (value, "true")) {
+		return true;
+	}
+
+	if (g_strcmp0 (value, "false")) {
+		g_warning ("ignoring invalid %s annotation: %s",
+				CC_OCI_ANNOTATION_HOOKS_ASYNC, value);
+	}
+
+	return false;
+}
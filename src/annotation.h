@@ -30,7 +30,50 @@
 #include "util.h"
 #include "oci.h"
 
+/** Annotation prefix for the shim log capture options. */
+#define CC_OCI_ANNOTATION_SHIM_LOG_PREFIX     "com.intel.clearcontainers.shim.log."
+
+/** Path of the file the shim writes the workload output to. */
+#define CC_OCI_ANNOTATION_SHIM_LOG_PATH       CC_OCI_ANNOTATION_SHIM_LOG_PREFIX "path"
+
+/** Format of the log file: "json" or "raw". */
+#define CC_OCI_ANNOTATION_SHIM_LOG_FORMAT     CC_OCI_ANNOTATION_SHIM_LOG_PREFIX "format"
+
+/** Size in bytes at which the log file is rotated. */
+#define CC_OCI_ANNOTATION_SHIM_LOG_MAX_SIZE   CC_OCI_ANNOTATION_SHIM_LOG_PREFIX "max-size"
+
+/** Number of rotated log files to keep. */
+#define CC_OCI_ANNOTATION_SHIM_LOG_MAX_FILES  CC_OCI_ANNOTATION_SHIM_LOG_PREFIX "max-files"
+
+/** Maximum amount of output in bytes the shim buffers in memory. */
+#define CC_OCI_ANNOTATION_SHIM_LOG_MAX_BUFFER CC_OCI_ANNOTATION_SHIM_LOG_PREFIX "max-buffer"
+
+/**
+ * If "true", poststart and poststop hooks run detached from the
+ * runtime, with their output written to the container log.
+ */
+#define CC_OCI_ANNOTATION_HOOKS_ASYNC         "com.intel.clearcontainers.hooks.async"
+
+/**
+ * Shim log capture options, as specified by the
+ * \ref CC_OCI_ANNOTATION_SHIM_LOG_PREFIX annotations.
+ *
+ * All values point to annotation values, \c NULL when the
+ * annotation is not set (the shim uses its defaults).
+ */
+struct cc_oci_shim_log_options {
+	const gchar *path;
+	const gchar *format;
+	const gchar *max_size;
+	const gchar *max_files;
+	const gchar *max_buffer;
+};
+
 void cc_oci_annotations_free_all (GSList *annotations);
 JsonObject *cc_oci_annotations_to_json (const struct cc_oci_config *config);
+const gchar *cc_oci_annotation_get (GSList *annotations, const gchar *key);
+gboolean cc_oci_annotations_get_shim_log_options (GSList *annotations,
+		struct cc_oci_shim_log_options *options);
+gboolean cc_oci_annotations_get_hooks_async (GSList *annotations);
 
 #endif /* _CC_OCI_ANNOTATION_H */
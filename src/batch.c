@@ -0,0 +1,385 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Run a command against many containers in one invocation.
+ *
+ * Each container is handled by a forked worker process, exactly as if
+ * the runtime had been run once per container, but logging is set up
+ * and the configuration loaded only once. At most "jobs" workers run
+ * at a time.
+ *
+ * Workers write to stderr rather than stdout since the result of the
+ * batch, a JSON array with an object per container, is written to
+ * stdout.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "oci.h"
+#include "common.h"
+#include "util.h"
+#include "logging.h"
+#include "state.h"
+#include "runtime.h"
+#include "batch.h"
+
+/*!
+ * Handle a single container of a batch.
+ *
+ * Called in the worker process; never returns.
+ *
+ * \param parent \ref cc_oci_config of the batch.
+ * \param id Container id.
+ * \param func \ref cc_oci_batch_func.
+ * \param user_data Data for \p func.
+ */
+static void
+cc_oci_batch_worker (const struct cc_oci_config *parent, const gchar *id,
+		cc_oci_batch_func func, gpointer user_data)
+{
+	struct cc_oci_config  *config;
+	gboolean               ret = false;
+
+	/* keep stdout for the results */
+	if (dup2 (STDERR_FILENO, STDOUT_FILENO) < 0) {
+		goto out;
+	}
+
+	config = cc_oci_config_create ();
+	if (! config) {
+		goto out;
+	}
+
+	if (parent->root_dir) {
+		config->root_dir = g_strdup (parent->root_dir);
+	}
+
+	config->state.sync = parent->state.sync;
+	config->optarg_container_id = id;
+
+	ret = func (config, user_data);
+
+	cc_oci_config_free (config);
+
+out:
+	fflush (NULL);
+	cc_oci_log_flush ();
+	_exit (ret ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*!
+ * Wait for a worker to finish.
+ *
+ * Other children of the process which finish meanwhile are reaped
+ * but otherwise ignored.
+ *
+ * \param[in,out] pids Process ID of the worker for each container
+ * (reset to \c 0 once the worker has been reaped).
+ * \param results Result for each container.
+ * \param count Number of containers.
+ *
+ * \return \c true if a worker finished, \c false if there are no
+ * children left.
+ */
+static gboolean
+cc_oci_batch_wait (GPid *pids, gboolean *results, guint count)
+{
+	int    status;
+	pid_t  pid;
+
+	while (true) {
+		do {
+			pid = waitpid (-1, &status, 0);
+		} while (pid < 0 && errno == EINTR);
+
+		if (pid < 0) {
+			return false;
+		}
+
+		for (guint i = 0; i < count; i++) {
+			if (pids[i] == pid) {
+				results[i] = WIFEXITED (status) &&
+					WEXITSTATUS (status) == EXIT_SUCCESS;
+				pids[i] = 0;
+				return true;
+			}
+		}
+
+		g_debug ("ignoring child %d, not a batch worker", (int)pid);
+	}
+}
+
+/*!
+ * Remove duplicates from a list of container ids, so that a container
+ * is never handled by two workers at once.
+ *
+ * \param ids \c GSList of container ids.
+ *
+ * \return \c GSList of the first occurrence of each id in \p ids (the
+ * ids themselves are not copied).
+ */
+private GSList *
+cc_oci_batch_unique_ids (GSList *ids)
+{
+	GHashTable  *seen;
+	GSList      *unique = NULL;
+
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (GSList *l = ids; l; l = g_slist_next (l)) {
+		if (! g_hash_table_add (seen, l->data)) {
+			g_debug ("ignoring duplicate container %s",
+					(gchar *)l->data);
+			continue;
+		}
+
+		unique = g_slist_prepend (unique, l->data);
+	}
+
+	g_hash_table_destroy (seen);
+
+	return g_slist_reverse (unique);
+}
+
+/*!
+ * Display the results of a batch as a JSON array.
+ *
+ * \param ids Container ids.
+ * \param results Result for each container.
+ */
+static void
+cc_oci_batch_show_results (GSList *ids, const gboolean *results)
+{
+	JsonArray  *array;
+	gchar      *str;
+	guint       i = 0;
+
+	array = json_array_new ();
+
+	for (GSList *l = ids; l; l = g_slist_next (l), i++) {
+		JsonObject *obj = json_object_new ();
+
+		json_object_set_string_member (obj, "id", l->data);
+		json_object_set_boolean_member (obj, "success", results[i]);
+		json_array_add_object_element (array, obj);
+	}
+
+	str = cc_oci_json_arr_to_string (array, false);
+	if (str) {
+		g_print ("%s\n", str);
+		g_free (str);
+	}
+
+	json_array_unref (array);
+}
+
+/*!
+ * Run \p func for each of the containers in \p ids, displaying the
+ * result for each container as JSON.
+ *
+ * Containers listed more than once are only handled once.
+ *
+ * \param config \ref cc_oci_config of the command.
+ * \param ids \c GSList of container ids.
+ * \param jobs Maximum number of containers to handle concurrently
+ * (\c 0 for the number of processors).
+ * \param func \ref cc_oci_batch_func.
+ * \param user_data Data for \p func.
+ *
+ * \return \c true if \p func succeeded for all containers,
+ * else \c false.
+ */
+gboolean
+cc_oci_batch_run (const struct cc_oci_config *config,
+		GSList *ids, guint jobs,
+		cc_oci_batch_func func, gpointer user_data)
+{
+	GPid      *pids;
+	gboolean  *results;
+	GSList    *unique;
+	GSList    *next;
+	guint      count;
+	guint      running = 0;
+	guint      i = 0;
+	gboolean   ret = true;
+
+	if (! (config && func)) {
+		return false;
+	}
+
+	if (! jobs) {
+		jobs = g_get_num_processors ();
+	}
+
+	unique = cc_oci_batch_unique_ids (ids);
+	count = g_slist_length (unique);
+	pids = g_new0 (GPid, count);
+	results = g_new0 (gboolean, count);
+
+	g_debug ("running batch of %u containers (%u jobs)", count, jobs);
+
+	/* don't let the workers flush our buffered output */
+	fflush (NULL);
+
+	for (next = unique; next || running; ) {
+		while (next && running < jobs) {
+			GPid pid = fork ();
+
+			if (pid < 0) {
+				g_critical ("failed to fork: %s",
+						strerror (errno));
+			} else if (pid == 0) {
+				cc_oci_batch_worker (config, next->data,
+						func, user_data);
+			} else {
+				pids[i] = pid;
+				running++;
+			}
+
+			next = g_slist_next (next);
+			i++;
+		}
+
+		if (! running) {
+			break;
+		}
+
+		if (! cc_oci_batch_wait (pids, results, count)) {
+			break;
+		}
+
+		running--;
+	}
+
+	for (i = 0; i < count; i++) {
+		ret &= results[i];
+	}
+
+	cc_oci_batch_show_results (unique, results);
+
+	g_slist_free (unique);
+	g_free (pids);
+	g_free (results);
+
+	return ret;
+}
+
+/*!
+ * Determine if \p annotations match \p label.
+ *
+ * \param annotations \c GSList of \ref oci_cfg_annotation.
+ * \param label Either "key" (matching any annotation called "key") or
+ * "key=value" (matching only if its value is "value").
+ *
+ * \return \c true on match, else \c false.
+ */
+gboolean
+cc_oci_batch_label_matches (GSList *annotations, const gchar *label)
+{
+	g_autofree gchar  *key = NULL;
+	const gchar       *value = NULL;
+	const gchar       *eq;
+
+	if (! label || ! *label) {
+		return false;
+	}
+
+	eq = strchr (label, '=');
+	if (eq) {
+		key = g_strndup (label, (gsize)(eq - label));
+		value = eq + 1;
+	} else {
+		key = g_strdup (label);
+	}
+
+	for (GSList *l = annotations; l; l = g_slist_next (l)) {
+		const struct oci_cfg_annotation *a = l->data;
+
+		if (g_strcmp0 (a->key, key)) {
+			continue;
+		}
+
+		if (! value || ! g_strcmp0 (a->value, value)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * Get the ids of all containers below \p root_dir with an annotation
+ * matching \p label.
+ *
+ * \param root_dir Runtime root directory.
+ * \param label See cc_oci_batch_label_matches().
+ *
+ * \return \c GSList of newly-allocated container ids (may be \c NULL
+ * if no containers match).
+ */
+GSList *
+cc_oci_batch_ids_matching (const gchar *root_dir, const gchar *label)
+{
+	GSList  *ids;
+	GSList  *matching = NULL;
+
+	if (! (root_dir && label)) {
+		return NULL;
+	}
+
+	ids = cc_oci_runtime_container_ids (root_dir);
+
+	for (GSList *l = ids; l; l = g_slist_next (l)) {
+		g_autofree gchar   *state_file = NULL;
+		struct oci_state   *state;
+
+		state_file = g_build_path ("/", root_dir, l->data,
+				CC_OCI_STATE_FILE, NULL);
+
+		/* the container may have been deleted meanwhile */
+		state = cc_oci_state_file_read (state_file);
+		if (! state) {
+			continue;
+		}
+
+		if (cc_oci_batch_label_matches (state->annotations, label)) {
+			matching = g_slist_prepend (matching,
+					g_strdup (l->data));
+		}
+
+		cc_oci_state_free (state);
+	}
+
+	g_slist_free_full (ids, g_free);
+
+	return g_slist_reverse (matching);
+}
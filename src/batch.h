@@ -0,0 +1,47 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_BATCH_H
+#define _CC_OCI_BATCH_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** Function run (in a worker process) for each container of a batch.
+ *
+ * \param config \ref cc_oci_config for the container
+ * (\c optarg_container_id is set).
+ * \param user_data Data passed to cc_oci_batch_run().
+ *
+ * \return \c true on success, else \c false.
+ */
+typedef gboolean (*cc_oci_batch_func) (struct cc_oci_config *config,
+		gpointer user_data);
+
+gboolean cc_oci_batch_run (const struct cc_oci_config *config,
+		GSList *ids, guint jobs,
+		cc_oci_batch_func func, gpointer user_data);
+gboolean cc_oci_batch_label_matches (GSList *annotations,
+		const gchar *label);
+GSList *cc_oci_batch_ids_matching (const gchar *root_dir,
+		const gchar *label);
+
+#endif /* _CC_OCI_BATCH_H */
@@ -0,0 +1,429 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Checkpoint and restore of containers.
+ *
+ * A checkpoint image is a directory holding the state of the VM,
+ * saved using hypervisor migration (\ref CC_OCI_CHECKPOINT_VM_FILE),
+ * and a copy of the \ref CC_OCI_STATE_FILE of the container, which
+ * records its mounts, proxy sockets and workload I/O streams. The
+ * state file is written last so that only complete images are
+ * restored.
+ *
+ * Restoring launches the hypervisor with the saved state rather than
+ * booting the VM, so the workload resumes where it was checkpointed.
+ *
+ * With "lazy pages", the main memory of the VM is moved out of the
+ * saved state into \ref CC_OCI_CHECKPOINT_RAM_FILE. On restore, the
+ * hypervisor maps that file privately as guest memory rather than
+ * reading every page up front, so the container runs as soon as the
+ * device state is loaded and pages are read as the guest touches them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "oci.h"
+#include "util.h"
+#include "common.h"
+#include "state.h"
+#include "network.h"
+#include "migration.h"
+#include "checkpoint.h"
+
+/** Mode of the checkpoint image directory. */
+#define CC_OCI_CHECKPOINT_DIR_MODE 0700
+
+/*!
+ * Build the migration URI used to save the state of a VM to a file.
+ *
+ * \param vm_file Full path to file to save the state to.
+ *
+ * \return Newly-allocated string.
+ */
+private gchar *
+cc_oci_checkpoint_uri (const gchar *vm_file)
+{
+	gchar *quoted;
+	gchar *uri;
+
+	if (! vm_file) {
+		return NULL;
+	}
+
+	/* The command is run by the shell */
+	quoted = g_shell_quote (vm_file);
+	uri = g_strdup_printf ("exec:cat > %s", quoted);
+	g_free (quoted);
+
+	return uri;
+}
+
+/*!
+ * Read the state file saved in a checkpoint image.
+ *
+ * \param image_path Path to checkpoint image directory.
+ * \param container_id Expected container ID.
+ *
+ * \return \ref oci_state on success, else \c NULL.
+ */
+private struct oci_state *
+cc_oci_checkpoint_state_read (const gchar *image_path,
+		const gchar *container_id)
+{
+	struct oci_state  *state = NULL;
+	gchar             *state_file = NULL;
+	gchar             *vm_file = NULL;
+
+	if (! (image_path && container_id)) {
+		return NULL;
+	}
+
+	state_file = g_build_path ("/", image_path, CC_OCI_STATE_FILE, NULL);
+	vm_file = g_build_path ("/", image_path,
+			CC_OCI_CHECKPOINT_VM_FILE, NULL);
+
+	if (! (g_file_test (state_file, G_FILE_TEST_IS_REGULAR) &&
+			g_file_test (vm_file, G_FILE_TEST_IS_REGULAR))) {
+		g_critical ("no checkpoint image found in %s", image_path);
+		goto out;
+	}
+
+	state = cc_oci_state_file_read (state_file);
+	if (! state) {
+		g_critical ("failed to read checkpoint state file %s",
+				state_file);
+		goto out;
+	}
+
+	/* The agent in the VM knows the workload by its container ID */
+	if (g_strcmp0 (state->id, container_id)) {
+		g_critical ("checkpoint image %s is of container %s, not %s",
+				image_path, state->id, container_id);
+		goto err;
+	}
+
+	if (state->pod) {
+		g_critical ("checkpoint image %s is of a pod container",
+				image_path);
+		goto err;
+	}
+
+	if (! (state->process && state->process->stdio_stream > 0)) {
+		g_critical ("checkpoint image %s has no workload I/O streams",
+				image_path);
+		goto err;
+	}
+
+	goto out;
+
+err:
+	cc_oci_state_free (state);
+	state = NULL;
+
+out:
+	g_free_if_set (state_file);
+	g_free_if_set (vm_file);
+
+	return state;
+}
+
+/*!
+ * Move the main memory of a VM out of its saved state, so that it
+ * can be loaded on demand when the container is restored.
+ *
+ * \param vm_file Full path to saved state of VM.
+ * \param ram_file Full path to file to save main memory to.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_checkpoint_split_ram (const gchar *vm_file, const gchar *ram_file)
+{
+	gboolean   ret = false;
+	gchar     *vm_tmp;
+	gchar     *ram_tmp;
+	guint64    pages_total = 0;
+	guint64    pages_saved = 0;
+
+	vm_tmp = g_strconcat (vm_file, ".tmp", NULL);
+	ram_tmp = g_strconcat (ram_file, ".tmp", NULL);
+
+	if (! cc_oci_migration_split_ram (vm_file, vm_tmp, ram_tmp,
+				&pages_total, &pages_saved)) {
+		goto out;
+	}
+
+	/* Replace rather than rewrite the files: a container restored
+	 * from an earlier image in the same directory still maps its
+	 * memory file.
+	 */
+	if (g_rename (ram_tmp, ram_file) < 0 ||
+			g_rename (vm_tmp, vm_file) < 0) {
+		g_critical ("failed to save guest memory to %s: %s",
+				ram_file, strerror (errno));
+		(void)g_unlink (ram_tmp);
+		(void)g_unlink (vm_tmp);
+		(void)g_unlink (ram_file);
+		goto out;
+	}
+
+	g_debug ("saved %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT
+			" pages of guest memory to %s",
+			pages_saved, pages_total, ram_file);
+
+	ret = true;
+
+out:
+	g_free (vm_tmp);
+	g_free (ram_tmp);
+
+	return ret;
+}
+
+/*!
+ * Save the state of a running container to a checkpoint image.
+ *
+ * The VM is paused while its state is saved. Unless
+ * \p leave_running is set, the hypervisor is then stopped (without
+ * resuming the VM, so that the container's files are not modified
+ * after the checkpoint) and the container can be deleted.
+ *
+ * \param config \ref cc_oci_config.
+ * \param state \ref oci_state.
+ * \param image_path Path to checkpoint image directory
+ *   (created if necessary).
+ * \param leave_running If \c true, resume the container once its
+ *   state has been saved.
+ * \param lazy_pages If \c true, save the main memory of the VM
+ *   separately so that it is loaded on demand on restore.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_checkpoint (struct cc_oci_config *config,
+		struct oci_state *state,
+		const gchar *image_path,
+		gboolean leave_running,
+		gboolean lazy_pages)
+{
+	gboolean   ret = false;
+	gboolean   was_paused;
+	gchar     *state_file = NULL;
+	gchar     *vm_file = NULL;
+	gchar     *ram_file = NULL;
+	gchar     *uri = NULL;
+	gchar     *contents = NULL;
+	gsize      len = 0;
+	GError    *error = NULL;
+	GPid       vm_pid;
+
+	if (! (config && state && image_path && config->vm)) {
+		return false;
+	}
+
+	if (config->pod) {
+		g_critical ("checkpoint of pod containers is not supported");
+		return false;
+	}
+
+	if (! (state->status == OCI_STATUS_RUNNING ||
+				state->status == OCI_STATUS_PAUSED)) {
+		g_critical ("container %s is not running",
+				config->optarg_container_id);
+		return false;
+	}
+
+	/* QEMU blocks migration while a 9p export is mounted in the
+	 * guest, so only a block device rootfs can be saved. The device
+	 * name is not kept in the state file, but its fstype is.
+	 */
+	if (! (config->device_name || config->state.block_fstype)) {
+		g_critical ("cannot checkpoint container %s: "
+				"checkpoint requires a block device rootfs",
+				config->optarg_container_id);
+		return false;
+	}
+
+	vm_pid = config->vm->pid;
+
+	if (g_mkdir_with_parents (image_path,
+				CC_OCI_CHECKPOINT_DIR_MODE) < 0) {
+		g_critical ("failed to create checkpoint directory %s: %s",
+				image_path, strerror (errno));
+		return false;
+	}
+
+	state_file = g_build_path ("/", image_path, CC_OCI_STATE_FILE, NULL);
+	vm_file = g_build_path ("/", image_path,
+			CC_OCI_CHECKPOINT_VM_FILE, NULL);
+	ram_file = g_build_path ("/", image_path,
+			CC_OCI_CHECKPOINT_RAM_FILE, NULL);
+
+	/* Invalidate any previous image in the directory */
+	(void)g_unlink (state_file);
+	(void)g_unlink (ram_file);
+
+	/* Read the state file first: it is only saved in the image once
+	 * the VM state has been.
+	 */
+	if (! g_file_get_contents (config->state.state_file_path,
+				&contents, &len, &error)) {
+		g_critical ("failed to read state file: %s",
+				error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	was_paused = state->status == OCI_STATUS_PAUSED;
+
+	if (! was_paused && ! cc_oci_vm_pause (state->comms_path, vm_pid)) {
+		g_critical ("failed to pause container %s",
+				config->optarg_container_id);
+		goto out;
+	}
+
+	uri = cc_oci_checkpoint_uri (vm_file);
+
+	ret = cc_oci_vm_migrate (state->comms_path, vm_pid, uri);
+	if (! ret) {
+		g_critical ("failed to save state of container %s",
+				config->optarg_container_id);
+		(void)g_unlink (vm_file);
+
+		if (! was_paused) {
+			(void)cc_oci_vm_resume (state->comms_path, vm_pid);
+		}
+
+		goto out;
+	}
+
+	if (lazy_pages && ! cc_oci_checkpoint_split_ram (vm_file, ram_file)) {
+		g_critical ("failed to save memory of container %s",
+				config->optarg_container_id);
+		(void)g_unlink (vm_file);
+
+		if (! was_paused) {
+			(void)cc_oci_vm_resume (state->comms_path, vm_pid);
+		}
+
+		ret = false;
+		goto out;
+	}
+
+	ret = g_file_set_contents (state_file, contents,
+			(gssize)len, &error);
+	if (! ret) {
+		g_critical ("failed to save state file to %s: %s",
+				state_file, error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	g_debug ("checkpointed container %s to %s",
+			config->optarg_container_id, image_path);
+
+	if (leave_running) {
+		if (! was_paused) {
+			ret = cc_oci_vm_resume (state->comms_path, vm_pid);
+		}
+		goto out;
+	}
+
+	if (kill (vm_pid, SIGKILL) < 0) {
+		g_critical ("failed to stop VM (pid %d): %s",
+				(int)vm_pid, strerror (errno));
+		ret = false;
+		goto out;
+	}
+
+	config->state.status = OCI_STATUS_STOPPED;
+
+	ret = cc_oci_state_file_update (config, CC_OCI_STATE_UPDATE_STATUS);
+
+out:
+	g_free_if_set (state_file);
+	g_free_if_set (vm_file);
+	g_free_if_set (ram_file);
+	g_free_if_set (uri);
+	g_free_if_set (contents);
+
+	return ret;
+}
+
+/*!
+ * Create and run a container from a checkpoint image.
+ *
+ * The container is created from its bundle as for "run", but the
+ * hypervisor loads the saved state of the VM rather than booting it,
+ * and the proxy is told the workload is already running.
+ *
+ * \param config \ref cc_oci_config.
+ * \param image_path Path to checkpoint image directory.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_restore (struct cc_oci_config *config, const gchar *image_path)
+{
+	struct oci_state  *saved;
+	gboolean           ret;
+
+	if (! (config && config->proxy && image_path)) {
+		return false;
+	}
+
+	saved = cc_oci_checkpoint_state_read (image_path,
+			config->optarg_container_id);
+	if (! saved) {
+		return false;
+	}
+
+	/* The hypervisor needs an absolute path */
+	g_free_if_set (config->restore_path);
+	config->restore_path = cc_oci_resolve_path (image_path);
+	if (! config->restore_path) {
+		g_critical ("invalid checkpoint path %s", image_path);
+		cc_oci_state_free (saved);
+		return false;
+	}
+
+	/* The workload keeps the I/O streams it had */
+	config->proxy->restore_io_base = saved->process->stdio_stream;
+
+	cc_oci_state_free (saved);
+
+	ret = cc_oci_run (config);
+	if (! ret) {
+		g_critical ("failed to restore container %s from %s",
+				config->optarg_container_id, image_path);
+	}
+
+	return ret;
+}
@@ -0,0 +1,36 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_CHECKPOINT_H
+#define _CC_OCI_CHECKPOINT_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+gboolean cc_oci_checkpoint (struct cc_oci_config *config,
+		struct oci_state *state,
+		const gchar *image_path,
+		gboolean leave_running,
+		gboolean lazy_pages);
+gboolean cc_oci_restore (struct cc_oci_config *config,
+		const gchar *image_path);
+
+#endif /* _CC_OCI_CHECKPOINT_H */
@@ -0,0 +1,66 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * cc-oci-runtime-client: a drop-in replacement for cc-oci-runtime
+ * that asks a running "cc-oci-runtime daemon" to handle the command,
+ * avoiding the cost of starting the runtime for every command.
+ *
+ * If no daemon is running, cc-oci-runtime is run instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "daemon_client.h"
+
+extern char **environ;
+
+int
+main (int argc, char *argv[])
+{
+	const int   fds[CC_OCI_DAEMON_FDS] = {
+		STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO
+	};
+	const char *socket_path;
+	int         status;
+
+	socket_path = getenv (CC_OCI_DAEMON_SOCKET_ENV);
+	if (! socket_path || ! *socket_path) {
+		socket_path = CC_OCI_DAEMON_SOCKET;
+	}
+
+	status = cc_oci_daemon_client_run (socket_path, argc, argv,
+			environ, fds);
+	if (status >= 0) {
+		return status;
+	}
+
+	/* no daemon, so run the command directly */
+	argv[0] = (char *)CC_OCI_RUNTIME_PATH;
+	execv (CC_OCI_RUNTIME_PATH, argv);
+
+	perror ("failed to run " CC_OCI_RUNTIME_PATH);
+
+	return EXIT_FAILURE;
+}
@@ -24,6 +24,7 @@
 #include "config.h"
 #include "state.h"
 #include "oci-config.h"
+#include "config_cache.h"
 
 #include <errno.h>
 #include <glib/gstdio.h>
@@ -34,6 +35,7 @@ struct subcommand *subcommands[] =
 {
 	&command_checkpoint,
 	&command_create,
+	&command_daemon,
 	&command_delete,
 	&command_events,
 	&command_exec,
@@ -136,36 +138,23 @@ out:
 }
 
 /*!
- * Handle commands to stop the Hypervisor cleanly.
+ * Stop the Hypervisor of the container specified by
+ * \c config->optarg_container_id cleanly and delete its resources.
  *
- * \param sub \ref subcommand.
  * \param config \ref cc_oci_config.
- * \param argc Argument count.
- * \param argv Argument vector.
  *
  * \return \c true on success, else \c false.
  */
 gboolean
-handle_command_stop (const struct subcommand *sub,
-		struct cc_oci_config *config,
-		int argc, char *argv[])
+handle_container_stop (struct cc_oci_config *config)
 {
 	struct oci_state  *state = NULL;
 	gchar             *config_file = NULL;
 	gboolean           ret;
-	GNode*             root = NULL;
 	gchar             *cgroup_dir = NULL;
 
-	g_assert (sub);
 	g_assert (config);
-
-	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, NULL)) {
-		return ret;
-	}
-
-	/* Used to allow us to find the state file */
-	config->optarg_container_id = argv[0];
+	g_assert (config->optarg_container_id);
 
 	/* FIXME: deal with containerd calling "delete" twice */
 	if (! cc_oci_state_file_exists (config)) {
@@ -182,23 +171,14 @@ handle_command_stop (const struct subcommand *sub,
 		goto out;
 	}
 
-	/* convert json file to GNode */
-	if (! cc_oci_json_parse(&root, config_file)) {
-		goto out;
-	}
-
-#ifdef DEBUG
-	/* show json file converted to GNode */
-	cc_oci_node_dump(root);
-#endif /*DEBUG*/
-
-	if (! cc_oci_process_config(root, config, stop_spec_handlers)) {
+	/* The parts of the config needed here were cached by "create" */
+	if (! cc_oci_config_cache_load (config, config_file) &&
+			! cc_oci_process_config_file (config_file, config,
+				stop_spec_handlers)) {
 		g_critical ("failed to process config");
 		goto out;
 	}
 
-	g_free_node(root);
-
 	if (! cc_oci_config_update (config, state)) {
 		goto out;
 	}
@@ -234,6 +214,37 @@ out:
 	return ret;
 }
 
+/*!
+ * Handle commands to stop the Hypervisor cleanly.
+ *
+ * \param sub \ref subcommand.
+ * \param config \ref cc_oci_config.
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+handle_command_stop (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	gboolean ret;
+
+	g_assert (sub);
+	g_assert (config);
+
+	if (handle_default_usage (argc, argv, sub->name,
+				&ret, 1, NULL)) {
+		return ret;
+	}
+
+	/* Used to allow us to find the state file */
+	config->optarg_container_id = argv[0];
+
+	return handle_container_stop (config);
+}
+
 /*!
  * Handle commands to setup the environment as a precursor to
  * creating the state file.
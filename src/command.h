@@ -89,6 +89,7 @@ struct start_data {
 gboolean handle_command_toggle (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[], gboolean pause);
+gboolean handle_container_stop (struct cc_oci_config *config);
 gboolean handle_command_stop (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[]);
@@ -107,6 +108,7 @@ gboolean handle_option_user (const gchar *option_name,
 
 extern struct subcommand command_checkpoint;
 extern struct subcommand command_create;
+extern struct subcommand command_daemon;
 extern struct subcommand command_delete;
 extern struct subcommand command_events;
 extern struct subcommand command_exec;
@@ -20,34 +20,92 @@
 
 #include "command.h"
 #include "state.h"
+#include "checkpoint.h"
+
+/** Default checkpoint image directory, as used by runc. */
+#define DEFAULT_IMAGE_PATH "checkpoint"
+
+static gchar *image_path;
+static gboolean leave_running;
+static gboolean lazy_pages;
+
+static GOptionEntry options_checkpoint[] =
+{
+	{
+		"image-path", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &image_path,
+		"path to save the checkpoint image to "
+			"(default \"" DEFAULT_IMAGE_PATH "\")",
+		"<path>"
+	},
+	{
+		"leave-running", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &leave_running,
+		"leave the container running after checkpointing it",
+		NULL
+	},
+	{
+		"lazy-pages", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &lazy_pages,
+		"save guest memory so that restore loads it on demand",
+		NULL
+	},
+	{NULL}
+};
 
 static gboolean
 handler_checkpoint (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	gboolean  ret = true;
+	gboolean           ret = false;
+	struct oci_state  *state = NULL;
+	gchar             *config_file = NULL;
 
 	g_assert (sub);
 	g_assert (config);
 
 	if (handle_default_usage (argc, argv, sub->name,
 				&ret, 1, NULL)) {
-		return ret;
+		goto out;
 	}
 
+	config->optarg_container_id = argv[0];
+
 	if (! cc_oci_state_file_exists(config)) {
 		g_warning ("state file does not exist for container %s",
 				config->optarg_container_id);
 		ret = false;
+		goto out;
 	}
 
+	ret = cc_oci_get_config_and_state (&config_file, config, &state);
+	if (! ret) {
+		goto out;
+	}
+
+	ret = cc_oci_config_update (config, state);
+	if (! ret) {
+		goto out;
+	}
+
+	ret = cc_oci_checkpoint (config, state,
+			image_path ? image_path : DEFAULT_IMAGE_PATH,
+			leave_running, lazy_pages);
+
+out:
+	g_free_if_set (image_path);
+	g_free_if_set (config_file);
+	cc_oci_state_free (state);
+
 	return ret;
 }
 
 struct subcommand command_checkpoint =
 {
 	.name    = "checkpoint",
+	.options = options_checkpoint,
 	.handler = handler_checkpoint,
-	.description = "checkpoint a running container",
+	.description = "checkpoint a running container "
+		"(requires a block device rootfs)",
 };
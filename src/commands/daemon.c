@@ -0,0 +1,74 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "command.h"
+#include "daemon.h"
+#include "spec_handler.h"
+
+static gchar *socket_path;
+
+static GOptionEntry options_daemon[] =
+{
+	{
+		"socket", 's', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &socket_path,
+		"path to listen for requests on (default: "
+			CC_OCI_DAEMON_SOCKET ")", NULL
+	},
+
+	{NULL}
+};
+
+static gboolean
+handler_daemon (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	gboolean ret;
+
+	g_assert (sub);
+	g_assert (config);
+
+	(void)argc;
+	(void)argv;
+
+	/* Read the VM configuration now so that it is inherited by
+	 * every command the daemon runs.
+	 */
+	if (! get_spec_vm_from_cfg_file (config)) {
+		g_warning ("failed to preload VM configuration");
+	}
+
+	ret = cc_oci_daemon_run (socket_path ? socket_path
+			: CC_OCI_DAEMON_SOCKET);
+
+	g_free_if_set (socket_path);
+
+	return ret;
+}
+
+struct subcommand command_daemon =
+{
+	.name        = "daemon",
+	.options     = options_daemon,
+	.handler     = handler_daemon,
+	.description = "handle commands sent by cc-oci-runtime-client "
+	               "(except create, exec, restore and run)",
+};
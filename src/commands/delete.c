@@ -19,12 +19,79 @@
  */
 
 #include "command.h"
+#include "batch.h"
+
+static gboolean batch;
+static gint jobs;
+
+static GOptionEntry options_delete[] =
+{
+	{
+		"batch", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &batch,
+		"delete all the containers specified, displaying the "
+			"result for each as JSON", NULL
+	},
+	{
+		"jobs", 'j', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_INT, &jobs,
+		"with --batch, maximum number of containers to delete "
+			"concurrently (default: number of CPUs)", NULL
+	},
+
+	{NULL}
+};
+
+static gboolean
+batch_stop (struct cc_oci_config *config, gpointer user_data)
+{
+	(void)user_data;
+
+	return handle_container_stop (config);
+}
+
+static gboolean
+handler_delete (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	GSList    *ids = NULL;
+	gboolean   ret;
+
+	g_assert (sub);
+	g_assert (config);
+
+	if (! batch) {
+		return handle_command_stop (sub, config, argc, argv);
+	}
+
+	if (handle_default_usage (argc, argv, sub->name,
+				&ret, 1, "[<container-id> ...]")) {
+		return ret;
+	}
+
+	if (jobs < 0) {
+		g_critical ("invalid number of jobs: %d", jobs);
+		return false;
+	}
+
+	for (int i = argc - 1; i >= 0; i--) {
+		ids = g_slist_prepend (ids, argv[i]);
+	}
+
+	ret = cc_oci_batch_run (config, ids, (guint)jobs, batch_stop, NULL);
+
+	g_slist_free (ids);
+
+	return ret;
+}
 
 struct subcommand command_delete =
 {
 	.name        = "delete",
+	.options     = options_delete,
 
 	/* delete is what the OCI spec calls stop */
-	.handler     = handle_command_stop,
+	.handler     = handler_delete,
 	.description = "delete resources held by a container",
 };
@@ -20,11 +20,21 @@
 
 #include "command.h"
 #include "events.h"
-#define DEFAULT_INTERVAL 5
+#include "config_cache.h"
+
+/* milliseconds */
+#define DEFAULT_INTERVAL 5000
 
 static gboolean run_once;
-static gint interval = DEFAULT_INTERVAL;
+static guint interval = DEFAULT_INTERVAL;
+static gboolean all;
+static gboolean delta;
 
+static gboolean
+handle_option_interval (const gchar *option_name,
+		const gchar *value,
+		gpointer data,
+		GError **error);
 
 static GOptionEntry options_events[] =
 {
@@ -35,12 +45,54 @@ static GOptionEntry options_events[] =
 	},
 	{
 		"interval", 0, G_OPTION_FLAG_NONE,
-		G_OPTION_ARG_INT, &interval,
-		"set the interval to refresh stats", NULL
+		G_OPTION_ARG_CALLBACK, handle_option_interval,
+		"set the interval to refresh stats "
+			"(seconds, or a duration such as \"500ms\")",
+		"<interval>"
+	},
+	{
+		"all", 'a', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &all,
+		"show the events of all containers "
+			"(with --stats, the stats of all running containers)",
+		NULL
+	},
+	{
+		"delta", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &delta,
+		"only show the counters that changed since the "
+			"previous sample, as differences", NULL
 	},
 	{NULL}
 };
 
+/**
+ * Handle parsing of --interval.
+ *
+ * \param option_name Full option name ("--interval").
+ * \param value Value of interval option.
+ * \param data Unused.
+ * \param error Error to set on failure.
+ *
+ * \return \c true if option \p option_name was parsed successfully,
+ * else \c false.
+ */
+static gboolean
+handle_option_interval (const gchar *option_name,
+		const gchar *value,
+		gpointer data,
+		GError **error)
+{
+	if (! cc_oci_parse_duration (value, &interval)) {
+		g_set_error (error, G_OPTION_ERROR,
+				G_OPTION_ERROR_BAD_VALUE,
+				"invalid interval: %s", value);
+		return false;
+	}
+
+	return true;
+}
+
 static gboolean
 handler_events (const struct subcommand *sub,
 		struct cc_oci_config *config,
@@ -55,28 +107,47 @@ handler_events (const struct subcommand *sub,
 		goto out;
 	}
 
+	if (! interval) {
+		g_critical ("Interval must be greater than 0");
+		return false;
+	}
+
+	if (run_once) {
+		/* set interva 0 to avoid show_container_stats blocking */
+		interval = 0;
+	}
+
+	if (all) {
+		if (argc) {
+			g_print ("Usage: %s --all [<options>]\n", sub->name);
+			return false;
+		}
+
+		return show_all_container_events (config, interval, delta);
+	}
+
 	if (handle_default_usage (argc, argv, sub->name,
 				&ret, -1, NULL)) {
 		goto out;
 	}
 
-	if (interval <= 0) {
-		g_critical ("Interval must be greater than 0");
-		return false;
-	}
-
 	/* Used to allow us to find the state file */
 	config->optarg_container_id = argv[0];
 	ret = cc_oci_get_config_and_state (&config_file, config, &state);
 	if (! ret) {
 		goto out;
 	}
-	if (run_once) {
-		/* set interva 0 to avoid show_container_stats blocking */
-		interval = 0;
+
+	/* the proxy details are needed to query the agent */
+	ret = cc_oci_config_update (config, state);
+	if (! ret) {
+		goto out;
 	}
 
-	ret = show_container_stats(config, state, interval);
+	/* only needed for the memory limit */
+	(void)cc_oci_config_cache_load (config, config_file);
+
+	ret = show_container_stats(config, state, interval, delta);
 
 out:
 	g_free_if_set (config_file);
@@ -137,7 +137,6 @@ handler_exec (const struct subcommand *sub,
 		int argc, char *argv[])
 {
 	struct oci_state  *state = NULL;
-	gchar             *config_file = NULL;
 	gboolean           ret = false;
 	struct oci_cfg_process *process = NULL;
 
@@ -187,7 +186,7 @@ handler_exec (const struct subcommand *sub,
 		}
 	}
 
-	ret = cc_oci_get_config_and_state (&config_file, config, &state);
+	ret = cc_oci_get_exec_state (config, &state);
 	if (! ret) {
 		goto out;
 	}
@@ -204,7 +203,6 @@ handler_exec (const struct subcommand *sub,
 	ret = true;
 
 out:
-	g_free_if_set (config_file);
 	cc_oci_state_free (state);
 	g_free_if_set (apparmor);
 	g_free_if_set (cap);
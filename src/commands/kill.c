@@ -22,8 +22,11 @@
 #include <signal.h>
 
 #include "command.h"
+#include "batch.h"
 
 static gboolean all_processes = false;
+static gchar *all_matching;
+static gint jobs;
 
 static GOptionEntry options_kill[] =
 {
@@ -33,23 +36,160 @@ static GOptionEntry options_kill[] =
 		"send a signal to all processes inside the container",
 		NULL
 	},
+	{
+		"all-matching", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &all_matching,
+		"send the signal to all containers with an annotation "
+			"matching the label (\"key\" or \"key=value\"), "
+			"displaying the result for each as JSON",
+		NULL
+	},
+	{
+		"jobs", 'j', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_INT, &jobs,
+		"with --all-matching, maximum number of containers to "
+			"signal concurrently (default: number of CPUs)",
+		NULL
+	},
 	{ NULL }
 };
 
+/** Arguments for kill_container(). */
+struct kill_args {
+	int       signum;
+	gboolean  all;
+};
+
+/*!
+ * Convert \p signame to a signal number.
+ *
+ * \param signame Signal name or number (or \c NULL for the default).
+ *
+ * \return Signal number, or \c -1 if \p signame is invalid.
+ */
+static int
+get_signum (const gchar *signame)
+{
+	int signum;
+
+	if (! signame) {
+		return SIGTERM;
+	}
+
+	/* first, try to convert the string argument to a number */
+	signum = atoi (signame);
+
+	if (signum <= 0) {
+		/* not a number, so try to convert the signame
+		 * name to a number.
+		 */
+		signum = cc_oci_get_signum (signame);
+	}
+
+	if (signum < 0) {
+		g_critical ("invalid signal specified: %s",
+				signame);
+	}
+
+	return signum;
+}
+
+/*!
+ * Signal the container specified by \c config->optarg_container_id.
+ *
+ * \param config \ref cc_oci_config.
+ * \param user_data \ref kill_args.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+kill_container (struct cc_oci_config *config, gpointer user_data)
+{
+	const struct kill_args  *args = user_data;
+	struct oci_state        *state = NULL;
+	gchar                   *config_file = NULL;
+	gboolean                 ret = false;
+
+	ret = cc_oci_get_config_and_state (&config_file, config, &state);
+	if (! ret) {
+		goto out;
+	}
+
+	if (! cc_oci_config_update (config, state)) {
+		goto out;
+	}
+
+	ret = cc_oci_kill (config, state, args->signum, args->all);
+
+out:
+	g_free_if_set (config_file);
+	cc_oci_state_free (state);
+
+	return ret;
+}
+
+/*!
+ * Signal all containers with an annotation matching \ref all_matching.
+ *
+ * \param config \ref cc_oci_config.
+ * \param args \ref kill_args.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+kill_matching (struct cc_oci_config *config, struct kill_args *args)
+{
+	GSList    *ids;
+	gboolean   ret;
+
+	if (jobs < 0) {
+		g_critical ("invalid number of jobs: %d", jobs);
+		return false;
+	}
+
+	ids = cc_oci_batch_ids_matching (config->root_dir
+			? config->root_dir
+			: CC_OCI_RUNTIME_DIR_PREFIX,
+			all_matching);
+
+	ret = cc_oci_batch_run (config, ids, (guint)jobs,
+			kill_container, args);
+
+	g_slist_free_full (ids, g_free);
+
+	return ret;
+}
+
 static gboolean
 handler_kill (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	struct oci_state      *state = NULL;
-	gchar                 *config_file = NULL;
-	gboolean               ret = false;
-	const gchar           *signame = NULL;
-	int                    signum = SIGTERM;
+	struct kill_args  args = { 0 };
+	gboolean          ret = false;
+	const gchar      *signame = NULL;
 
 	g_assert (sub);
 	g_assert (config);
 
+	args.all = all_processes;
+
+	if (all_matching) {
+		if (argc > 1) {
+			g_print ("Usage: %s --all-matching <label> "
+					"[<signal>]\n", sub->name);
+			goto out;
+		}
+
+		args.signum = get_signum (argc ? argv[0] : NULL);
+		if (args.signum < 0) {
+			goto out;
+		}
+
+		ret = kill_matching (config, &args);
+		goto out;
+	}
+
 	if (handle_default_usage (argc, argv, sub->name,
 				&ret, 1, "[<options>] [<signal>]")) {
 		return ret;
@@ -60,38 +200,17 @@ handler_kill (const struct subcommand *sub,
 
 	if (argc == 2) {
 		signame = argv[1];
-
-		/* first, try to convert the string argument to a number */
-		signum = atoi (signame);
-
-		if (signum <= 0) {
-			/* not a number, so try to convert the signame
-			 * name to a number.
-			 */
-			signum = cc_oci_get_signum (signame);
-		}
-
-		if (signum < 0) {
-			g_critical ("invalid signal specified: %s",
-					signame);
-			return false;
-		}
-	}
-
-	ret = cc_oci_get_config_and_state (&config_file, config, &state);
-	if (! ret) {
-		goto out;
 	}
 
-	if (! cc_oci_config_update (config, state)) {
-		goto out;
+	args.signum = get_signum (signame);
+	if (args.signum < 0) {
+		return false;
 	}
 
-	ret = cc_oci_kill (config, state, signum, all_processes);
+	ret = kill_container (config, &args);
 
 out:
-	g_free_if_set (config_file);
-	cc_oci_state_free (state);
+	g_free_if_set (all_matching);
 
 	return ret;
 }
@@ -22,6 +22,7 @@
 
 static char *format;
 static gboolean show_all;
+static gboolean quiet;
 
 static GOptionEntry options_list[] =
 {
@@ -35,6 +36,11 @@ static GOptionEntry options_list[] =
 		G_OPTION_ARG_STRING, &format,
 		"change output format", NULL
 	},
+	{
+		"quiet", 'q', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &quiet,
+		"display only container IDs", NULL
+	},
 
 	{NULL}
 };
@@ -49,7 +55,11 @@ handler_list (const struct subcommand *sub,
 	g_assert (sub);
 	g_assert (config);
 
-	ret = cc_oci_list (config, format ? format : "table", show_all);
+	if (quiet) {
+		ret = cc_oci_list_ids (config);
+	} else {
+		ret = cc_oci_list (config, format ? format : "table", show_all);
+	}
 
 	g_free_if_set (format);
 
@@ -20,21 +20,54 @@
 
 #include "command.h"
 #include "state.h"
+#include "ps.h"
 
+static char *format;
+
+static GOptionEntry options_ps[] =
+{
+	{
+		"format", 'f', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &format,
+		"select output format (\"table\" or \"json\")", NULL
+	},
+	{NULL}
+};
 
 static gboolean
 handler_ps (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	gboolean   ret;
+	gboolean           ret = false;
+	gboolean           use_json = false;
+	struct oci_state  *state = NULL;
+	gchar             *config_file = NULL;
+	GArray            *procs = NULL;
+	JsonArray         *array = NULL;
+	gchar             *str = NULL;
 
 	g_assert (sub);
 	g_assert (config);
 
 	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, "<ps options>")) {
-		return ret;
+				&ret, 1, NULL)) {
+		goto out;
+	}
+
+	if (argc > 1) {
+		/* runc passes these on to ps(1), which is not run here */
+		g_critical ("ps options are not supported");
+		goto out;
+	}
+
+	if (! format || ! g_strcmp0 (format, "table")) {
+		; /* NOP */
+	} else if (! g_strcmp0 (format, "json")) {
+		use_json = true;
+	} else {
+		g_critical ("invalid ps format: %s", format);
+		goto out;
 	}
 
 	config->optarg_container_id = argv[0];
@@ -42,17 +75,73 @@ handler_ps (const struct subcommand *sub,
 	if (! cc_oci_state_file_exists(config)) {
 		g_warning ("state file does not exist for container %s",
 				config->optarg_container_id);
-		return false;
+		goto out;
+	}
+
+	ret = cc_oci_get_config_and_state (&config_file, config, &state);
+	if (! ret) {
+		goto out;
+	}
+
+	ret = false;
+
+	if (state->status == OCI_STATUS_PAUSED) {
+		/* the agent cannot reply while the VM is paused */
+		g_critical ("container %s is paused",
+				config->optarg_container_id);
+		goto out;
 	}
 
-	//FIXME: implement ps, run ps inside the VM ?
+	/* the proxy details are needed to query the agent */
+	if (! cc_oci_config_update (config, state)) {
+		goto out;
+	}
+
+	procs = cc_oci_ps_get (config);
+	if (! procs) {
+		goto out;
+	}
+
+	if (use_json) {
+		array = cc_oci_ps_to_json (procs);
+		str = cc_oci_json_arr_to_string (array, false);
+		if (! str) {
+			goto out;
+		}
+
+		g_print ("%s\n", str);
+	} else {
+		str = cc_oci_ps_to_table (procs);
+		if (! str) {
+			goto out;
+		}
+
+		g_print ("%s", str);
+	}
+
+	ret = true;
+
+out:
+	g_free_if_set (format);
+	g_free_if_set (config_file);
+	g_free_if_set (str);
+	cc_oci_state_free (state);
+
+	if (array) {
+		json_array_unref (array);
+	}
+
+	if (procs) {
+		g_array_free (procs, true);
+	}
 
-	return true;
+	return ret;
 }
 
 struct subcommand command_ps =
 {
 	.name        = "ps",
+	.options     = options_ps,
 	.handler     = handler_ps,
 	.description = "display the processes running inside a container",
 };
@@ -19,28 +19,77 @@
  */
 
 #include "command.h"
-#include "state.h"
+#include "checkpoint.h"
+
+/** Default checkpoint image directory, as used by runc. */
+#define DEFAULT_IMAGE_PATH "checkpoint"
+
+extern struct start_data start_data;
+
+static gchar *image_path;
+
+/* ignore -pedantic to cast handle_option_console, a function pointer, to a
+ * void* */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+static GOptionEntry options_restore[] =
+{
+	{
+		"bundle", 'b', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &start_data.bundle,
+		"path to the bundle directory",
+		NULL
+	},
+	{
+		"console", 0, G_OPTION_FLAG_OPTIONAL_ARG,
+		G_OPTION_ARG_CALLBACK, handle_option_console,
+		"set pty console that will be used in the container",
+		NULL
+	},
+	{
+		"detach", 'd', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &start_data.detach,
+		"detach after restoring the container",
+		NULL
+	},
+	{
+		"image-path", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &image_path,
+		"path to the checkpoint image to restore "
+			"(default \"" DEFAULT_IMAGE_PATH "\")",
+		"<path>"
+	},
+	{
+		"pid-file", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &start_data.pid_file,
+		"the file to write the process ID of the restored "
+		"container to",
+		NULL
+	},
+
+	{NULL}
+};
+#pragma GCC diagnostic pop
 
 static gboolean
 handler_restore (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	gboolean  ret = true;
+	gboolean  ret = false;
 
 	g_assert (sub);
 	g_assert (config);
 
-	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, NULL)) {
-		return ret;
+	if (! handle_command_setup (sub, config, argc, argv)) {
+		goto out;
 	}
 
-	if (! cc_oci_state_file_exists(config)) {
-		g_warning ("state file does not exist for container %s",
-				config->optarg_container_id);
-		ret = false;
-	}
+	ret = cc_oci_restore (config,
+			image_path ? image_path : DEFAULT_IMAGE_PATH);
+
+out:
+	g_free_if_set (image_path);
 
 	return ret;
 }
@@ -48,6 +97,7 @@ handler_restore (const struct subcommand *sub,
 struct subcommand command_restore =
 {
 	.name    = "restore",
+	.options = options_restore,
 	.handler = handler_restore,
 	.description = "restore a container from a previous checkpoint",
 };
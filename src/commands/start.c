@@ -25,11 +25,15 @@
 #include "util.h"
 #include "oci.h"
 #include "spec_handler.h"
+#include "batch.h"
 #include <stdlib.h>
 #include <glib.h>
 
 extern struct start_data start_data;
 
+static gboolean batch;
+static gint jobs;
+
 static GOptionEntry options_start[] =
 {
 	// FIXME: runc allows this. why?
@@ -39,14 +43,32 @@ static GOptionEntry options_start[] =
 		"path to the bundle directory",
 		NULL
 	},
+	{
+		"batch", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &batch,
+		"start all the containers specified, displaying the "
+			"result for each as JSON", NULL
+	},
+	{
+		"jobs", 'j', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_INT, &jobs,
+		"with --batch, maximum number of containers to start "
+			"concurrently (default: number of CPUs)", NULL
+	},
 
 	{NULL}
 };
 
+/*!
+ * Start the container specified by \c config->optarg_container_id.
+ *
+ * \param config \ref cc_oci_config.
+ * \param user_data Unused.
+ *
+ * \return \c true on success, else \c false.
+ */
 static gboolean
-handler_start (const struct subcommand *sub,
-		struct cc_oci_config *config,
-		int argc, char *argv[])
+start_container (struct cc_oci_config *config, gpointer user_data)
 {
 	struct oci_state  *state;
 	gboolean           ret;
@@ -54,15 +76,7 @@ handler_start (const struct subcommand *sub,
 	/* not used */
 	g_autofree gchar  *config_file = NULL;
 
-	g_assert (sub);
-	g_assert (config);
-
-	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, NULL)) {
-		return ret;
-	}
-
-	config->optarg_container_id = argv[0];
+	(void)user_data;
 
 	ret = cc_oci_get_config_and_state (&config_file, config, &state);
 	if (! ret) {
@@ -79,6 +93,45 @@ handler_start (const struct subcommand *sub,
 	return cc_oci_start (config, state);
 }
 
+static gboolean
+handler_start (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	GSList    *ids = NULL;
+	gboolean   ret;
+
+	g_assert (sub);
+	g_assert (config);
+
+	if (handle_default_usage (argc, argv, sub->name,
+				&ret, 1, batch ? "[<container-id> ...]" : NULL)) {
+		return ret;
+	}
+
+	if (! batch) {
+		config->optarg_container_id = argv[0];
+
+		return start_container (config, NULL);
+	}
+
+	if (jobs < 0) {
+		g_critical ("invalid number of jobs: %d", jobs);
+		return false;
+	}
+
+	for (int i = argc - 1; i >= 0; i--) {
+		ids = g_slist_prepend (ids, argv[i]);
+	}
+
+	ret = cc_oci_batch_run (config, ids, (guint)jobs,
+			start_container, NULL);
+
+	g_slist_free (ids);
+
+	return ret;
+}
+
 struct subcommand command_start =
 {
 	.name         = "start",
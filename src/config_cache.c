@@ -0,0 +1,513 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Cache of the parsed \ref CC_OCI_CONFIG_FILE.
+ *
+ * Commands run after "create" only need the parts of the config file
+ * which are not recorded in \ref CC_OCI_STATE_FILE: the hooks and the
+ * "linux" section. These are saved by "create" to
+ * \ref CC_OCI_CONFIG_CACHE_FILE in a compact binary form so later
+ * commands can restore them without parsing the config file or
+ * running the spec handlers.
+ *
+ * The cache starts with a \ref cc_oci_config_cache_header recording
+ * the device, inode, mtime and size of the config file it was built
+ * from and a checksum of the payload which follows. A cache which
+ * doesn't match the config file is ignored and the config file is
+ * parsed as usual.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "oci.h"
+#include "util.h"
+#include "namespace.h"
+#include "oci-config.h"
+#include "config_cache.h"
+
+/** "CCCC" */
+#define CC_OCI_CONFIG_CACHE_MAGIC	0x43434343
+
+/** Bump whenever the payload format changes. */
+#define CC_OCI_CONFIG_CACHE_VERSION	1
+
+/** Length recorded for a \c NULL string or string vector. */
+#define CC_OCI_CONFIG_CACHE_NULL	G_MAXUINT32
+
+struct cc_oci_config_cache_header {
+	guint32  magic;
+	guint32  version;
+
+	/** identity of the config file the cache was built from */
+	guint64  dev;
+	guint64  ino;
+	gint64   mtime_sec;
+	gint64   mtime_nsec;
+	gint64   size;
+
+	/** size and checksum of the payload following the header */
+	guint32  payload_size;
+	guint32  checksum;
+};
+
+/** Position in the payload being decoded. */
+struct cc_oci_config_cache_reader {
+	const guint8  *p;
+	gsize          left;
+};
+
+/*!
+ * Calculate the checksum (32-bit FNV-1a) of \p data.
+ *
+ * \param data Data to checksum.
+ * \param len Length of \p data.
+ *
+ * \return Checksum.
+ */
+static guint32
+cc_oci_config_cache_checksum (const guint8 *data, gsize len)
+{
+	guint32 hash = 2166136261U;
+
+	for (gsize i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/*!
+ * Determine the full path to \ref CC_OCI_CONFIG_CACHE_FILE.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated path on success, else \c NULL.
+ */
+static gchar *
+cc_oci_config_cache_path (const struct cc_oci_config *config)
+{
+	if (! config->state.runtime_path[0]) {
+		return NULL;
+	}
+
+	return g_build_path ("/", config->state.runtime_path,
+			CC_OCI_CONFIG_CACHE_FILE, NULL);
+}
+
+static void
+put_u32 (GByteArray *buf, guint32 value)
+{
+	g_byte_array_append (buf, (const guint8 *)&value, sizeof (value));
+}
+
+static void
+put_str (GByteArray *buf, const gchar *str)
+{
+	gsize len;
+
+	if (! str) {
+		put_u32 (buf, CC_OCI_CONFIG_CACHE_NULL);
+		return;
+	}
+
+	len = strlen (str);
+
+	put_u32 (buf, (guint32)len);
+	g_byte_array_append (buf, (const guint8 *)str, (guint)len);
+}
+
+static void
+put_strv (GByteArray *buf, gchar **strv)
+{
+	if (! strv) {
+		put_u32 (buf, CC_OCI_CONFIG_CACHE_NULL);
+		return;
+	}
+
+	put_u32 (buf, g_strv_length (strv));
+
+	for (gchar **s = strv; *s; s++) {
+		put_str (buf, *s);
+	}
+}
+
+static void
+put_hooks (GByteArray *buf, GSList *hooks)
+{
+	put_u32 (buf, g_slist_length (hooks));
+
+	for (GSList *l = hooks; l; l = g_slist_next (l)) {
+		const struct oci_cfg_hook *hook = l->data;
+
+		put_str (buf, hook->path);
+		put_strv (buf, hook->args);
+		put_strv (buf, hook->env);
+		put_u32 (buf, (guint32)hook->timeout);
+	}
+}
+
+static gboolean
+get_u32 (struct cc_oci_config_cache_reader *r, guint32 *value)
+{
+	if (r->left < sizeof (*value)) {
+		return false;
+	}
+
+	memcpy (value, r->p, sizeof (*value));
+	r->p += sizeof (*value);
+	r->left -= sizeof (*value);
+
+	return true;
+}
+
+static gboolean
+get_str (struct cc_oci_config_cache_reader *r, gchar **str)
+{
+	guint32 len;
+
+	if (! get_u32 (r, &len)) {
+		return false;
+	}
+
+	if (len == CC_OCI_CONFIG_CACHE_NULL) {
+		*str = NULL;
+		return true;
+	}
+
+	if (r->left < len) {
+		return false;
+	}
+
+	*str = g_strndup ((const gchar *)r->p, len);
+	r->p += len;
+	r->left -= len;
+
+	return true;
+}
+
+static gboolean
+get_strv (struct cc_oci_config_cache_reader *r, gchar ***strv)
+{
+	guint32 count;
+
+	*strv = NULL;
+
+	if (! get_u32 (r, &count)) {
+		return false;
+	}
+
+	if (count == CC_OCI_CONFIG_CACHE_NULL) {
+		return true;
+	}
+
+	/* each string takes at least its length */
+	if (count > r->left / sizeof (guint32)) {
+		return false;
+	}
+
+	*strv = g_new0 (gchar *, count + 1);
+
+	for (guint32 i = 0; i < count; i++) {
+		if (! get_str (r, &(*strv)[i]) || ! (*strv)[i]) {
+			g_strfreev (*strv);
+			*strv = NULL;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static gboolean
+get_hooks (struct cc_oci_config_cache_reader *r, GSList **hooks)
+{
+	guint32 count;
+
+	if (! get_u32 (r, &count)) {
+		return false;
+	}
+
+	for (guint32 i = 0; i < count; i++) {
+		struct oci_cfg_hook  *hook;
+		g_autofree gchar     *path = NULL;
+		guint32               timeout;
+
+		hook = g_new0 (struct oci_cfg_hook, 1);
+		*hooks = g_slist_append (*hooks, hook);
+
+		if (! get_str (r, &path) || ! path) {
+			return false;
+		}
+
+		if (g_strlcpy (hook->path, path,
+				sizeof (hook->path)) >= sizeof (hook->path)) {
+			return false;
+		}
+
+		if (! (get_strv (r, &hook->args) &&
+				get_strv (r, &hook->env) &&
+				get_u32 (r, &timeout))) {
+			return false;
+		}
+
+		hook->timeout = (gint)timeout;
+	}
+
+	return true;
+}
+
+static gboolean
+get_namespaces (struct cc_oci_config_cache_reader *r, GSList **namespaces)
+{
+	guint32 count;
+
+	if (! get_u32 (r, &count)) {
+		return false;
+	}
+
+	for (guint32 i = 0; i < count; i++) {
+		struct oci_cfg_namespace  *ns;
+		guint32                    type;
+
+		ns = g_new0 (struct oci_cfg_namespace, 1);
+		*namespaces = g_slist_append (*namespaces, ns);
+
+		if (! (get_u32 (r, &type) && get_str (r, &ns->path))) {
+			return false;
+		}
+
+		ns->type = (enum oci_namespace)(gint32)type;
+	}
+
+	return true;
+}
+
+/*!
+ * Save the parts of the parsed \ref CC_OCI_CONFIG_FILE needed by
+ * later commands to \ref CC_OCI_CONFIG_CACHE_FILE.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_config_cache_save (const struct cc_oci_config *config)
+{
+	struct cc_oci_config_cache_header  header = { 0 };
+	g_autofree gchar                  *config_file = NULL;
+	g_autofree gchar                  *path = NULL;
+	g_autoptr(GError)                  err = NULL;
+	GByteArray                        *buf;
+	GSList                            *l;
+	struct stat                        st;
+	gboolean                           ret = false;
+
+	if (! (config && config->bundle_path)) {
+		return false;
+	}
+
+	path = cc_oci_config_cache_path (config);
+	if (! path) {
+		return false;
+	}
+
+	config_file = cc_oci_config_file_path (config->bundle_path);
+	if (! config_file) {
+		return false;
+	}
+
+	if (stat (config_file, &st) < 0) {
+		g_warning ("failed to stat %s: %s",
+				config_file, strerror (errno));
+		return false;
+	}
+
+	/* reserve space for the header */
+	buf = g_byte_array_sized_new (1024);
+	g_byte_array_append (buf, (const guint8 *)&header, sizeof (header));
+
+	put_hooks (buf, config->oci.hooks.prestart);
+	put_hooks (buf, config->oci.hooks.poststart);
+	put_hooks (buf, config->oci.hooks.poststop);
+
+	put_u32 (buf, g_slist_length (config->oci.oci_linux.namespaces));
+
+	for (l = config->oci.oci_linux.namespaces; l; l = g_slist_next (l)) {
+		const struct oci_cfg_namespace *ns = l->data;
+
+		put_u32 (buf, (guint32)ns->type);
+		put_str (buf, ns->path);
+	}
+
+	put_str (buf, config->oci.oci_linux.cgroupsPath);
+
+	header.magic = CC_OCI_CONFIG_CACHE_MAGIC;
+	header.version = CC_OCI_CONFIG_CACHE_VERSION;
+	header.dev = (guint64)st.st_dev;
+	header.ino = (guint64)st.st_ino;
+	header.mtime_sec = (gint64)st.st_mtim.tv_sec;
+	header.mtime_nsec = (gint64)st.st_mtim.tv_nsec;
+	header.size = (gint64)st.st_size;
+	header.payload_size = (guint32)(buf->len - sizeof (header));
+	header.checksum = cc_oci_config_cache_checksum (
+			buf->data + sizeof (header), header.payload_size);
+
+	memcpy (buf->data, &header, sizeof (header));
+
+	if (! g_file_set_contents (path, (const gchar *)buf->data,
+				(gssize)buf->len, &err)) {
+		g_warning ("failed to save config cache %s: %s",
+				path, err->message);
+		goto out;
+	}
+
+	g_debug ("saved config cache %s (%u bytes)", path, buf->len);
+
+	ret = true;
+
+out:
+	g_byte_array_free (buf, true);
+
+	return ret;
+}
+
+/*!
+ * Restore the parts of \ref CC_OCI_CONFIG_FILE saved by
+ * cc_oci_config_cache_save(), as if the "hooks" and "linux" spec
+ * handlers had been run.
+ *
+ * If the cache doesn't exist, is damaged or was built from a
+ * different \p config_file, \p config is not modified.
+ *
+ * \param[in,out] config \ref cc_oci_config.
+ * \param config_file Full path to \ref CC_OCI_CONFIG_FILE.
+ *
+ * \return \c true if \p config was updated from the cache, else
+ * \c false.
+ */
+gboolean
+cc_oci_config_cache_load (struct cc_oci_config *config,
+		const gchar *config_file)
+{
+	struct cc_oci_config_cache_header  header;
+	struct cc_oci_config_cache_reader  r;
+	struct oci_cfg_hooks               hooks = { NULL };
+	g_autofree gchar                  *path = NULL;
+	g_autofree gchar                  *contents = NULL;
+	gchar                             *cgroups_path = NULL;
+	GSList                            *namespaces = NULL;
+	gsize                              len = 0;
+	struct stat                        st;
+
+	if (! (config && config_file)) {
+		return false;
+	}
+
+	path = cc_oci_config_cache_path (config);
+	if (! path) {
+		return false;
+	}
+
+	if (! g_file_get_contents (path, &contents, &len, NULL)) {
+		return false;
+	}
+
+	if (stat (config_file, &st) < 0) {
+		return false;
+	}
+
+	if (len < sizeof (header)) {
+		goto out;
+	}
+
+	memcpy (&header, contents, sizeof (header));
+
+	if (header.magic != CC_OCI_CONFIG_CACHE_MAGIC ||
+			header.version != CC_OCI_CONFIG_CACHE_VERSION ||
+			header.payload_size != len - sizeof (header)) {
+		goto out;
+	}
+
+	if (header.dev != (guint64)st.st_dev ||
+			header.ino != (guint64)st.st_ino ||
+			header.mtime_sec != (gint64)st.st_mtim.tv_sec ||
+			header.mtime_nsec != (gint64)st.st_mtim.tv_nsec ||
+			header.size != (gint64)st.st_size) {
+		g_debug ("config cache %s does not match %s",
+				path, config_file);
+		goto out;
+	}
+
+	r.p = (const guint8 *)contents + sizeof (header);
+	r.left = header.payload_size;
+
+	if (header.checksum != cc_oci_config_cache_checksum (r.p, r.left)) {
+		goto out;
+	}
+
+	if (! (get_hooks (&r, &hooks.prestart) &&
+			get_hooks (&r, &hooks.poststart) &&
+			get_hooks (&r, &hooks.poststop) &&
+			get_namespaces (&r, &namespaces) &&
+			get_str (&r, &cgroups_path) &&
+			! r.left)) {
+		goto out;
+	}
+
+	/* Append, as the spec handlers do */
+	config->oci.hooks.prestart = g_slist_concat (
+			config->oci.hooks.prestart, hooks.prestart);
+	config->oci.hooks.poststart = g_slist_concat (
+			config->oci.hooks.poststart, hooks.poststart);
+	config->oci.hooks.poststop = g_slist_concat (
+			config->oci.hooks.poststop, hooks.poststop);
+	config->oci.oci_linux.namespaces = g_slist_concat (
+			config->oci.oci_linux.namespaces, namespaces);
+
+	if (cgroups_path) {
+		g_free_if_set (config->oci.oci_linux.cgroupsPath);
+		config->oci.oci_linux.cgroupsPath = cgroups_path;
+	}
+
+	g_debug ("using config cache %s", path);
+
+	return true;
+
+out:
+	g_debug ("ignoring config cache %s", path);
+
+	g_slist_free_full (hooks.prestart, (GDestroyNotify)cc_oci_hook_free);
+	g_slist_free_full (hooks.poststart, (GDestroyNotify)cc_oci_hook_free);
+	g_slist_free_full (hooks.poststop, (GDestroyNotify)cc_oci_hook_free);
+	g_slist_free_full (namespaces, (GDestroyNotify)cc_oci_ns_free);
+	g_free (cgroups_path);
+
+	return false;
+}
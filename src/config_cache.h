@@ -0,0 +1,37 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_CONFIG_CACHE_H
+#define _CC_OCI_CONFIG_CACHE_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** File below the container runtime directory holding the parts of
+ * the parsed \ref CC_OCI_CONFIG_FILE needed after "create".
+ */
+#define CC_OCI_CONFIG_CACHE_FILE	"config.cache"
+
+gboolean cc_oci_config_cache_save (const struct cc_oci_config *config);
+gboolean cc_oci_config_cache_load (struct cc_oci_config *config,
+		const gchar *config_file);
+
+#endif /* _CC_OCI_CONFIG_CACHE_H */
@@ -0,0 +1,618 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * "cc-oci-runtime daemon": a long-running runtime that handles
+ * commands sent by cc-oci-runtime-client.
+ *
+ * Every request is handled by a forked child so that commands remain
+ * isolated from each other (and from the daemon) exactly as if the
+ * runtime had been run directly, but without the cost of loading the
+ * runtime and reading its configuration each time: the child inherits
+ * everything the daemon loaded when it started.
+ *
+ * Commands that start processes outliving them (the hypervisor and
+ * cc-shim) are refused: those processes must be descendants of the
+ * caller, since callers such as containerd-shim and conmon are child
+ * subreapers that wait for the process in the --pid-file. Started by
+ * the daemon, they would be reparented to init once the child exits.
+ * The client runs the runtime itself for such commands.
+ *
+ * See daemon_protocol.h for the protocol.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include "daemon.h"
+#include "logging.h"
+
+/** Maximum number of pending connections. */
+#define CC_OCI_DAEMON_BACKLOG		64
+
+/** How often (in milliseconds) to reap children when idle. */
+#define CC_OCI_DAEMON_POLL_TIMEOUT	1000
+
+/** How long (in seconds) a client has to send its request. */
+#define CC_OCI_DAEMON_REQUEST_TIMEOUT	5
+
+/** Commands that start processes which must be descendants of the
+ * caller, so are refused.
+ */
+static const gchar *daemon_refused_commands[] = {
+	"create", "exec", "restore", "run", NULL
+};
+
+/** Set in a child when its command has been refused. */
+static gboolean daemon_refused;
+
+/** Function used to handle requests. */
+static cc_oci_daemon_handler daemon_handler;
+
+/** Set when the daemon has been asked to exit. */
+static volatile sig_atomic_t daemon_exit;
+
+/*!
+ * Set the function used to handle requests.
+ *
+ * \param handler \ref cc_oci_daemon_handler.
+ */
+void
+cc_oci_daemon_set_handler (cc_oci_daemon_handler handler)
+{
+	daemon_handler = handler;
+}
+
+/*!
+ * Determine if a command must be refused by the daemon.
+ *
+ * Called by the \ref cc_oci_daemon_handler once the command is known,
+ * before it is run. If the command is refused, the handler must return
+ * without running it and the client runs the runtime itself.
+ *
+ * \param cmd Name of the command.
+ *
+ * \return \c true if the command is refused, else \c false.
+ */
+gboolean
+cc_oci_daemon_refuse_command (const gchar *cmd)
+{
+	if (! cmd) {
+		return false;
+	}
+
+	if (g_strv_contains (daemon_refused_commands, cmd)) {
+		g_debug ("refusing command %s", cmd);
+		daemon_refused = true;
+	}
+
+	return daemon_refused;
+}
+
+static void
+daemon_handle_signal (int signum)
+{
+	(void)signum;
+
+	daemon_exit = 1;
+}
+
+/*!
+ * Split the strings of a request.
+ *
+ * \param payload Strings following \p request.
+ * \param request \ref cc_oci_daemon_request.
+ * \param[out] cwd Working directory of the client.
+ * \param[out] argv \c NULL-terminated argument vector.
+ * \param[out] envp \c NULL-terminated environment.
+ *
+ * \note The strings of \p argv and \p envp point into \p payload, so
+ * only the vectors themselves should be freed (with \c g_free()).
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_daemon_request_parse (const gchar *payload,
+		const struct cc_oci_daemon_request *request,
+		const gchar **cwd, gchar ***argv, gchar ***envp)
+{
+	const gchar  *p;
+	const gchar  *end;
+	gchar       **strv;
+	guint32       count;
+
+	if (! (payload && request && cwd && argv && envp)) {
+		return false;
+	}
+
+	if (request->magic != CC_OCI_DAEMON_MAGIC) {
+		g_warning ("invalid request magic: 0x%x", request->magic);
+		return false;
+	}
+
+	if (request->version != CC_OCI_DAEMON_VERSION) {
+		g_warning ("unsupported request version: %u",
+				request->version);
+		return false;
+	}
+
+	if (! request->argc || ! request->size ||
+			request->size > CC_OCI_DAEMON_MAX_REQUEST) {
+		g_warning ("invalid request");
+		return false;
+	}
+
+	/* each string needs at least its terminator */
+	if ((guint64)request->argc + request->envc + 1 > request->size) {
+		g_warning ("invalid request counts");
+		return false;
+	}
+
+	if (payload[request->size - 1]) {
+		g_warning ("request not terminated");
+		return false;
+	}
+
+	strv = g_new0 (gchar *, request->argc + request->envc + 2);
+	count = 0;
+
+	p = payload;
+	end = payload + request->size;
+
+	while (p < end) {
+		strv[count++] = (gchar *)p;
+		p += strlen (p) + 1;
+
+		if (count > request->argc + request->envc + 1) {
+			break;
+		}
+	}
+
+	if (count != request->argc + request->envc + 1) {
+		g_warning ("expected %u strings in request, found %u",
+				request->argc + request->envc + 1, count);
+		g_free (strv);
+		return false;
+	}
+
+	*cwd = strv[0];
+
+	*argv = g_new0 (gchar *, request->argc + 1);
+	memcpy (*argv, strv + 1, sizeof (gchar *) * request->argc);
+
+	*envp = g_new0 (gchar *, request->envc + 1);
+	memcpy (*envp, strv + 1 + request->argc,
+			sizeof (gchar *) * request->envc);
+
+	g_free (strv);
+
+	return true;
+}
+
+/*!
+ * Read a request from \p conn.
+ *
+ * \param conn Connected socket.
+ * \param[out] request \ref cc_oci_daemon_request.
+ * \param[out] fds Descriptors sent by the client.
+ *
+ * \return Newly-allocated strings of the request on success,
+ * else \c NULL.
+ */
+static gchar *
+daemon_read_request (int conn, struct cc_oci_daemon_request *request,
+		int fds[CC_OCI_DAEMON_FDS])
+{
+	struct msghdr    msg = { 0 };
+	struct iovec     io = { .iov_base = request,
+	                        .iov_len = sizeof (*request) };
+	char             ctl_buffer[CMSG_SPACE(sizeof (int) * CC_OCI_DAEMON_FDS)];
+	struct cmsghdr  *cmsg;
+	gchar           *payload = NULL;
+	gsize            got = 0;
+	ssize_t          ret;
+
+	msg.msg_iov = &io;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl_buffer;
+	msg.msg_controllen = sizeof (ctl_buffer);
+
+	do {
+		ret = recvmsg (conn, &msg, MSG_CMSG_CLOEXEC);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0) {
+		g_warning ("recvmsg failed: %s", strerror (errno));
+		return NULL;
+	}
+
+	cmsg = CMSG_FIRSTHDR (&msg);
+	if (! cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+			cmsg->cmsg_type != SCM_RIGHTS ||
+			cmsg->cmsg_len != CMSG_LEN (sizeof (int) * CC_OCI_DAEMON_FDS)) {
+		g_warning ("request did not include descriptors");
+		/* the client could have sent fewer descriptors */
+		if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+				cmsg->cmsg_type == SCM_RIGHTS) {
+			int   *received = (int *)CMSG_DATA (cmsg);
+			gsize  n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+
+			for (gsize i = 0; i < n; i++) {
+				close (received[i]);
+			}
+		}
+		return NULL;
+	}
+
+	memcpy (fds, CMSG_DATA (cmsg), sizeof (int) * CC_OCI_DAEMON_FDS);
+
+	if (ret != (ssize_t)sizeof (*request) ||
+			request->magic != CC_OCI_DAEMON_MAGIC ||
+			! request->size ||
+			request->size > CC_OCI_DAEMON_MAX_REQUEST) {
+		g_warning ("invalid request header");
+		goto err;
+	}
+
+	payload = g_malloc (request->size);
+
+	while (got < request->size) {
+		ret = read (conn, payload + got, request->size - got);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0) {
+			g_warning ("failed to read request");
+			goto err;
+		}
+		got += (gsize)ret;
+	}
+
+	return payload;
+
+err:
+	g_free (payload);
+	for (int i = 0; i < CC_OCI_DAEMON_FDS; i++) {
+		close (fds[i]);
+	}
+
+	return NULL;
+}
+
+/*!
+ * Run the command described by a request.
+ *
+ * Called in the child process; never returns.
+ *
+ * \param conn Connected socket.
+ * \param fds Descriptors sent by the client.
+ * \param cwd Working directory of the client.
+ * \param argv Argument vector.
+ * \param envp Environment.
+ */
+static void
+daemon_run_request (int conn, const int fds[CC_OCI_DAEMON_FDS],
+		const gchar *cwd, gchar **argv, gchar **envp)
+{
+	struct cc_oci_daemon_reply  reply = { 0 };
+	gboolean                    ret = false;
+	int                         argc = (int)g_strv_length (argv);
+
+	signal (SIGTERM, SIG_DFL);
+	signal (SIGINT, SIG_DFL);
+
+	for (int i = 0; i < CC_OCI_DAEMON_FDS; i++) {
+		if (dup2 (fds[i], i) < 0) {
+			goto out;
+		}
+		if (fds[i] > STDERR_FILENO) {
+			close (fds[i]);
+		}
+	}
+
+	if (chdir (cwd) < 0) {
+		g_critical ("failed to change directory to %s: %s",
+				cwd, strerror (errno));
+		goto out;
+	}
+
+	if (clearenv ()) {
+		goto out;
+	}
+
+	for (gchar **e = envp; e && *e; e++) {
+		(void)putenv (*e);
+	}
+
+	ret = daemon_handler (argc, argv);
+
+out:
+	fflush (NULL);
+	cc_oci_log_flush ();
+
+	reply.magic = CC_OCI_DAEMON_MAGIC;
+	reply.status = ret ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (daemon_refused) {
+		reply.status = CC_OCI_DAEMON_STATUS_REFUSED;
+	}
+
+	(void)send (conn, &reply, sizeof (reply), MSG_NOSIGNAL);
+
+	_exit (daemon_refused ? EXIT_FAILURE : reply.status);
+}
+
+/*!
+ * Handle a connection, running the request in a child process.
+ *
+ * \param listen_fd Listening socket.
+ * \param conn Connected socket.
+ */
+static void
+daemon_handle_connection (int listen_fd, int conn)
+{
+	struct cc_oci_daemon_request  request = { 0 };
+	struct ucred                  cred = { 0 };
+	struct timeval                timeout = {
+		.tv_sec = CC_OCI_DAEMON_REQUEST_TIMEOUT
+	};
+	socklen_t                     len = sizeof (cred);
+	int                           fds[CC_OCI_DAEMON_FDS] = { -1, -1, -1 };
+	gchar                        *payload = NULL;
+	const gchar                  *cwd = NULL;
+	gchar                       **argv = NULL;
+	gchar                       **envp = NULL;
+	pid_t                         pid;
+
+	if (getsockopt (conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+		g_warning ("failed to determine client credentials: %s",
+				strerror (errno));
+		return;
+	}
+
+	/* only allow clients that could run the runtime themselves */
+	if (cred.uid && cred.uid != geteuid ()) {
+		g_warning ("rejecting request from uid %u (pid %d)",
+				(unsigned)cred.uid, (int)cred.pid);
+		return;
+	}
+
+	/* Requests are read before forking, so a client that stalls
+	 * must not block the daemon.
+	 */
+	if (setsockopt (conn, SOL_SOCKET, SO_RCVTIMEO,
+				&timeout, sizeof (timeout)) < 0) {
+		g_warning ("failed to set request timeout: %s",
+				strerror (errno));
+		return;
+	}
+
+	payload = daemon_read_request (conn, &request, fds);
+	if (! payload) {
+		return;
+	}
+
+	if (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp)) {
+		goto out;
+	}
+
+	g_debug ("request from pid %d: %s", (int)cred.pid, argv[0]);
+
+	/* don't let the child flush buffered output of the daemon */
+	fflush (NULL);
+
+	pid = fork ();
+	if (pid < 0) {
+		g_critical ("failed to fork: %s", strerror (errno));
+		goto out;
+	} else if (pid == 0) {
+		close (listen_fd);
+		daemon_run_request (conn, fds, cwd, argv, envp);
+	}
+
+out:
+	for (int i = 0; i < CC_OCI_DAEMON_FDS; i++) {
+		close (fds[i]);
+	}
+	g_free (argv);
+	g_free (envp);
+	g_free (payload);
+}
+
+/*!
+ * Create the socket to listen for requests on.
+ *
+ * \param socket_path Path to create socket at.
+ *
+ * \return Listening socket on success, else \c -1.
+ */
+static int
+daemon_listen (const gchar *socket_path)
+{
+	struct sockaddr_un  addr = { 0 };
+	int                 fd;
+
+	if (strlen (socket_path) >= sizeof (addr.sun_path)) {
+		g_critical ("socket path too long: %s", socket_path);
+		return -1;
+	}
+
+	addr.sun_family = AF_UNIX;
+	g_strlcpy (addr.sun_path, socket_path, sizeof (addr.sun_path));
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		g_critical ("failed to create socket: %s", strerror (errno));
+		return -1;
+	}
+
+	/* a socket left behind by a daemon that is no longer running
+	 * can be replaced, but not one still in use.
+	 */
+	if (! connect (fd, (struct sockaddr *)&addr, sizeof (addr))) {
+		g_critical ("daemon already running on %s", socket_path);
+		goto err;
+	}
+
+	close (fd);
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		g_critical ("failed to create socket: %s", strerror (errno));
+		return -1;
+	}
+
+	if (unlink (socket_path) < 0 && errno != ENOENT) {
+		g_critical ("failed to remove %s: %s",
+				socket_path, strerror (errno));
+		goto err;
+	}
+
+	if (bind (fd, (struct sockaddr *)&addr, sizeof (addr)) < 0) {
+		g_critical ("failed to bind %s: %s",
+				socket_path, strerror (errno));
+		goto err;
+	}
+
+	if (chmod (socket_path, 0600) < 0) {
+		g_critical ("failed to set mode of %s: %s",
+				socket_path, strerror (errno));
+		goto err_unlink;
+	}
+
+	if (listen (fd, CC_OCI_DAEMON_BACKLOG) < 0) {
+		g_critical ("failed to listen on %s: %s",
+				socket_path, strerror (errno));
+		goto err_unlink;
+	}
+
+	return fd;
+
+err_unlink:
+	(void)unlink (socket_path);
+err:
+	close (fd);
+	return -1;
+}
+
+/*!
+ * Reap all children that have finished.
+ */
+static void
+daemon_reap (void)
+{
+	while (waitpid (-1, NULL, WNOHANG) > 0) {
+		;
+	}
+}
+
+/*!
+ * Handle requests until \c SIGTERM or \c SIGINT is received.
+ *
+ * \param socket_path Path to listen for requests on.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_daemon_run (const gchar *socket_path)
+{
+	struct sigaction  act = { 0 };
+	struct pollfd     pfd = { 0 };
+	int               fd;
+
+	if (! socket_path || ! daemon_handler) {
+		return false;
+	}
+
+	act.sa_handler = daemon_handle_signal;
+	sigemptyset (&act.sa_mask);
+
+	/* no SA_RESTART so poll() is interrupted */
+	if (sigaction (SIGTERM, &act, NULL) < 0 ||
+			sigaction (SIGINT, &act, NULL) < 0) {
+		g_critical ("failed to install signal handlers: %s",
+				strerror (errno));
+		return false;
+	}
+
+	fd = daemon_listen (socket_path);
+	if (fd < 0) {
+		return false;
+	}
+
+	g_debug ("listening on %s", socket_path);
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	daemon_exit = 0;
+
+	while (! daemon_exit) {
+		int conn;
+		int ret;
+
+		ret = poll (&pfd, 1, CC_OCI_DAEMON_POLL_TIMEOUT);
+
+		daemon_reap ();
+
+		if (ret <= 0) {
+			continue;
+		}
+
+		conn = accept4 (fd, NULL, NULL, SOCK_CLOEXEC);
+		if (conn < 0) {
+			if (errno != EINTR && errno != EAGAIN) {
+				g_warning ("accept failed: %s",
+						strerror (errno));
+			}
+			continue;
+		}
+
+		daemon_handle_connection (fd, conn);
+
+		close (conn);
+	}
+
+	g_debug ("exiting");
+
+	close (fd);
+	(void)unlink (socket_path);
+
+	daemon_reap ();
+
+	return true;
+}
@@ -0,0 +1,44 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_DAEMON_H
+#define _CC_OCI_DAEMON_H
+
+#include <glib.h>
+
+#include "daemon_protocol.h"
+
+/** Function run (in a child process) to handle a request.
+ *
+ * \param argc Argument count.
+ * \param argv Argument vector (including the program name).
+ *
+ * \return \c true on success, else \c false.
+ */
+typedef gboolean (*cc_oci_daemon_handler) (int argc, char **argv);
+
+void cc_oci_daemon_set_handler (cc_oci_daemon_handler handler);
+gboolean cc_oci_daemon_refuse_command (const gchar *cmd);
+gboolean cc_oci_daemon_run (const gchar *socket_path);
+gboolean cc_oci_daemon_request_parse (const gchar *payload,
+		const struct cc_oci_daemon_request *request,
+		const gchar **cwd, gchar ***argv, gchar ***envp);
+
+#endif /* _CC_OCI_DAEMON_H */
@@ -0,0 +1,252 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Client side of the "cc-oci-runtime daemon" protocol.
+ *
+ * Used by cc-oci-runtime-client, so only uses the C library.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "daemon_client.h"
+
+/*!
+ * Write all of \p len bytes of \p buf to \p fd.
+ *
+ * \return \c 0 on success, else \c -1.
+ */
+static int
+daemon_client_write (int fd, const char *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = send (fd, buf, len, MSG_NOSIGNAL);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+/*!
+ * Append the NUL-terminated strings in \p strv to \p buf.
+ *
+ * \param buf Buffer to append to.
+ * \param offset Offset to append at.
+ * \param strv Strings.
+ * \param count Number of strings in \p strv.
+ *
+ * \return New offset.
+ */
+static size_t
+daemon_client_pack (char *buf, size_t offset,
+		char *const strv[], uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		size_t len = strlen (strv[i]) + 1;
+
+		memcpy (buf + offset, strv[i], len);
+		offset += len;
+	}
+
+	return offset;
+}
+
+/*!
+ * Connect to the daemon listening on \p socket_path.
+ *
+ * \return Connected socket on success, else \c -1.
+ */
+static int
+daemon_client_connect (const char *socket_path)
+{
+	struct sockaddr_un addr = { 0 };
+	int fd;
+
+	if (strlen (socket_path) >= sizeof (addr.sun_path)) {
+		return -1;
+	}
+
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, socket_path);
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	if (connect (fd, (struct sockaddr *)&addr, sizeof (addr)) < 0) {
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*!
+ * Ask the daemon listening on \p socket_path to run a command on
+ * behalf of the caller.
+ *
+ * \param socket_path Path to the daemon's socket.
+ * \param argc Argument count.
+ * \param argv Argument vector (including the program name).
+ * \param envp Environment to run the command with.
+ * \param fds stdin, stdout and stderr to run the command with.
+ *
+ * \return \c -1 if the daemon could not be contacted or refused the
+ * command (in which case the caller should run the command itself),
+ * else the exit status of the command (\c EXIT_FAILURE if the daemon
+ * failed to reply).
+ */
+int
+cc_oci_daemon_client_run (const char *socket_path,
+		int argc, char *const argv[], char *const envp[],
+		const int fds[CC_OCI_DAEMON_FDS])
+{
+	struct cc_oci_daemon_request  request = { 0 };
+	struct cc_oci_daemon_reply    reply = { 0 };
+	struct msghdr                 msg = { 0 };
+	struct iovec                  io;
+	struct cmsghdr               *cmsg;
+	char                          ctl_buffer[CMSG_SPACE(sizeof (int) * CC_OCI_DAEMON_FDS)];
+	char                          cwd[PATH_MAX];
+	char                         *payload = NULL;
+	const char                   *cwd_strv[] = { cwd };
+	uint32_t                      envc = 0;
+	size_t                        size;
+	size_t                        offset;
+	size_t                        got = 0;
+	ssize_t                       ret;
+	int                           fd;
+	int                           status = EXIT_FAILURE;
+
+	if (! socket_path || argc <= 0 || ! argv || ! fds) {
+		return -1;
+	}
+
+	if (! getcwd (cwd, sizeof (cwd))) {
+		return -1;
+	}
+
+	size = strlen (cwd) + 1;
+
+	for (int i = 0; i < argc; i++) {
+		size += strlen (argv[i]) + 1;
+	}
+
+	for (; envp && envp[envc]; envc++) {
+		size += strlen (envp[envc]) + 1;
+	}
+
+	if (size > CC_OCI_DAEMON_MAX_REQUEST) {
+		return -1;
+	}
+
+	fd = daemon_client_connect (socket_path);
+	if (fd < 0) {
+		return -1;
+	}
+
+	payload = malloc (size);
+	if (! payload) {
+		goto out;
+	}
+
+	offset = daemon_client_pack (payload, 0,
+			(char *const *)cwd_strv, 1);
+	offset = daemon_client_pack (payload, offset,
+			argv, (uint32_t)argc);
+	(void)daemon_client_pack (payload, offset, envp, envc);
+
+	request.magic = CC_OCI_DAEMON_MAGIC;
+	request.version = CC_OCI_DAEMON_VERSION;
+	request.argc = (uint32_t)argc;
+	request.envc = envc;
+	request.size = (uint32_t)size;
+
+	io.iov_base = &request;
+	io.iov_len = sizeof (request);
+
+	msg.msg_iov = &io;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl_buffer;
+	msg.msg_controllen = sizeof (ctl_buffer);
+
+	cmsg = CMSG_FIRSTHDR (&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN (sizeof (int) * CC_OCI_DAEMON_FDS);
+	memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * CC_OCI_DAEMON_FDS);
+
+	do {
+		ret = sendmsg (fd, &msg, MSG_NOSIGNAL);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret != (ssize_t)sizeof (request)) {
+		goto out;
+	}
+
+	if (daemon_client_write (fd, payload, size) < 0) {
+		goto out;
+	}
+
+	/* wait for the command to finish */
+	while (got < sizeof (reply)) {
+		ret = read (fd, (char *)&reply + got, sizeof (reply) - got);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0) {
+			goto out;
+		}
+		got += (size_t)ret;
+	}
+
+	if (reply.magic != CC_OCI_DAEMON_MAGIC) {
+		goto out;
+	}
+
+	status = reply.status == CC_OCI_DAEMON_STATUS_REFUSED ?
+		-1 : reply.status;
+
+out:
+	free (payload);
+	close (fd);
+
+	return status;
+}
@@ -0,0 +1,30 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_DAEMON_CLIENT_H
+#define _CC_OCI_DAEMON_CLIENT_H
+
+#include "daemon_protocol.h"
+
+int cc_oci_daemon_client_run (const char *socket_path,
+		int argc, char *const argv[], char *const envp[],
+		const int fds[CC_OCI_DAEMON_FDS]);
+
+#endif /* _CC_OCI_DAEMON_CLIENT_H */
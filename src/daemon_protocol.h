@@ -0,0 +1,89 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Protocol spoken between cc-oci-runtime-client and
+ * "cc-oci-runtime daemon".
+ *
+ * This header is shared with the client, so must only use the C
+ * library.
+ *
+ * A request is a \ref cc_oci_daemon_request sent with the client's
+ * stdin, stdout and stderr attached as \c SCM_RIGHTS, followed by
+ * \ref cc_oci_daemon_request.size bytes of NUL-terminated strings:
+ * the client's working directory, then \ref cc_oci_daemon_request.argc
+ * arguments, then \ref cc_oci_daemon_request.envc environment
+ * variables.
+ *
+ * Once the command has finished (and its output has been flushed),
+ * the daemon sends a \ref cc_oci_daemon_reply and closes the
+ * connection. Commands the daemon cannot run on behalf of the client
+ * are answered with \ref CC_OCI_DAEMON_STATUS_REFUSED, in which case
+ * the client runs the runtime itself.
+ */
+
+#ifndef _CC_OCI_DAEMON_PROTOCOL_H
+#define _CC_OCI_DAEMON_PROTOCOL_H
+
+#include <stdint.h>
+
+/** Default socket "cc-oci-runtime daemon" listens on. */
+#define CC_OCI_DAEMON_SOCKET		"/run/cc-oci-runtime.sock"
+
+/** Environment variable overriding \ref CC_OCI_DAEMON_SOCKET. */
+#define CC_OCI_DAEMON_SOCKET_ENV	"CC_OCI_RUNTIME_SOCKET"
+
+/** "CCOD" */
+#define CC_OCI_DAEMON_MAGIC		0x43434f44
+
+/** Bump whenever the protocol changes. */
+#define CC_OCI_DAEMON_VERSION		1
+
+/** Number of fds sent with a request (stdin, stdout and stderr). */
+#define CC_OCI_DAEMON_FDS		3
+
+/** Maximum size of the strings of a request. */
+#define CC_OCI_DAEMON_MAX_REQUEST	(1024 * 1024)
+
+/** Reply status of a command the daemon refused to run. */
+#define CC_OCI_DAEMON_STATUS_REFUSED	(-1)
+
+struct cc_oci_daemon_request {
+	uint32_t  magic;
+	uint32_t  version;
+	uint32_t  argc;
+	uint32_t  envc;
+
+	/** Size of the strings following the request. */
+	uint32_t  size;
+};
+
+struct cc_oci_daemon_reply {
+	uint32_t  magic;
+
+	/** Exit status of the command, or
+	 * \ref CC_OCI_DAEMON_STATUS_REFUSED.
+	 */
+	int32_t   status;
+};
+
+#endif /* _CC_OCI_DAEMON_PROTOCOL_H */
@@ -18,21 +18,126 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/types.h>
+
 #include <glib.h>
+#include <gio/gio.h>
 #include <json-glib/json-glib.h>
 #include <stdbool.h>
 #include "oci.h"
 #include "util.h"
+#include "state.h"
+#include "runtime.h"
+#include "network.h"
+#include "config_cache.h"
+#include "stats.h"
+#include "events.h"
+
+/** Size of buffer used to read inotify events and QMP messages. */
+#define EVENTS_BUF_SIZE 4096
+
+/** Events watched for in the runtime root directory. */
+#define EVENTS_ROOT_MASK \
+	(IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_ONLYDIR)
+
+/** Events watched for in a container's runtime directory. */
+#define EVENTS_CONTAINER_MASK \
+	(IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR)
 
-/** used by watcher_destroyed_vm() */
-struct watcher_vm_data
+struct stats_sampler;
+
+/** A container sampled by the stats sampler. */
+struct stats_watch
 {
-	GMainLoop              *loop;
-	struct cc_oci_config *config;
-	struct oci_state *state;
-	gboolean result;
+	/** Container id. */
+	gchar                 *id;
+
+	struct cc_oci_config  *config;
+	struct oci_state      *state;
+
+	/** If \c true, \ref config and \ref state belong to the watch. */
+	gboolean               owned;
+
+	/** \ref stats_sampler the watch belongs to. */
+	struct stats_sampler  *sampler;
+
+	/** Last known status, used to report pause and resume. */
+	enum oci_status        status;
+
+	/** Connection to the hypervisor's \ref CC_OCI_EVENTS_SOCKET,
+	 * or \c NULL.
+	 */
+	GSocket               *qmp;
+
+	/** Event source for \ref qmp. */
+	guint                  qmp_source;
+
+	/** Data received from \ref qmp not yet handled. */
+	GString               *qmp_received;
+
+	/** Previous sample, used to calculate deltas. */
+	struct cc_oci_stats    prev;
+	gboolean               have_prev;
+
+	/** Number of records shown. */
+	guint64                seq;
+
+	/** Time spent sampling the container (usec). */
+	gint64                 cost;
+
+	/** Number of samples taken. */
+	guint64                samples;
 };
 
+/** State of the stats sampler. */
+struct stats_sampler
+{
+	GMainLoop    *loop;
+
+	/** \ref stats_watch for each container sampled, by id. */
+	GHashTable   *watches;
+
+	/** Directory to scan for containers, or \c NULL to sample a
+	 * single container.
+	 */
+	const gchar  *root_dir;
+
+	/** \ref cc_oci_config of the command. */
+	struct cc_oci_config *config;
+
+	/** If \c true, show only the counters that changed. */
+	gboolean      delta;
+
+	/** If \c true, show lifecycle events as well as stats. */
+	gboolean      events;
+
+	/** inotify instance watching \ref root_dir and the container
+	 * directories below it, or \c -1.
+	 */
+	int           inotify_fd;
+
+	/** Event source for \ref inotify_fd. */
+	guint         inotify_source;
+
+	/** inotify watch descriptor of \ref root_dir. */
+	int           root_wd;
+
+	/** Container ids, by inotify watch descriptor of their
+	 * runtime directory.
+	 */
+	GHashTable   *dirs;
+
+	/** Records not shown yet. */
+	GString      *out;
+
+	/** Set if the last sample of a single container failed. */
+	gboolean      failed;
+};
 
 /**
  * Stops show_container_stats main loop when the 
@@ -43,19 +148,19 @@ struct watcher_vm_data
  * \param file \c GFile.
  * \param other_file \c GFile.
  * \param event_type \c GFileMonitorEvent.
- * \param data \ref watcher_destroyed_vm.
+ * \param sampler \ref stats_sampler.
  */
 static void
 watcher_destroyed_vm (GFileMonitor            *monitor,
 		GFile                        *file,
 		GFile                        *other_file,
 		GFileMonitorEvent             event_type,
-		struct watcher_vm_data *data)
+		struct stats_sampler         *sampler)
 {
 	g_autofree gchar  *path = NULL;
 	g_autofree gchar  *name = NULL;
 
-	g_assert (data);
+	g_assert (sampler);
 
 	if (event_type != G_FILE_MONITOR_EVENT_DELETED) {
 		return;
@@ -75,147 +180,1034 @@ watcher_destroyed_vm (GFileMonitor            *monitor,
 	/* file was removed, remove monitor */
 	g_object_unref (monitor);
 
-	g_main_loop_quit (data->loop);
+	g_main_loop_quit (sampler->loop);
+}
+
+/*!
+ * Show the records added to the sampler's output, in a single write.
+ *
+ * \param sampler \ref stats_sampler.
+ */
+static void
+stats_sampler_flush (struct stats_sampler *sampler)
+{
+	if (! sampler->out->len) {
+		return;
+	}
+
+	g_print ("%s", sampler->out->str);
+	g_string_truncate (sampler->out, 0);
+}
+
+/*!
+ * Add a record to the sampler's output.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param root \c JsonObject of record.
+ */
+static void
+stats_sampler_add (struct stats_sampler *sampler, JsonObject *root)
+{
+	gchar  *str;
+	gsize   str_len = 0;
+
+	str = cc_oci_json_obj_to_string (root, false, &str_len);
+	if (! str) {
+		return;
+	}
+
+	g_string_append_len (sampler->out, str, (gssize)str_len);
+	g_string_append_c (sampler->out, '\n');
+
+	g_free (str);
+}
+
+/*!
+ * Add a lifecycle event record to the sampler's output.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param type Type of event ("exit", "oom", "pause" or "resume").
+ * \param id Container id.
+ */
+static void
+stats_sampler_event (struct stats_sampler *sampler, const gchar *type,
+		const gchar *id)
+{
+	JsonObject        *root;
+	g_autofree gchar  *timestamp = NULL;
+
+	if (! sampler->events) {
+		return;
+	}
+
+	timestamp = cc_oci_get_iso8601_timestamp ();
+
+	root = json_object_new ();
+
+	json_object_set_string_member (root, "type", type);
+	json_object_set_string_member (root, "id", id);
+	json_object_set_string_member (root, "time", timestamp);
+
+	stats_sampler_add (sampler, root);
+
+	json_object_unref (root);
 }
 
 /*!
- * Get container stats (cpu, memory, etc) in json format.
+ * Create a \ref stats_watch.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param id Container id.
  * \param config \ref cc_oci_config.
  * \param state \ref oci_state.
+ * \param owned If \c true, \p config and \p state are freed with
+ *   the watch.
+ *
+ * \return Newly-allocated \ref stats_watch.
+ */
+static struct stats_watch *
+stats_watch_new (struct stats_sampler *sampler, const gchar *id,
+		struct cc_oci_config *config,
+		struct oci_state *state, gboolean owned)
+{
+	struct stats_watch *watch;
+
+	watch = g_new0 (struct stats_watch, 1);
+
+	watch->id = g_strdup (id);
+	watch->sampler = sampler;
+	watch->config = config;
+	watch->state = state;
+	watch->owned = owned;
+
+	cc_oci_stats_init (&watch->prev);
+
+	return watch;
+}
+
+/*!
+ * Close the connection of a \ref stats_watch to the hypervisor's
+ * \ref CC_OCI_EVENTS_SOCKET.
+ *
+ * \param watch \ref stats_watch.
+ */
+static void
+stats_watch_qmp_close (struct stats_watch *watch)
+{
+	if (watch->qmp_source) {
+		g_source_remove (watch->qmp_source);
+		watch->qmp_source = 0;
+	}
+
+	if (watch->qmp) {
+		g_object_unref (watch->qmp);
+		watch->qmp = NULL;
+	}
+
+	if (watch->qmp_received) {
+		g_string_free (watch->qmp_received, true);
+		watch->qmp_received = NULL;
+	}
+}
+
+/*!
+ * Free a \ref stats_watch.
+ *
+ * \param watch \ref stats_watch.
+ */
+static void
+stats_watch_free (struct stats_watch *watch)
+{
+	if (! watch) {
+		return;
+	}
+
+	if (watch->samples) {
+		g_debug ("sampled container %s %" G_GUINT64_FORMAT
+				" times in %" G_GINT64_FORMAT "us (%"
+				G_GINT64_FORMAT "us per sample)",
+				watch->id, watch->samples, watch->cost,
+				watch->cost / (gint64)watch->samples);
+	}
+
+	stats_watch_qmp_close (watch);
+
+	cc_oci_stats_clear (&watch->prev);
+
+	if (watch->owned) {
+		cc_oci_state_free (watch->state);
+		cc_oci_config_free (watch->config);
+	}
+
+	g_free (watch->id);
+	g_free (watch);
+}
+
+/*!
+ * Determine if the hypervisor of a container is still running.
+ *
+ * \param watch \ref stats_watch.
+ *
+ * \return \c true if the hypervisor is running (or the container has
+ * no hypervisor of its own), else \c false.
+ */
+static gboolean
+stats_watch_alive (const struct stats_watch *watch)
+{
+	GPid pid;
+
+	if (! (watch->state && watch->state->vm)) {
+		return true;
+	}
+
+	pid = watch->state->vm->pid;
+	if (pid <= 0) {
+		return true;
+	}
+
+	return kill (pid, 0) == 0 || errno == EPERM;
+}
+
+/*!
+ * Stop watching a container whose hypervisor has exited.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param id Container id.
+ */
+static void
+stats_sampler_exited (struct stats_sampler *sampler, const gchar *id)
+{
+	g_autofree gchar *name = g_strdup (id);
+
+	if (! g_hash_table_remove (sampler->watches, id)) {
+		return;
+	}
+
+	stats_sampler_event (sampler, "exit", name);
+}
+
+/*!
+ * Record a change of status of a watched container, reporting
+ * pause and resume.
+ *
+ * \param watch \ref stats_watch.
+ * \param status New status.
+ */
+static void
+stats_watch_set_status (struct stats_watch *watch, enum oci_status status)
+{
+	if (status == watch->status) {
+		return;
+	}
+
+	if (status == OCI_STATUS_PAUSED) {
+		stats_sampler_event (watch->sampler, "pause", watch->id);
+	} else if (watch->status == OCI_STATUS_PAUSED &&
+			status == OCI_STATUS_RUNNING) {
+		stats_sampler_event (watch->sampler, "resume", watch->id);
+	}
+
+	watch->status = status;
+}
+
+/*!
+ * Handle data from the hypervisor's \ref CC_OCI_EVENTS_SOCKET.
+ *
+ * \param channel \c GIOChannel (unused).
+ * \param condition \c GIOCondition.
+ * \param watch \ref stats_watch.
+ *
+ * \return \c G_SOURCE_CONTINUE, or \c G_SOURCE_REMOVE once the
+ * hypervisor has closed the socket.
+ */
+static gboolean
+stats_watch_qmp_cb (GIOChannel *channel, GIOCondition condition,
+		struct stats_watch *watch)
+{
+	struct stats_sampler  *sampler = watch->sampler;
+	gchar                  buffer[EVENTS_BUF_SIZE];
+	gssize                 bytes;
+	GError                *error = NULL;
+	GSList                *events;
+
+	(void)channel;
+
+	bytes = g_socket_receive (watch->qmp, buffer, sizeof (buffer),
+			NULL, &error);
+	if (bytes < 0 && g_error_matches (error,
+				G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+		g_error_free (error);
+		return G_SOURCE_CONTINUE;
+	}
+
+	if (bytes <= 0) {
+		if (error) {
+			g_debug ("failed to receive hypervisor events "
+					"for container %s: %s",
+					watch->id, error->message);
+			g_error_free (error);
+		}
+
+		/* the source is removed by returning */
+		watch->qmp_source = 0;
+		stats_watch_qmp_close (watch);
+
+		if (! stats_watch_alive (watch)) {
+			stats_sampler_exited (sampler, watch->id);
+			stats_sampler_flush (sampler);
+		}
+
+		return G_SOURCE_REMOVE;
+	}
+
+	g_string_append_len (watch->qmp_received, buffer, bytes);
+
+	events = cc_oci_qmp_events_parse (watch->qmp_received);
+
+	for (GSList *l = events; l; l = g_slist_next (l)) {
+		if (! g_strcmp0 (l->data, "STOP")) {
+			stats_watch_set_status (watch, OCI_STATUS_PAUSED);
+		} else if (! g_strcmp0 (l->data, "RESUME")) {
+			stats_watch_set_status (watch, OCI_STATUS_RUNNING);
+		}
+	}
+
+	g_slist_free_full (events, g_free);
+
+	stats_sampler_flush (sampler);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/*!
+ * Connect to the hypervisor's \ref CC_OCI_EVENTS_SOCKET, if it has
+ * one, to be told when the VM is paused and resumed.
+ *
+ * Without the socket (VMs started with an older hypervisor.args),
+ * pause and resume are reported from the state file.
+ *
+ * \param watch \ref stats_watch.
+ */
+static void
+stats_watch_qmp_connect (struct stats_watch *watch)
+{
+	g_autofree gchar  *path = NULL;
+	GIOChannel        *channel;
+
+	if (watch->qmp || ! watch->sampler->events) {
+		return;
+	}
+
+	path = g_build_path ("/", watch->config->state.runtime_path,
+			CC_OCI_EVENTS_SOCKET, NULL);
+
+	if (! g_file_test (path, G_FILE_TEST_EXISTS)) {
+		return;
+	}
+
+	watch->qmp = cc_oci_qmp_events_connect (path);
+	if (! watch->qmp) {
+		return;
+	}
+
+	watch->qmp_received = g_string_new (NULL);
+
+	channel = g_io_channel_unix_new (g_socket_get_fd (watch->qmp));
+	watch->qmp_source = g_io_add_watch (channel,
+			G_IO_IN | G_IO_HUP | G_IO_ERR,
+			(GIOFunc)stats_watch_qmp_cb, watch);
+	g_io_channel_unref (channel);
+}
+
+/*!
+ * Load the details of a container found by the sampler.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param id Container id.
+ *
+ * \return Newly-allocated \ref stats_watch, or \c NULL if the
+ * container is not running or paused.
+ */
+static struct stats_watch *
+stats_watch_load (struct stats_sampler *sampler, const gchar *id)
+{
+	struct cc_oci_config  *config;
+	struct oci_state      *state = NULL;
+	struct stats_watch    *watch;
+	g_autofree gchar      *config_file = NULL;
+
+	config = cc_oci_config_create ();
+	if (! config) {
+		return NULL;
+	}
+
+	watch = stats_watch_new (sampler, id, config, NULL, true);
+
+	if (sampler->config->root_dir) {
+		config->root_dir = g_strdup (sampler->config->root_dir);
+	}
+
+	config->optarg_container_id = watch->id;
+
+	if (! cc_oci_get_config_and_state (&config_file, config, &state)) {
+		goto err;
+	}
+
+	watch->state = state;
+	watch->status = config->state.status;
+
+	if (! (watch->status == OCI_STATUS_RUNNING ||
+				watch->status == OCI_STATUS_PAUSED)) {
+		goto err;
+	}
+
+	/* the state file isn't updated when the VM goes away */
+	if (! stats_watch_alive (watch)) {
+		goto err;
+	}
+
+	if (! cc_oci_config_update (config, state)) {
+		goto err;
+	}
+
+	/* only needed for the memory limit */
+	(void)cc_oci_config_cache_load (config, config_file);
+
+	stats_watch_qmp_connect (watch);
+
+	return watch;
+
+err:
+	stats_watch_free (watch);
+	return NULL;
+}
+
+/*!
+ * Sample the stats of a container, adding a record to the sampler's
+ * output unless only deltas are shown and nothing changed.
  *
- * \return json string on success, else NULL
+ * Records include the time taken to sample the container
+ * ("cost_us"). If lifecycle events are shown, an increase of the
+ * number of OOM kills in the container is reported too.
+ *
+ * \param watch \ref stats_watch.
+ *
+ * \return \c true on success, else \c false.
  */
-static gchar*
-get_container_stats(struct cc_oci_config *config,
-	struct oci_state *state)
+static gboolean
+stats_watch_sample (struct stats_watch *watch)
 {
-	JsonObject  *root = NULL;
-	JsonObject  *data = NULL;
-	JsonObject  *resources = NULL;
-	gchar       *stats_str = NULL;
-	gsize        str_len = 0;
+	struct stats_sampler *sampler = watch->sampler;
+	JsonObject           *root = NULL;
+	JsonObject           *data;
+	struct cc_oci_stats   stats;
+	gint64                start;
+	gint64                cost;
+	gboolean              ret = false;
 
+	cc_oci_stats_init (&stats);
 
-	if(config->state.status != OCI_STATUS_RUNNING){
+	start = g_get_monotonic_time ();
+
+	if (! cc_oci_stats_get (watch->config, watch->state, &stats)) {
 		goto out;
 	}
 
-	root = json_object_new ();
-	data = json_object_new ();
-	resources = json_object_new ();
+	cost = g_get_monotonic_time () - start;
+
+	watch->cost += cost;
+	watch->samples++;
 
-	/* Get CPU stats*/
-	//FIXME: Implment cpu usage
-	json_object_set_object_member (resources, "cpu_stats", json_object_new());
+	if (watch->have_prev &&
+			stats.values[CC_OCI_STAT_MEM_OOM_KILLS] >
+			watch->prev.values[CC_OCI_STAT_MEM_OOM_KILLS]) {
+		stats_sampler_event (sampler, "oom", watch->id);
+	}
 
-	/* Get Memory stats*/
-	//FIXME: Implment memory usage
-	json_object_set_object_member (resources, "memory_stats", json_object_new());
+	if (sampler->delta) {
+		data = json_object_new ();
 
-	/* Add resoruces node to data node */
-	/* 
-	   FIXME:
-	   We dont use cgroups but, let use  CgroupStats node name
-	   to make docker happy
-        */
-	json_object_set_object_member (data, "CgroupStats", resources);
+		if (! cc_oci_stats_delta (watch->have_prev ? &watch->prev : NULL,
+					&stats, data) && watch->have_prev) {
+			/* nothing to show */
+			json_object_unref (data);
+			ret = true;
+			goto swap;
+		}
+	} else {
+		data = cc_oci_stats_to_json (&stats);
+	}
+
+	root = json_object_new ();
 
 	/* Add root elements */
-	json_object_set_string_member (root, "type", "stats");
-	json_object_set_string_member (root, "id", config->optarg_container_id);
-	json_object_set_string_member (root, "id", config->optarg_container_id);
+	json_object_set_string_member (root, "type",
+			sampler->delta ? "stats-delta" : "stats");
+	json_object_set_string_member (root, "id", watch->id);
+	if (sampler->delta) {
+		json_object_set_int_member (root, "seq",
+				(gint64)watch->seq);
+	}
+	json_object_set_int_member (root, "cost_us", cost);
 	json_object_set_object_member (root, "data", data);
-	stats_str = cc_oci_json_obj_to_string (root, false, &str_len);
+
+	stats_sampler_add (sampler, root);
+
+	watch->seq++;
+	ret = true;
+
+swap:
+	/* keep the sample to calculate the next delta */
+	cc_oci_stats_clear (&watch->prev);
+	watch->prev = stats;
+	watch->have_prev = true;
+	cc_oci_stats_init (&stats);
 
 out:
-	return stats_str;
+	if (root) {
+		json_object_unref (root);
+	}
+	cc_oci_stats_clear (&stats);
+
+	return ret;
+}
+
+/*!
+ * Start watching the runtime directory of a container, and sample
+ * the container if it is running.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param id Container id.
+ */
+static void
+stats_sampler_add_container (struct stats_sampler *sampler,
+		const gchar *id)
+{
+	struct stats_watch  *watch;
+
+	if (sampler->inotify_fd >= 0) {
+		g_autofree gchar  *path = NULL;
+		int                wd;
+
+		path = g_build_path ("/", sampler->root_dir, id, NULL);
+
+		/* watches are per-inode, so adding one twice is harmless */
+		wd = inotify_add_watch (sampler->inotify_fd, path,
+				EVENTS_CONTAINER_MASK);
+		if (wd < 0) {
+			g_debug ("failed to watch %s: %s",
+					path, strerror (errno));
+			return;
+		}
+
+		g_hash_table_replace (sampler->dirs, GINT_TO_POINTER (wd),
+				g_strdup (id));
+	}
+
+	if (g_hash_table_contains (sampler->watches, id)) {
+		return;
+	}
+
+	watch = stats_watch_load (sampler, id);
+	if (! watch) {
+		return;
+	}
+
+	g_hash_table_insert (sampler->watches, watch->id, watch);
+}
+
+/*!
+ * Handle a change to the state file of a container.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param id Container id.
+ */
+static void
+stats_sampler_state_changed (struct stats_sampler *sampler,
+		const gchar *id)
+{
+	struct stats_watch  *watch;
+	struct oci_state    *state;
+
+	watch = g_hash_table_lookup (sampler->watches, id);
+	if (! watch) {
+		/* the container may have started */
+		stats_sampler_add_container (sampler, id);
+		return;
+	}
+
+	state = cc_oci_state_file_read_summary (
+			watch->config->state.state_file_path);
+	if (! state) {
+		return;
+	}
+
+	if (state->status == OCI_STATUS_RUNNING ||
+			state->status == OCI_STATUS_PAUSED) {
+		/* the hypervisor reports pause and resume first */
+		if (! watch->qmp) {
+			stats_watch_set_status (watch, state->status);
+		}
+
+		watch->config->state.status = state->status;
+	} else {
+		g_hash_table_remove (sampler->watches, id);
+	}
+
+	cc_oci_state_free (state);
+}
+
+/*!
+ * Handle an inotify event.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param event \c inotify_event.
+ */
+static void
+stats_sampler_handle_inotify (struct stats_sampler *sampler,
+		const struct inotify_event *event)
+{
+	const gchar *id;
+
+	if (event->mask & IN_Q_OVERFLOW) {
+		GSList *ids;
+
+		g_debug ("inotify queue overflowed, rescanning %s",
+				sampler->root_dir);
+
+		ids = cc_oci_runtime_container_ids (sampler->root_dir);
+		for (GSList *l = ids; l; l = g_slist_next (l)) {
+			stats_sampler_add_container (sampler, l->data);
+		}
+		g_slist_free_full (ids, g_free);
+
+		return;
+	}
+
+	if (event->wd == sampler->root_wd) {
+		if (! (event->len && (event->mask & IN_ISDIR))) {
+			return;
+		}
+
+		if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+			stats_sampler_add_container (sampler, event->name);
+		} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+			(void)g_hash_table_remove (sampler->watches,
+					event->name);
+		}
+
+		return;
+	}
+
+	if (event->mask & IN_IGNORED) {
+		/* the container directory was deleted */
+		(void)g_hash_table_remove (sampler->dirs,
+				GINT_TO_POINTER (event->wd));
+		return;
+	}
+
+	id = g_hash_table_lookup (sampler->dirs, GINT_TO_POINTER (event->wd));
+	if (! (id && event->len)) {
+		return;
+	}
+
+	if (! g_strcmp0 (event->name, CC_OCI_STATE_FILE)) {
+		if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+			stats_sampler_state_changed (sampler, id);
+		}
+	} else if (! g_strcmp0 (event->name, CC_OCI_PROCESS_SOCKET)) {
+		if (event->mask & IN_DELETE) {
+			stats_sampler_exited (sampler, id);
+		}
+	} else if (! g_strcmp0 (event->name, CC_OCI_EVENTS_SOCKET)) {
+		struct stats_watch *watch;
+
+		watch = g_hash_table_lookup (sampler->watches, id);
+		if (watch && (event->mask & IN_CREATE)) {
+			stats_watch_qmp_connect (watch);
+		}
+	}
+}
+
+/*!
+ * Handle the inotify events for the runtime root directory and the
+ * container directories below it.
+ *
+ * \param channel \c GIOChannel (unused).
+ * \param condition \c GIOCondition.
+ * \param sampler \ref stats_sampler.
+ *
+ * \return \c G_SOURCE_CONTINUE, or \c G_SOURCE_REMOVE on error.
+ */
+static gboolean
+stats_sampler_inotify_cb (GIOChannel *channel, GIOCondition condition,
+		struct stats_sampler *sampler)
+{
+	gchar    buffer[EVENTS_BUF_SIZE]
+		__attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	ssize_t  len;
+
+	(void)channel;
+
+	if (condition & (G_IO_HUP | G_IO_ERR)) {
+		goto err;
+	}
+
+	len = read (sampler->inotify_fd, buffer, sizeof (buffer));
+	if (len < 0) {
+		if (errno == EINTR || errno == EAGAIN) {
+			return G_SOURCE_CONTINUE;
+		}
+
+		g_critical ("failed to read inotify events: %s",
+				strerror (errno));
+		goto err;
+	}
+
+	for (gchar *p = buffer; p < buffer + len; ) {
+		const struct inotify_event *event;
+
+		event = (const struct inotify_event *)p;
+		stats_sampler_handle_inotify (sampler, event);
+
+		p += sizeof (struct inotify_event) + event->len;
+	}
+
+	stats_sampler_flush (sampler);
+
+	return G_SOURCE_CONTINUE;
+
+err:
+	sampler->inotify_source = 0;
+	g_main_loop_quit (sampler->loop);
+
+	return G_SOURCE_REMOVE;
 }
 
+/*!
+ * Watch the runtime root directory for containers being created and
+ * deleted, and their directories for changes of state.
+ *
+ * \param sampler \ref stats_sampler.
+ *
+ * \return \c true on success, else \c false.
+ */
 static gboolean
-show_interval_stats(struct watcher_vm_data *data)
+stats_sampler_watch_root (struct stats_sampler *sampler)
 {
-	gchar       *stats_str = NULL;
-	stats_str = get_container_stats(data->config, data->state);
-	if (!stats_str){
+	GIOChannel *channel;
+
+	/* no containers have been created yet */
+	if (g_mkdir_with_parents (sampler->root_dir, CC_OCI_DIR_MODE)) {
+		g_critical ("failed to create directory %s: %s",
+				sampler->root_dir, strerror (errno));
+		return false;
+	}
+
+	sampler->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (sampler->inotify_fd < 0) {
+		g_critical ("failed to create inotify instance: %s",
+				strerror (errno));
+		return false;
+	}
+
+	sampler->root_wd = inotify_add_watch (sampler->inotify_fd,
+			sampler->root_dir, EVENTS_ROOT_MASK);
+	if (sampler->root_wd < 0) {
+		g_critical ("failed to watch %s: %s",
+				sampler->root_dir, strerror (errno));
 		return false;
 	}
-	g_print("%s", stats_str);
+
+	channel = g_io_channel_unix_new (sampler->inotify_fd);
+	sampler->inotify_source = g_io_add_watch (channel,
+			G_IO_IN | G_IO_HUP | G_IO_ERR,
+			(GIOFunc)stats_sampler_inotify_cb, sampler);
+	g_io_channel_unref (channel);
+
 	return true;
 }
 
 /*!
- * Show container stats.
- * If interval param is \c 0 will show the stats once and exit;
- * otherwise the function will block and show stats after
- * "interval" seconds.
- * \param config \ref cc_oci_config.
- * \param state \ref oci_state.
- * \param state \ref interval to show.
- * \param interval seconds to pause between displaying statistics.
+ * Sample all running containers, showing the records in a single
+ * write.
  *
- * \return \c true on success, else \c false.
+ * \param sampler \ref stats_sampler.
+ *
+ * \return \c G_SOURCE_CONTINUE, or \c G_SOURCE_REMOVE if a single
+ * container is sampled and sampling it failed.
  */
-gboolean
-show_container_stats(struct cc_oci_config *config,
-	struct oci_state *state, int interval)
+static gboolean
+stats_sampler_run (struct stats_sampler *sampler)
 {
+	GHashTableIter  iter;
+	gpointer        value;
+	GSList         *exited = NULL;
 
-	gchar       *stats_str = NULL;
-	gboolean     result = false;
+	g_hash_table_iter_init (&iter, sampler->watches);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		struct stats_watch *watch = value;
+
+		/* the agent can't answer while the VM is paused */
+		if (watch->status == OCI_STATUS_PAUSED) {
+			continue;
+		}
+
+		if (stats_watch_sample (watch)) {
+			continue;
+		}
 
+		if (! sampler->root_dir) {
+			g_critical ("failed to get stats for container %s",
+					watch->id);
+			sampler->failed = true;
+			continue;
+		}
+
+		g_debug ("failed to get stats for container %s", watch->id);
+
+		if (! stats_watch_alive (watch)) {
+			exited = g_slist_prepend (exited, g_strdup (watch->id));
+		}
+	}
+
+	for (GSList *l = exited; l; l = g_slist_next (l)) {
+		stats_sampler_exited (sampler, l->data);
+	}
+
+	g_slist_free_full (exited, g_free);
+
+	stats_sampler_flush (sampler);
+
+	return sampler->failed ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+}
+
+/*!
+ * Run the stats sampler.
+ *
+ * If \p interval is \c 0, the containers are sampled once; otherwise
+ * the function blocks, sampling the containers every \p interval
+ * milliseconds. A single container is sampled until its VM is
+ * destroyed; with a root directory, containers are picked up and
+ * dropped as they start and stop until the command is interrupted.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param interval Milliseconds between samples.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+stats_sampler_loop (struct stats_sampler *sampler, guint interval)
+{
 	GError        *error = NULL;
 	GFile         *file = NULL;
 	GFileMonitor  *monitor = NULL;
-	struct watcher_vm_data  data = {0};
+	GSList        *ids;
+	gboolean       ret = false;
 
 	if (interval) {
-		data.loop = g_main_loop_new (NULL, 0);
-		data.config = config;
-		data.state = state;
-		if (! data.loop) {
+		sampler->loop = g_main_loop_new (NULL, 0);
+		if (! sampler->loop) {
 			g_critical ("cannot create main loop");
 			goto out;
 		}
+	}
+
+	if (sampler->root_dir) {
+		/* watch before scanning to not miss any container */
+		if (interval && ! stats_sampler_watch_root (sampler)) {
+			goto out;
+		}
+
+		ids = cc_oci_runtime_container_ids (sampler->root_dir);
+		for (GSList *l = ids; l; l = g_slist_next (l)) {
+			stats_sampler_add_container (sampler, l->data);
+		}
+		g_slist_free_full (ids, g_free);
+	}
 
-		file = g_file_new_for_path (config->state.runtime_path);
+	(void)stats_sampler_run (sampler);
+
+	if (! interval) {
+		ret = ! sampler->failed;
+		goto out;
+	}
+
+	if (! sampler->root_dir) {
+		file = g_file_new_for_path (sampler->config->state.runtime_path);
 		if (! file) {
-			g_main_loop_unref (data.loop);
 			goto out;
 		}
+
 		monitor = g_file_monitor_directory (file,
 				G_FILE_MONITOR_WATCH_MOVES,
 				NULL, &error);
 		if (! monitor) {
 			g_critical ("failed to monitor %s: %s",
-					g_file_get_path (file),
+					sampler->config->state.runtime_path,
 					error->message);
 			g_error_free (error);
-			g_object_unref (file);
-			g_main_loop_unref (data.loop);
-
 			goto out;
 		}
 
+		/* Monitor when vm is destroyed */
 		g_signal_connect (monitor, "changed",
 				G_CALLBACK (watcher_destroyed_vm),
-				&data);
+				sampler);
+	}
 
-		g_timeout_add_seconds ((guint) interval,
-				       (GSourceFunc) show_interval_stats,
-				       (gpointer) &data);
+	g_timeout_add (interval, (GSourceFunc) stats_sampler_run, sampler);
 
-		/* Monitor when vm is destroyed */
-		g_main_loop_run (data.loop);
-	}else {
-		stats_str = get_container_stats(config, state);
-		if (!stats_str){
-			goto out;
-		}
-		g_print("%s", stats_str);
-	}
+	g_main_loop_run (sampler->loop);
+
+	ret = true;
 
-	result = true;
 out:
-	g_free_if_set(stats_str);
-	return result;
+	if (file) {
+		g_object_unref (file);
+	}
+	if (sampler->loop) {
+		g_main_loop_unref (sampler->loop);
+	}
+
+	return ret;
+}
+
+/*!
+ * Initialise a \ref stats_sampler.
+ *
+ * \param sampler \ref stats_sampler.
+ * \param config \ref cc_oci_config.
+ * \param root_dir Directory to scan for containers, or \c NULL.
+ * \param delta If \c true, only show the counters that changed.
+ */
+static void
+stats_sampler_init (struct stats_sampler *sampler,
+		struct cc_oci_config *config, const gchar *root_dir,
+		gboolean delta)
+{
+	memset (sampler, 0, sizeof (*sampler));
+
+	sampler->config = config;
+	sampler->root_dir = root_dir;
+	sampler->delta = delta;
+	sampler->inotify_fd = -1;
+	sampler->root_wd = -1;
+	sampler->out = g_string_new (NULL);
+	sampler->watches = g_hash_table_new_full (g_str_hash, g_str_equal,
+			NULL, (GDestroyNotify)stats_watch_free);
+	sampler->dirs = g_hash_table_new_full (g_direct_hash,
+			g_direct_equal, NULL, g_free);
+}
+
+/*!
+ * Free the resources held by \p sampler.
+ *
+ * \param sampler \ref stats_sampler.
+ */
+static void
+stats_sampler_clear (struct stats_sampler *sampler)
+{
+	g_hash_table_destroy (sampler->watches);
+	g_hash_table_destroy (sampler->dirs);
+
+	if (sampler->inotify_source) {
+		g_source_remove (sampler->inotify_source);
+	}
+
+	if (sampler->inotify_fd >= 0) {
+		close (sampler->inotify_fd);
+	}
+
+	g_string_free (sampler->out, true);
+}
+
+/*!
+ * Show container stats.
+ * If interval param is \c 0 will show the stats once and exit;
+ * otherwise the function will block and show stats every
+ * "interval" milliseconds until the container VM is destroyed.
+ *
+ * \param config \ref cc_oci_config.
+ * \param state \ref oci_state.
+ * \param interval milliseconds to pause between displaying statistics.
+ * \param delta If \c true, only show the counters that changed.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+show_container_stats (struct cc_oci_config *config,
+	struct oci_state *state, guint interval, gboolean delta)
+{
+	struct stats_sampler  sampler;
+	struct stats_watch   *watch;
+	gboolean              ret;
+
+	if (! (config && state)) {
+		return false;
+	}
+
+	if (config->state.status != OCI_STATUS_RUNNING) {
+		return false;
+	}
+
+	stats_sampler_init (&sampler, config, NULL, delta);
+
+	watch = stats_watch_new (&sampler, config->optarg_container_id,
+			config, state, false);
+	watch->status = config->state.status;
+	g_hash_table_insert (sampler.watches, watch->id, watch);
+
+	ret = stats_sampler_loop (&sampler, interval);
+
+	stats_sampler_clear (&sampler);
+
+	return ret;
+}
+
+/*!
+ * Show the events of all containers as JSON lines.
+ *
+ * If \p interval is \c 0, the stats of all running containers are
+ * shown once. Otherwise the function blocks until interrupted,
+ * showing the stats of the running containers every \p interval
+ * milliseconds, and the "exit", "oom", "pause" and "resume" events
+ * of all containers as they happen.
+ *
+ * A single inotify instance watches the runtime root directory and
+ * the container directories below it for containers being created,
+ * changing state and exiting. Where the hypervisor provides a
+ * \ref CC_OCI_EVENTS_SOCKET, pause and resume are reported from its
+ * QMP events. OOM kills are found by sampling the stats.
+ *
+ * \param config \ref cc_oci_config.
+ * \param interval milliseconds to pause between displaying
+ *   statistics, or \c 0 to show them once.
+ * \param delta If \c true, only show the counters that changed.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+show_all_container_events (struct cc_oci_config *config,
+	guint interval, gboolean delta)
+{
+	struct stats_sampler  sampler;
+	gboolean              ret;
+
+	if (! config) {
+		return false;
+	}
+
+	stats_sampler_init (&sampler, config, config->root_dir
+			? config->root_dir
+			: CC_OCI_RUNTIME_DIR_PREFIX,
+			delta);
+
+	sampler.events = interval != 0;
+
+	ret = stats_sampler_loop (&sampler, interval);
+
+	stats_sampler_clear (&sampler);
+
+	return ret;
 }
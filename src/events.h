@@ -23,5 +23,8 @@
 
 gboolean
 show_container_stats(struct cc_oci_config *config,
-	struct oci_state *state, int interval);
+	struct oci_state *state, guint interval, gboolean delta);
+gboolean
+show_all_container_events(struct cc_oci_config *config,
+	guint interval, gboolean delta);
 #endif /* _CC_OCI_EVENTS_H */
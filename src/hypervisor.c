@@ -200,6 +200,7 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 	gchar            *console_device = NULL;
 	gchar		 *hypervisor_console = NULL;
 	g_autofree gchar *procsock_device = NULL;
+	g_autofree gchar *events_socket = NULL;
 
 	gboolean          ret = false;
 	gint              count;
@@ -273,6 +274,9 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 
 	procsock_device = g_strdup_printf ("socket,id=procsock,path=%s,server,nowait", config->state.procsock_path);
 
+	events_socket = g_build_path ("/", config->state.runtime_path,
+			CC_OCI_EVENTS_SOCKET, NULL);
+
 	proxy = config->proxy;
 
 	proxy->vm_console_socket = hypervisor_console;
@@ -299,6 +303,7 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 		{ "@IMAGE@"             , config->vm->image_path     },
 		{ "@SIZE@"              , bytes                      },
 		{ "@COMMS_SOCKET@"      , config->state.comms_path   },
+		{ "@EVENTS_SOCKET@"     , events_socket              },
 		{ "@PROCESS_SOCKET@"    , procsock_device            },
 		{ "@CONSOLE_DEVICE@"    , console_device             },
 		{ "@NAME@"              , g_strrstr(uuid_str, "-")+1 },
@@ -505,6 +510,50 @@ out:
 	return ret;
 }
 
+/*!
+ * Add the arguments to load the state of the VM from a checkpoint
+ * image, if the VM is being restored.
+ *
+ * \param config \ref cc_oci_config.
+ * \param additional_args Array to append to.
+ */
+static void
+cc_oci_append_incoming_args(struct cc_oci_config *config,
+			GPtrArray *additional_args)
+{
+	gchar *path;
+	gchar *quoted;
+
+	if (! (config && config->restore_path && additional_args)) {
+		return;
+	}
+
+	path = g_build_path ("/", config->restore_path,
+			CC_OCI_CHECKPOINT_VM_FILE, NULL);
+	quoted = g_shell_quote (path);
+
+	g_ptr_array_add(additional_args, g_strdup("-incoming"));
+	g_ptr_array_add(additional_args,
+			g_strdup_printf ("exec:cat %s", quoted));
+
+	g_free (quoted);
+	g_free (path);
+
+	/* Main memory saved separately is mapped (privately) rather
+	 * than read, so that pages are only loaded when the guest
+	 * touches them.
+	 */
+	path = g_build_path ("/", config->restore_path,
+			CC_OCI_CHECKPOINT_RAM_FILE, NULL);
+
+	if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		g_ptr_array_add(additional_args, g_strdup("-mem-path"));
+		g_ptr_array_add(additional_args, path);
+	} else {
+		g_free (path);
+	}
+}
+
 /*!
  * Populate array that will be appended to hypervisor command line.
  *
@@ -524,6 +573,7 @@ cc_oci_populate_extra_args(struct cc_oci_config *config ,
 
 	cc_oci_append_network_args(config, additional_args);
 	cc_oci_append_storage_args(config, additional_args);
+	cc_oci_append_incoming_args(config, additional_args);
 
 	return;
 }
@@ -20,9 +20,12 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <json-glib/json-glib.h>
 
+#include "json.h"
+
 /**
  * Buffer which must be large enough to hold the string representation
  * of any JSON node type (\c GType).
@@ -136,22 +139,21 @@ cc_oci_json_parse_aux(JsonNode* root, GNode* node, bool parsing_array) {
 }
 
 /*!
- * Convert a JSON file into a tree of nodes.
+ * Load and parse a JSON file.
  *
- * \param[out] node Tree representation of \p filename.
  * \param filename Absolute path to JSON file to parse.
  *
- * \return \c true on success, else \c false.
+ * \return \c JsonParser holding the parsed file on success (to be
+ * released with \c g_object_unref()), else \c NULL.
  */
-bool
-cc_oci_json_parse (GNode** node, const gchar* filename) {
-	bool result = false;
+JsonParser *
+cc_oci_json_load (const gchar *filename)
+{
 	GError* error = NULL;
 	JsonParser* parser = NULL;
-	JsonNode *root = NULL;
 
-	if ((!node) || (!filename) || (!(*filename))) {
-		return false;
+	if ((!filename) || (!(*filename))) {
+		return NULL;
 	}
 
 	parser = json_parser_new();
@@ -161,20 +163,295 @@ cc_oci_json_parse (GNode** node, const gchar* filename) {
 			g_debug("Error parsing '%s': %s", filename, error->message);
 			g_error_free(error);
 		}
-		goto exit;
+		g_object_unref(parser);
+		return NULL;
 	}
 
-	root = json_parser_get_root (parser);
-	if (! root) {
-		goto exit;
+	if (! json_parser_get_root (parser)) {
+		g_object_unref(parser);
+		return NULL;
 	}
 
-	*node = g_node_new(g_strdup(filename));
-	cc_oci_json_parse_aux(root, *node, false);
+	return parser;
+}
+
+/*!
+ * Convert a JSON file into a tree of nodes.
+ *
+ * \param[out] node Tree representation of \p filename.
+ * \param filename Absolute path to JSON file to parse.
+ *
+ * \return \c true on success, else \c false.
+ */
+bool
+cc_oci_json_parse (GNode** node, const gchar* filename) {
+	JsonParser* parser = NULL;
 
-	result = true;
+	if ((!node) || (!filename) || (!(*filename))) {
+		return false;
+	}
+
+	parser = cc_oci_json_load (filename);
+	if (! parser) {
+		return false;
+	}
+
+	*node = g_node_new(g_strdup(filename));
+	cc_oci_json_parse_aux(json_parser_get_root (parser), *node, false);
 
-exit:
 	g_object_unref(parser);
-	return result;
+	return true;
+}
+
+/*!
+ * Convert a single JSON object member into a tree of nodes.
+ *
+ * The tree is identical to the subtree \ref cc_oci_json_parse()
+ * creates for the member, so it can be passed to the existing
+ * section handlers.
+ *
+ * \param name Name of the member.
+ * \param value Value of the member.
+ *
+ * \return Newly-allocated \c GNode on success, else \c NULL.
+ */
+GNode *
+cc_oci_json_member_to_node (const gchar *name, JsonNode *value)
+{
+	GNode *node;
+
+	if (! (name && value)) {
+		return NULL;
+	}
+
+	node = g_node_new(g_strdup(name));
+	cc_oci_json_parse_aux(value, node, false);
+
+	return node;
+}
+
+/*!
+ * Find the key with the specified name.
+ *
+ * \param keys \c NULL terminated array of \ref cc_oci_json_key's.
+ * \param name Name of JSON object member.
+ *
+ * \return \ref cc_oci_json_key on success, else \c NULL.
+ */
+const struct cc_oci_json_key *
+cc_oci_json_key_find (const struct cc_oci_json_key *keys,
+		const gchar *name)
+{
+	const struct cc_oci_json_key *key;
+
+	if (! (keys && name)) {
+		return NULL;
+	}
+
+	for (key = keys; key->name; key++) {
+		if (! g_strcmp0 (key->name, name)) {
+			return key;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * Determine if \p node can be decoded as a value of the specified
+ * type.
+ *
+ * \param node \c JsonNode.
+ * \param type \ref cc_oci_json_type.
+ * \param[out] number Value of \p node for \ref CC_OCI_JSON_INT.
+ *
+ * \return \c true if \p node can be decoded, else \c false.
+ */
+static gboolean
+cc_oci_json_value_check (JsonNode *node, enum cc_oci_json_type type,
+		gint64 *number)
+{
+	GType        value_type;
+	const gchar *str;
+	gchar       *endptr = NULL;
+
+	if (JSON_NODE_TYPE (node) != JSON_NODE_VALUE) {
+		return false;
+	}
+
+	value_type = json_node_get_value_type (node);
+
+	switch (type) {
+	case CC_OCI_JSON_STRING:
+	case CC_OCI_JSON_STRBUF:
+		return value_type == G_TYPE_STRING;
+
+	case CC_OCI_JSON_INT:
+		if (value_type == G_TYPE_INT64) {
+			*number = json_node_get_int (node);
+		} else if (value_type == G_TYPE_STRING) {
+			str = json_node_get_string (node);
+			*number = g_ascii_strtoll (str, &endptr, 10);
+			if (endptr == str || *endptr) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+		return *number >= G_MININT && *number <= G_MAXINT;
+
+	case CC_OCI_JSON_BOOLEAN:
+		return value_type == G_TYPE_BOOLEAN;
+	}
+
+	return false;
+}
+
+/*!
+ * Decode \p node into the struct member described by \p key.
+ *
+ * \param node \c JsonNode.
+ * \param key \ref cc_oci_json_key.
+ * \param base Struct containing the member.
+ * \param decode If \c false, only check that \p node can be decoded.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_json_value_decode (JsonNode *node, const struct cc_oci_json_key *key,
+		gpointer base, gboolean decode)
+{
+	gpointer  member;
+	gint64    number = 0;
+	gchar   **str;
+
+	if (! cc_oci_json_value_check (node, key->type, &number)) {
+		return false;
+	}
+
+	if (key->type == CC_OCI_JSON_STRBUF &&
+			strlen (json_node_get_string (node)) >= key->size) {
+		return false;
+	}
+
+	if (! decode) {
+		return true;
+	}
+
+	member = G_STRUCT_MEMBER_P (base, key->offset);
+
+	switch (key->type) {
+	case CC_OCI_JSON_STRING:
+		str = member;
+		g_free (*str);
+		*str = json_node_dup_string (node);
+		break;
+
+	case CC_OCI_JSON_STRBUF:
+		g_strlcpy (member, json_node_get_string (node), key->size);
+		break;
+
+	case CC_OCI_JSON_INT:
+		*(gint *)member = (gint)number;
+		break;
+
+	case CC_OCI_JSON_BOOLEAN:
+		*(gboolean *)member = json_node_get_boolean (node);
+		break;
+	}
+
+	return true;
+}
+
+/*!
+ * Decode a single JSON value into the struct member described by
+ * \p key.
+ *
+ * \param node \c JsonNode.
+ * \param key \ref cc_oci_json_key.
+ * \param base Struct containing the member.
+ *
+ * \return \c true on success, else \c false (\p base is untouched).
+ */
+gboolean
+cc_oci_json_decode_value (JsonNode *node, const struct cc_oci_json_key *key,
+		gpointer base)
+{
+	if (! (node && key && base)) {
+		return false;
+	}
+
+	return cc_oci_json_value_decode (node, key, base, true);
+}
+
+/*!
+ * Decode \p node into the struct members described by \p keys.
+ *
+ * If the first key of \p keys has no name, \p node is a single
+ * value described by that key. Otherwise \p node must be an object
+ * (or \c null) whose members are all described by \p keys.
+ *
+ * Decoding is all or nothing: if any value cannot be decoded (unknown
+ * member, unexpected type, string too long), \p base is left
+ * untouched so the caller can fall back to the \c GNode handlers.
+ *
+ * \param node \c JsonNode.
+ * \param keys Array of \ref cc_oci_json_key's.
+ * \param base Struct the values are decoded into.
+ *
+ * \return Number of values decoded on success, else \c -1.
+ */
+gint
+cc_oci_json_decode (JsonNode *node, const struct cc_oci_json_key *keys,
+		gpointer base)
+{
+	const struct cc_oci_json_key *key;
+	JsonObject *object;
+	GList      *members = NULL;
+	GList      *l;
+	gint        count = 0;
+
+	if (! (node && keys && base)) {
+		return -1;
+	}
+
+	if (! keys->name) {
+		return cc_oci_json_value_decode (node, keys, base, true)
+			? 1 : -1;
+	}
+
+	if (JSON_NODE_HOLDS_NULL (node)) {
+		return 0;
+	}
+
+	if (JSON_NODE_TYPE (node) != JSON_NODE_OBJECT) {
+		return -1;
+	}
+
+	object = json_node_get_object (node);
+	members = json_object_get_members (object);
+
+	/* check every member first so nothing is decoded on error */
+	for (l = members; l; l = g_list_next (l)) {
+		key = cc_oci_json_key_find (keys, l->data);
+		if (! (key && cc_oci_json_value_decode (
+				json_object_get_member (object, l->data),
+				key, base, false))) {
+			count = -1;
+			goto out;
+		}
+	}
+
+	for (l = members; l; l = g_list_next (l)) {
+		key = cc_oci_json_key_find (keys, l->data);
+		(void)cc_oci_json_value_decode (
+				json_object_get_member (object, l->data),
+				key, base, true);
+		count++;
+	}
+
+out:
+	g_list_free (members);
+
+	return count;
 }
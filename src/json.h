@@ -25,6 +25,55 @@
 
 #include <json-glib/json-glib.h>
 
+/*! Type of the struct member a JSON value is decoded into. */
+enum cc_oci_json_type {
+	/** \c gchar pointer, set to a newly-allocated string. */
+	CC_OCI_JSON_STRING,
+
+	/** \c gchar array of \ref cc_oci_json_key.size bytes. */
+	CC_OCI_JSON_STRBUF,
+
+	/** \c gint, from a number or a string holding a number. */
+	CC_OCI_JSON_INT,
+
+	/** \c gboolean. */
+	CC_OCI_JSON_BOOLEAN,
+};
+
+/*!
+ * Describes how a JSON value is decoded directly into a struct member,
+ * without going through the \c GNode representation.
+ *
+ * Arrays of keys describing the members of an object are terminated
+ * by an entry with a \c NULL name. An array holding a single entry
+ * with a \c NULL name describes a JSON value that is not an object.
+ */
+struct cc_oci_json_key {
+	/** Name of the JSON object member. */
+	const gchar           *name;
+
+	/** Type of the struct member. */
+	enum cc_oci_json_type  type;
+
+	/** Offset of the member in the struct. */
+	glong                  offset;
+
+	/** Size of the struct member. */
+	gsize                  size;
+};
+
+/** Declare a \ref cc_oci_json_key for \a member of \a st. */
+#define CC_OCI_JSON_KEY(name, type, st, member) \
+	{ name, type, G_STRUCT_OFFSET (st, member), sizeof (((st *)0)->member) }
+
 bool cc_oci_json_parse (GNode** node, const gchar* filename);
+JsonParser *cc_oci_json_load (const gchar *filename);
+GNode *cc_oci_json_member_to_node (const gchar *name, JsonNode *value);
+const struct cc_oci_json_key *cc_oci_json_key_find
+	(const struct cc_oci_json_key *keys, const gchar *name);
+gboolean cc_oci_json_decode_value (JsonNode *node,
+		const struct cc_oci_json_key *key, gpointer base);
+gint cc_oci_json_decode (JsonNode *node,
+		const struct cc_oci_json_key *keys, gpointer base);
 
 #endif /* _CC_OCI_JSON_H */
@@ -26,6 +26,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <syslog.h>
+#include <pthread.h>
+#include <sys/uio.h>
 
 #include <glib.h>
 #include <glib/gprintf.h>
@@ -60,8 +62,43 @@
 #define HYPERVISOR_STDOUT_FILE "hypervisor.stdout"
 #define HYPERVISOR_STDERR_FILE "hypervisor.stderr"
 
+/** Maximum number of records buffered for a logfile. */
+#define CC_OCI_LOG_RECORDS 64
+
+/** Maximum number of bytes buffered for a logfile. */
+#define CC_OCI_LOG_BUFFERED_MAX (64 * 1024)
+
+/** Number of logfiles that can be open (container and global). */
+#define CC_OCI_LOG_FILES 2
+
+/** A logfile, kept open for the lifetime of the process. */
+struct cc_oci_log_file {
+	/** Full path to logfile (\c NULL if slot unused). */
+	gchar         *path;
+
+	/** File descriptor (opened on first flush), or -1. */
+	int            fd;
+
+	/** Records waiting to be written. */
+	struct iovec   records[CC_OCI_LOG_RECORDS];
+
+	/** Number of \ref records used. */
+	guint          count;
+
+	/** Total size of \ref records. */
+	gsize          size;
+};
+
 static gchar* hypervisor_log_dir;
 
+/** Options passed to cc_oci_log_init(). */
+static const struct cc_log_options *cc_oci_log_options;
+
+static struct cc_oci_log_file cc_oci_log_files[CC_OCI_LOG_FILES];
+
+/** Protects \ref cc_oci_log_files. */
+static GMutex cc_oci_log_lock;
+
 /*!
  * Last-ditch logging routine which sends an error
  * message to syslog.
@@ -221,81 +258,276 @@ cc_oci_msg_fmt (const gchar *log_domain,
 }
 
 /*!
- * Write a log message.
+ * Open \p file for appending if it isn't already open.
+ *
+ * The logfile is re-opened if it has been removed or replaced
+ * (for example by log rotation) since it was opened.
  *
  * \warning Note that this function should not call any glib log
  * handling functions (g_debug(), etc) to avoid going recursive.
  *
- * \param filename Full path of file to write message to.
- * \param message Text to write to \p filename.
+ * \param file \ref cc_oci_log_file.
  *
  * \return \c true on success, else \c false.
  */
 static gboolean
-cc_oci_log_msg_write (const char *filename, const char *message)
+cc_oci_log_file_open (struct cc_oci_log_file *file)
 {
-	GIOChannel  *channel = NULL;
-	GError      *err = NULL;
-	GIOStatus    status;
-	gboolean     ret = false;
-	int          fd;
+	struct stat  path_st;
+	struct stat  fd_st;
 	int          flags = (O_CREAT | O_APPEND | O_WRONLY | O_CLOEXEC);
 
-	g_assert (filename);
-	g_assert (message);
+	if (file->fd != -1) {
+		if (stat (file->path, &path_st) == 0 &&
+				fstat (file->fd, &fd_st) == 0 &&
+				path_st.st_dev == fd_st.st_dev &&
+				path_st.st_ino == fd_st.st_ino) {
+			return true;
+		}
 
-	fd = open (filename, flags, CC_OCI_LOGFILE_MODE);
-	if (fd < 0) {
+		close (file->fd);
+	}
+
+	file->fd = open (file->path, flags, CC_OCI_LOGFILE_MODE);
+	if (file->fd < 0) {
 		CC_OCI_ERROR ("failed to open logfile %s for writing: %s",
-				filename, strerror (errno));
-		goto out;
+				file->path, strerror (errno));
+		return false;
 	}
 
-	/* append to file if it already exists */
-	channel = g_io_channel_unix_new (fd);
-	if (! channel) {
-		CC_OCI_ERROR ("failed to create I/O channel");
-		goto out;
+	return true;
+}
+
+/*!
+ * Write all buffered records of \p file.
+ *
+ * Records are written with a single \c writev() where possible, so
+ * that (thanks to \c O_APPEND) they are not interleaved with records
+ * written by other processes.
+ *
+ * \warning Note that this function should not call any glib log
+ * handling functions (g_debug(), etc) to avoid going recursive.
+ *
+ * \param file \ref cc_oci_log_file.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_log_file_flush (struct cc_oci_log_file *file)
+{
+	struct iovec   iovecs[CC_OCI_LOG_RECORDS];
+	struct iovec  *iov = iovecs;
+	guint          count = file->count;
+	gboolean       ret = false;
+	ssize_t        bytes;
+
+	if (! count) {
+		return true;
 	}
 
-	status = g_io_channel_write_chars (
-			channel,
-			message,
-			-1, /* signify it's a string */
-			NULL, /* bytes written */
-			&err);
+	/* copied since a short write modifies them */
+	memcpy (iovecs, file->records, count * sizeof (struct iovec));
 
-	if (status != G_IO_STATUS_NORMAL) {
-		CC_OCI_ERROR ("failed to write to I/O channel: %s",
-				err->message);
-		g_error_free (err);
+	if (! cc_oci_log_file_open (file)) {
 		goto out;
 	}
 
-	status = g_io_channel_shutdown (channel,
-			TRUE, /* flush */
-			&err);
-	if (status != G_IO_STATUS_NORMAL) {
-		CC_OCI_ERROR ("failed to close I/O channel: %s",
-				err->message);
-		g_error_free (err);
-		goto out;
+	while (count) {
+		bytes = writev (file->fd, iov, (int)count);
+		if (bytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			CC_OCI_ERROR ("failed to write to logfile %s: %s",
+					file->path, strerror (errno));
+			goto out;
+		}
+
+		/* skip what was written of a short write */
+		while (count && (gsize)bytes >= iov->iov_len) {
+			bytes -= (ssize_t)iov->iov_len;
+			iov++;
+			count--;
+		}
+
+		if (count) {
+			iov->iov_base = (char *)iov->iov_base + bytes;
+			iov->iov_len -= (gsize)bytes;
+		}
 	}
 
 	ret = true;
 
 out:
-	if (channel) {
-		g_io_channel_unref (channel);
+	for (guint i = 0; i < file->count; i++) {
+		g_free (file->records[i].iov_base);
+	}
+
+	file->count = 0;
+	file->size = 0;
+
+	return ret;
+}
+
+/*!
+ * Find the \ref cc_oci_log_file for \p filename, allocating a slot
+ * if necessary.
+ *
+ * \param filename Full path of logfile.
+ *
+ * \return \ref cc_oci_log_file, or \c NULL if no slot is available.
+ */
+static struct cc_oci_log_file *
+cc_oci_log_file_get (const char *filename)
+{
+	struct cc_oci_log_file *unused = NULL;
+
+	for (guint i = 0; i < CC_OCI_LOG_FILES; i++) {
+		struct cc_oci_log_file *file = &cc_oci_log_files[i];
+
+		if (! file->path) {
+			if (! unused) {
+				unused = file;
+			}
+			continue;
+		}
+
+		if (! g_strcmp0 (file->path, filename)) {
+			return file;
+		}
 	}
 
-	if (fd != -1) {
-		close (fd);
+	if (unused) {
+		unused->path = g_strdup (filename);
+		unused->fd = -1;
 	}
 
+	return unused;
+}
+
+/*!
+ * Flush and close \p file, releasing its slot.
+ *
+ * \param file \ref cc_oci_log_file.
+ */
+static void
+cc_oci_log_file_close (struct cc_oci_log_file *file)
+{
+	(void)cc_oci_log_file_flush (file);
+
+	if (file->fd != -1) {
+		close (file->fd);
+		file->fd = -1;
+	}
+
+	g_free_if_set (file->path);
+}
+
+/*!
+ * Write a log message.
+ *
+ * The message is buffered and only written when \p flush is \c true,
+ * when the buffer for \p filename is full, or when
+ * cc_oci_log_flush() is called.
+ *
+ * \warning Note that this function should not call any glib log
+ * handling functions (g_debug(), etc) to avoid going recursive.
+ *
+ * \param filename Full path of file to write message to.
+ * \param message Text to write to \p filename.
+ * \param flush If \c true, write all buffered messages now.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_log_msg_write (const char *filename, const char *message,
+		gboolean flush)
+{
+	struct cc_oci_log_file  *file;
+	gsize                    len;
+	gboolean                 ret = false;
+
+	g_assert (filename);
+	g_assert (message);
+
+	len = strlen (message);
+
+	g_mutex_lock (&cc_oci_log_lock);
+
+	file = cc_oci_log_file_get (filename);
+	if (! file) {
+		CC_OCI_ERROR ("too many logfiles (%s)", filename);
+		goto out;
+	}
+
+	if (file->count == CC_OCI_LOG_RECORDS ||
+			file->size + len > CC_OCI_LOG_BUFFERED_MAX) {
+		(void)cc_oci_log_file_flush (file);
+	}
+
+	file->records[file->count].iov_base = g_strndup (message, len);
+	file->records[file->count].iov_len = len;
+	file->count++;
+	file->size += len;
+
+	ret = flush ? cc_oci_log_file_flush (file) : true;
+
+out:
+	g_mutex_unlock (&cc_oci_log_lock);
+
 	return ret;
 }
 
+/*!
+ * Flush all logfiles without locking.
+ */
+static void
+cc_oci_log_flush_unlocked (void)
+{
+	for (guint i = 0; i < CC_OCI_LOG_FILES; i++) {
+		if (cc_oci_log_files[i].path) {
+			(void)cc_oci_log_file_flush (&cc_oci_log_files[i]);
+		}
+	}
+}
+
+/*!
+ * Write all buffered log messages.
+ *
+ * Must be called before the process calls \c exec() or \c _exit()
+ * so that no messages are lost.
+ */
+void
+cc_oci_log_flush (void)
+{
+	g_mutex_lock (&cc_oci_log_lock);
+	cc_oci_log_flush_unlocked ();
+	g_mutex_unlock (&cc_oci_log_lock);
+}
+
+/*!
+ * \c pthread_atfork() prepare handler.
+ *
+ * Flushes the buffered log messages so they are not written by both
+ * parent and child.
+ */
+static void
+cc_oci_log_fork_prepare (void)
+{
+	g_mutex_lock (&cc_oci_log_lock);
+	cc_oci_log_flush_unlocked ();
+}
+
+/*!
+ * \c pthread_atfork() parent and child handler.
+ */
+static void
+cc_oci_log_fork_done (void)
+{
+	g_mutex_unlock (&cc_oci_log_lock);
+}
+
 /*!
  * glib log handler (for \c g_debug(), \c g_message(), \c g_warning(),
  * \c g_critical(), etc).
@@ -332,6 +564,7 @@ cc_oci_log_handler (const gchar *log_domain,
 	gchar                        *timestamp = NULL;
 	const struct cc_log_options  *options;
 	gboolean                      ret;
+	gboolean                      flush;
 
 	g_assert (message);
 
@@ -384,6 +617,12 @@ cc_oci_log_handler (const gchar *log_domain,
 		break;
 	}
 
+	/* Ensure the message gets across, along with everything that
+	 * led up to it.
+	 */
+	flush = log_level == G_LOG_LEVEL_ERROR ||
+		log_level == G_LOG_LEVEL_CRITICAL;
+
 	timestamp = cc_oci_get_iso8601_timestamp ();
 	if (! timestamp) {
 		goto out;
@@ -411,7 +650,7 @@ cc_oci_log_handler (const gchar *log_domain,
 			}
 		}
 		ret = cc_oci_log_msg_write (options->global_logfile,
-				final);
+				final, flush);
 		if (! ret) {
 			goto out;
 		}
@@ -436,7 +675,8 @@ cc_oci_log_handler (const gchar *log_domain,
 	}
 
 	if (options->filename) {
-		ret = cc_oci_log_msg_write (options->filename, final);
+		ret = cc_oci_log_msg_write (options->filename, final,
+				flush);
 		if (! ret) {
 			goto out;
 		}
@@ -447,6 +687,30 @@ out:
 	g_free_if_set (final);
 }
 
+/*!
+ * Determine if \c g_debug() messages will be logged.
+ *
+ * \return \c true if debug messages will be written to a logfile,
+ * else \c false.
+ */
+gboolean
+cc_oci_log_debug_enabled (void)
+{
+#ifdef CC_OCI_DISABLE_DEBUG_LOGGING
+	return false;
+#else
+	const struct cc_log_options *options = cc_oci_log_options;
+
+	if (! options) {
+		return false;
+	}
+
+	/* see cc_oci_log_handler() */
+	return options->global_logfile ||
+		(options->enable_debug && options->filename);
+#endif /* CC_OCI_DISABLE_DEBUG_LOGGING */
+}
+
 /*!
  * Initialise logging.
  *
@@ -457,8 +721,41 @@ out:
 gboolean
 cc_oci_log_init (const struct cc_log_options *options)
 {
+	static gboolean  registered = false;
+
 	g_assert (options);
 
+	if (! registered) {
+		if (pthread_atfork (cc_oci_log_fork_prepare,
+					cc_oci_log_fork_done,
+					cc_oci_log_fork_done)) {
+			return false;
+		}
+
+		if (atexit (cc_oci_log_flush)) {
+			return false;
+		}
+
+		registered = true;
+	}
+
+	/* Close logfiles from any previous call that are no longer
+	 * needed.
+	 */
+	g_mutex_lock (&cc_oci_log_lock);
+
+	for (guint i = 0; i < CC_OCI_LOG_FILES; i++) {
+		struct cc_oci_log_file *file = &cc_oci_log_files[i];
+
+		if (file->path &&
+				g_strcmp0 (file->path, options->filename) &&
+				g_strcmp0 (file->path, options->global_logfile)) {
+			cc_oci_log_file_close (file);
+		}
+	}
+
+	g_mutex_unlock (&cc_oci_log_lock);
+
 	/* Create path to allow global log file to be created */
 	if (options->global_logfile) {
 		gboolean  ret;
@@ -479,6 +776,7 @@ cc_oci_log_init (const struct cc_log_options *options)
 	}
 
 	hypervisor_log_dir = options->hypervisor_log_dir;
+	cc_oci_log_options = options;
 
 	(void)g_log_set_handler (G_LOG_DOMAIN,
 			(GLogLevelFlags)CC_OCI_LOG_FLAGS,
@@ -581,6 +879,16 @@ cc_oci_log_free (struct cc_log_options *options)
 		return;
 	}
 
+	g_mutex_lock (&cc_oci_log_lock);
+
+	for (guint i = 0; i < CC_OCI_LOG_FILES; i++) {
+		if (cc_oci_log_files[i].path) {
+			cc_oci_log_file_close (&cc_oci_log_files[i]);
+		}
+	}
+
+	g_mutex_unlock (&cc_oci_log_lock);
+
 	g_free_if_set (options->filename);
 	g_free_if_set (options->global_logfile);
 	g_free_if_set (options->hypervisor_log_dir);
@@ -29,7 +29,9 @@
 #include "logging.h"
 #include "command.h"
 #include "oci-config.h"
+#include "state.h"
 #include "priv.h"
+#include "daemon.h"
 
 #define KVM_PATH "/dev/kvm"
 
@@ -48,6 +50,12 @@ static gboolean systemd_cgroup;
 /** Path to create state under */
 static gchar *root_dir;
 
+/** How to flush state file writes */
+static gchar *state_sync;
+
+/** Set when handling a request sent to "cc-oci-runtime daemon" */
+static gboolean daemon_request;
+
 struct start_data start_data;
 
 /** Global options (available to all sub-commands) */
@@ -98,6 +106,12 @@ static GOptionEntry options_global[] =
 		"directory to use for runtime state files",
 		NULL
 	},
+	{
+		"state-sync", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &state_sync,
+		"how to flush state file writes (file, none or full)",
+		NULL
+	},
 	{
 		"systemd-cgroup", 0, G_OPTION_FLAG_NONE,
 		G_OPTION_ARG_NONE, &systemd_cgroup,
@@ -356,6 +370,13 @@ handle_arguments (int argc, char **argv)
 		config->root_dir = g_strdup (root_dir);
 	}
 
+	if (state_sync && ! cc_oci_state_sync_from_str (state_sync,
+				&config->state.sync)) {
+		g_critical ("invalid state sync mode: %s", state_sync);
+		ret = false;
+		goto out;
+	}
+
 	cmd = argv[0];
 
 	/* Find the options for the specific sub-command */
@@ -367,6 +388,14 @@ handle_arguments (int argc, char **argv)
 		goto out;
 	}
 
+	/* The processes started by some commands must be descendants
+	 * of the caller, so the client runs those itself.
+	 */
+	if (daemon_request && cc_oci_daemon_refuse_command (cmd)) {
+		ret = false;
+		goto out;
+	}
+
 	priv_level = cc_oci_get_priv_level (argc, argv, sub, config);
 	if (priv_level == 1 && getuid ()) {
 		g_critical ("must run as root");
@@ -423,12 +452,44 @@ out:
 	return ret;
 }
 
+/*!
+ * Handle a command sent to "cc-oci-runtime daemon".
+ *
+ * Called in a child of the daemon, so the options the daemon itself
+ * was started with are discarded first.
+ *
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+handle_daemon_request (int argc, char **argv)
+{
+	cc_oci_log_free (&cc_log_options);
+	memset (&cc_log_options, 0, sizeof (cc_log_options));
+	memset (&start_data, 0, sizeof (start_data));
+
+	format = NULL;
+	criu = NULL;
+	root_dir = NULL;
+	state_sync = NULL;
+	show_version = false;
+	show_help = false;
+	systemd_cgroup = false;
+	daemon_request = true;
+
+	return handle_arguments (argc, argv);
+}
+
 /**
  * Handle global setup.
  */
 static gboolean
 setup (void)
 {
+	cc_oci_daemon_set_handler (handle_daemon_request);
+
 	return cc_oci_handle_signals ();
 }
 
@@ -0,0 +1,823 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Handling of hypervisor migration streams.
+ *
+ * A migration stream saved by \ref cc_oci_vm_migrate() holds every
+ * page of guest memory, so the VM cannot run again until all of its
+ * memory has been read back. \ref cc_oci_migration_split_ram() moves
+ * the pages of the VM's main memory out of the stream into a sparse
+ * file laid out like that memory. The hypervisor can map that file
+ * privately as guest memory, so that pages are only read when the
+ * guest first touches them (and zero pages are never read at all),
+ * while changes made by the guest never reach the file.
+ *
+ * Only the parts of the stream format needed to find those pages are
+ * understood: the header, the "ram" live section and section footers.
+ * Everything following the last "ram" section (the state of devices)
+ * is copied unchanged.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "util.h"
+#include "common.h"
+#include "migration.h"
+
+/* Stream format, as defined by QEMU's migration/savevm.c */
+#define QEMU_VM_FILE_MAGIC		0x5145564d
+#define QEMU_VM_FILE_VERSION		0x00000003
+#define QEMU_VM_SECTION_START		0x01
+#define QEMU_VM_SECTION_PART		0x02
+#define QEMU_VM_SECTION_END		0x03
+#define QEMU_VM_SUBSECTION		0x05
+#define QEMU_VM_CONFIGURATION		0x07
+#define QEMU_VM_SECTION_FOOTER		0x7e
+
+/* Page flags, as defined by QEMU's migration/ram.c */
+#define RAM_SAVE_FLAG_ZERO		0x02
+#define RAM_SAVE_FLAG_MEM_SIZE		0x04
+#define RAM_SAVE_FLAG_PAGE		0x08
+#define RAM_SAVE_FLAG_EOS		0x10
+#define RAM_SAVE_FLAG_CONTINUE		0x20
+
+/** Name of the live section holding guest memory. */
+#define CC_OCI_MIGRATION_RAM_SECTION	"ram"
+
+/** Mode of the file guest memory is saved to. */
+#define CC_OCI_MIGRATION_RAM_FILE_MODE	0600
+
+/** Maximum length of the ID strings in a stream (plus terminator). */
+#define CC_OCI_MIGRATION_ID_LEN		(G_MAXUINT8 + 1)
+
+/** State of a migration stream being split. */
+struct cc_oci_migration_split {
+	/** Stream being read. */
+	FILE      *in;
+
+	/** Stream being written, without the pages of main memory. */
+	FILE      *out;
+
+	/** File main memory is saved to. */
+	int        ram_fd;
+
+	/** Size of main memory (bytes, 0 until known). */
+	guint64    ram_size;
+
+	/** Pages holding data in \ref ram_fd (one bit per page). */
+	guint8    *saved;
+
+	/** Number of bits set in \ref saved. */
+	guint64    pages_saved;
+
+	/** \c true once the "ram" section has started. */
+	gboolean   have_ram_section;
+
+	/** Section ID of the "ram" section. */
+	guint32    ram_section_id;
+
+	/** ID string of the RAM block of the last page read. */
+	gchar      block[CC_OCI_MIGRATION_ID_LEN];
+};
+
+/*!
+ * Read from the stream being split.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param[out] buf Buffer to read into.
+ * \param len Number of bytes to read.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_read (struct cc_oci_migration_split *split,
+		void *buf, gsize len)
+{
+	if (len && fread (buf, 1, len, split->in) != len) {
+		g_critical ("migration stream is truncated");
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Write to the stream being created.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param buf Data to write.
+ * \param len Number of bytes to write.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_write (struct cc_oci_migration_split *split,
+		const void *buf, gsize len)
+{
+	if (len && fwrite (buf, 1, len, split->out) != len) {
+		g_critical ("failed to write migration stream: %s",
+				strerror (errno));
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Copy bytes unchanged from the stream being split to the stream
+ * being created.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param[out] buf Buffer for the bytes copied.
+ * \param len Number of bytes to copy.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy (struct cc_oci_migration_split *split,
+		void *buf, gsize len)
+{
+	return cc_oci_migration_read (split, buf, len) &&
+		cc_oci_migration_write (split, buf, len);
+}
+
+/*!
+ * Copy a big-endian 32-bit value.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param[out] value Value copied (may be \c NULL).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy_be32 (struct cc_oci_migration_split *split,
+		guint32 *value)
+{
+	guint32 be;
+
+	if (! cc_oci_migration_copy (split, &be, sizeof (be))) {
+		return false;
+	}
+
+	if (value) {
+		*value = GUINT32_FROM_BE (be);
+	}
+
+	return true;
+}
+
+/*!
+ * Copy a big-endian 64-bit value.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param[out] value Value copied.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy_be64 (struct cc_oci_migration_split *split,
+		guint64 *value)
+{
+	guint64 be;
+
+	if (! cc_oci_migration_copy (split, &be, sizeof (be))) {
+		return false;
+	}
+
+	*value = GUINT64_FROM_BE (be);
+
+	return true;
+}
+
+/*!
+ * Copy an ID string (a length byte followed by the characters).
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param[out] str Buffer of \ref CC_OCI_MIGRATION_ID_LEN bytes for
+ *   the nul-terminated string.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy_string (struct cc_oci_migration_split *split,
+		gchar *str)
+{
+	guint8 len;
+
+	if (! (cc_oci_migration_copy (split, &len, sizeof (len)) &&
+			cc_oci_migration_copy (split, str, len))) {
+		return false;
+	}
+
+	str[len] = '\0';
+
+	return true;
+}
+
+/*!
+ * Look at the next byte of the stream being split without
+ * consuming it.
+ *
+ * \param split \ref cc_oci_migration_split.
+ *
+ * \return Next byte, or \c EOF at the end of the stream.
+ */
+static int
+cc_oci_migration_peek (struct cc_oci_migration_split *split)
+{
+	int c = getc (split->in);
+
+	if (c != EOF) {
+		(void)ungetc (c, split->in);
+	}
+
+	return c;
+}
+
+/*!
+ * Copy the footer of a section, if the hypervisor sends them.
+ *
+ * \param split \ref cc_oci_migration_split.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy_footer (struct cc_oci_migration_split *split)
+{
+	guint8 type;
+
+	if (cc_oci_migration_peek (split) != QEMU_VM_SECTION_FOOTER) {
+		return true;
+	}
+
+	return cc_oci_migration_copy (split, &type, sizeof (type)) &&
+		cc_oci_migration_copy_be32 (split, NULL);
+}
+
+/*!
+ * Copy the configuration section (the machine type and optional
+ * subsections).
+ *
+ * \param split \ref cc_oci_migration_split.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy_configuration (struct cc_oci_migration_split *split)
+{
+	gchar    buf[CC_OCI_MIGRATION_ID_LEN];
+	guint32  len;
+	guint32  count;
+	guint8   type;
+
+	if (! cc_oci_migration_copy_be32 (split, &len)) {
+		return false;
+	}
+
+	if (len >= sizeof (buf)) {
+		g_critical ("invalid machine type in migration stream");
+		return false;
+	}
+
+	if (! cc_oci_migration_copy (split, buf, len)) {
+		return false;
+	}
+
+	/* Subsections are not terminated, so each has to be known to
+	 * find where the next starts.
+	 */
+	while (cc_oci_migration_peek (split) == QEMU_VM_SUBSECTION) {
+		if (! (cc_oci_migration_copy (split, &type, sizeof (type)) &&
+				cc_oci_migration_copy_string (split, buf) &&
+				cc_oci_migration_copy_be32 (split, NULL))) {
+			return false;
+		}
+
+		if (! g_strcmp0 (buf, "configuration/target-page-bits")) {
+			if (! cc_oci_migration_copy_be32 (split, NULL)) {
+				return false;
+			}
+		} else if (! g_strcmp0 (buf, "configuration/uuid")) {
+			if (! cc_oci_migration_copy (split, buf, 16)) {
+				return false;
+			}
+		} else if (! g_strcmp0 (buf, "configuration/capabilities")) {
+			if (! cc_oci_migration_copy_be32 (split, &count)) {
+				return false;
+			}
+
+			for (guint32 i = 0; i < count; i++) {
+				if (! cc_oci_migration_copy_string (split,
+							buf)) {
+					return false;
+				}
+			}
+		} else {
+			g_critical ("unsupported migration stream "
+					"subsection %s", buf);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * Prepare the file main memory is saved to.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param size Size of main memory (bytes).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_ram_init (struct cc_oci_migration_split *split,
+		guint64 size)
+{
+	guint64 pages = size / CC_OCI_MIGRATION_PAGE_SIZE;
+
+	if (split->ram_size) {
+		g_critical ("migration stream lists RAM block %s twice",
+				CC_OCI_MIGRATION_RAM_BLOCK);
+		return false;
+	}
+
+	if (! pages || size % CC_OCI_MIGRATION_PAGE_SIZE) {
+		g_critical ("invalid size of RAM block %s: %" G_GUINT64_FORMAT,
+				CC_OCI_MIGRATION_RAM_BLOCK, size);
+		return false;
+	}
+
+	/* The file is sparse: pages never saved read as zero */
+	if (ftruncate (split->ram_fd, (off_t)size) < 0) {
+		g_critical ("failed to size guest memory file: %s",
+				strerror (errno));
+		return false;
+	}
+
+	split->ram_size = size;
+	split->saved = g_malloc0 ((gsize)((pages + 7) / 8));
+
+	return true;
+}
+
+/*!
+ * Save a page of main memory to its file.
+ *
+ * \param split \ref cc_oci_migration_split.
+ * \param addr Offset of page in main memory.
+ * \param data Contents of page, or \c NULL if every byte of the page
+ *   is \p fill.
+ * \param fill Value of every byte of page if \p data is \c NULL.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_save_page (struct cc_oci_migration_split *split,
+		guint64 addr, const guint8 *data, guint8 fill)
+{
+	guint8    buf[CC_OCI_MIGRATION_PAGE_SIZE];
+	guint64   page = addr / CC_OCI_MIGRATION_PAGE_SIZE;
+	guint8    bit = (guint8)(1 << (page % 8));
+	gboolean  zero = ! data && ! fill;
+	gboolean  saved;
+
+	if (addr + CC_OCI_MIGRATION_PAGE_SIZE > split->ram_size) {
+		g_critical ("page 0x%" G_GINT64_MODIFIER "x of migration "
+				"stream is beyond the end of guest memory",
+				addr);
+		return false;
+	}
+
+	saved = (split->saved[page / 8] & bit) != 0;
+
+	/* A page may be sent more than once, so a zero page only needs
+	 * writing if it overwrites data.
+	 */
+	if (zero && ! saved) {
+		return true;
+	}
+
+	if (! data) {
+		memset (buf, fill, sizeof (buf));
+		data = buf;
+	}
+
+	if (pwrite (split->ram_fd, data, CC_OCI_MIGRATION_PAGE_SIZE,
+				(off_t)addr) != CC_OCI_MIGRATION_PAGE_SIZE) {
+		g_critical ("failed to save guest memory: %s",
+				strerror (errno));
+		return false;
+	}
+
+	if (zero) {
+		split->saved[page / 8] &= (guint8)~bit;
+		split->pages_saved--;
+	} else if (! saved) {
+		split->saved[page / 8] |= bit;
+		split->pages_saved++;
+	}
+
+	return true;
+}
+
+/*!
+ * Split the pages of a "ram" section up to its end-of-section marker.
+ *
+ * Pages of main memory are saved to its file, and pages of other
+ * RAM blocks (such as firmware) are copied to the new stream.
+ *
+ * \param split \ref cc_oci_migration_split.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_split_pages (struct cc_oci_migration_split *split)
+{
+	const guint64  supported = RAM_SAVE_FLAG_ZERO |
+		RAM_SAVE_FLAG_PAGE | RAM_SAVE_FLAG_CONTINUE;
+	guint8         data[CC_OCI_MIGRATION_PAGE_SIZE];
+
+	for (;;) {
+		guint64  be;
+		guint64  addr;
+		guint64  flags;
+		guint8   len = 0;
+		guint8   fill = 0;
+
+		if (! cc_oci_migration_read (split, &be, sizeof (be))) {
+			return false;
+		}
+
+		addr = GUINT64_FROM_BE (be);
+		flags = addr & (CC_OCI_MIGRATION_PAGE_SIZE - 1);
+		addr -= flags;
+
+		if (flags & RAM_SAVE_FLAG_EOS) {
+			return cc_oci_migration_write (split, &be, sizeof (be));
+		}
+
+		/* Compressed pages and the like are never sent unless the
+		 * migration asks for them.
+		 */
+		if ((flags & ~supported) ||
+				! (flags & RAM_SAVE_FLAG_ZERO) ==
+				! (flags & RAM_SAVE_FLAG_PAGE)) {
+			g_critical ("unsupported page in migration stream "
+					"(flags 0x%" G_GINT64_MODIFIER "x)",
+					flags);
+			return false;
+		}
+
+		if (! (flags & RAM_SAVE_FLAG_CONTINUE)) {
+			if (! (cc_oci_migration_read (split, &len,
+							sizeof (len)) &&
+					cc_oci_migration_read (split,
+						split->block, len))) {
+				return false;
+			}
+			split->block[len] = '\0';
+		} else if (! *split->block) {
+			g_critical ("migration stream page has no RAM block");
+			return false;
+		}
+
+		if (flags & RAM_SAVE_FLAG_ZERO) {
+			if (! cc_oci_migration_read (split, &fill,
+						sizeof (fill))) {
+				return false;
+			}
+		} else if (! cc_oci_migration_read (split, data,
+					sizeof (data))) {
+			return false;
+		}
+
+		if (split->ram_size && ! g_strcmp0 (split->block,
+					CC_OCI_MIGRATION_RAM_BLOCK)) {
+			if (! cc_oci_migration_save_page (split, addr,
+					(flags & RAM_SAVE_FLAG_PAGE) ?
+					data : NULL, fill)) {
+				return false;
+			}
+			continue;
+		}
+
+		/* Pages of other blocks are copied as they were. Since the
+		 * pages removed all belong to one block, the page before
+		 * one that continues a block is always kept too.
+		 */
+		if (! cc_oci_migration_write (split, &be, sizeof (be))) {
+			return false;
+		}
+
+		if (! (flags & RAM_SAVE_FLAG_CONTINUE) &&
+				! (cc_oci_migration_write (split, &len,
+						sizeof (len)) &&
+				cc_oci_migration_write (split,
+					split->block, len))) {
+			return false;
+		}
+
+		if (! ((flags & RAM_SAVE_FLAG_ZERO) ?
+				cc_oci_migration_write (split, &fill,
+					sizeof (fill)) :
+				cc_oci_migration_write (split, data,
+					sizeof (data)))) {
+			return false;
+		}
+	}
+}
+
+/*!
+ * Copy the start of a live section, splitting its pages.
+ *
+ * \param split \ref cc_oci_migration_split.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_split_start (struct cc_oci_migration_split *split)
+{
+	gchar    id[CC_OCI_MIGRATION_ID_LEN];
+	guint32  section_id;
+	guint64  total;
+	guint64  length;
+
+	if (! (cc_oci_migration_copy_be32 (split, &section_id) &&
+			cc_oci_migration_copy_string (split, id) &&
+			cc_oci_migration_copy_be32 (split, NULL) &&
+			cc_oci_migration_copy_be32 (split, NULL))) {
+		return false;
+	}
+
+	/* Block migration and the like would interleave their own
+	 * sections with those of guest memory.
+	 */
+	if (g_strcmp0 (id, CC_OCI_MIGRATION_RAM_SECTION) ||
+			split->have_ram_section) {
+		g_critical ("unsupported live section %s in migration stream",
+				id);
+		return false;
+	}
+
+	split->have_ram_section = true;
+	split->ram_section_id = section_id;
+
+	/* The section starts with the list of RAM blocks */
+	if (! cc_oci_migration_copy_be64 (split, &total)) {
+		return false;
+	}
+
+	if (! (total & RAM_SAVE_FLAG_MEM_SIZE)) {
+		g_critical ("migration stream does not list RAM blocks");
+		return false;
+	}
+
+	total -= total & (CC_OCI_MIGRATION_PAGE_SIZE - 1);
+
+	while (total) {
+		if (! (cc_oci_migration_copy_string (split, id) &&
+				cc_oci_migration_copy_be64 (split, &length))) {
+			return false;
+		}
+
+		if (length > total) {
+			g_critical ("invalid size of RAM block %s", id);
+			return false;
+		}
+
+		total -= length;
+
+		if (! g_strcmp0 (id, CC_OCI_MIGRATION_RAM_BLOCK) &&
+				! cc_oci_migration_ram_init (split, length)) {
+			return false;
+		}
+	}
+
+	return cc_oci_migration_split_pages (split) &&
+		cc_oci_migration_copy_footer (split);
+}
+
+/*!
+ * Copy the rest of the stream being split unchanged.
+ *
+ * \param split \ref cc_oci_migration_split.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_migration_copy_rest (struct cc_oci_migration_split *split)
+{
+	guint8  buf[CC_OCI_MIGRATION_PAGE_SIZE];
+	gsize   len;
+
+	while ((len = fread (buf, 1, sizeof (buf), split->in)) > 0) {
+		if (! cc_oci_migration_write (split, buf, len)) {
+			return false;
+		}
+	}
+
+	if (ferror (split->in)) {
+		g_critical ("failed to read migration stream");
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Move the main memory of a VM out of a migration stream into a
+ * sparse file that the hypervisor can map as guest memory.
+ *
+ * \param stream_file Full path to migration stream to split.
+ * \param out_file Full path to file to write the stream to, without
+ *   the pages of main memory.
+ * \param ram_file Full path to file to save main memory to.
+ * \param[out] pages_total Number of pages of main memory
+ *   (may be \c NULL).
+ * \param[out] pages_saved Number of pages of main memory which
+ *   hold data, and so take up space in \p ram_file (may be \c NULL).
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_migration_split_ram (const gchar *stream_file,
+		const gchar *out_file,
+		const gchar *ram_file,
+		guint64 *pages_total,
+		guint64 *pages_saved)
+{
+	struct cc_oci_migration_split  split = { 0 };
+	gboolean                       ret = false;
+	gboolean                       done = false;
+	guint32                        header[2];
+	guint32                        section_id;
+	guint8                         type;
+
+	if (! (stream_file && out_file && ram_file)) {
+		return false;
+	}
+
+	split.ram_fd = -1;
+
+	split.in = fopen (stream_file, "rb");
+	if (! split.in) {
+		g_critical ("failed to open migration stream %s: %s",
+				stream_file, strerror (errno));
+		goto out;
+	}
+
+	split.out = fopen (out_file, "wb");
+	if (! split.out) {
+		g_critical ("failed to create %s: %s",
+				out_file, strerror (errno));
+		goto out;
+	}
+
+	split.ram_fd = open (ram_file,
+			O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			CC_OCI_MIGRATION_RAM_FILE_MODE);
+	if (split.ram_fd < 0) {
+		g_critical ("failed to create %s: %s",
+				ram_file, strerror (errno));
+		goto out;
+	}
+
+	if (! cc_oci_migration_read (&split, header, sizeof (header))) {
+		goto out;
+	}
+
+	if (GUINT32_FROM_BE (header[0]) != QEMU_VM_FILE_MAGIC ||
+			GUINT32_FROM_BE (header[1]) != QEMU_VM_FILE_VERSION) {
+		g_critical ("%s is not a supported migration stream",
+				stream_file);
+		goto out;
+	}
+
+	if (! cc_oci_migration_write (&split, header, sizeof (header))) {
+		goto out;
+	}
+
+	while (! done) {
+		if (! cc_oci_migration_copy (&split, &type, sizeof (type))) {
+			goto out;
+		}
+
+		switch (type) {
+		case QEMU_VM_CONFIGURATION:
+			if (! cc_oci_migration_copy_configuration (&split)) {
+				goto out;
+			}
+			break;
+
+		case QEMU_VM_SECTION_START:
+			if (! cc_oci_migration_split_start (&split)) {
+				goto out;
+			}
+			break;
+
+		case QEMU_VM_SECTION_PART:
+		case QEMU_VM_SECTION_END:
+			if (! cc_oci_migration_copy_be32 (&split,
+						&section_id)) {
+				goto out;
+			}
+
+			if (! (split.have_ram_section &&
+					section_id == split.ram_section_id)) {
+				g_critical ("unsupported section %u in "
+						"migration stream",
+						section_id);
+				goto out;
+			}
+
+			if (! (cc_oci_migration_split_pages (&split) &&
+					cc_oci_migration_copy_footer (&split))) {
+				goto out;
+			}
+			break;
+
+		default:
+			/* The state of devices follows the last page of
+			 * memory.
+			 */
+			if (! cc_oci_migration_copy_rest (&split)) {
+				goto out;
+			}
+			done = true;
+			break;
+		}
+	}
+
+	if (! split.ram_size) {
+		g_critical ("no RAM block %s found in migration stream %s",
+				CC_OCI_MIGRATION_RAM_BLOCK, stream_file);
+		goto out;
+	}
+
+	if (pages_total) {
+		*pages_total = split.ram_size / CC_OCI_MIGRATION_PAGE_SIZE;
+	}
+
+	if (pages_saved) {
+		*pages_saved = split.pages_saved;
+	}
+
+	ret = true;
+
+out:
+	if (split.in) {
+		fclose (split.in);
+	}
+
+	if (split.out && fclose (split.out) != 0 && ret) {
+		g_critical ("failed to write %s: %s",
+				out_file, strerror (errno));
+		ret = false;
+	}
+
+	if (split.ram_fd >= 0) {
+		close (split.ram_fd);
+	}
+
+	g_free_if_set (split.saved);
+
+	if (! ret) {
+		if (split.out) {
+			(void)g_unlink (out_file);
+		}
+		if (split.ram_fd >= 0) {
+			(void)g_unlink (ram_file);
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_MIGRATION_H
+#define _CC_OCI_MIGRATION_H
+
+#include <glib.h>
+
+/** Name of the RAM block holding the main memory of the VM. */
+#define CC_OCI_MIGRATION_RAM_BLOCK	"pc.ram"
+
+/** Size of a page of guest memory in a migration stream. */
+#define CC_OCI_MIGRATION_PAGE_SIZE	4096
+
+gboolean cc_oci_migration_split_ram (const gchar *stream_file,
+		const gchar *out_file,
+		const gchar *ram_file,
+		guint64 *pages_total,
+		guint64 *pages_saved);
+
+#endif /* _CC_OCI_MIGRATION_H */
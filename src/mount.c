@@ -490,6 +490,10 @@ cc_handle_rootfs_mount (struct cc_oci_config *config)
 /*!
  * Unmount the mount specified by \p m.
  *
+ * A destination that is no longer mounted (or no longer exists) is not
+ * an error, so that a "delete" interrupted after unmounting (for
+ * example by the proxy failing) can be retried.
+ *
  * \param m \ref cc_oci_mount.
  *
  * \return \c true on success, else \c false.
@@ -497,13 +501,22 @@ cc_handle_rootfs_mount (struct cc_oci_config *config)
 private gboolean
 cc_oci_perform_unmount (const struct cc_oci_mount *m)
 {
-	if (! m) {
+	if (! (m && *m->dest)) {
 		return false;
 	}
 
 	g_debug ("unmounting %s", m->dest);
 
-	return umount (m->dest) == 0;
+	if (umount (m->dest) == 0) {
+		return true;
+	}
+
+	if (errno == EINVAL || errno == ENOENT) {
+		g_debug ("%s already unmounted", m->dest);
+		return true;
+	}
+
+	return false;
 }
 
 /*!
@@ -49,6 +49,15 @@
 /** String that separates messages returned from the hypervisor */
 #define CC_OCI_MSG_SEPARATOR "\r\n"
 
+/** Bandwidth limit (bytes per second) used to save the state of a VM */
+#define CC_OCI_MIGRATE_BANDWIDTH ((gint64)G_MAXINT32 * 4)
+
+/** Interval (microseconds) between checks of a VM migration */
+#define CC_OCI_MIGRATE_POLL_INTERVAL (10 * 1000)
+
+/** Maximum time (microseconds) to wait for a VM to load its state */
+#define CC_OCI_INCOMING_TIMEOUT (120 * G_USEC_PER_SEC)
+
 /*! VM connection object. */
 struct cc_oci_vm_conn
 {
@@ -60,6 +69,9 @@ struct cc_oci_vm_conn
 
 	/*! The socket. */
 	GSocket *socket;
+
+	/*! \c true once the QMP capabilities have been negotiated. */
+	gboolean initialised;
 };
 
 /*!
@@ -314,7 +326,6 @@ cc_oci_qmp_msg_send (struct cc_oci_vm_conn *conn,
 		gsize expected_resp_count,
 		gboolean expect_empty)
 {
-	private gboolean   initialised = false;
 	const  gchar      capabilities[] = "{ \"execute\": \"qmp_capabilities\" }";
 	GError           *error = NULL;
 	gssize            size;
@@ -326,7 +337,7 @@ cc_oci_qmp_msg_send (struct cc_oci_vm_conn *conn,
 	g_assert (conn);
 	g_assert (msg);
 
-	if (! initialised) {
+	if (! conn->initialised) {
 		/* The QMP protocol requires we query its capabilities
 		 * before sending any further messages.
 		 */
@@ -367,7 +378,7 @@ cc_oci_qmp_msg_send (struct cc_oci_vm_conn *conn,
 
 		cc_oci_net_msgs_free_all (msgs);
 
-		initialised = true;
+		conn->initialised = true;
 
 		/* reset */
 		recv_msg = NULL;
@@ -452,6 +463,171 @@ out:
 	return ret;
 }
 
+/*!
+ * Run a QMP command and wait for its reply, skipping any events
+ * the hypervisor sends in the meantime.
+ *
+ * \param conn \ref cc_oci_vm_conn to use.
+ * \param command Name of QMP command.
+ * \param arguments Arguments of \p command (or \c NULL), which are
+ *   owned by the request.
+ * \param[out] result Value returned by \p command (or \c NULL if
+ *   not required), to be freed with \c json_node_free().
+ * \param optional If \c true, failure of \p command is expected on
+ *   some hypervisors, so is not reported as an error.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_qmp_execute (struct cc_oci_vm_conn *conn,
+		const gchar *command,
+		JsonObject *arguments,
+		JsonNode **result,
+		gboolean optional)
+{
+	gchar        buffer[CC_OCI_NET_BUF_SIZE];
+	JsonObject  *obj;
+	JsonParser  *parser = NULL;
+	GString     *received = NULL;
+	GError      *error = NULL;
+	gchar       *msg = NULL;
+	gsize        msg_len = 0;
+	gboolean     ret = false;
+
+	g_assert (conn);
+	g_assert (command);
+
+	if (! conn->initialised) {
+		/* The QMP protocol requires we query its capabilities
+		 * before sending any further messages.
+		 */
+		conn->initialised = true;
+
+		if (! cc_oci_qmp_execute (conn, "qmp_capabilities",
+					NULL, NULL, false)) {
+			conn->initialised = false;
+			if (arguments) {
+				json_object_unref (arguments);
+			}
+			return false;
+		}
+	}
+
+	obj = json_object_new ();
+	json_object_set_string_member (obj, "execute", command);
+	if (arguments) {
+		json_object_set_object_member (obj, "arguments", arguments);
+	}
+
+	msg = cc_oci_json_obj_to_string (obj, false, &msg_len);
+	json_object_unref (obj);
+	if (! msg) {
+		return false;
+	}
+
+	g_debug ("sending message '%s'", msg);
+
+	if (g_socket_send (conn->socket, msg, msg_len, NULL, &error) < 0) {
+		g_critical ("failed to send json: %s: %s", msg,
+				error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	parser = json_parser_new ();
+	received = g_string_new ("");
+
+	while (true) {
+		JsonObject  *reply;
+		JsonNode    *root;
+		gssize       bytes;
+		gchar       *p;
+		gsize        len;
+
+		p = strstr (received->str, CC_OCI_MSG_SEPARATOR);
+		if (! p) {
+			bytes = g_socket_receive (conn->socket, buffer,
+					sizeof (buffer), NULL, &error);
+			if (bytes <= 0) {
+				g_critical ("failed to receive reply to %s: %s",
+						command,
+						error ? error->message
+						: "connection closed");
+				if (error) {
+					g_error_free (error);
+				}
+				goto out;
+			}
+
+			g_string_append_len (received, buffer, bytes);
+			continue;
+		}
+
+		len = (gsize)(p - received->str);
+
+		if (! json_parser_load_from_data (parser, received->str,
+					(gssize)len, &error)) {
+			g_critical ("failed to parse qmp message: %s",
+					error->message);
+			g_error_free (error);
+			goto out;
+		}
+
+		g_string_erase (received, 0,
+				(gssize)(len + sizeof (CC_OCI_MSG_SEPARATOR)-1));
+
+		root = json_parser_get_root (parser);
+		if (! (root && JSON_NODE_HOLDS_OBJECT (root))) {
+			continue;
+		}
+
+		reply = json_node_get_object (root);
+
+		if (json_object_has_member (reply, "return")) {
+			if (result) {
+				*result = json_node_copy (
+					json_object_get_member (reply,
+						"return"));
+			}
+			ret = true;
+			break;
+		}
+
+		if (json_object_has_member (reply, "error")) {
+			JsonObject *err;
+			const gchar *desc = NULL;
+
+			err = json_object_get_object_member (reply, "error");
+			if (err && json_object_has_member (err, "desc")) {
+				desc = json_object_get_string_member (err,
+						"desc");
+			}
+
+			if (optional) {
+				g_debug ("qmp command %s failed: %s",
+						command, desc ? desc : "");
+			} else {
+				g_critical ("qmp command %s failed: %s",
+						command, desc ? desc : "");
+			}
+			break;
+		}
+
+		/* an asynchronous event */
+	}
+
+out:
+	g_free (msg);
+	if (received) {
+		g_string_free (received, true);
+	}
+	if (parser) {
+		g_object_unref (parser);
+	}
+
+	return ret;
+}
+
 /*!
  * Send a QMP pause message to the hypervisor.
  *
@@ -714,3 +890,346 @@ out:
 
 	return ret;
 }
+
+/*!
+ * Save the state of a paused VM using hypervisor migration.
+ *
+ * The VM remains paused once its state has been saved.
+ *
+ * \param socket_path Path to \ref CC_OCI_HYPERVISOR_SOCKET.
+ * \param pid \c GPid of hypervisor process.
+ * \param uri Migration URI to save the state to
+ *   (for example "exec:cat &gt; file").
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_vm_migrate (const gchar *socket_path, GPid pid, const gchar *uri)
+{
+	struct cc_oci_vm_conn  *conn = NULL;
+	JsonObject             *args;
+	JsonNode               *result = NULL;
+	gboolean                ret = false;
+
+	if (! (socket_path && pid > 0 && uri)) {
+		return false;
+	}
+
+	conn = cc_oci_vm_conn_new (socket_path, pid);
+	if (! conn) {
+		goto out;
+	}
+
+	/* The default bandwidth limit is meant for live migration over
+	 * a network, not for saving a paused VM to a local file.
+	 * Older hypervisors only support the deprecated command.
+	 */
+	args = json_object_new ();
+	json_object_set_int_member (args, "max-bandwidth",
+			CC_OCI_MIGRATE_BANDWIDTH);
+	if (! cc_oci_qmp_execute (conn, "migrate-set-parameters",
+				args, NULL, true)) {
+		args = json_object_new ();
+		json_object_set_int_member (args, "value",
+				CC_OCI_MIGRATE_BANDWIDTH);
+		(void)cc_oci_qmp_execute (conn, "migrate_set_speed",
+				args, NULL, true);
+	}
+
+	args = json_object_new ();
+	json_object_set_string_member (args, "uri", uri);
+	if (! cc_oci_qmp_execute (conn, "migrate", args, NULL, false)) {
+		goto out;
+	}
+
+	/* Wait for the migration to finish */
+	while (true) {
+		const gchar *status = NULL;
+		JsonObject  *obj;
+
+		if (! cc_oci_qmp_execute (conn, "query-migrate",
+					NULL, &result, false)) {
+			goto out;
+		}
+
+		if (JSON_NODE_HOLDS_OBJECT (result)) {
+			obj = json_node_get_object (result);
+			if (json_object_has_member (obj, "status")) {
+				status = json_object_get_string_member (obj,
+						"status");
+			}
+		} else {
+			obj = NULL;
+		}
+
+		if (! g_strcmp0 (status, "completed")) {
+			break;
+		}
+
+		if (! g_strcmp0 (status, "failed") ||
+				! g_strcmp0 (status, "cancelled")) {
+			g_critical ("failed to save VM state: %s",
+					obj && json_object_has_member (obj,
+						"error-desc")
+					? json_object_get_string_member (obj,
+						"error-desc")
+					: status);
+			goto out;
+		}
+
+		json_node_free (result);
+		result = NULL;
+
+		g_usleep (CC_OCI_MIGRATE_POLL_INTERVAL);
+	}
+
+	g_debug ("saved VM state to %s", uri);
+
+	ret = true;
+
+out:
+	if (result) {
+		json_node_free (result);
+	}
+	if (conn) {
+		cc_oci_vm_conn_free (conn);
+	}
+
+	return ret;
+}
+
+/*!
+ * Wait for a hypervisor started with "-incoming" to load the state of
+ * the VM, and resume the VM.
+ *
+ * \param socket_path Path to \ref CC_OCI_HYPERVISOR_SOCKET.
+ * \param pid \c GPid of hypervisor process.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_vm_incoming_wait (const gchar *socket_path, GPid pid)
+{
+	struct cc_oci_vm_conn  *conn = NULL;
+	JsonNode               *result = NULL;
+	gboolean                ret = false;
+	gint64                  timeout;
+	const gchar            *status = NULL;
+
+	if (! (socket_path && pid > 0)) {
+		return false;
+	}
+
+	timeout = g_get_monotonic_time () + CC_OCI_INCOMING_TIMEOUT;
+
+	/* The hypervisor creates its sockets once it has started */
+	while (! g_file_test (socket_path, G_FILE_TEST_EXISTS)) {
+		if (kill (pid, 0) < 0 ||
+				g_get_monotonic_time () > timeout) {
+			g_critical ("hypervisor did not create %s",
+					socket_path);
+			return false;
+		}
+
+		g_usleep (CC_OCI_MIGRATE_POLL_INTERVAL);
+	}
+
+	conn = cc_oci_vm_conn_new (socket_path, pid);
+	if (! conn) {
+		goto out;
+	}
+
+	while (true) {
+		JsonObject *obj;
+
+		if (! cc_oci_qmp_execute (conn, "query-status",
+					NULL, &result, false)) {
+			goto out;
+		}
+
+		status = NULL;
+
+		if (JSON_NODE_HOLDS_OBJECT (result)) {
+			obj = json_node_get_object (result);
+			if (json_object_has_member (obj, "status")) {
+				status = json_object_get_string_member (obj,
+						"status");
+			}
+		}
+
+		if (g_strcmp0 (status, "inmigrate")) {
+			break;
+		}
+
+		if (g_get_monotonic_time () > timeout) {
+			g_critical ("timed out loading VM state");
+			goto out;
+		}
+
+		json_node_free (result);
+		result = NULL;
+
+		g_usleep (CC_OCI_MIGRATE_POLL_INTERVAL);
+	}
+
+	g_debug ("VM state loaded (status %s)", status);
+
+	if (! g_strcmp0 (status, "running")) {
+		ret = true;
+	} else if (! g_strcmp0 (status, "paused")) {
+		/* The VM was paused when its state was saved */
+		ret = cc_oci_qmp_execute (conn, "cont", NULL, NULL, false);
+	} else {
+		g_critical ("failed to load VM state: status %s",
+				status ? status : "unknown");
+	}
+
+out:
+	if (result) {
+		json_node_free (result);
+	}
+	if (conn) {
+		cc_oci_vm_conn_free (conn);
+	}
+
+	return ret;
+}
+
+/*!
+ * Connect to a hypervisor QMP socket to receive its events.
+ *
+ * The capabilities negotiation is started, but the replies are left
+ * to be read (and ignored by cc_oci_qmp_events_parse()) along with
+ * the events, so the returned socket is non-blocking and nothing
+ * here waits for the hypervisor.
+ *
+ * \note The hypervisor only serves one client per QMP socket, so
+ * this must not be used with \ref CC_OCI_HYPERVISOR_SOCKET.
+ *
+ * \param socket_path Full path to named socket.
+ *
+ * \return \c GSocket on success, else \c NULL.
+ */
+GSocket *
+cc_oci_qmp_events_connect (const gchar *socket_path)
+{
+	const gchar      capabilities[] = "{ \"execute\": \"qmp_capabilities\" }";
+	GSocketAddress  *addr = NULL;
+	GSocket         *socket = NULL;
+	GError          *error = NULL;
+
+	if (! socket_path) {
+		return NULL;
+	}
+
+	addr = g_unix_socket_address_new (socket_path);
+	if (! addr) {
+		g_critical ("failed to create a new socket addres: %s", socket_path);
+		goto err;
+	}
+
+	socket = g_socket_new (G_SOCKET_FAMILY_UNIX,
+			G_SOCKET_TYPE_STREAM,
+			G_SOCKET_PROTOCOL_DEFAULT, &error);
+	if (! socket) {
+		g_critical ("failed to create socket: %s",
+				error->message);
+		g_error_free (error);
+		goto err;
+	}
+
+	if (! g_socket_connect (socket, addr, NULL, &error)) {
+		g_warning ("failed to connect to hypervisor event socket %s: %s",
+				socket_path,
+				error->message);
+		g_error_free (error);
+		goto err;
+	}
+
+	if (g_socket_send (socket, capabilities, sizeof (capabilities)-1,
+				NULL, &error) < 0) {
+		g_critical ("failed to send json: %s", capabilities);
+		if (error) {
+			g_critical ("error: %s", error->message);
+			g_error_free (error);
+		}
+		goto err;
+	}
+
+	g_socket_set_blocking (socket, false);
+
+	g_debug ("connected to event socket path %s", socket_path);
+
+	g_object_unref (addr);
+
+	return socket;
+
+err:
+	if (socket) {
+		g_object_unref (socket);
+	}
+	if (addr) {
+		g_object_unref (addr);
+	}
+
+	return NULL;
+}
+
+/*!
+ * Extract the QMP events from the data received so far.
+ *
+ * Complete messages are removed from \p received; messages other
+ * than events (the welcome message and command responses) are
+ * skipped.
+ *
+ * \param received Data received from the hypervisor.
+ *
+ * \return List of newly-allocated event names (such as "STOP"),
+ * in the order they were received.
+ */
+GSList *
+cc_oci_qmp_events_parse (GString *received)
+{
+	GSList  *events = NULL;
+	gchar   *p;
+
+	if (! received) {
+		return NULL;
+	}
+
+	while ((p = g_strstr_len (received->str, (gssize)received->len,
+					CC_OCI_MSG_SEPARATOR)) != NULL) {
+		JsonParser  *parser;
+		JsonNode    *root;
+		gssize       msg_len = p - received->str;
+
+		parser = json_parser_new ();
+
+		if (json_parser_load_from_data (parser, received->str,
+					msg_len, NULL)) {
+			root = json_parser_get_root (parser);
+
+			if (root && JSON_NODE_HOLDS_OBJECT (root)) {
+				JsonObject   *obj = json_node_get_object (root);
+				const gchar  *event = NULL;
+
+				if (json_object_has_member (obj, "event")) {
+					event = json_object_get_string_member (obj,
+							"event");
+				}
+
+				if (event) {
+					events = g_slist_prepend (events,
+							g_strdup (event));
+				}
+			}
+		}
+
+		g_object_unref (parser);
+
+		g_string_erase (received, 0,
+				msg_len + (gssize)sizeof (CC_OCI_MSG_SEPARATOR)-1);
+	}
+
+	return g_slist_reverse (events);
+}
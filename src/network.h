@@ -21,7 +21,14 @@
 #ifndef _CC_OCI_NETWORK_H
 #define _CC_OCI_NETWORK_H
 
+#include <gio/gio.h>
+
 gboolean cc_oci_vm_pause (const gchar *socket_path, GPid pid);
 gboolean cc_oci_vm_resume (const gchar *socket_path, GPid pid);
+gboolean cc_oci_vm_migrate (const gchar *socket_path, GPid pid,
+		const gchar *uri);
+gboolean cc_oci_vm_incoming_wait (const gchar *socket_path, GPid pid);
+GSocket *cc_oci_qmp_events_connect (const gchar *socket_path);
+GSList *cc_oci_qmp_events_parse (GString *received);
 
 #endif /* _CC_OCI_NETWORK_H */
@@ -34,6 +34,27 @@
 #include "oci-config.h"
 #include "networking.h"
 #include "proxy.h"
+#include "json.h"
+#include "section.h"
+
+/** Keys of the top-level values of \ref CC_OCI_CONFIG_FILE. */
+static const struct cc_oci_json_key config_keys[] = {
+	CC_OCI_JSON_KEY ("ociVersion" , CC_OCI_JSON_STRING , struct oci_cfg , oci_version),
+	CC_OCI_JSON_KEY ("hostname"   , CC_OCI_JSON_STRING , struct oci_cfg , hostname),
+
+	/* terminator */
+	{ NULL }
+};
+
+/** Data passed to \ref cc_oci_config_handle_member. */
+struct config_parse_data {
+	struct cc_oci_config  *config;
+
+	/** Spec handler for each \ref cc_oci_section (or \c NULL). */
+	struct spec_handler   *spec_handlers[CC_OCI_SECTION_COUNT];
+
+	gboolean               ret;
+};
 
 /*!
  * Free all resources associated with \p h hook object.
@@ -150,6 +171,7 @@ cc_oci_config_free (struct cc_oci_config *config)
 	g_free_if_set (config->console);
 	g_free_if_set (config->bundle_path);
 	g_free_if_set (config->root_dir);
+	g_free_if_set (config->restore_path);
 	g_free_if_set (config->pid_file);
 	g_free_if_set (config->device_name);
 
@@ -229,6 +251,35 @@ cc_oci_config_free (struct cc_oci_config *config)
 	g_free (config);
 }
 
+/*!
+ * Index \p spec_handlers by the section each of them handles.
+ *
+ * \param spec_handlers Array of \ref spec_handler's.
+ * \param[out] index Spec handler for each \ref cc_oci_section.
+ */
+static void
+cc_oci_spec_handlers_index (struct spec_handler **spec_handlers,
+	struct spec_handler *index[CC_OCI_SECTION_COUNT])
+{
+	enum cc_oci_section section;
+
+	memset (index, 0, sizeof (*index) * CC_OCI_SECTION_COUNT);
+
+	for (struct spec_handler** i=spec_handlers; (*i); ++i) {
+		section = cc_oci_section_from_name ((*i)->name);
+		if (section == CC_OCI_SECTION_UNKNOWN) {
+			g_critical ("no section for spec handler: %s",
+					(*i)->name);
+			continue;
+		}
+
+		/* the first handler for a section is used */
+		if (! index[section]) {
+			index[section] = *i;
+		}
+	}
+}
+
 /*!
  * find and call the spec handler for each child of GNode
  *
@@ -242,35 +293,145 @@ gboolean
 cc_oci_process_config (GNode *root, struct cc_oci_config *config,
 	struct spec_handler **spec_handlers)
 {
+	struct spec_handler *index[CC_OCI_SECTION_COUNT];
+	struct spec_handler *handler;
+	enum cc_oci_section section;
 	GNode* node;
 
+	cc_oci_spec_handlers_index (spec_handlers, index);
+
 	for (node = g_node_first_child(root); node; node = g_node_next_sibling(node)) {
 		if (! node->data) {
 			continue;
 		}
 
+		section = cc_oci_section_from_name (node->data);
+
 		if (node->children) {
-			if (g_strcmp0 (node->data, "ociVersion") == 0) {
+			if (section == CC_OCI_SECTION_OCI_VERSION) {
 				config->oci.oci_version = g_strdup (node->children->data);
 			}
 
-			if (g_strcmp0 (node->data, "hostname") == 0) {
+			if (section == CC_OCI_SECTION_HOSTNAME) {
 				config->oci.hostname = g_strdup (node->children->data);
 			}
 		}
 
-		/* looking for right spec handler */
-		for (struct spec_handler** i=spec_handlers; (*i); ++i) {
-			if (g_strcmp0((*i)->name, node->data) == 0) {
-				/* run spec handler */
-				if (! (*i)->handle_section(node, config)) {
-					g_critical("failed spec handler: %s", (*i)->name);
-					return false;
-				}
-				break;
-			}
+		/* run spec handler */
+		handler = index[section];
+		if (handler && ! handler->handle_section(node, config)) {
+			g_critical("failed spec handler: %s", handler->name);
+			return false;
 		}
 	}
 
 	return true;
 }
+
+/*!
+ * Handle a single top-level member of \ref CC_OCI_CONFIG_FILE.
+ *
+ * Only members handled by one of the spec handlers are converted to
+ * a \c GNode tree.
+ *
+ * \param object \c JsonObject of the config file.
+ * \param name Name of the member.
+ * \param value \c JsonNode of the member.
+ * \param data \ref config_parse_data.
+ */
+static void
+cc_oci_config_handle_member (JsonObject *object, const gchar *name,
+	JsonNode *value, struct config_parse_data *data)
+{
+	const struct cc_oci_json_key *key;
+	struct spec_handler *handler;
+	enum cc_oci_section section;
+	GNode *node;
+
+	(void)object;
+
+	if (! data->ret) {
+		return;
+	}
+
+	section = cc_oci_section_from_name (name);
+	if (section == CC_OCI_SECTION_UNKNOWN) {
+		return;
+	}
+
+	key = cc_oci_json_key_find (config_keys, name);
+	if (key) {
+		if (! cc_oci_json_decode_value (value, key, &data->config->oci)) {
+			g_warning ("ignoring invalid %s", name);
+		}
+		return;
+	}
+
+	handler = data->spec_handlers[section];
+	if (! handler) {
+		return;
+	}
+
+	node = cc_oci_json_member_to_node (name, value);
+
+	/* run spec handler */
+	if (! handler->handle_section(node, data->config)) {
+		g_critical("failed spec handler: %s", handler->name);
+		data->ret = false;
+	}
+
+	g_free_node (node);
+}
+
+/*!
+ * Parse \ref CC_OCI_CONFIG_FILE and call the spec handler for each
+ * of its sections.
+ *
+ * Unlike \ref cc_oci_process_config(), only the sections handled by
+ * \p spec_handlers are converted to a \c GNode tree; top-level values
+ * are decoded directly into \p config and other sections are skipped.
+ *
+ * \param config_file Full path to \ref CC_OCI_CONFIG_FILE.
+ * \param[in,out] config \ref cc_oci_config.
+ * \param spec_handlers Array of \ref spec_handler's.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_process_config_file (const gchar *config_file,
+	struct cc_oci_config *config,
+	struct spec_handler **spec_handlers)
+{
+	JsonParser *parser = NULL;
+	JsonNode *root;
+	struct config_parse_data data = {
+		.config = config,
+		.ret = false,
+	};
+
+	if (! (config_file && config && spec_handlers)) {
+		return false;
+	}
+
+	cc_oci_spec_handlers_index (spec_handlers, data.spec_handlers);
+
+	parser = cc_oci_json_load (config_file);
+	if (! parser) {
+		return false;
+	}
+
+	root = json_parser_get_root (parser);
+	if (JSON_NODE_TYPE (root) != JSON_NODE_OBJECT) {
+		g_critical ("invalid config file: %s", config_file);
+		goto out;
+	}
+
+	data.ret = true;
+
+	json_object_foreach_member (json_node_get_object (root),
+		(JsonObjectForeach)cc_oci_config_handle_member, &data);
+
+out:
+	g_object_unref (parser);
+	return data.ret;
+}
@@ -35,4 +35,9 @@ void cc_oci_hook_free (struct oci_cfg_hook *h);
 gboolean
 cc_oci_process_config (GNode* root, struct cc_oci_config* config,
 	struct spec_handler** spec_handlers);
+
+gboolean
+cc_oci_process_config_file (const gchar *config_file,
+	struct cc_oci_config *config,
+	struct spec_handler **spec_handlers);
 #endif /* _CC_OCI_CONFIG_H */
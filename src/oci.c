@@ -52,13 +52,16 @@
 #include "json.h"
 #include "mount.h"
 #include "state.h"
+#include "state_index.h"
 #include "oci-config.h"
+#include "config_cache.h"
 #include "runtime.h"
 #include "spec_handler.h"
 #include "command.h"
 #include "proxy.h"
 #include "pod.h"
 #include "namespace.h"
+#include "annotation.h"
 
 extern struct start_data start_data;
 private gboolean cc_oci_container_running (const struct oci_state *state);
@@ -253,6 +256,50 @@ err:
 }
 
 
+/*!
+ * Determine the state of a container a process is about to be
+ * exec'd in.
+ *
+ * Only the state summary (container id, PID, status and pod details)
+ * is read since that is all that is needed to reach the container
+ * through the proxy.
+ *
+ * \param[out] config \ref cc_oci_config.
+ * \param[out] state \ref oci_state.
+ *
+ * \note Used by the "exec" command.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_get_exec_state (struct cc_oci_config *config,
+		struct oci_state **state)
+{
+	if ((!config) || (!state)) {
+		return false;
+	}
+
+	if (! cc_oci_runtime_path_get (config)) {
+		return false;
+	}
+
+	if (! cc_oci_state_file_get (config)) {
+		return false;
+	}
+
+	*state = cc_oci_state_file_read_summary (config->state.state_file_path);
+	if (! (*state)) {
+		g_critical("failed to read state file for container %s",
+		           config->optarg_container_id);
+		return false;
+	}
+
+	config->state.workload_pid = (*state)->pid;
+	config->state.status = (*state)->status;
+
+	return true;
+}
+
 /*!
  * Create OCI cgroup files under a given directory.
  * The actual cgroup creation routine (\ref cc_oci_create_cgroups)
@@ -370,8 +417,9 @@ cc_oci_kill (struct cc_oci_config *config,
 		config->state.status = OCI_STATUS_STOPPED;
 
 		/* update state file */
-		if (! cc_oci_state_file_create (config, state->create_time)) {
-			g_critical ("failed to recreate state file");
+		if (! cc_oci_state_file_update (config,
+					CC_OCI_STATE_UPDATE_STATUS)) {
+			g_critical ("failed to update state file");
 			return false;
 		}
 
@@ -410,8 +458,9 @@ cc_oci_kill (struct cc_oci_config *config,
 		if (signum == SIGKILL || signum == SIGTERM) {
 			config->state.status = OCI_STATUS_STOPPED;
 			/* update state file */
-			if (! cc_oci_state_file_create (config, state->create_time)) {
-				g_critical ("failed to recreate state file");
+			if (! cc_oci_state_file_update (config,
+						CC_OCI_STATE_UPDATE_STATUS)) {
+				g_critical ("failed to update state file");
 				return false;
 			}
 		}
@@ -426,8 +475,9 @@ cc_oci_kill (struct cc_oci_config *config,
 
 		config->state.status = OCI_STATUS_STOPPED;
 		/* update state file */
-		if (! cc_oci_state_file_create (config, state->create_time)) {
-			g_critical ("failed to recreate state file");
+		if (! cc_oci_state_file_update (config,
+					CC_OCI_STATE_UPDATE_STATUS)) {
+			g_critical ("failed to update state file");
 			return false;
 		}
 	}
@@ -555,25 +605,41 @@ set_env_home(struct cc_oci_config *config)
  * the specified config.
  *
  * \param config \ref cc_oci_config.
+ * \param proxy_bye Thread running cc_oci_proxy_bye_thread() (or \c NULL).
+ * It is always joined; the state of the container is only deleted if
+ * it succeeded.
  *
  * \return \c true on success, else \c false.
  */
 static gboolean
-cc_oci_cleanup (struct cc_oci_config *config)
+cc_oci_cleanup (struct cc_oci_config *config, GThread *proxy_bye)
 {
+	gboolean ret = false;
+
 	g_assert (config);
 
 	if (! cc_oci_handle_unmounts (config)) {
-		return false;
+		goto out;
 	}
 
 	/* Container rootfs unmount should happen after volume unmounts */
 	if (! cc_oci_handle_rootfs_unmount(config)) {
-		return false;
+		goto out;
 	}
 
 	/* Pod unmounts should happen after the volume unmounts */
 	if (! cc_pod_handle_unmounts(config)) {
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	if (proxy_bye && ! GPOINTER_TO_INT (g_thread_join (proxy_bye))) {
+		ret = false;
+	}
+
+	if (! ret) {
 		return false;
 	}
 
@@ -588,6 +654,31 @@ cc_oci_cleanup (struct cc_oci_config *config)
 	return true;
 }
 
+/*!
+ * Allow the proxy to clean up the resources of a container.
+ *
+ * Run in its own thread since it doesn't depend on the host-side
+ * teardown done by cc_oci_cleanup().
+ *
+ * \param data \ref cc_oci_config.
+ *
+ * \return \c GINT_TO_POINTER(true) on success,
+ * else \c GINT_TO_POINTER(false).
+ */
+static gpointer
+cc_oci_proxy_bye_thread (gpointer data)
+{
+	struct cc_oci_config *config = data;
+	gboolean ret;
+
+	/* The proxy commands run the default main context, which is
+	 * safe as cc_oci_cleanup() doesn't use it.
+	 */
+	ret = cc_proxy_cmd_bye (config->proxy, config->optarg_container_id);
+
+	return GINT_TO_POINTER (ret);
+}
+
 /*!
  * Parse the \c GNode representation of \ref CC_OCI_CONFIG_FILE
  * and save values in the provided \ref cc_oci_config.
@@ -601,7 +692,6 @@ cc_oci_config_file_parse (struct cc_oci_config *config)
 {
 	g_autofree gchar  *config_file = NULL;
 	g_autofree gchar  *cwd = NULL;
-	GNode             *root = NULL;
 	gboolean           ret = false;
 
 	if (! config || ! config->bundle_path) {
@@ -632,18 +722,9 @@ cc_oci_config_file_parse (struct cc_oci_config *config)
 		return false;
 	}
 
-	/* convert json file to GNode */
-	if (! cc_oci_json_parse (&root, config_file)) {
-		goto out;
-	}
-
-#ifdef DEBUG
-	/* show json file converted to GNode */
-	cc_oci_node_dump (root);
-#endif /*DEBUG*/
-
-	/* parse the GNode representation of CC_OCI_CONFIG_FILE */
-	if (! cc_oci_process_config(root, config, start_spec_handlers)) {
+	/* parse CC_OCI_CONFIG_FILE */
+	if (! cc_oci_process_config_file (config_file, config,
+				start_spec_handlers)) {
 		g_critical ("failed to process config");
 		goto out;
 	}
@@ -659,8 +740,6 @@ cc_oci_config_file_parse (struct cc_oci_config *config)
 	ret = true;
 
 out:
-	g_free_node (root);
-
 	(void)g_chdir (cwd);
 
 	return ret;
@@ -704,6 +783,11 @@ cc_oci_create (struct cc_oci_config *config)
 		return false;
 	}
 
+	/* Save the parsed config so later commands needn't parse it
+	 * again (failure is not fatal).
+	 */
+	(void)cc_oci_config_cache_save (config);
+
 	/**
 	 * Bind mount container rootfs
 	 */
@@ -903,7 +987,9 @@ cc_oci_start (struct cc_oci_config *config,
 		}
 	}
 
-	if (! config->pod) {
+	if (config->restore_path) {
+		; /* the workload is already running in the restored VM */
+	} else if (! config->pod) {
 		if (! cc_proxy_hyper_new_container (config)) {
 			ret = false;
 			goto out;
@@ -935,16 +1021,21 @@ cc_oci_start (struct cc_oci_config *config,
 	config->state.status = OCI_STATUS_RUNNING;
 
 	/* update state file after run container */
-	if (! cc_oci_state_file_create (config, state->create_time)) {
-		g_critical ("failed to recreate state file");
+	if (! cc_oci_state_file_update (config, CC_OCI_STATE_UPDATE_STATUS)) {
+		g_critical ("failed to update state file");
 		ret = false;
 		goto out;
 	}
 
 	/* If a hook returns a non-zero exit code, then an error is
 	logged and the remaining hooks are executed. */
-	cc_run_hooks (config->oci.hooks.poststart,
-	              config->state.state_file_path, false);
+	if (cc_oci_annotations_get_hooks_async (config->oci.annotations)) {
+		cc_run_hooks_detached (config->oci.hooks.poststart,
+		                       config->state.state_file_path);
+	} else {
+		cc_run_hooks (config->oci.hooks.poststart,
+		              config->state.state_file_path, false);
+	}
 
 	if (wait) {
 		if (loop) {
@@ -981,7 +1072,7 @@ cc_oci_start (struct cc_oci_config *config,
 
 		/* If the VM was stopped then *do not* cleanup */
 		if (config->state.status != OCI_STATUS_STOPPED) {
-			ret = cc_oci_cleanup (config);
+			ret = cc_oci_cleanup (config, NULL);
 		}
 	} else {
 		ret = true;
@@ -1071,6 +1162,8 @@ gboolean
 cc_oci_stop (struct cc_oci_config *config,
 		struct oci_state *state)
 {
+	GThread *proxy_bye = NULL;
+
 	if (! (config && state)){
 		return false;
 	}
@@ -1099,21 +1192,31 @@ cc_oci_stop (struct cc_oci_config *config,
 				state->id, state->pid);
 	}
 
-	/* Allow the proxy to clean up resources */
-	if (cc_pod_is_vm (config) &&
-	    ! cc_proxy_cmd_bye (config->proxy, config->optarg_container_id)) {
-		return false;
-	}
-
 	/* The post-stop hooks are called after the container process is
 	 * stopped. Cleanup or debugging could be performed in such a
 	 * hook. If a hook returns a non-zero exit code, then an error
 	 * is logged and the remaining hooks are executed.
+	 *
+	 * They are run before any other thread is started since they
+	 * fork.
+	 */
+	if (cc_oci_annotations_get_hooks_async (config->oci.annotations)) {
+		cc_run_hooks_detached (config->oci.hooks.poststop,
+		                       config->state.state_file_path);
+	} else {
+		cc_run_hooks (config->oci.hooks.poststop,
+		              config->state.state_file_path, false);
+	}
+
+	/* Allow the proxy to clean up resources while the host-side
+	 * resources are released.
 	 */
-	cc_run_hooks (config->oci.hooks.poststop,
-	              config->state.state_file_path, false);
+	if (cc_pod_is_vm (config)) {
+		proxy_bye = g_thread_new ("proxy-bye",
+				cc_oci_proxy_bye_thread, config);
+	}
 
-	return cc_oci_cleanup (config);
+	return cc_oci_cleanup (config, proxy_bye);
 }
 
 /*!
@@ -1155,7 +1258,7 @@ cc_oci_toggle (struct cc_oci_config *config,
 
 	config->state.status = dest_status;
 
-	return cc_oci_state_file_create (config, state->create_time);
+	return cc_oci_state_file_update (config, CC_OCI_STATE_UPDATE_STATUS);
 }
 /*!
  * Parse the \c GNode representation of \c process_json file
@@ -1356,59 +1459,6 @@ cc_oci_list_vm (const struct oci_state *state,
 	json_array_add_object_element (options->array, obj);
 }
 
-/*!
- * Get the state of a VM.
- *
- * \param name Name of VM.
- * \param root_dir Root directory to use for runtime.
- *
- * Note that error checking has to be lax here since:
- *
- * - the VM may be destroyed as this function runs.
- *
- * \return \ref oci_state on success, else \c NULL.
- */
-static struct oci_state *
-cc_oci_vm_get_state (const gchar *name, const char *root_dir)
-{
-	struct cc_oci_config  *config = NULL;
-	struct oci_state      *state = NULL;
-	gchar                 *config_file = NULL;
-
-	if (! (name && root_dir)) {
-		return NULL;
-	}
-
-	config = cc_oci_config_create ();
-	if (! config) {
-		return NULL;
-	}
-
-	config->optarg_container_id = name;
-
-	if (root_dir) {
-		config->root_dir = g_strdup (root_dir);
-	}
-
-	if (! cc_oci_runtime_path_get (config)) {
-		goto out;
-	}
-
-	if (! cc_oci_state_file_get (config)) {
-		goto out;
-	}
-
-	state = cc_oci_state_file_read (config->state.state_file_path);
-
-out:
-	g_free_if_set (config_file);
-	if (config) {
-		cc_oci_config_free (config);
-	}
-
-	return state;
-}
-
 /*!
  * Update the widths required to display a VM.
  *
@@ -1427,7 +1477,7 @@ cc_oci_update_options (const struct oci_state *state,
 		struct format_options *options)
 {
 	static int   status_max = 0;
-	GString     *str = g_string_new("");
+	gchar        pid[sizeof ("4294967295")];
 
 	g_assert (state);
 	g_assert (state->vm);
@@ -1438,13 +1488,12 @@ cc_oci_update_options (const struct oci_state *state,
 		options->status_width = status_max;
 	}
 
-	g_string_assign(str, state->id);
 	options->id_width = CC_OCI_MAX (options->id_width,
-			(int)str->len);
+			(int)strlen (state->id));
 
-	g_string_printf(str, "%u", (unsigned)state->pid);
+	g_snprintf (pid, sizeof (pid), "%u", (unsigned)state->pid);
 	options->pid_width = CC_OCI_MAX (options->pid_width,
-			(int)str->len);
+			(int)strlen (pid));
 
 	/* XXX: a PID may be shorter than its column heading, so handle
 	 * that.
@@ -1452,27 +1501,25 @@ cc_oci_update_options (const struct oci_state *state,
 	options->pid_width = CC_OCI_MAX (options->pid_width,
 			(int)sizeof("PID")-1);
 
-	g_string_assign(str, state->bundle_path);
 	options->bundle_width = CC_OCI_MAX (options->bundle_width,
-			(int)str->len);
+			(int)strlen (state->bundle_path));
 
-	g_string_assign(str, state->create_time);
 	options->created_width = CC_OCI_MAX (options->created_width,
-			(int)str->len);
+			(int)strlen (state->create_time));
+
+	/* VM columns are only displayed with "--all" */
+	if (! options->show_all) {
+		return;
+	}
 
-	g_string_assign(str, state->vm->hypervisor_path);
 	options->hypervisor_width = CC_OCI_MAX (options->hypervisor_width,
-			(int)str->len);
+			(int)strlen (state->vm->hypervisor_path));
 
-	g_string_assign(str, state->vm->image_path);
 	options->image_width = CC_OCI_MAX (options->image_width,
-			(int)str->len);
+			(int)strlen (state->vm->image_path));
 
-	g_string_assign(str, state->vm->kernel_path);
 	options->kernel_width = CC_OCI_MAX (options->kernel_width,
-			(int)str->len);
-
-	g_string_free(str, true);
+			(int)strlen (state->vm->kernel_path));
 }
 
 /*!
@@ -1494,11 +1541,9 @@ gboolean
 cc_oci_list (struct cc_oci_config *config, const gchar *format,
         gboolean show_all)
 {
-	GDir                   *dir;
 	const gchar            *dirname;
-	const gchar            *name;
 	GSList                 *vms = NULL;
-	struct oci_state       *state = NULL;
+	GSList                 *l;
 	gchar                  *str = NULL;
 	struct format_options   options = { 0 };
 
@@ -1521,40 +1566,16 @@ cc_oci_list (struct cc_oci_config *config, const gchar *format,
 
 	options.show_all = show_all;
 
-	dir = g_dir_open (dirname, 0x0, NULL);
-	if (! dir) {
-		/* No containers yet, so not an error */
-		goto no_vms;
-	}
-
-	/* Read all VM state files and add to a list */
-	while ((name = g_dir_read_name (dir)) != NULL) {
-		gboolean ret;
-		gchar *path;
+	/* Read all VM states, from the index where possible */
+	vms = cc_oci_state_index_list (dirname);
 
-		path = g_build_path ("/", dirname, name, NULL);
-
-		ret = g_file_test (path, G_FILE_TEST_IS_DIR);
-		if (! ret) {
-			g_free (path);
-			continue;
-		}
-
-		g_free (path);
-
-		state = cc_oci_vm_get_state (name, dirname);
-		if (! state) {
-			continue;
-		}
-
-		if (! options.use_json) {
-			/* calculate the maximum field widths
-			 * to display the state values.
-			 */
-			cc_oci_update_options (state, &options);
+	if (! options.use_json) {
+		/* calculate the maximum field widths
+		 * to display the state values.
+		 */
+		for (l = vms; l; l = g_slist_next (l)) {
+			cc_oci_update_options (l->data, &options);
 		}
-
-		vms = g_slist_append (vms, state);
 	}
 
 no_vms:
@@ -1618,14 +1639,46 @@ no_vms:
 	g_slist_free_full (vms, (GDestroyNotify)cc_oci_state_free);
 
 out:
-	if (dir) {
-		g_dir_close (dir);
-	}
 	g_free_if_set (str);
 
 	return true;
 }
 
+/*!
+ * List the ids of all containers, one per line.
+ *
+ * Unlike cc_oci_list(), state files are not read.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_list_ids (struct cc_oci_config *config)
+{
+	const gchar  *dirname;
+	GSList       *ids;
+	GSList       *l;
+
+	if (! config) {
+		return false;
+	}
+
+	dirname = config->root_dir
+		? config->root_dir
+		: CC_OCI_RUNTIME_DIR_PREFIX;
+
+	ids = cc_oci_runtime_container_ids (dirname);
+
+	for (l = ids; l; l = g_slist_next (l)) {
+		g_print ("%s\n", (const gchar *)l->data);
+	}
+
+	g_slist_free_full (ids, g_free);
+
+	return true;
+}
+
 /**
  * Transfer certain elements from \p state to \p config.
  *
@@ -1708,6 +1761,11 @@ cc_oci_config_update (struct cc_oci_config *config,
 		state->block_fstype = NULL;
 	}
 
+	if (state->annotations && ! config->oci.annotations) {
+		config->oci.annotations = state->annotations;
+		state->annotations = NULL;
+	}
+
 	return true;
 }
 
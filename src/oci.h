@@ -62,6 +62,11 @@
 /** Name of hypervisor socket used to determine if VM is running */
 #define CC_OCI_PROCESS_SOCKET		"process.sock"
 
+/** Name of hypervisor socket (a second QMP monitor) that "events"
+ * keeps connected to, to receive hypervisor events.
+ */
+#define CC_OCI_EVENTS_SOCKET		"events.sock"
+
 /** Name of hypervisor socket used as a console device. */
 #define CC_OCI_CONSOLE_SOCKET		"console.sock"
 
@@ -78,6 +83,20 @@
  */
 #define CC_OCI_STATE_FILE		"state.json"
 
+/** Mode for \ref CC_OCI_STATE_FILE. */
+#define CC_OCI_STATE_FILE_MODE		0644
+
+/** File below a checkpoint image directory that holds the saved
+ * state of the VM (device state and guest memory).
+ */
+#define CC_OCI_CHECKPOINT_VM_FILE	"vm.img"
+
+/** File below a checkpoint image directory that holds the main memory
+ * of the VM when it is saved separately from \ref
+ * CC_OCI_CHECKPOINT_VM_FILE, to be loaded on demand on restore.
+ */
+#define CC_OCI_CHECKPOINT_RAM_FILE	"ram.img"
+
 /** Directory below which container-specific directory will be created.
  */
 #define CC_OCI_RUNTIME_DIR_PREFIX	LOCALSTATEDIR \
@@ -188,8 +207,7 @@ struct oci_cfg_hook {
 	gchar  **args;           /*!< Arguments to command (argv[0] is the first argument). */
 	gchar  **env;            /*!< List of environment variables to set. */
 
-	/** \warning FIXME: hook timeout not in the official schema yet!?! */
-	gint     timeout;
+	gint     timeout;        /*!< Seconds the hook may run for before it is killed (no limit if \c 0). */
 };
 
 struct oci_cfg_hooks {
@@ -298,6 +316,21 @@ struct cc_oci_vm_cfg {
 	/** Full path to kernel to use for VM. */
 	gchar kernel_path[PATH_MAX];
 
+	/** Hypervisor path as specified in \ref CC_OCI_VM_CONFIG
+	 * (may be a symbolic link to \ref hypervisor_path).
+	 */
+	gchar hypervisor_config_path[PATH_MAX];
+
+	/** Image path as specified in \ref CC_OCI_VM_CONFIG
+	 * (may be a symbolic link to \ref image_path).
+	 */
+	gchar image_config_path[PATH_MAX];
+
+	/** Kernel path as specified in \ref CC_OCI_VM_CONFIG
+	 * (may be a symbolic link to \ref kernel_path).
+	 */
+	gchar kernel_config_path[PATH_MAX];
+
 	/** Full path to CC_OCI_WORKLOAD_FILE
 	 * (which exists below "root_path").
 	 */
@@ -466,6 +499,24 @@ struct oci_state {
 	int              block_index;
 };
 
+/** How state file writes are flushed to storage.
+ *
+ * State files are always written to a temporary file which is then
+ * renamed, so readers never see a partially-written file.
+ */
+enum cc_oci_state_sync {
+	/** \c fsync(2) the file before renaming it (default). */
+	CC_OCI_STATE_SYNC_FILE = 0,
+
+	/** Don't flush, leaving it to the kernel. */
+	CC_OCI_STATE_SYNC_NONE,
+
+	/** As \ref CC_OCI_STATE_SYNC_FILE, and also \c fsync(2) the
+	 * directory after the rename.
+	 */
+	CC_OCI_STATE_SYNC_FULL,
+};
+
 /** clr-specific state fields. */
 struct cc_oci_container_state {
 	/** Full path to generated state file. */
@@ -508,6 +559,9 @@ struct cc_oci_container_state {
 
 	/* Index of the drive/block device passed to the hypervisor */
 	int             block_index;
+
+	/** How to flush writes to \ref state_file_path. */
+	enum cc_oci_state_sync sync;
 };
 
 /** clr-specific mount details. */
@@ -564,6 +618,16 @@ struct cc_proxy {
 	 * from hyperstart when asked for it.
 	 */
 	gchar *vm_console_socket;
+
+	/** Maximum I/O frame size negotiated with the proxy on the
+	 * last allocateIO command (0 if the proxy didn't advertise one).
+	 */
+	guint32 max_frame_size;
+
+	/** If non-zero, the VM was restored from a checkpoint and this
+	 * is the first I/O sequence number used by its processes.
+	 */
+	gint restore_io_base;
 };
 
 /**
@@ -647,6 +711,11 @@ struct cc_oci_config {
 	/** If \c true, don't wait for hypervisor process to finish. */
 	gboolean detached_mode;
 
+	/** If set, path to the checkpoint image directory the VM
+	 * is restored from, rather than being booted.
+	 */
+	gchar *restore_path;
+
 	struct cc_proxy *proxy;
 
 	/** Workload directory for regular container
@@ -682,6 +751,8 @@ gchar *cc_oci_get_workload_dir (struct cc_oci_config *config);
 gboolean cc_oci_get_config_and_state (gchar **config_file,
 		struct cc_oci_config *config,
 		struct oci_state **state);
+gboolean cc_oci_get_exec_state (struct cc_oci_config *config,
+		struct oci_state **state);
 void cc_oci_state_free (struct oci_state *state);
 gboolean cc_oci_stop (struct cc_oci_config *config,
         struct oci_state *state);
@@ -692,6 +763,7 @@ gboolean cc_oci_exec (struct cc_oci_config *config,
 		const gchar *process_json);
 gboolean cc_oci_list (struct cc_oci_config *config,
 		const gchar *format, gboolean show_all);
+gboolean cc_oci_list_ids (struct cc_oci_config *config);
 gboolean cc_oci_delete (struct cc_oci_config *config,
 		struct oci_state *state);
 gboolean cc_oci_kill (struct cc_oci_config *config,
@@ -303,6 +303,14 @@ cc_pod_container_create (struct cc_oci_config *config)
 		goto out;
 	}
 
+	bytes = write (shim_args_fd, &config->proxy->max_frame_size,
+			sizeof (config->proxy->max_frame_size));
+	if (bytes < 0) {
+		g_critical ("failed to send proxy I/O frame size to shim child: %s",
+			strerror (errno));
+		goto out;
+	}
+
 	/* send proxy IO fd to cc-shim child */
 	shim_socket_connection = cc_oci_socket_connection_from_fd(shim_socket_fd);
 	if (! shim_socket_connection) {
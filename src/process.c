@@ -48,6 +48,8 @@
 #include <sys/ioctl.h>
 #include <sys/file.h>
 #include <sys/ptrace.h>
+#include <poll.h>
+#include <signal.h>
 
 #include <glib.h>
 #include <glib/gprintf.h>
@@ -68,8 +70,19 @@
 #include "pod.h"
 #include "proxy.h"
 #include "command.h"
+#include "annotation.h"
+#include "network.h"
 
-#define SHIM_ARG_COUNT 13
+#define SHIM_ARG_COUNT 25
+
+/** Initial interval (ms) between checks for a hook having exited. */
+#define CC_OCI_HOOK_POLL_MIN 1
+
+/** Maximum interval (ms) between checks for a hook having exited. */
+#define CC_OCI_HOOK_POLL_MAX 100
+
+/** Length at which hook output without a newline is logged anyway. */
+#define CC_OCI_HOOK_OUTPUT_LINE_MAX 4096
 
 extern struct start_data start_data;
 
@@ -262,22 +275,178 @@ cc_oci_child_watcher (GPid pid, gint status,
 	g_main_loop_quit (main_loop);
 }
 
+/*!
+ * Log the lines of output read from a hook.
+ *
+ * Any incomplete final line is left in \p buffer.
+ *
+ * \param hook \ref oci_cfg_hook.
+ * \param buffer Output read from the hook.
+ * \param flush If \c true, also log an incomplete final line.
+ */
+static void
+cc_run_hook_log_output (const struct oci_cfg_hook *hook, GString *buffer,
+		gboolean flush)
+{
+	gchar *nl;
+
+	while ((nl = memchr (buffer->str, '\n', buffer->len))) {
+		*nl = '\0';
+		g_message ("hook %s: %s", hook->path, buffer->str);
+		g_string_erase (buffer, 0, (nl - buffer->str) + 1);
+	}
+
+	if ((flush || buffer->len >= CC_OCI_HOOK_OUTPUT_LINE_MAX)
+			&& buffer->len) {
+		g_message ("hook %s: %s", hook->path, buffer->str);
+		g_string_truncate (buffer, 0);
+	}
+}
+
+/*!
+ * Read the output available from a hook and log it.
+ *
+ * \param hook \ref oci_cfg_hook.
+ * \param fd Non-blocking readable end of the hook output pipe.
+ * \param buffer Output not yet logged.
+ *
+ * \return \c false once there is no more output to read,
+ * else \c true.
+ */
+static gboolean
+cc_run_hook_read_output (const struct oci_cfg_hook *hook, int fd,
+		GString *buffer)
+{
+	gchar    buf[BUFSIZ];
+	ssize_t  bytes;
+
+	while (true) {
+		bytes = read (fd, buf, sizeof (buf));
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (bytes <= 0) {
+			break;
+		}
+
+		g_string_append_len (buffer, buf, bytes);
+		cc_run_hook_log_output (hook, buffer, false);
+	}
+
+	return bytes < 0 && errno == EAGAIN;
+}
+
+/*!
+ * Wait for a hook to exit, killing it if it runs for longer than
+ * its timeout.
+ *
+ * The hook is polled with an increasing interval so that short hooks
+ * are reaped promptly without spinning on long ones.
+ *
+ * \param hook \ref oci_cfg_hook.
+ * \param pid Process ID of hook.
+ * \param output_fd Non-blocking readable end of a pipe connected to
+ *   the hook's stdout and stderr whose contents are logged, or \c -1.
+ * \param[out] status Wait status of hook.
+ *
+ * \return \c true if the hook exited before its timeout, else \c false.
+ */
+static gboolean
+cc_run_hook_wait (const struct oci_cfg_hook *hook, pid_t pid,
+		int output_fd, int *status)
+{
+	GString  *output = NULL;
+	gint64    deadline = 0;
+	gint      interval = CC_OCI_HOOK_POLL_MIN;
+	gboolean  ret = false;
+	pid_t     waited;
+
+	if (hook->timeout <= 0 && output_fd < 0) {
+		/* nothing to do until the hook exits */
+		if (waitpid (pid, status, 0) != pid) {
+			g_critical ("waitpid failed: %s", strerror(errno));
+			return false;
+		}
+		return true;
+	}
+
+	if (hook->timeout > 0) {
+		deadline = g_get_monotonic_time ()
+			+ (gint64)hook->timeout * G_USEC_PER_SEC;
+	}
+
+	output = g_string_new ("");
+
+	while (true) {
+		waited = waitpid (pid, status, WNOHANG);
+		if (waited == pid) {
+			break;
+		} else if (waited < 0) {
+			g_critical ("waitpid failed: %s", strerror(errno));
+			goto out;
+		}
+
+		if (deadline && g_get_monotonic_time () >= deadline) {
+			g_critical ("hook %s timed out after %ds, killing it",
+					hook->path, hook->timeout);
+			(void)kill (pid, SIGKILL);
+			(void)waitpid (pid, status, 0);
+			goto out;
+		}
+
+		if (output_fd >= 0) {
+			struct pollfd pfd = { output_fd, POLLIN, 0 };
+
+			if (poll (&pfd, 1, interval) > 0) {
+				if (! cc_run_hook_read_output (hook,
+							output_fd, output)) {
+					/* hook closed its output */
+					output_fd = -1;
+				}
+				continue;
+			}
+		} else {
+			g_usleep ((gulong)interval * 1000);
+		}
+
+		interval = MIN (interval * 2, CC_OCI_HOOK_POLL_MAX);
+	}
+
+	ret = true;
+
+out:
+	/* Log whatever the hook wrote before exiting. Anything its own
+	 * children write later is lost.
+	 */
+	if (output_fd >= 0) {
+		(void)cc_run_hook_read_output (hook, output_fd, output);
+	}
+	cc_run_hook_log_output (hook, output, true);
+	g_string_free (output, true);
+
+	return ret;
+}
+
 /*!
  * Start a hook
  *
  * \param hook \ref oci_cfg_hook.
  * \param state container state.
  * \param state_length length of container state.
+ * \param capture_output If \c true, log the hook's stdout and stderr
+ *   rather than letting it inherit those of the runtime.
  *
  * \return \c true on success, else \c false.
  * */
 private gboolean
 cc_run_hook(struct oci_cfg_hook* hook, const gchar* state,
-             gsize state_length)
+             gsize state_length, gboolean capture_output)
 {
 	int stdin_pipe[2]        = { -1, -1 };
 	int pipe_child_error[2]  = { -1, -1 };
 	int pipe_parent_error[2] = { -1, -1 };
+	int output_pipe[2]       = { -1, -1 };
 	pid_t pid = 0;
 	int pipe_sz = 0;
 	bool ret = false;
@@ -310,6 +479,11 @@ cc_run_hook(struct oci_cfg_hook* hook, const gchar* state,
 		goto fail3;
 	}
 
+	if (capture_output && pipe2 (output_pipe, O_CLOEXEC) < 0) {
+		g_critical ("failed to create output pipe: %s", strerror(errno));
+		goto fail4;
+	}
+
 	pid = fork ();
 	if (pid < 0) {
 		g_critical ("failed to fork parent: %s", strerror(errno));
@@ -319,6 +493,7 @@ cc_run_hook(struct oci_cfg_hook* hook, const gchar* state,
 		close_if_set (stdin_pipe[1]);
 		close_if_set (pipe_child_error[0]);
 		close_if_set (pipe_parent_error[1]);
+		close_if_set (output_pipe[0]);
 
 		/* waiting for parent setup */
 		if (read (pipe_parent_error[0], &c, sizeof(c)) > 0) {
@@ -333,12 +508,22 @@ cc_run_hook(struct oci_cfg_hook* hook, const gchar* state,
 			goto fail_child;
 		}
 
+		if (output_pipe[1] != -1 &&
+				(dup2 (output_pipe[1], STDOUT_FILENO) < 0 ||
+				 dup2 (output_pipe[1], STDERR_FILENO) < 0)) {
+			saved_errno = errno;
+			g_critical ("failed to dup hook output");
+			goto fail_child;
+		}
+
 		args = hook->args;
 		if (! (hook->args && *hook->args)) {
 			args = g_new0(gchar *, 2);
 			args[0] = hook->path;
 		}
 
+		cc_oci_log_flush ();
+
 		if (execvpe (hook->path, args, hook->env) < 0) {
 			saved_errno = errno;
 			g_critical ("failed to exec hook %s: %s",
@@ -353,6 +538,7 @@ fail_child:
 		close_if_set (stdin_pipe[0]);
 		close_if_set (pipe_child_error[1]);
 		close_if_set (pipe_parent_error[0]);
+		close_if_set (output_pipe[1]);
 		exit(saved_errno);
 	}
 
@@ -360,6 +546,7 @@ fail_child:
 	close_if_set (stdin_pipe[0]);
 	close_if_set (pipe_child_error[1]);
 	close_if_set (pipe_parent_error[0]);
+	close_if_set (output_pipe[1]);
 
 	/* if needed resize pipe size */
 	pipe_sz = fcntl (stdin_pipe[1], F_GETPIPE_SZ);
@@ -370,6 +557,14 @@ fail_child:
 		}
 	}
 
+	/* the hook output is read while waiting for it to exit */
+	if (output_pipe[0] != -1 &&
+			fcntl (output_pipe[0], F_SETFL, O_NONBLOCK) < 0) {
+		g_critical ("failed to make output pipe non-blocking: %s",
+				strerror(errno));
+		goto fail5;
+	}
+
 	/* send state to hook */
 	if (write (stdin_pipe[1], state, state_length) < 0) {
 		g_critical ("failed to send state to hook: %s", strerror(errno));
@@ -386,8 +581,7 @@ fail_child:
 		goto fail4;
 	}
 
-	if (waitpid (pid, &status, 0) != pid) {
-		g_critical ("waitpid failed: %s", strerror(errno));
+	if (! cc_run_hook_wait (hook, pid, output_pipe[0], &status)) {
 		goto fail4;
 	}
 
@@ -408,6 +602,8 @@ fail5:
 		}
 	}
 fail4:
+	close_if_set (output_pipe[0]);
+	close_if_set (output_pipe[1]);
 	close_if_set (pipe_parent_error[0]);
 	close_if_set (pipe_parent_error[1]);
 fail3:
@@ -489,6 +685,110 @@ out:
 	return connection;
 }
 
+/*!
+ * Build the command line of \ref CC_OCI_SHIM.
+ *
+ * \param config \ref cc_oci_config.
+ * \param proxy_socket_fd Proxy socket connection.
+ * \param proxy_io_fd Proxy IO fd.
+ * \param proxy_io_base First I/O stream sequence number of the workload.
+ * \param max_frame_size I/O frame size negotiated with the proxy
+ *   (or 0 if none was).
+ * \param initial_workload \c true if the shim is for the initial
+ *   workload of the container, \c false for an exec'd process.
+ *
+ * \return Newly-allocated \c NULL-terminated argument vector on
+ * success, else \c NULL.
+ */
+private gchar **
+cc_shim_args (struct cc_oci_config *config,
+		int proxy_socket_fd,
+		int proxy_io_fd,
+		int proxy_io_base,
+		guint32 max_frame_size,
+		gboolean initial_workload)
+{
+	gchar   **args = NULL;
+	struct cc_oci_shim_log_options log_options;
+	int       i = 0;
+
+	if (! config) {
+		return NULL;
+	}
+
+	/* +1 for for NULL terminator */
+	args = g_new0 (gchar *, SHIM_ARG_COUNT+1);
+
+	/* cc-shim path can be specified via command line */
+	if (start_data.shim_path) {
+		args[i++] = g_strdup (start_data.shim_path);
+	} else {
+		args[i++] = g_strdup (CC_OCI_SHIM);
+	}
+	args[i++] = g_strdup ("-c");
+	args[i++] = g_strdup (config->optarg_container_id);
+	args[i++] = g_strdup ("-p");
+	args[i++] = g_strdup_printf ("%d", proxy_socket_fd);
+	args[i++] = g_strdup ("-o");
+	args[i++] = g_strdup_printf ("%d", proxy_io_fd);
+	args[i++] = g_strdup ("-s");
+	args[i++] = g_strdup_printf ("%d", proxy_io_base);
+	if ( ! config->oci.process.terminal) {
+		args[i++] = g_strdup ("-e");
+		args[i++] = g_strdup_printf ("%d", proxy_io_base + 1);
+	}
+	if (max_frame_size) {
+		args[i++] = g_strdup ("-m");
+		args[i++] = g_strdup_printf ("%u", max_frame_size);
+	}
+	if (initial_workload) {
+		/* cc-shim will destroy the VM when initial workload ends */
+		args[i++] = g_strdup ("-w");
+	}
+
+	/* Let cc-shim write the workload output to disk if asked
+	 * to by the container annotations.
+	 */
+	if (initial_workload &&
+			cc_oci_annotations_get_shim_log_options (
+				config->oci.annotations, &log_options)) {
+		args[i++] = g_strdup ("--log-file");
+		args[i++] = g_strdup (log_options.path);
+		if (log_options.format) {
+			args[i++] = g_strdup ("--log-format");
+			args[i++] = g_strdup (log_options.format);
+		}
+		if (log_options.max_size) {
+			args[i++] = g_strdup ("--log-max-size");
+			args[i++] = g_strdup (log_options.max_size);
+		}
+		if (log_options.max_files) {
+			args[i++] = g_strdup ("--log-max-files");
+			args[i++] = g_strdup (log_options.max_files);
+		}
+		if (log_options.max_buffer) {
+			args[i++] = g_strdup ("--log-max-buffer");
+			args[i++] = g_strdup (log_options.max_buffer);
+		}
+	}
+
+	/* Pass debug flag to shim if the runtime is invoked
+	 * with debug flag
+	 */
+	if (start_data.debug) {
+		args[i++] = g_strdup("-d");
+	}
+
+	if (i > SHIM_ARG_COUNT) {
+		g_critical("args index exceeds SHIM_ARG_COUNT: %d > %d",
+			i, SHIM_ARG_COUNT);
+		g_strfreev (args);
+		return NULL;
+	}
+
+	return args;
+}
+
 /*!
  * Start \ref CC_OCI_SHIM as a child process.
  *
@@ -568,9 +868,9 @@ cc_shim_launch (struct cc_oci_config *config,
 		int       proxy_socket_fd = -1;
 		int       proxy_io_fd = -1;
 		int       proxy_io_base = -1;
+		guint32   max_frame_size = 0;
 		GSocketConnection *connection = NULL;
 		GError   *error = NULL;
-		int       i = 0;
 
 		/* child */
 		close (child_err_pipe[0]);
@@ -599,6 +899,16 @@ cc_shim_launch (struct cc_oci_config *config,
 			goto child_failed;
 		}
 
+		/* block reading the I/O frame size negotiated with the proxy */
+		bytes = read (shim_args_pipe[0],
+				&max_frame_size,
+				sizeof (max_frame_size));
+
+		if (bytes <= 0) {
+			g_critical ("failed to read proxy I/O frame size");
+			goto child_failed;
+		}
+
 		/* read proxy IO fd from socket out-of-band */
 		connection = cc_oci_socket_connection_from_fd(shim_socket[0]);
 		if (!connection) {
@@ -663,42 +973,10 @@ cc_shim_launch (struct cc_oci_config *config,
 			goto child_failed;
 		}
 
-		/* +1 for for NULL terminator */
-		args = g_new0 (gchar *, SHIM_ARG_COUNT+1);
-
-		/* cc-shim path can be specified via command line */
-		if (start_data.shim_path) {
-			args[i++] = g_strdup (start_data.shim_path);
-		} else {
-			args[i++] = g_strdup (CC_OCI_SHIM);
-		}
-		args[i++] = g_strdup ("-c");
-		args[i++] = g_strdup (config->optarg_container_id);
-		args[i++] = g_strdup ("-p");
-		args[i++] = g_strdup_printf ("%d", proxy_socket_fd);
-		args[i++] = g_strdup ("-o");
-		args[i++] = g_strdup_printf ("%d", proxy_io_fd);
-		args[i++] = g_strdup ("-s");
-		args[i++] = g_strdup_printf ("%d", proxy_io_base);
-		if ( ! config->oci.process.terminal) {
-			args[i++] = g_strdup ("-e");
-			args[i++] = g_strdup_printf ("%d", proxy_io_base + 1);
-		}
-		if (initial_workload) {
-			/* cc-shim will destroy the VM when initial workload ends */
-			args[i++] = g_strdup ("-w");
-		}
-
-		/* Pass debug flag to shim if the runtime is invoked
-		 * with debug flag
-		 */
-		if (start_data.debug) {
-			args[i++] = g_strdup("-d");
-		}
-
-		if (i > SHIM_ARG_COUNT) {
-			g_critical("args index exceeds SHIM_ARG_COUNT: %d > %d",
-				i, SHIM_ARG_COUNT);
+		args = cc_shim_args (config, proxy_socket_fd, proxy_io_fd,
+				proxy_io_base, max_frame_size,
+				initial_workload);
+		if (! args) {
 			goto child_failed;
 		}
 
@@ -724,6 +1002,8 @@ cc_shim_launch (struct cc_oci_config *config,
 			}
 		}
 
+		cc_oci_log_flush ();
+
 		if (execvp (args[0], args) < 0) {
 			g_critical ("failed to exec child %s: %s",
 					args[0],
@@ -935,6 +1215,8 @@ cc_oci_vm_launch (struct cc_oci_config *config)
 			goto child_failed;
 		}
 
+		cc_oci_log_flush ();
+
 		if (execvp (args[0], args) < 0) {
 			g_critical ("failed to exec child %s: %s",
 					args[0],
@@ -1084,6 +1366,18 @@ child_failed:
 
 	g_debug ("child setup successful");
 
+	if (config->restore_path) {
+		/* The agent (and the container) are already running in
+		 * the VM being restored, once it has loaded its state.
+		 */
+		if (! cc_oci_vm_incoming_wait (config->state.comms_path,
+					pid)) {
+			g_critical ("failed to restore VM from %s",
+					config->restore_path);
+			goto out;
+		}
+	}
+
 	/* Wait for the proxy to signal readiness.
 	 *
 	 * This can only happen once the agent details have been added
@@ -1097,7 +1391,7 @@ child_failed:
 	/* At this point ctl and tty sockets already exist,
 	 * is time to communicate with the proxy
 	 */
-	if (! cc_proxy_hyper_pod_create (config)) {
+	if (! config->restore_path && ! cc_proxy_hyper_pod_create (config)) {
 		goto out;
 	}
 
@@ -1119,6 +1413,14 @@ child_failed:
 		goto out;
 	}
 
+	if (config->restore_path &&
+			ioBase != config->proxy->restore_io_base) {
+		g_critical ("proxy allocated I/O stream %d, "
+				"but the restored workload uses %d",
+				ioBase, config->proxy->restore_io_base);
+		goto out;
+	}
+
 	bytes = write (shim_args_fd, &ioBase, sizeof (ioBase));
 	if (bytes < 0) {
 		g_critical ("failed to send proxy ioBase to shim child: %s",
@@ -1126,6 +1428,14 @@ child_failed:
 		goto out;
 	}
 
+	bytes = write (shim_args_fd, &config->proxy->max_frame_size,
+			sizeof (config->proxy->max_frame_size));
+	if (bytes < 0) {
+		g_critical ("failed to send proxy I/O frame size to shim child: %s",
+			strerror (errno));
+		goto out;
+	}
+
 	/* send proxy IO fd to cc-shim child */
 	shim_socket_connection = cc_oci_socket_connection_from_fd(shim_socket_fd);
 	if (! shim_socket_connection) {
@@ -1281,6 +1591,55 @@ out:
 	return ret;
 }
 
+/*!
+ * Run a list of hooks in order, logging how long each one takes.
+ *
+ * \param hooks \c GSList of \ref oci_cfg_hook.
+ * \param state container state.
+ * \param state_length length of container state.
+ * \param stop_on_failure Stop on error if \c true.
+ * \param capture_output If \c true, log the output of the hooks.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_run_hook_list (GSList *hooks, const gchar *state, gsize state_length,
+		gboolean stop_on_failure, gboolean capture_output)
+{
+	GSList               *l;
+	struct oci_cfg_hook  *hook;
+	gint64                start;
+	gboolean              ok;
+	gboolean              ret = true;
+
+	for (l = hooks; l; l = g_slist_next (l)) {
+		hook = (struct oci_cfg_hook *)l->data;
+
+		start = g_get_monotonic_time ();
+
+		ok = cc_run_hook (hook, state, state_length, capture_output);
+
+		/* Logged at info level so that slow hooks (such as
+		 * network plugins) show up in the container log without
+		 * enabling debug.
+		 */
+		if (hook) {
+			g_info ("hook %s %s in %" G_GINT64_FORMAT "us",
+					hook->path, ok ? "ran" : "failed",
+					g_get_monotonic_time () - start);
+		}
+
+		if (! ok) {
+			ret = false;
+			if (stop_on_failure) {
+				break;
+			}
+		}
+	}
+
+	return ret;
+}
+
 /*!
  * Run hooks.
  *
@@ -1293,8 +1652,6 @@ out:
 gboolean
 cc_run_hooks(GSList* hooks, const gchar* state_file_path,
               gboolean stop_on_failure) {
-	GSList* i = NULL;
-	struct oci_cfg_hook* hook = NULL;
 	gchar* container_state = NULL;
 	gsize length = 0;
 	GError* error = NULL;
@@ -1317,11 +1674,10 @@ cc_run_hooks(GSList* hooks, const gchar* state_file_path,
 		goto exit;
 	}
 
-	for (i=g_slist_nth(hooks, 0); i; i=g_slist_next(i) ) {
-		hook = (struct oci_cfg_hook*)i->data;
-		if ((!cc_run_hook(hook, container_state, length)) && stop_on_failure) {
-			goto exit;
-		}
+	if (! cc_run_hook_list (hooks, container_state, length,
+				stop_on_failure, false)
+			&& stop_on_failure) {
+		goto exit;
 	}
 
 	result = true;
@@ -1333,118 +1689,277 @@ exit:
 }
 
 /*!
- * Start a process that launch \ref CC_OCI_SHIM as a child process
- * then send all needed data to launch a shim.
+ * Run hooks in the background.
  *
- * \param config \ref cc_oci_config.
- * \param process \ref oci_cfg_process
- * \param initial_workload \ref true if shim to be be launched is an initial
- * 	workload,  false to launch an exec shim
+ * The hooks are run in order by a detached process, so the caller
+ * does not wait for them to finish and failures cannot be reported
+ * to it. Their stdout and stderr, along with any errors, are written
+ * to the container log.
  *
- * \return \c true on success, else \c false.
+ * The state is read before returning, so the hooks still receive it
+ * if the state file is removed while they run.
+ *
+ * \param hooks \c GSList.
+ * \param state_file_path Full path to state file.
+ *
+ * \return \c true if the hooks were started, else \c false.
  */
 gboolean
-cc_oci_exec_shim (struct cc_oci_config *config, int ioBase, int proxy_io_fd,
-		gboolean initial_workload) {
+cc_run_hooks_detached (GSList *hooks, const gchar *state_file_path)
+{
+	gchar    *container_state = NULL;
+	gsize     length = 0;
+	GError   *error = NULL;
+	gboolean  ret = false;
+	pid_t     pid;
+	int       status = 0;
+	int       fd;
 
-	gboolean           ret = false;
-	GSocketConnection *shim_socket_connection = NULL;
-	int                shim_args_fd = -1;
-	int                shim_socket_fd = -1;
-	int                shim_err_fd = -1;
-	ssize_t            bytes;
-	char               err_buffer[2] = { '\0' };
-	int                proxy_fd = -1;
-	GError            *error = NULL;
+	if (! hooks) {
+		return true;
+	}
 
-	if(! config){
-		return false;
+	if (! g_file_get_contents (state_file_path, &container_state,
+				&length, &error)) {
+		g_critical ("failed to read state file: %s",
+				error->message);
+		g_error_free (error);
+		goto out;
 	}
 
-	/* FIXME: Close proxy_fd before launch shim to avoid race conditions */
+	pid = fork ();
+	if (pid < 0) {
+		g_critical ("failed to fork hook runner: %s",
+				strerror (errno));
+		goto out;
+	} else if (! pid) {
+		/* Fork again so the hook runner is reparented rather
+		 * than becoming a zombie of the runtime, and is not
+		 * affected by signals sent to its session.
+		 */
+		if (setsid () < 0) {
+			_exit (EXIT_FAILURE);
+		}
 
-	if (! cc_shim_launch (config, &shim_err_fd, &shim_args_fd,
-				&shim_socket_fd, initial_workload)) {
+		pid = fork ();
+		if (pid) {
+			_exit (pid < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+
+		/* Callers such as containerd wait for the runtime's
+		 * standard streams to be closed, so the hook runner must
+		 * not keep them open.
+		 */
+		fd = open ("/dev/null", O_RDWR);
+		if (fd < 0) {
+			g_critical ("failed to open /dev/null: %s",
+					strerror (errno));
+			cc_oci_log_flush ();
+			_exit (EXIT_FAILURE);
+		}
+
+		(void)dup2 (fd, STDIN_FILENO);
+		(void)dup2 (fd, STDOUT_FILENO);
+		(void)dup2 (fd, STDERR_FILENO);
+		if (fd > STDERR_FILENO) {
+			close (fd);
+		}
+
+		(void)cc_run_hook_list (hooks, container_state, length,
+				false, true);
+
+		cc_oci_log_flush ();
+		_exit (EXIT_SUCCESS);
+	}
+
+	/* reap the intermediate child */
+	if (waitpid (pid, &status, 0) != pid) {
+		g_critical ("waitpid failed: %s", strerror (errno));
 		goto out;
 	}
 
-	/*
-	 * 1. The child blocks waiting for a write proxy fd to shim_args_fd.
-	*/
-	proxy_fd = g_socket_get_fd (config->proxy->socket);
-	if (proxy_fd < 0) {
-		g_critical ("invalid proxy fd: %d", proxy_fd);
+	if (! (WIFEXITED (status) && WEXITSTATUS (status) == 0)) {
+		g_critical ("failed to start hook runner");
 		goto out;
 	}
 
-	bytes = write (shim_args_fd, &proxy_fd, sizeof (proxy_fd));
-	if (bytes < 0) {
-		g_critical ("failed to send proxy fd to shim child: %s",
-			strerror (errno));
+	ret = true;
+
+out:
+	g_free_if_set (container_state);
+
+	return ret;
+}
+
+/*!
+ * Start \ref CC_OCI_SHIM as a child process for a workload exec'd in
+ * a running container.
+ *
+ * Unlike \ref cc_shim_launch(), which has to start the shim of the
+ * initial workload before the proxy connection it needs exists, everything
+ * the shim needs is known at this point: its command line is built before
+ * forking and the child only has to set itself up and exec it.
+ *
+ * \param config \ref cc_oci_config.
+ * \param ioBase First I/O stream sequence number of the workload.
+ * \param proxy_io_fd Proxy IO fd.
+ *
+ * \return \c true on success, else \c false.
+ */
+private gboolean
+cc_oci_exec_shim (struct cc_oci_config *config, int ioBase, int proxy_io_fd)
+{
+	gboolean   ret = false;
+	GPid       pid = -1;
+	gchar    **args = NULL;
+	gchar     *shim_flock_path = NULL;
+	int        child_err_pipe[2] = {-1, -1};
+	int        proxy_fd = -1;
+	int        io_fd = -1;
+	int        shim_flock_fd = -1;
+	int        fd;
+	ssize_t    bytes;
+	char       err_buffer[2] = { '\0' };
+
+	if (! (config && config->proxy && config->proxy->socket)) {
+		return false;
+	}
+
+	if (proxy_io_fd < 0) {
+		return false;
+	}
+
+	/* The child replaces fds 0, 1 and 2 with the console, so the fds
+	 * passed to the shim must be above those before its command line
+	 * is built. The copies are close-on-exec until the child clears
+	 * the flag.
+	 */
+	proxy_fd = fcntl (g_socket_get_fd (config->proxy->socket),
+			F_DUPFD_CLOEXEC, 3);
+	if (proxy_fd < 0) {
+		g_critical ("failed to dup proxy fd: %s", strerror (errno));
 		goto out;
 	}
 
-	/*
-	 * 2. The child blocks waiting for a write ioBase to shim_args_fd.
-	*/
+	io_fd = fcntl (proxy_io_fd, F_DUPFD_CLOEXEC, 3);
+	if (io_fd < 0) {
+		g_critical ("failed to dup proxy IO fd: %s", strerror (errno));
+		goto out;
+	}
 
-	bytes = write (shim_args_fd, &ioBase, sizeof (ioBase));
-	if (bytes < 0) {
-		g_critical ("failed to send proxy ioBase to shim child: %s",
+	shim_flock_path = g_strdup_printf ("%s/%s", config->state.runtime_path,
+		CC_OCI_SHIM_LOCK_FILE);
+	fd = open (shim_flock_path, O_RDONLY|O_CREAT|O_CLOEXEC, S_IRUSR);
+	g_free (shim_flock_path);
+	if (fd < 0) {
+		g_critical ("failed to create shim flock file: %s",
 			strerror (errno));
 		goto out;
 	}
 
+	shim_flock_fd = fcntl (fd, F_DUPFD_CLOEXEC, 3);
+	close (fd);
+	if (shim_flock_fd < 0) {
+		g_critical ("failed to dup shim flock fd: %s",
+			strerror (errno));
+		goto out;
+	}
 
-	/*
-	 * 3. The child blocks waiting for a write proxy IO fd to shim_socket_fd.
-	*/
-	proxy_fd = g_socket_get_fd (config->proxy->socket);
-	if (proxy_fd < 0) {
-		g_critical ("invalid proxy fd: %d", proxy_fd);
+	args = cc_shim_args (config, proxy_fd, io_fd, ioBase,
+			config->proxy->max_frame_size, false);
+	if (! args) {
 		goto out;
 	}
 
-	/* send proxy IO fd to cc-shim child */
-	shim_socket_connection = cc_oci_socket_connection_from_fd(shim_socket_fd);
-	if (! shim_socket_connection) {
-		g_critical("failed to create a socket connection to send proxy IO fd");
+	g_debug ("running command:");
+	for (gchar** p = args; p && *p; p++) {
+		g_debug ("arg: '%s'", *p);
+	}
+
+	if (pipe2 (child_err_pipe, O_CLOEXEC) < 0) {
+		g_critical ("failed to create shim err pipe: %s",
+				strerror (errno));
 		goto out;
 	}
 
-	if (! g_unix_connection_send_fd (
-				G_UNIX_CONNECTION (shim_socket_connection),
-				proxy_io_fd, NULL, &error) ) {
+	cc_oci_log_flush ();
 
-		g_critical("failed to send proxy IO fd");
+	/* Inform caller of workload PID */
+	config->state.workload_pid = pid = fork ();
+
+	if (pid < 0) {
+		g_critical ("failed to spawn shim child: %s",
+				strerror (errno));
 		goto out;
+	} else if (! pid) {
+		/* child */
+		close (child_err_pipe[0]);
+
+		cc_oci_fd_toggle_cloexec (proxy_fd, false);
+		cc_oci_fd_toggle_cloexec (io_fd, false);
+		cc_oci_fd_toggle_cloexec (shim_flock_fd, false);
+
+		if (! cc_oci_setup_shim (config, proxy_fd, io_fd,
+					shim_flock_fd)) {
+			goto child_failed;
+		}
+
+		if (execvp (args[0], args) < 0) {
+			g_critical ("failed to exec child %s: %s",
+					args[0],
+					strerror (errno));
+		}
+
+child_failed:
+		/* Any data written by the child to this pipe signifies
+		 * failure, so send a very short message ("E", denoting
+		 * Error).
+		 */
+		(void)write (child_err_pipe[1], "E", 1);
+		exit (EXIT_FAILURE);
 	}
-	/*
-	 * Finally. Check if an error happend
-	*/
-	bytes = read (shim_err_fd,
-			err_buffer,
-			sizeof (err_buffer));
+
+	/* parent */
+
+	g_debug ("shim process running with pid %d", (int)pid);
+
+	close (child_err_pipe[1]);
+	child_err_pipe[1] = -1;
+
+	/* The child closes its end of the pipe once it's set up (see
+	 * cc_oci_setup_shim()), so data can only be read on failure.
+	 */
+	bytes = read (child_err_pipe[0], err_buffer, sizeof (err_buffer));
 	if (bytes > 0) {
 		g_critical ("shim setup failed");
 		goto out;
 	}
 
 	ret = true;
+
 out:
-	if (shim_err_fd != -1) {
-		close (shim_err_fd);
+	if (child_err_pipe[0] != -1) {
+		close (child_err_pipe[0]);
 	}
-	if (shim_args_fd != -1) {
-		close (shim_args_fd);
+	if (child_err_pipe[1] != -1) {
+		close (child_err_pipe[1]);
 	}
-	if (shim_socket_fd != -1) {
-		close (shim_socket_fd);
+	if (proxy_fd != -1) {
+		close (proxy_fd);
 	}
-	if (! ret) {
-		g_critical ("killing shim with pid:%d", config->state.workload_pid);
-		kill (config->state.workload_pid, SIGTERM);
+	if (io_fd != -1) {
+		close (io_fd);
+	}
+	if (shim_flock_fd != -1) {
+		close (shim_flock_fd);
 	}
+	g_strfreev (args);
+
+	if (! ret && pid > 0) {
+		g_critical ("killing shim with pid:%d", (int)pid);
+		kill (pid, SIGTERM);
+	}
+
 	return ret;
 }
 
@@ -1481,7 +1996,6 @@ cc_oci_vm_connect (struct cc_oci_config *config)
 	int         ioBase = -1;
 	int         proxy_io_fd = -1;
 	gint        exit_code = -1;
-	const gchar *container_id;
 
 	if(! config){
 		goto out;
@@ -1491,37 +2005,15 @@ cc_oci_vm_connect (struct cc_oci_config *config)
 		goto out;
 	}
 
-	container_id = cc_pod_container_id(config);
-	if (! container_id) {
-		goto out;
-	}
-
-	if (! cc_proxy_attach (config->proxy, container_id)) {
-		goto out;
-	}
-
-	if (! cc_proxy_cmd_allocate_io(config->proxy,
-			&proxy_io_fd, &ioBase, config->oci.process.terminal)) {
-		goto out;
-	}
-
-	/* save ioBase */
-	config->oci.process.stdio_stream = ioBase;
-	if ( config->oci.process.terminal) {
-		/* For tty, pass stderr seq as 0, so that stdout and
-		 * and stderr are redirected to the terminal
-		 */
-		config->oci.process.stderr_stream = 0;
-	} else {
-		config->oci.process.stderr_stream = ioBase + 1;
-	}
-
+	/* Attach to the VM, allocate the I/O streams of the workload and
+	 * start it with a single proxy request.
+	 */
 	g_debug("exec command");
-	if (! cc_proxy_hyper_exec_command (config)) {
+	if (! cc_proxy_cmd_exec (config, &proxy_io_fd, &ioBase)) {
 		goto out;
 	}
 
-	if (! cc_oci_exec_shim (config, ioBase, proxy_io_fd, false)) {
+	if (! cc_oci_exec_shim (config, ioBase, proxy_io_fd)) {
 		goto out;
 	}
 
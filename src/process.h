@@ -25,6 +25,7 @@ gboolean cc_oci_vm_launch (struct cc_oci_config *config);
 
 gboolean cc_run_hooks(GSList* hooks, const gchar* state_file_path,
                        gboolean stop_on_failure);
+gboolean cc_run_hooks_detached (GSList *hooks, const gchar *state_file_path);
 
 gboolean cc_oci_vm_connect (struct cc_oci_config *config);
 
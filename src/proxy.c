@@ -673,6 +673,15 @@ cc_proxy_cmd_hello (struct cc_proxy *proxy, const char *container_id)
 	json_object_set_string_member (data, "console",
 			proxy->vm_console_socket);
 
+	if (proxy->restore_io_base > 0) {
+		/* The agent won't announce it is ready again and its
+		 * processes keep using their I/O sequence numbers.
+		 */
+		json_object_set_boolean_member (data, "restored", true);
+		json_object_set_int_member (data, "ioBase",
+				proxy->restore_io_base);
+	}
+
 	json_object_set_object_member (obj, "data", data);
 
 	root = json_node_new (JSON_NODE_OBJECT);
@@ -867,9 +876,90 @@ out:
 	return ret;
 }
 
+/**
+ * Parse the reply of a proxy command allocating I/O streams.
+ *
+ * The I/O frame size negotiated with the proxy is saved in
+ * \ref cc_proxy \c max_frame_size.
+ *
+ * \param proxy \ref cc_proxy.
+ * \param response Raw proxy response message.
+ * \param[out] ioBase First I/O stream sequence number allocated.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_proxy_parse_io_result (struct cc_proxy *proxy,
+		const GString *response,
+		int *ioBase)
+{
+	JsonParser        *parser = NULL;
+	JsonReader        *reader = NULL;
+	GError            *error = NULL;
+	gboolean           ret = false;
+
+	parser = json_parser_new();
+	ret = json_parser_load_from_data(parser,
+		response->str,
+		(gssize) response->len,
+		&error);
+
+	if (! ret) {
+		g_critical ("failed to parse proxy response: %s",
+				error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	reader = json_reader_new(json_parser_get_root(parser));
+	if (!reader) {
+		g_critical("failed to create reader");
+		ret = false;
+		goto out;
+	}
+
+	ret = json_reader_read_member (reader, "data");
+	if (! ret) {
+		g_critical ("failed to find proxy data");
+		goto out;
+	}
+
+	ret = json_reader_read_member (reader, "ioBase");
+	if (! ret) {
+		g_critical ("failed to find ioBase");
+		goto out;
+	}
+
+	*ioBase = (int) json_reader_get_int_value(reader);
+
+	json_reader_end_member (reader);
+
+	/* older proxies don't advertise the frame size */
+	proxy->max_frame_size = 0;
+	if (json_reader_read_member (reader, "maxFrameSize")) {
+		proxy->max_frame_size =
+			(guint32) json_reader_get_int_value(reader);
+	}
+
+	json_reader_end_member (reader);
+
+	ret = true;
+
+out:
+	if (reader) {
+		g_object_unref (reader);
+	}
+	g_object_unref (parser);
+
+	return ret;
+}
+
 /**
  * Ask the proxy to allocate I/O stream "sequence numbers".
  *
+ * The I/O frame size negotiated with the proxy is saved in
+ * \ref cc_proxy \c max_frame_size.
+ *
  * \param proxy \ref cc_proxy.
  *
  * \return \c true on success, else \c false.
@@ -887,9 +977,6 @@ cc_proxy_cmd_allocate_io (struct cc_proxy *proxy,
 	gchar             *msg_to_send = NULL;
 	GString           *msg_received = NULL;
 	gboolean           ret = false;
-	JsonParser        *parser = NULL;
-	GError            *error = NULL;
-	JsonReader        *reader = NULL;
 
 	const gchar       *proxy_cmd = "allocateIO";
 	int n_streams = IO_STREAMS_NUMBER;
@@ -913,6 +1000,9 @@ cc_proxy_cmd_allocate_io (struct cc_proxy *proxy,
 			n_streams);
 	}
 
+	json_object_set_int_member (data, "maxFrameSize",
+		CC_PROXY_MAX_FRAME_SIZE);
+
 	json_object_set_object_member (obj, "data", data);
 
 	root = json_node_new (JSON_NODE_OBJECT);
@@ -944,51 +1034,9 @@ cc_proxy_cmd_allocate_io (struct cc_proxy *proxy,
 		goto out;
 	}
 
-	/* parse message received to get ioBase */
-	parser = json_parser_new();
-	ret = json_parser_load_from_data(parser,
-		msg_received->str,
-		(gssize) msg_received->len,
-		&error);
-
-	if (! ret) {
-		g_critical ("failed to parse proxy response: %s",
-				error->message);
-		g_error_free (error);
-		goto out;
-	}
-
-	reader = json_reader_new(json_parser_get_root(parser));
-	if (!reader) {
-		g_critical("failed to create reader");
-		goto out;
-	}
-
-	ret = json_reader_read_member (reader, "data");
-	if (! ret) {
-		g_critical ("failed to find proxy data");
-		goto out;
-	}
-
-	ret = json_reader_read_member (reader, "ioBase");
-	if (! ret) {
-		g_critical ("failed to find ioBase");
-		goto out;
-	}
-
-	*ioBase = (int) json_reader_get_int_value(reader);
-
-	json_reader_end_member (reader);
-
-	ret = true;
+	ret = cc_proxy_parse_io_result (proxy, msg_received, ioBase);
 
 out:
-	if (reader) {
-		g_object_unref (reader);
-	}
-	if (parser) {
-		g_object_unref (parser);
-	}
 	if (msg_received) {
 		g_string_free(msg_received, true);
 	}
@@ -1062,19 +1110,72 @@ out:
 }
 
 /**
- * Run a Hyper command via the \ref CC_OCI_PROXY.
+ * Extract the payload of the hyperstart reply returned by a successful
+ * "hyper" proxy command.
+ *
+ * The proxy returns it as the "data" member of the response data:
+ *
+ *     { "success": true, "data": { "data": "..." } }
+ *
+ * \param response Raw proxy response message.
+ *
+ * \return Newly-allocated string, or \c NULL if the response does not
+ * contain a reply payload (proxies older than protocol version 5 do not
+ * return it).
+ */
+private gchar *
+cc_proxy_response_data (const GString *response)
+{
+	JsonParser  *parser = NULL;
+	JsonReader  *reader = NULL;
+	gchar       *data = NULL;
+
+	parser = json_parser_new ();
+	reader = json_reader_new (NULL);
+
+	if (! json_parser_load_from_data (parser, response->str,
+				(gssize)response->len, NULL)) {
+		goto out;
+	}
+
+	json_reader_set_root (reader, json_parser_get_root (parser));
+
+	if (json_reader_read_member (reader, "data") &&
+			json_reader_is_object (reader) &&
+			json_reader_read_member (reader, "data") &&
+			json_reader_is_value (reader) &&
+			json_node_get_value_type (
+				json_reader_get_value (reader)) == G_TYPE_STRING) {
+		data = g_strdup (json_reader_get_string_value (reader));
+	}
+
+out:
+	g_object_unref (reader);
+	g_object_unref (parser);
+
+	return data;
+}
+
+/**
+ * Run a Hyper command via the \ref CC_OCI_PROXY, returning the data
+ * of the reply.
  *
  * \note Must already be connected to the proxy.
  *
  * \param config \ref cc_oci_config.
  * \param cmd Name of hyper command to run.
  * \param payload \c JsonObject to send as message data.
+ * \param[out] reply_data Newly-allocated data returned by the command
+ *   (or \c NULL if none), or \c NULL if not required.
+ * \param optional If \c true, failure of the command is expected
+ *   (for example, if the agent does not support it) so is not an error.
  *
  * \return \c true on success, else \c false.
  */
 static gboolean
-cc_proxy_run_hyper_cmd (struct cc_oci_config *config,
-		const char *cmd, JsonObject *payload)
+cc_proxy_run_hyper_cmd_reply (struct cc_oci_config *config,
+		const char *cmd, JsonObject *payload, gchar **reply_data,
+		gboolean optional)
 {
 	JsonObject        *obj = NULL;
 	JsonObject        *data = NULL;
@@ -1121,14 +1222,24 @@ cc_proxy_run_hyper_cmd (struct cc_oci_config *config,
 	}
 
 	if (! cc_proxy_run_cmd(config->proxy, msg_to_send, msg_received, NULL)) {
-		g_critical("failed to run hyper cmd %s: %s",
-				cmd,
-				msg_received->str);
+		if (optional) {
+			g_debug("hyper cmd %s failed: %s",
+					cmd,
+					msg_received->str);
+		} else {
+			g_critical("failed to run hyper cmd %s: %s",
+					cmd,
+					msg_received->str);
+		}
 		goto out;
 	}
 
 	g_debug("msg received: %s", msg_received->str);
 
+	if (reply_data) {
+		*reply_data = cc_proxy_response_data (msg_received);
+	}
+
 	ret = true;
 
 out:
@@ -1142,6 +1253,25 @@ out:
 	return ret;
 }
 
+/**
+ * Run a Hyper command via the \ref CC_OCI_PROXY.
+ *
+ * \note Must already be connected to the proxy.
+ *
+ * \param config \ref cc_oci_config.
+ * \param cmd Name of hyper command to run.
+ * \param payload \c JsonObject to send as message data.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_proxy_run_hyper_cmd (struct cc_oci_config *config,
+		const char *cmd, JsonObject *payload)
+{
+	return cc_proxy_run_hyper_cmd_reply (config, cmd, payload, NULL,
+			false);
+}
+
 /**
  * Request \ref CC_OCI_PROXY create a new POD (container group).
  *
@@ -1659,44 +1789,102 @@ out:
 }
 
 /**
- * Request \ref CC_OCI_PROXY to execute a workload in a container.
+ * Request \ref CC_OCI_PROXY to read files from the container's
+ * filesystem in the VM (using the hyperstart "readfile" command).
+ *
+ * All files are read over a single proxy connection. A file that
+ * cannot be read is not fatal: its entry in \p contents is left
+ * \c NULL.
  *
  * \param config \ref cc_oci_config.
- * \param process \ref oci_cfg_process.
+ * \param files \c NULL-terminated array of absolute paths within the
+ *   container.
+ * \param[out] contents Array (of the same length as \p files) that will
+ *   contain the newly-allocated content of each file.
  *
- * \return \c true on success, else \c false.
+ * \return \c true if the proxy could be used, else \c false.
  */
 gboolean
-cc_proxy_hyper_exec_command (struct cc_oci_config *config)
+cc_proxy_hyper_read_files (struct cc_oci_config *config,
+		const gchar **files, gchar **contents)
 {
-	JsonObject *payload= NULL;
-	JsonObject *process_node = NULL;
-	JsonArray *args= NULL;
-	JsonArray *envs= NULL;
-	gboolean ret = false;
-	struct oci_cfg_process *process = &config->oci.process;
+	const gchar *container_id;
 
-	if (! (config && config->proxy)) {
-		goto out;
+	if (! (config && config->proxy && files && contents)) {
+		return false;
 	}
 
-	if (process->stdio_stream < 0  ||
-			process->stderr_stream < 0 ) {
-		g_critical("invalid io stream number");
-		goto out;
+	container_id = cc_pod_container_id(config);
+	if (! container_id) {
+		return false;
+	}
+
+	if (! cc_proxy_connect (config->proxy)) {
+		return false;
+	}
+
+	if (! cc_proxy_attach (config->proxy, container_id)) {
+		cc_proxy_disconnect (config->proxy);
+		return false;
+	}
+
+	for (guint i = 0; files[i]; i++) {
+		JsonObject *payload = json_object_new ();
+
+		json_object_set_string_member (payload, "container",
+			config->optarg_container_id);
+		json_object_set_string_member (payload, "file", files[i]);
+
+		/* the payload is owned by the request */
+		(void)cc_proxy_run_hyper_cmd_reply (config, "readfile",
+				payload, &contents[i], true);
+	}
+
+	cc_proxy_disconnect (config->proxy);
+
+	return true;
+}
+
+/**
+ * Build the payload of an "execcmd" hyper command for the process
+ * of \p config.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated \c JsonObject on success, else \c NULL.
+ */
+private JsonObject *
+cc_proxy_exec_payload (struct cc_oci_config *config)
+{
+	JsonObject *payload = NULL;
+	JsonObject *process_node = NULL;
+	JsonArray *args = NULL;
+	JsonArray *envs = NULL;
+	struct oci_cfg_process *process;
+
+	if (! config) {
+		return NULL;
 	}
 
+	process = &config->oci.process;
+
 	payload = json_object_new ();
 	process_node  = json_object_new ();
 	args     = json_array_new ();
 	envs     = json_array_new ();
 
+	/* the payload owns the members added to it */
+	json_object_set_object_member (payload,
+			"process", process_node);
+	json_object_set_array_member (process_node, "args", args);
+	json_object_set_array_member (process_node, "envs", envs);
+
 	json_object_set_string_member (payload, "container",
 			config->optarg_container_id);
 
 	/* execcmd.process */
 	json_object_set_boolean_member(process_node, "terminal",
-			config->oci.process.terminal);
+			process->terminal);
 
 	json_object_set_int_member (process_node, "stdio",
 			process->stdio_stream);
@@ -1709,16 +1897,18 @@ cc_proxy_hyper_exec_command (struct cc_oci_config *config)
 
 	set_env_home(config);
 	for (gchar** p = process->env; p && *p; p++) {
-		JsonObject *env_var = json_object_new ();
+		JsonObject *env_var;
 		g_autofree char *var = g_strdup(*p);
 
 		char *e = g_strstr_len (var, -1, "=");
 		if (! e ){
 			g_critical("failed to split enviroment variable value");
-			goto out;
+			json_object_unref (payload);
+			return NULL;
 		}
 		*e = '\0';
 		e++;
+		env_var = json_object_new ();
 		json_object_set_string_member (env_var, "value", e);
 		json_object_set_string_member (env_var, "env", var);
 		json_array_add_object_element (envs, env_var);
@@ -1727,20 +1917,130 @@ cc_proxy_hyper_exec_command (struct cc_oci_config *config)
 	if (process->cwd[0]) {
 		json_object_set_string_member (process_node, "workdir", process->cwd);
 	}
-	json_object_set_array_member (process_node, "args", args);
-	json_object_set_array_member (process_node, "envs", envs);
-	json_object_set_object_member (payload,
-			"process", process_node);
 
-	if (! cc_proxy_run_hyper_cmd (config, "execcmd", payload)) {
-		g_critical("failed to run execcmd");
+	return payload;
+}
+
+/**
+ * Request \ref CC_OCI_PROXY to execute a workload in a container
+ * with a single "exec" command, which attaches to the VM, allocates
+ * the I/O streams of the workload and starts it.
+ *
+ * The I/O stream sequence numbers allocated are saved in the
+ * \ref oci_cfg_process of \p config and the I/O frame size negotiated
+ * with the proxy in \ref cc_proxy \c max_frame_size.
+ *
+ * \note Must already be connected to the proxy.
+ *
+ * \param config \ref cc_oci_config.
+ * \param[out] proxy_io_fd I/O file descriptor of the workload.
+ * \param[out] ioBase First I/O stream sequence number allocated.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_proxy_cmd_exec (struct cc_oci_config *config,
+		int *proxy_io_fd,
+		int *ioBase)
+{
+	JsonObject        *obj = NULL;
+	JsonObject        *data = NULL;
+	JsonObject        *payload = NULL;
+	JsonNode          *root = NULL;
+	JsonGenerator     *generator = NULL;
+	gchar             *msg_to_send = NULL;
+	GString           *msg_received = NULL;
+	gboolean           ret = false;
+	const gchar       *container_id;
+	struct oci_cfg_process *process;
+
+	const gchar       *proxy_cmd = "exec";
+
+	if (! (config && config->proxy && proxy_io_fd && ioBase)) {
+		return false;
+	}
+
+	container_id = cc_pod_container_id (config);
+	if (! container_id) {
+		return false;
+	}
+
+	process = &config->oci.process;
+
+	/* the proxy fills in the sequence numbers it allocates */
+	process->stdio_stream = 0;
+	process->stderr_stream = 0;
+
+	payload = cc_proxy_exec_payload (config);
+	if (! payload) {
+		return false;
+	}
+
+	obj = json_object_new ();
+	data = json_object_new ();
+
+	json_object_set_string_member (obj, "id", proxy_cmd);
+
+	json_object_set_string_member (data, "containerId",
+			container_id);
+
+	/* If run interactively, allocate just 1 stream since
+	 * stdout and stderr are both connected to the terminal
+	 */
+	json_object_set_int_member (data, "nStreams",
+			process->terminal ? 1 : IO_STREAMS_NUMBER);
+
+	json_object_set_int_member (data, "maxFrameSize",
+		CC_PROXY_MAX_FRAME_SIZE);
+
+	json_object_set_object_member (data, "execcmd", payload);
+
+	json_object_set_object_member (obj, "data", data);
+
+	root = json_node_new (JSON_NODE_OBJECT);
+	generator = json_generator_new ();
+	json_node_take_object (root, obj);
+
+	json_generator_set_root (generator, root);
+	g_object_set (generator, "pretty", FALSE, NULL);
+
+	msg_to_send = json_generator_to_data (generator, NULL);
+
+	msg_received = g_string_new("");
+
+	if (! msg_received ) {
 		goto out;
 	}
 
+	if (! cc_proxy_run_cmd(config->proxy, msg_to_send, msg_received,
+				proxy_io_fd)) {
+		g_critical("failed to run proxy command %s: %s",
+				proxy_cmd,
+				msg_received->str);
+		goto out;
+	}
+
+	g_debug("msg received: %s", msg_received->str);
+
+	if (! cc_proxy_parse_io_result (config->proxy, msg_received,
+				ioBase)) {
+		goto out;
+	}
+
+	process->stdio_stream = *ioBase;
+	if (! process->terminal) {
+		process->stderr_stream = *ioBase + 1;
+	}
+
 	ret = true;
+
 out:
-	if (payload) {
-		json_object_unref (payload);
+	if (msg_received) {
+		g_string_free(msg_received, true);
 	}
+	if (obj) {
+		json_object_unref (obj);
+	}
+
 	return ret;
 }
@@ -28,6 +28,13 @@
 /* allocate 2 streams, stdio and stderr */
 #define IO_STREAMS_NUMBER 2
 
+/*
+ * Maximum size of the I/O frames (header included) requested
+ * from the proxy. Bigger frames allow bulk output to be forwarded
+ * to the shim with fewer reads and writes.
+ */
+#define CC_PROXY_MAX_FRAME_SIZE (1024*1024)
+
 /*
  * 4 bytes for the message length.
  * 4 bytes for the message flags.
@@ -64,5 +71,8 @@ gboolean cc_proxy_hyper_new_pod_container(struct cc_oci_config *config,
 gboolean cc_proxy_hyper_new_container (struct cc_oci_config *config);
 void cc_proxy_free (struct cc_proxy *proxy);
 gboolean cc_proxy_attach (struct cc_proxy *proxy, const char *container_id);
-gboolean cc_proxy_hyper_exec_command (struct cc_oci_config *config);
+gboolean cc_proxy_cmd_exec (struct cc_oci_config *config, int *proxy_io_fd,
+		int *ioBase);
+gboolean cc_proxy_hyper_read_files (struct cc_oci_config *config,
+		const gchar **files, gchar **contents);
 #endif /* _CC_OCI_PROXY_H */
@@ -0,0 +1,414 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * List the processes running inside a container.
+ *
+ * The agent has no request to list processes, so rather than running
+ * ps(1) inside the container (which the container image may not even
+ * provide), the table is built from the guest's procfs using
+ * "readfile" requests: one for the container's cgroup process list,
+ * then one for the stat file of each process listed. No process is
+ * started in the VM, and each step uses a single proxy connection.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "oci.h"
+#include "util.h"
+#include "common.h"
+#include "proxy.h"
+#include "ps.h"
+
+/** File listing the processes in the container's cgroup in the VM. */
+#define CC_OCI_PS_GUEST_PROCS "/sys/fs/cgroup/pids/cgroup.procs"
+
+/*!
+ * Compare two process IDs.
+ *
+ * \param a First \c GPid.
+ * \param b Second \c GPid.
+ *
+ * \return Negative, zero or positive value, as for \c strcmp(3).
+ */
+static gint
+cc_oci_ps_compare_pids (const GPid *a, const GPid *b)
+{
+	return (*a > *b) - (*a < *b);
+}
+
+/*!
+ * Parse the contents of a cgroup.procs file.
+ *
+ * \param contents Contents of file.
+ *
+ * \return Sorted \c GArray of unique \c GPid values.
+ */
+private GArray *
+cc_oci_ps_parse_pids (const gchar *contents)
+{
+	GArray   *pids;
+	gchar   **lines;
+	guint     i;
+
+	pids = g_array_new (false, false, sizeof (GPid));
+
+	if (! contents) {
+		return pids;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	for (i = 0; lines[i]; i++) {
+		gchar   *end = NULL;
+		gint64   value;
+		GPid     pid;
+
+		g_strstrip (lines[i]);
+		if (! *lines[i]) {
+			continue;
+		}
+
+		value = g_ascii_strtoll (lines[i], &end, 10);
+		if (*end || value <= 0 || value > G_MAXINT) {
+			continue;
+		}
+
+		pid = (GPid)value;
+		g_array_append_val (pids, pid);
+	}
+
+	g_strfreev (lines);
+
+	/* cgroup.procs is neither guaranteed to be sorted nor free of
+	 * duplicates.
+	 */
+	g_array_sort (pids, (GCompareFunc)cc_oci_ps_compare_pids);
+
+	for (i = 1; i < pids->len; ) {
+		if (g_array_index (pids, GPid, i) ==
+				g_array_index (pids, GPid, i - 1)) {
+			g_array_remove_index (pids, i);
+		} else {
+			i++;
+		}
+	}
+
+	return pids;
+}
+
+/*!
+ * Parse the contents of a /proc/&lt;pid&gt;/stat file.
+ *
+ * \param contents Contents of file.
+ * \param[out] entry \ref cc_oci_ps_entry to fill in.
+ *
+ * \return \c true on success, else \c false.
+ */
+private gboolean
+cc_oci_ps_parse_stat (const gchar *contents, struct cc_oci_ps_entry *entry)
+{
+	/* fields after the command name (which may contain spaces
+	 * and parentheses), counting from "state" (field 3 in proc(5)).
+	 */
+	const guint   ppid_field = 4 - 3;
+	const guint   utime_field = 14 - 3;
+	const guint   stime_field = 15 - 3;
+	const guint   rss_field = 24 - 3;
+	const gchar  *start;
+	const gchar  *end;
+	gchar       **fields = NULL;
+	gchar        *p = NULL;
+	gboolean      ret = false;
+	guint64       ns_per_tick;
+	long          ticks;
+	long          page_size;
+	gint64        pid;
+	gsize         len;
+
+	if (! (contents && entry)) {
+		return false;
+	}
+
+	start = strchr (contents, '(');
+	end = strrchr (contents, ')');
+	if (! (start && end && end > start && end[1] == ' ')) {
+		return false;
+	}
+
+	ticks = sysconf (_SC_CLK_TCK);
+	page_size = sysconf (_SC_PAGESIZE);
+	if (ticks <= 0 || page_size <= 0) {
+		return false;
+	}
+
+	ns_per_tick = (guint64)(G_USEC_PER_SEC * 1000 / ticks);
+
+	pid = g_ascii_strtoll (contents, &p, 10);
+	if (p == contents || pid <= 0 || pid > G_MAXINT) {
+		return false;
+	}
+
+	fields = g_strsplit (end + 2, " ", -1);
+
+	if (g_strv_length (fields) <= rss_field) {
+		goto out;
+	}
+
+	memset (entry, 0, sizeof (*entry));
+
+	entry->pid = (GPid)pid;
+	entry->ppid = (GPid)g_ascii_strtoll (fields[ppid_field], NULL, 10);
+	entry->state = fields[0][0];
+
+	entry->time = (g_ascii_strtoull (fields[utime_field], NULL, 10) +
+			g_ascii_strtoull (fields[stime_field], NULL, 10)) *
+			ns_per_tick;
+
+	entry->rss = g_ascii_strtoull (fields[rss_field], NULL, 10) *
+		(guint64)page_size;
+
+	len = MIN ((gsize)(end - start - 1), (gsize)CC_OCI_PS_CMD_LEN);
+	memcpy (entry->cmd, start + 1, len);
+	entry->cmd[len] = '\0';
+
+	ret = true;
+
+out:
+	g_strfreev (fields);
+
+	return ret;
+}
+
+/*!
+ * Format a CPU time the way ps(1) does ("[DD-]HH:MM:SS").
+ *
+ * \param ns CPU time (ns).
+ *
+ * \return Newly-allocated string.
+ */
+private gchar *
+cc_oci_ps_format_time (guint64 ns)
+{
+	guint64 secs = ns / (G_USEC_PER_SEC * 1000);
+	guint64 days = secs / (24 * 60 * 60);
+
+	secs %= 24 * 60 * 60;
+
+	if (days) {
+		return g_strdup_printf ("%" G_GUINT64_FORMAT
+				"-%02u:%02u:%02u",
+				days,
+				(guint)(secs / 3600),
+				(guint)((secs / 60) % 60),
+				(guint)(secs % 60));
+	}
+
+	return g_strdup_printf ("%02u:%02u:%02u",
+			(guint)(secs / 3600),
+			(guint)((secs / 60) % 60),
+			(guint)(secs % 60));
+}
+
+/*!
+ * Request the process table of a container from the agent.
+ *
+ * Processes that exit between being listed and having their
+ * details read are silently omitted.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c GArray of \ref cc_oci_ps_entry sorted by PID
+ * on success, else \c NULL.
+ */
+GArray *
+cc_oci_ps_get (struct cc_oci_config *config)
+{
+	const gchar   *procs_files[] = { CC_OCI_PS_GUEST_PROCS, NULL };
+	gchar         *procs = NULL;
+	GArray        *pids = NULL;
+	GArray        *entries = NULL;
+	gchar        **files = NULL;
+	gchar        **contents = NULL;
+	guint          i;
+
+	if (! config) {
+		return NULL;
+	}
+
+	if (! cc_proxy_hyper_read_files (config, procs_files, &procs)) {
+		goto out;
+	}
+
+	if (! procs) {
+		g_critical ("failed to list processes of container %s",
+				config->optarg_container_id);
+		goto out;
+	}
+
+	pids = cc_oci_ps_parse_pids (procs);
+
+	entries = g_array_sized_new (false, true,
+			sizeof (struct cc_oci_ps_entry), pids->len);
+
+	if (! pids->len) {
+		goto out;
+	}
+
+	files = g_new0 (gchar *, pids->len + 1);
+	contents = g_new0 (gchar *, pids->len + 1);
+
+	for (i = 0; i < pids->len; i++) {
+		files[i] = g_strdup_printf ("/proc/%d/stat",
+				(int)g_array_index (pids, GPid, i));
+	}
+
+	if (! cc_proxy_hyper_read_files (config,
+				(const gchar **)files, contents)) {
+		g_array_free (entries, true);
+		entries = NULL;
+		goto out;
+	}
+
+	for (i = 0; i < pids->len; i++) {
+		struct cc_oci_ps_entry entry;
+
+		if (! contents[i]) {
+			/* process exited since being listed */
+			continue;
+		}
+
+		if (cc_oci_ps_parse_stat (contents[i], &entry)) {
+			g_array_append_val (entries, entry);
+		}
+	}
+
+out:
+	if (contents) {
+		/* may contain holes, so g_strfreev() cannot be used */
+		for (i = 0; pids && i < pids->len; i++) {
+			g_free_if_set (contents[i]);
+		}
+		g_free (contents);
+	}
+
+	g_strfreev (files);
+	g_free_if_set (procs);
+
+	if (pids) {
+		g_array_free (pids, true);
+	}
+
+	return entries;
+}
+
+/*!
+ * Format a process table for display.
+ *
+ * \param procs \c GArray of \ref cc_oci_ps_entry.
+ *
+ * \return Newly-allocated string, or \c NULL on error.
+ */
+gchar *
+cc_oci_ps_to_table (GArray *procs)
+{
+	GString  *str;
+	guint     i;
+
+	if (! procs) {
+		return NULL;
+	}
+
+	str = g_string_new ("");
+
+	g_string_append_printf (str, "%7s %7s %s %10s %11s %s\n",
+			"PID", "PPID", "S", "RSS", "TIME", "CMD");
+
+	for (i = 0; i < procs->len; i++) {
+		struct cc_oci_ps_entry *entry;
+		gchar *time;
+
+		entry = &g_array_index (procs, struct cc_oci_ps_entry, i);
+
+		time = cc_oci_ps_format_time (entry->time);
+
+		/* like ps(1), show the RSS in KiB */
+		g_string_append_printf (str,
+				"%7d %7d %c %10" G_GUINT64_FORMAT " %11s %s\n",
+				(int)entry->pid,
+				(int)entry->ppid,
+				entry->state,
+				entry->rss / 1024,
+				time,
+				entry->cmd);
+
+		g_free (time);
+	}
+
+	return g_string_free (str, false);
+}
+
+/*!
+ * Convert a process table to JSON.
+ *
+ * \param procs \c GArray of \ref cc_oci_ps_entry.
+ *
+ * \return \c JsonArray of process objects, or \c NULL on error.
+ */
+JsonArray *
+cc_oci_ps_to_json (GArray *procs)
+{
+	JsonArray  *array;
+	guint       i;
+
+	if (! procs) {
+		return NULL;
+	}
+
+	array = json_array_new ();
+
+	for (i = 0; i < procs->len; i++) {
+		struct cc_oci_ps_entry *entry;
+		JsonObject *obj;
+		gchar state[2] = { '\0' };
+
+		entry = &g_array_index (procs, struct cc_oci_ps_entry, i);
+
+		state[0] = entry->state;
+
+		obj = json_object_new ();
+
+		json_object_set_int_member (obj, "pid", entry->pid);
+		json_object_set_int_member (obj, "ppid", entry->ppid);
+		json_object_set_string_member (obj, "state", state);
+		json_object_set_int_member (obj, "rss",
+				(gint64)entry->rss);
+		json_object_set_int_member (obj, "cpu_time",
+				(gint64)entry->time);
+		json_object_set_string_member (obj, "cmd", entry->cmd);
+
+		json_array_add_object_element (array, obj);
+	}
+
+	return array;
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_PS_H
+#define _CC_OCI_PS_H
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "oci.h"
+
+/** Maximum length of a process name (TASK_COMM_LEN less the nul). */
+#define CC_OCI_PS_CMD_LEN 15
+
+/** A process running inside a container. */
+struct cc_oci_ps_entry {
+	/** Process ID, as seen inside the container. */
+	GPid     pid;
+
+	/** Parent process ID. */
+	GPid     ppid;
+
+	/** Process state, as shown by proc(5) ('R', 'S', 'Z', ...). */
+	gchar    state;
+
+	/** Resident set size (bytes). */
+	guint64  rss;
+
+	/** CPU time consumed in user and kernel mode (ns). */
+	guint64  time;
+
+	/** Process name. */
+	gchar    cmd[CC_OCI_PS_CMD_LEN+1];
+};
+
+GArray *cc_oci_ps_get (struct cc_oci_config *config);
+gchar *cc_oci_ps_to_table (GArray *procs);
+JsonArray *cc_oci_ps_to_json (GArray *procs);
+
+#endif /* _CC_OCI_PS_H */
@@ -21,6 +21,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -134,3 +135,50 @@ cc_oci_runtime_dir_delete (struct cc_oci_config *config)
 
 	return cc_oci_rm_rf (config->state.runtime_path);
 }
+
+/*!
+ * Get the ids of all containers below \p root_dir.
+ *
+ * A container is a directory containing a \ref CC_OCI_STATE_FILE;
+ * state files are not opened.
+ *
+ * \param root_dir Runtime root directory.
+ *
+ * \return \c GSList of newly-allocated container ids (may be \c NULL
+ * if there are no containers).
+ */
+GSList *
+cc_oci_runtime_container_ids (const gchar *root_dir)
+{
+	GDir         *dir;
+	const gchar  *name;
+	GSList       *ids = NULL;
+	struct stat   st;
+
+	if (! root_dir) {
+		return NULL;
+	}
+
+	dir = g_dir_open (root_dir, 0x0, NULL);
+	if (! dir) {
+		/* No containers yet */
+		return NULL;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *state_file = NULL;
+
+		state_file = g_build_path ("/", root_dir, name,
+				CC_OCI_STATE_FILE, NULL);
+
+		if (stat (state_file, &st) < 0) {
+			continue;
+		}
+
+		ids = g_slist_prepend (ids, g_strdup (name));
+	}
+
+	g_dir_close (dir);
+
+	return g_slist_reverse (ids);
+}
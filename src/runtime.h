@@ -26,5 +26,6 @@
 gboolean cc_oci_runtime_path_get (struct cc_oci_config *config);
 gboolean cc_oci_runtime_dir_setup (struct cc_oci_config *config);
 gboolean cc_oci_runtime_dir_delete (struct cc_oci_config *config);
+GSList *cc_oci_runtime_container_ids (const gchar *root_dir);
 
 #endif /* _CC_OCI_RUNTIME_H */
@@ -0,0 +1,198 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Names of the top-level sections of the config and state files.
+ *
+ * Section names are looked up with a perfect hash (in the style of
+ * gperf) so that dispatching a section to its handler costs a single
+ * string comparison:
+ *
+ *     hash = length + asso[name[0]] + asso[name[1]] + asso[name[length-1]]
+ *
+ * \ref section_asso_values was chosen so that no two section names
+ * have the same hash. When adding a section, add it to
+ * \ref cc_oci_section and \ref section_names and, if the section_test
+ * reports a collision, adjust the values of the letters used by the
+ * new name until it no longer does.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "section.h"
+
+/** Shortest section name. */
+#define SECTION_MIN_LENGTH	2
+
+/** Longest section name. */
+#define SECTION_MAX_LENGTH	11
+
+/** Largest hash of a section name. */
+#define SECTION_MAX_HASH	71
+
+/** Value for letters not used by section names at hashed positions. */
+#define SECTION_NONE		(SECTION_MAX_HASH + 1)
+
+/** Name of each section. */
+static const gchar *section_names[CC_OCI_SECTION_COUNT] = {
+	[CC_OCI_SECTION_ANNOTATIONS]  = "annotations",
+	[CC_OCI_SECTION_BLOCK_FSTYPE] = "blockFstype",
+	[CC_OCI_SECTION_BLOCK_INDEX]  = "blockIndex",
+	[CC_OCI_SECTION_BUNDLE_PATH]  = "bundlePath",
+	[CC_OCI_SECTION_COMMS_PATH]   = "commsPath",
+	[CC_OCI_SECTION_CONSOLE]      = "console",
+	[CC_OCI_SECTION_CREATED]      = "created",
+	[CC_OCI_SECTION_HOOKS]        = "hooks",
+	[CC_OCI_SECTION_HOSTNAME]     = "hostname",
+	[CC_OCI_SECTION_ID]           = "id",
+	[CC_OCI_SECTION_LINUX]        = "linux",
+	[CC_OCI_SECTION_MOUNTS]       = "mounts",
+	[CC_OCI_SECTION_NAMESPACES]   = "namespaces",
+	[CC_OCI_SECTION_OCI_VERSION]  = "ociVersion",
+	[CC_OCI_SECTION_PID]          = "pid",
+	[CC_OCI_SECTION_PLATFORM]     = "platform",
+	[CC_OCI_SECTION_POD]          = "pod",
+	[CC_OCI_SECTION_PROCESS]      = "process",
+	[CC_OCI_SECTION_PROCESS_PATH] = "processPath",
+	[CC_OCI_SECTION_PROXY]        = "proxy",
+	[CC_OCI_SECTION_ROOT]         = "root",
+	[CC_OCI_SECTION_ROOTFS_MOUNT] = "rootfsMount",
+	[CC_OCI_SECTION_STATUS]       = "status",
+	[CC_OCI_SECTION_VM]           = "vm",
+	[CC_OCI_SECTION_WORKLOAD_DIR] = "workloadDir",
+};
+
+/** Hash value of each lower-case letter. */
+static const guint8 section_asso_values[26] = {
+	/* a  b   c   d   e   f            g            h   i */
+	12, 17, 15, 15, 20, SECTION_NONE, SECTION_NONE, 10, 4,
+	/* j           k            l  m  n   o   p  q */
+	SECTION_NONE, SECTION_NONE, 7, 4, 24, 12, 0, SECTION_NONE,
+	/* r  s   t   u  v   w   x   y   z */
+	11, 13, 37, 8, 18, 29, 22, 26, SECTION_NONE,
+};
+
+/** Section for each hash value. */
+static const guint8 section_hash_table[SECTION_MAX_HASH + 1] = {
+	[19] = CC_OCI_SECTION_PLATFORM,
+	[22] = CC_OCI_SECTION_PID,
+	[28] = CC_OCI_SECTION_VM,
+	[30] = CC_OCI_SECTION_POD,
+	[31] = CC_OCI_SECTION_PROCESS,
+	[32] = CC_OCI_SECTION_PROCESS_PATH,
+	[35] = CC_OCI_SECTION_MOUNTS,
+	[36] = CC_OCI_SECTION_ID,
+	[38] = CC_OCI_SECTION_LINUX,
+	[40] = CC_OCI_SECTION_HOOKS,
+	[42] = CC_OCI_SECTION_PROXY,
+	[45] = CC_OCI_SECTION_BUNDLE_PATH,
+	[46] = CC_OCI_SECTION_COMMS_PATH,
+	[48] = CC_OCI_SECTION_CREATED,
+	[50] = CC_OCI_SECTION_HOSTNAME,
+	[54] = CC_OCI_SECTION_CONSOLE,
+	[55] = CC_OCI_SECTION_BLOCK_FSTYPE,
+	[56] = CC_OCI_SECTION_BLOCK_INDEX,
+	[59] = CC_OCI_SECTION_NAMESPACES,
+	[60] = CC_OCI_SECTION_ANNOTATIONS,
+	[61] = CC_OCI_SECTION_OCI_VERSION,
+	[63] = CC_OCI_SECTION_WORKLOAD_DIR,
+	[64] = CC_OCI_SECTION_ROOT,
+	[69] = CC_OCI_SECTION_STATUS,
+	[71] = CC_OCI_SECTION_ROOTFS_MOUNT,
+};
+
+/*!
+ * Determine the hash value of the letter \p c.
+ *
+ * \param c Character.
+ *
+ * \return Hash value.
+ */
+static inline guint
+section_asso (gchar c)
+{
+	if (c < 'a' || c > 'z') {
+		return SECTION_NONE;
+	}
+
+	return section_asso_values[c - 'a'];
+}
+
+/*!
+ * Determine the section called \p name.
+ *
+ * \param name Name of a top-level member of \ref CC_OCI_CONFIG_FILE
+ * or \ref CC_OCI_STATE_FILE.
+ *
+ * \return \ref cc_oci_section, or \ref CC_OCI_SECTION_UNKNOWN if
+ * \p name is not a known section.
+ */
+enum cc_oci_section
+cc_oci_section_from_name (const gchar *name)
+{
+	gsize  len;
+	guint  hash;
+	guint8 section;
+
+	if (! name) {
+		return CC_OCI_SECTION_UNKNOWN;
+	}
+
+	len = strlen (name);
+	if (len < SECTION_MIN_LENGTH || len > SECTION_MAX_LENGTH) {
+		return CC_OCI_SECTION_UNKNOWN;
+	}
+
+	hash = (guint)len + section_asso (name[0]) +
+		section_asso (name[1]) + section_asso (name[len-1]);
+	if (hash > SECTION_MAX_HASH) {
+		return CC_OCI_SECTION_UNKNOWN;
+	}
+
+	section = section_hash_table[hash];
+	if (section == CC_OCI_SECTION_UNKNOWN ||
+			strcmp (section_names[section], name)) {
+		return CC_OCI_SECTION_UNKNOWN;
+	}
+
+	return (enum cc_oci_section)section;
+}
+
+/*!
+ * Determine the name of \p section.
+ *
+ * \param section \ref cc_oci_section.
+ *
+ * \return Static string on success, else \c NULL.
+ */
+const gchar *
+cc_oci_section_name (enum cc_oci_section section)
+{
+	if (section <= CC_OCI_SECTION_UNKNOWN ||
+			section >= CC_OCI_SECTION_COUNT) {
+		return NULL;
+	}
+
+	return section_names[section];
+}
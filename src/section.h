@@ -0,0 +1,65 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_SECTION_H
+#define _CC_OCI_SECTION_H
+
+#include <glib.h>
+
+/** Top-level sections of \ref CC_OCI_CONFIG_FILE and
+ * \ref CC_OCI_STATE_FILE.
+ */
+enum cc_oci_section {
+	CC_OCI_SECTION_UNKNOWN = 0,
+
+	CC_OCI_SECTION_ANNOTATIONS,
+	CC_OCI_SECTION_BLOCK_FSTYPE,
+	CC_OCI_SECTION_BLOCK_INDEX,
+	CC_OCI_SECTION_BUNDLE_PATH,
+	CC_OCI_SECTION_COMMS_PATH,
+	CC_OCI_SECTION_CONSOLE,
+	CC_OCI_SECTION_CREATED,
+	CC_OCI_SECTION_HOOKS,
+	CC_OCI_SECTION_HOSTNAME,
+	CC_OCI_SECTION_ID,
+	CC_OCI_SECTION_LINUX,
+	CC_OCI_SECTION_MOUNTS,
+	CC_OCI_SECTION_NAMESPACES,
+	CC_OCI_SECTION_OCI_VERSION,
+	CC_OCI_SECTION_PID,
+	CC_OCI_SECTION_PLATFORM,
+	CC_OCI_SECTION_POD,
+	CC_OCI_SECTION_PROCESS,
+	CC_OCI_SECTION_PROCESS_PATH,
+	CC_OCI_SECTION_PROXY,
+	CC_OCI_SECTION_ROOT,
+	CC_OCI_SECTION_ROOTFS_MOUNT,
+	CC_OCI_SECTION_STATUS,
+	CC_OCI_SECTION_VM,
+	CC_OCI_SECTION_WORKLOAD_DIR,
+
+	/** Number of sections (must be last). */
+	CC_OCI_SECTION_COUNT
+};
+
+enum cc_oci_section cc_oci_section_from_name (const gchar *name);
+const gchar *cc_oci_section_name (enum cc_oci_section section);
+
+#endif /* _CC_OCI_SECTION_H */
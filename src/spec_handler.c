@@ -18,11 +18,154 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <sys/stat.h>
+
 #include "spec_handler.h"
 #include "util.h"
 #include "json.h"
 #include "common.h"
+#include "vm_cache.h"
+
+/** Last VM configuration read by \ref get_spec_vm_from_cfg_file.
+ *
+ * Only useful to long-running processes ("cc-oci-runtime daemon" and
+ * its children), which would otherwise re-read the same file for
+ * every container.
+ */
+static struct spec_vm_cache {
+	/** File the configuration was read from. */
+	gchar                 *path;
+
+	/** Modification time of \ref path when it was read. */
+	struct timespec        mtime;
+
+	/** Size of \ref path when it was read. */
+	off_t                  size;
+
+	/** Configuration (\c NULL if nothing cached). */
+	struct cc_oci_vm_cfg  *vm;
+} spec_vm_cache;
+
+/*!
+ * Forget the cached VM configuration.
+ */
+static void
+spec_vm_cache_clear (void)
+{
+	g_free_if_set (spec_vm_cache.path);
+	if (spec_vm_cache.vm) {
+		g_free_if_set (spec_vm_cache.vm->kernel_params);
+		g_free (spec_vm_cache.vm);
+		spec_vm_cache.vm = NULL;
+	}
+}
+
+/*!
+ * Copy \p vm.
+ *
+ * \param vm \ref cc_oci_vm_cfg.
+ *
+ * \return Newly-allocated \ref cc_oci_vm_cfg.
+ */
+static struct cc_oci_vm_cfg *
+spec_vm_copy (const struct cc_oci_vm_cfg *vm)
+{
+	struct cc_oci_vm_cfg *copy;
 
+	copy = g_memdup (vm, (guint)sizeof (*vm));
+	copy->kernel_params = g_strdup (vm->kernel_params);
+
+	return copy;
+}
+
+/*!
+ * Set the VM configuration of \p config from the cache if
+ * \p file has not changed since it was cached.
+ *
+ * \param config \ref cc_oci_config.
+ * \param file VM configuration file.
+ *
+ * \return \c true if the cache was used, else \c false.
+ */
+static gboolean
+spec_vm_cache_lookup (struct cc_oci_config *config, const gchar *file)
+{
+	struct stat st;
+
+	if (! spec_vm_cache.vm || g_strcmp0 (spec_vm_cache.path, file)) {
+		return false;
+	}
+
+	if (stat (file, &st) < 0 ||
+			st.st_mtim.tv_sec != spec_vm_cache.mtime.tv_sec ||
+			st.st_mtim.tv_nsec != spec_vm_cache.mtime.tv_nsec ||
+			st.st_size != spec_vm_cache.size) {
+		spec_vm_cache_clear ();
+		return false;
+	}
+
+	/* the files referenced must still exist, and the paths in
+	 * the configuration (usually symbolic links) must still
+	 * resolve to them.
+	 */
+	if (stat (spec_vm_cache.vm->hypervisor_path, &st) < 0 ||
+			stat (spec_vm_cache.vm->image_path, &st) < 0 ||
+			stat (spec_vm_cache.vm->kernel_path, &st) < 0 ||
+			! cc_oci_vm_cache_path_resolves (
+				spec_vm_cache.vm->hypervisor_config_path,
+				spec_vm_cache.vm->hypervisor_path) ||
+			! cc_oci_vm_cache_path_resolves (
+				spec_vm_cache.vm->image_config_path,
+				spec_vm_cache.vm->image_path) ||
+			! cc_oci_vm_cache_path_resolves (
+				spec_vm_cache.vm->kernel_config_path,
+				spec_vm_cache.vm->kernel_path)) {
+		spec_vm_cache_clear ();
+		return false;
+	}
+
+	config->vm = spec_vm_copy (spec_vm_cache.vm);
+
+	return true;
+}
+
+/*!
+ * Cache the VM configuration of \p config, read from \p file.
+ *
+ * \param config \ref cc_oci_config.
+ * \param file VM configuration file.
+ * \param st Status of \p file before it was read.
+ */
+static void
+spec_vm_cache_store (const struct cc_oci_config *config,
+		const gchar *file, const struct stat *st)
+{
+	spec_vm_cache_clear ();
+
+	spec_vm_cache.path = g_strdup (file);
+	spec_vm_cache.mtime = st->st_mtim;
+	spec_vm_cache.size = st->st_size;
+	spec_vm_cache.vm = spec_vm_copy (config->vm);
+}
+
+/*!
+ * Determine if \ref CC_OCI_VM_CACHE_FILE should be used.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c true if the cache should be used, else \c false.
+ */
+static gboolean
+spec_vm_use_file_cache (const struct cc_oci_config *config)
+{
+#ifdef UNIT_TESTING
+	/* don't touch the real runtime root */
+	return config->root_dir != NULL;
+#else
+	(void)config;
+	return true;
+#endif // UNIT_TESTING
+}
 
 /*!
  * If the virtual machine attribute ("vm") in config is NULL,
@@ -38,9 +181,12 @@ gboolean
 get_spec_vm_from_cfg_file (struct cc_oci_config* config)
 {
 	bool result= true;
-	GNode* vm_config = NULL;
+	JsonParser* parser = NULL;
+	JsonNode* root = NULL;
 	GNode* vm_node= NULL;
 	gchar* sys_json_file = NULL;
+	struct stat st;
+	gboolean cacheable = false;
 
 	if (! config) {
 		return false;
@@ -61,27 +207,57 @@ get_spec_vm_from_cfg_file (struct cc_oci_config* config)
 		CC_OCI_VM_CONFIG, NULL);
 	}
 #endif // UNIT_TESTING
+	if (spec_vm_cache_lookup (config, sys_json_file)) {
+		g_debug ("Using cached VM configuration from %s",
+			sys_json_file);
+		goto out;
+	}
+
+	/* stat before reading so a concurrent change is detected
+	 * next time.
+	 */
+	cacheable = stat (sys_json_file, &st) == 0;
+
+	if (cacheable && spec_vm_use_file_cache (config) &&
+			cc_oci_vm_cache_load (config, sys_json_file)) {
+		spec_vm_cache_store (config, sys_json_file, &st);
+		goto out;
+	}
+
 	g_debug ("Reading VM configuration from %s",
 		sys_json_file);
-	if (! cc_oci_json_parse(&vm_config, sys_json_file)) {
+	parser = cc_oci_json_load (sys_json_file);
+	if (! parser) {
 		result = false;
 		goto out;
 	}
 
-	vm_node = g_node_first_child(vm_config);
-	while (vm_node) {
-		if (g_strcmp0(vm_node->data, vm_spec_handler.name) == 0) {
-			break;
-		}
-		vm_node = g_node_next_sibling(vm_node);
+	/* only convert the vm section to GNode */
+	root = json_parser_get_root (parser);
+	if (JSON_NODE_TYPE (root) == JSON_NODE_OBJECT &&
+			json_object_has_member (json_node_get_object (root),
+				vm_spec_handler.name)) {
+		vm_node = cc_oci_json_member_to_node (vm_spec_handler.name,
+				json_object_get_member (json_node_get_object (root),
+					vm_spec_handler.name));
 	}
 	vm_spec_handler.handle_section(vm_node, config);
 	if (! config->vm) {
 		g_critical ("VM json node not found");
 		result = false;
+	} else if (cacheable) {
+		spec_vm_cache_store (config, sys_json_file, &st);
+
+		if (spec_vm_use_file_cache (config)) {
+			(void)cc_oci_vm_cache_save (config, sys_json_file,
+					&st);
+		}
 	}
 out:
 	g_free_if_set (sys_json_file);
-	g_free_node (vm_config);
+	g_free_node (vm_node);
+	if (parser) {
+		g_object_unref (parser);
+	}
 	return result;
 }
@@ -38,6 +38,9 @@ handle_kernel_section(GNode* root, struct cc_oci_config* config) {
 			    "%s", path) < 0) {
 				g_critical("failed to copy vm kernel path");
 			}
+			(void)g_strlcpy(config->vm->kernel_config_path,
+			    root->children->data,
+			    sizeof(config->vm->kernel_config_path));
 		}
 	} else if (g_strcmp0(root->data, "parameters") == 0) {
 		config->vm->kernel_params = g_strdup(root->children->data);
@@ -57,6 +60,9 @@ handle_vm_section(GNode* root, struct cc_oci_config* config) {
 			    "%s", path) < 0) {
 				g_critical("failed to copy vm hypervisor path");
 			}
+			(void)g_strlcpy(config->vm->hypervisor_config_path,
+			    root->children->data,
+			    sizeof(config->vm->hypervisor_config_path));
 		}
 
 	} else if(g_strcmp0(root->data, "image") == 0) {
@@ -67,6 +73,9 @@ handle_vm_section(GNode* root, struct cc_oci_config* config) {
 			    "%s", path) < 0) {
 				g_critical("failed to copy vm image path");
 			}
+			(void)g_strlcpy(config->vm->image_config_path,
+			    root->children->data,
+			    sizeof(config->vm->image_config_path));
 		}
 	} else if (g_strcmp0(root->data, "kernel") == 0) {
 		g_node_children_foreach(root, G_TRAVERSE_ALL,
@@ -26,6 +26,9 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -34,11 +37,13 @@
 #include "oci.h"
 #include "util.h"
 #include "state.h"
+#include "state_index.h"
 #include "runtime.h"
 #include "mount.h"
 #include "namespace.h"
 #include "annotation.h"
 #include "json.h"
+#include "section.h"
 #include "config.h"
 #include "spec_handler.h"
 
@@ -71,6 +76,86 @@ static void handle_state_process_section(GNode* node, struct handler_data* data)
 static void handle_state_blockFstype_section(GNode*, struct handler_data*);
 static void handle_state_blockIndex_section(GNode* node, struct handler_data* data);
 
+/** Declare a key decoding a scalar section into \a member of \ref oci_state. */
+#define STATE_VALUE_KEY(type, member) \
+	((const struct cc_oci_json_key []) { \
+		CC_OCI_JSON_KEY (NULL, type, struct oci_state, member) \
+	})
+
+/** Keys of the "vm" section. */
+static const struct cc_oci_json_key state_vm_keys[] = {
+	CC_OCI_JSON_KEY ("workload_path"   , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , workload_path),
+	CC_OCI_JSON_KEY ("hypervisor_path" , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , hypervisor_path),
+	CC_OCI_JSON_KEY ("kernel_path"     , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , kernel_path),
+	CC_OCI_JSON_KEY ("image_path"      , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , image_path),
+	CC_OCI_JSON_KEY ("kernel_params"   , CC_OCI_JSON_STRING , struct cc_oci_vm_cfg , kernel_params),
+	CC_OCI_JSON_KEY ("pid"             , CC_OCI_JSON_INT    , struct cc_oci_vm_cfg , pid),
+
+	/* terminator */
+	{ NULL }
+};
+
+/** Keys of the "proxy" section. */
+static const struct cc_oci_json_key state_proxy_keys[] = {
+	CC_OCI_JSON_KEY ("ctlSocket"     , CC_OCI_JSON_STRING , struct cc_proxy , agent_ctl_socket),
+	CC_OCI_JSON_KEY ("ioSocket"      , CC_OCI_JSON_STRING , struct cc_proxy , agent_tty_socket),
+	CC_OCI_JSON_KEY ("consoleSocket" , CC_OCI_JSON_STRING , struct cc_proxy , vm_console_socket),
+
+	/* terminator */
+	{ NULL }
+};
+
+/** Keys of the "console" section. */
+static const struct cc_oci_json_key state_console_keys[] = {
+	CC_OCI_JSON_KEY ("path" , CC_OCI_JSON_STRING , struct oci_state , console),
+
+	/* terminator */
+	{ NULL }
+};
+
+/** Keys read by cc_oci_state_file_read_summary(). */
+static const struct cc_oci_json_key state_summary_keys[] = {
+	CC_OCI_JSON_KEY ("id"         , CC_OCI_JSON_STRING , struct oci_state , id),
+	CC_OCI_JSON_KEY ("pid"        , CC_OCI_JSON_INT    , struct oci_state , pid),
+	CC_OCI_JSON_KEY ("bundlePath" , CC_OCI_JSON_STRING , struct oci_state , bundle_path),
+	CC_OCI_JSON_KEY ("created"    , CC_OCI_JSON_STRING , struct oci_state , create_time),
+
+	/* terminator */
+	{ NULL }
+};
+
+/** Keys of the "vm" section read by cc_oci_state_file_read_summary(). */
+static const struct cc_oci_json_key state_summary_vm_keys[] = {
+	CC_OCI_JSON_KEY ("hypervisor_path" , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , hypervisor_path),
+	CC_OCI_JSON_KEY ("kernel_path"     , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , kernel_path),
+	CC_OCI_JSON_KEY ("image_path"      , CC_OCI_JSON_STRBUF , struct cc_oci_vm_cfg , image_path),
+	CC_OCI_JSON_KEY ("pid"             , CC_OCI_JSON_INT    , struct cc_oci_vm_cfg , pid),
+
+	/* terminator */
+	{ NULL }
+};
+
+/** Keys of the "pod" section read by cc_oci_state_file_read_summary(). */
+static const struct cc_oci_json_key state_summary_pod_keys[] = {
+	CC_OCI_JSON_KEY ("sandbox"      , CC_OCI_JSON_BOOLEAN , struct cc_pod , sandbox),
+	CC_OCI_JSON_KEY ("sandbox_name" , CC_OCI_JSON_STRING  , struct cc_pod , sandbox_name),
+
+	/* terminator */
+	{ NULL }
+};
+
+static gpointer
+state_vm_get (struct oci_state *state)
+{
+	return state->vm;
+}
+
+static gpointer
+state_proxy_get (struct oci_state *state)
+{
+	return state->proxy;
+}
+
 /*! Used to handle each section in \ref CC_OCI_STATE_FILE. */
 static struct state_handler {
 	/** Name of JSON element in \ref CC_OCI_STATE_FILE. */
@@ -86,29 +171,37 @@ static struct state_handler {
 	 * this value matches \ref subelements_needed.
 	 */
 	size_t subelements_count;
-} state_handlers[] = {
-	{ "ociVersion"  , handle_state_ociVersion_section  , 1 , 0 },
-	{ "id"          , handle_state_id_section          , 1 , 0 },
-	{ "pid"         , handle_state_pid_section         , 1 , 0 },
-	{ "bundlePath"  , handle_state_bundlePath_section  , 1 , 0 },
-	{ "commsPath"   , handle_state_commsPath_section   , 1 , 0 },
-	{ "processPath" , handle_state_processPath_section , 1 , 0 },
-	{ "workloadDir" , handle_state_workloadDir_section , 0 , 0 },
-	{ "status"      , handle_state_status_section      , 1 , 0 },
-	{ "created"     , handle_state_created_section     , 1 , 0 },
-	{ "mounts"      , handle_state_mounts_section      , 0 , 0 },
-	{ "rootfsMount" , handle_state_rootfsMount_section , 0 , 0 },
-	{ "console"     , handle_state_console_section     , 0 , 0 },
-	{ "vm"          , handle_state_vm_section          , 6 , 0 },
-	{ "proxy"       , handle_state_proxy_section       , 2 , 0 },
-	{ "pod"         , handle_state_pod_section         , 0 , 0 },
-	{ "annotations" , handle_state_annotations_section , 0 , 0 },
-	{ "namespaces"  , handle_state_namespaces_section  , 0 , 0 },
-	{ "blockFstype" , handle_state_blockFstype_section , 0 , 0 },
-	{ "blockIndex"  , handle_state_blockIndex_section  , 0 , 0 },
 
-	/* terminator */
-	{ NULL, NULL, 0, 0 }
+	/** Keys used to decode the element directly from JSON. If
+	 * \c NULL or if the element cannot be decoded using them,
+	 * \ref handle_section is used.
+	 */
+	const struct cc_oci_json_key *keys;
+
+	/** Return the struct \ref keys decode into, \ref oci_state if
+	 * \c NULL.
+	 */
+	gpointer (*get_base)(struct oci_state *state);
+} state_handlers[CC_OCI_SECTION_COUNT] = {
+	[CC_OCI_SECTION_OCI_VERSION]  = { "ociVersion"  , handle_state_ociVersion_section  , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, oci_version)   , NULL },
+	[CC_OCI_SECTION_ID]           = { "id"          , handle_state_id_section          , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, id)            , NULL },
+	[CC_OCI_SECTION_PID]          = { "pid"         , handle_state_pid_section         , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_INT, pid)              , NULL },
+	[CC_OCI_SECTION_BUNDLE_PATH]  = { "bundlePath"  , handle_state_bundlePath_section  , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, bundle_path)   , NULL },
+	[CC_OCI_SECTION_COMMS_PATH]   = { "commsPath"   , handle_state_commsPath_section   , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, comms_path)    , NULL },
+	[CC_OCI_SECTION_PROCESS_PATH] = { "processPath" , handle_state_processPath_section , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, procsock_path) , NULL },
+	[CC_OCI_SECTION_WORKLOAD_DIR] = { "workloadDir" , handle_state_workloadDir_section , 0 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, workload_dir)  , NULL },
+	[CC_OCI_SECTION_STATUS]       = { "status"      , handle_state_status_section      , 1 , 0 , NULL                                                , NULL },
+	[CC_OCI_SECTION_CREATED]      = { "created"     , handle_state_created_section     , 1 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, create_time)   , NULL },
+	[CC_OCI_SECTION_MOUNTS]       = { "mounts"      , handle_state_mounts_section      , 0 , 0 , NULL                                                , NULL },
+	[CC_OCI_SECTION_ROOTFS_MOUNT] = { "rootfsMount" , handle_state_rootfsMount_section , 0 , 0 , NULL                                                , NULL },
+	[CC_OCI_SECTION_CONSOLE]      = { "console"     , handle_state_console_section     , 0 , 0 , state_console_keys                                  , NULL },
+	[CC_OCI_SECTION_VM]           = { "vm"          , handle_state_vm_section          , 6 , 0 , state_vm_keys                                       , state_vm_get },
+	[CC_OCI_SECTION_PROXY]        = { "proxy"       , handle_state_proxy_section       , 2 , 0 , state_proxy_keys                                    , state_proxy_get },
+	[CC_OCI_SECTION_POD]          = { "pod"         , handle_state_pod_section         , 0 , 0 , NULL                                                , NULL },
+	[CC_OCI_SECTION_ANNOTATIONS]  = { "annotations" , handle_state_annotations_section , 0 , 0 , NULL                                                , NULL },
+	[CC_OCI_SECTION_NAMESPACES]   = { "namespaces"  , handle_state_namespaces_section  , 0 , 0 , NULL                                                , NULL },
+	[CC_OCI_SECTION_BLOCK_FSTYPE] = { "blockFstype" , handle_state_blockFstype_section , 0 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_STRING, block_fstype)  , NULL },
+	[CC_OCI_SECTION_BLOCK_INDEX]  = { "blockIndex"  , handle_state_blockIndex_section  , 0 , 0 , STATE_VALUE_KEY (CC_OCI_JSON_INT, block_index)      , NULL },
 };
 
 /*!
@@ -136,6 +229,15 @@ static struct cc_oci_map oci_status_map[] =
 	{ OCI_STATUS_INVALID , NULL      }
 };
 
+static struct cc_oci_map oci_state_sync_map[] =
+{
+	{ CC_OCI_STATE_SYNC_FILE , "file" },
+	{ CC_OCI_STATE_SYNC_NONE , "none" },
+	{ CC_OCI_STATE_SYNC_FULL , "full" },
+
+	{ -1                     , NULL   }
+};
+
 /**
  * Determine the human-readable string to be used to show the state
  * of the specified VM.
@@ -696,21 +798,24 @@ static void
 handle_state_sections(GNode* node, struct oci_state* state) {
 	struct state_handler* handler;
 	struct handler_data data = { .state=state };
+	enum cc_oci_section section;
 
 	if (! (node && node->data)) {
 		return;
 	}
 
-	for (handler=state_handlers; handler->name; handler++) {
-		if (g_strcmp0(handler->name, node->data) == 0) {
-			data.subelements_count = &handler->subelements_count;
-			g_node_children_foreach(node, G_TRAVERSE_ALL,
-				(GNodeForeachFunc)handler->handle_section, &data);
-			return;
-		}
+	section = cc_oci_section_from_name (node->data);
+
+	handler = &state_handlers[section];
+	if (handler->name) {
+		data.subelements_count = &handler->subelements_count;
+		g_node_children_foreach(node, G_TRAVERSE_ALL,
+			(GNodeForeachFunc)handler->handle_section, &data);
+		return;
 	}
+
 	/* Handle "process" node using oci spec handlers */
-	if (g_strcmp0(node->data, "process") == 0) {
+	if (section == CC_OCI_SECTION_PROCESS) {
 		handle_state_process_section(node, &data);
 		return;
 	}
@@ -769,9 +874,81 @@ cc_oci_state_file_exists (struct cc_oci_config *config)
 			G_FILE_TEST_EXISTS);
 }
 
+/*!
+ * Decode a section of the state file directly into \p state using
+ * the keys of its handler.
+ *
+ * \param name Name of the section.
+ * \param value \c JsonNode of the section.
+ * \param state \ref oci_state.
+ *
+ * \return \c true if the section was decoded, \c false if it must be
+ * handled by the \c GNode handlers.
+ */
+static gboolean
+decode_state_section (const gchar *name, JsonNode *value,
+		struct oci_state *state)
+{
+	struct state_handler *handler;
+	gpointer              base;
+	gint                  count;
+
+	handler = &state_handlers[cc_oci_section_from_name (name)];
+
+	if (! handler->keys) {
+		return false;
+	}
+
+	base = handler->get_base ? handler->get_base (state) : state;
+
+	count = cc_oci_json_decode (value, handler->keys, base);
+	if (count < 0) {
+		return false;
+	}
+
+	handler->subelements_count += (size_t)count;
+
+	return true;
+}
+
+/*!
+ * Handle a single section of the state file, falling back to the
+ * \c GNode handlers if it cannot be decoded directly.
+ *
+ * \param object \c JsonObject of the state file.
+ * \param name Name of the section.
+ * \param value \c JsonNode of the section.
+ * \param state \ref oci_state.
+ */
+static void
+handle_state_member (JsonObject *object, const gchar *name,
+		JsonNode *value, struct oci_state *state)
+{
+	GNode *node;
+
+	(void)object;
+
+	if (decode_state_section (name, value, state)) {
+		return;
+	}
+
+	node = cc_oci_json_member_to_node (name, value);
+	if (! node) {
+		return;
+	}
+
+	handle_state_sections (node, state);
+
+	g_free_node (node);
+}
+
 /*!
  * Read the state file.
  *
+ * Simple sections are decoded straight from the parsed JSON using
+ * the keys of \ref state_handlers; the others are converted to a
+ * \c GNode and handled by the section handlers.
+ *
  * \param file Full path to \ref CC_OCI_STATE_FILE state file.
  *
  * \return Newly-allocated \ref oci_state on success, else \c NULL.
@@ -779,7 +956,8 @@ cc_oci_state_file_exists (struct cc_oci_config *config)
 struct oci_state *
 cc_oci_state_file_read (const char *file)
 {
-	GNode* node = NULL;
+	JsonParser *parser = NULL;
+	JsonNode *root;
 	struct oci_state *state = NULL;
 	struct state_handler* handler;
 
@@ -787,17 +965,20 @@ cc_oci_state_file_read (const char *file)
 		return NULL;
 	}
 
-	if (! cc_oci_json_parse(&node, file)) {
+	parser = cc_oci_json_load (file);
+	if (! parser) {
 		g_critical("failed to parse json file: %s", file);
 		return NULL;
 	}
 
+	root = json_parser_get_root (parser);
+	if (JSON_NODE_TYPE (root) != JSON_NODE_OBJECT) {
+		g_critical("invalid state file: %s", file);
+		goto out;
+	}
+
 	state = g_new0 (struct oci_state, 1);
 	if (state) {
-#ifdef DEBUG
-		cc_oci_node_dump (node);
-#endif // DEBUG
-
 		state->vm = g_malloc0 (sizeof(struct cc_oci_vm_cfg));
 		if (! state->vm) {
 			g_free (state);
@@ -814,14 +995,18 @@ cc_oci_state_file_read (const char *file)
 		}
 
 		/* reset subelements_count */
-		for (handler=state_handlers; handler->name; ++handler) {
+		for (handler=state_handlers;
+				handler < state_handlers + CC_OCI_SECTION_COUNT;
+				++handler) {
 			handler->subelements_count = 0;
 		}
 
-		g_node_children_foreach(node, G_TRAVERSE_ALL,
-			(GNodeForeachFunc)handle_state_sections, state);
+		json_object_foreach_member (json_node_get_object (root),
+			(JsonObjectForeach)handle_state_member, state);
 
-		for (handler=state_handlers; handler->name; ++handler) {
+		for (handler=state_handlers;
+				handler < state_handlers + CC_OCI_SECTION_COUNT;
+				++handler) {
 			if (handler->subelements_count < handler->subelements_needed) {
 				g_critical("failed to run handler: %s", handler->name);
 				cc_oci_state_free(state);
@@ -832,8 +1017,134 @@ cc_oci_state_file_read (const char *file)
 	}
 
 out:
-	g_free_node(node);
+	g_object_unref (parser);
+	return state;
+}
+
+/*!
+ * Decode the members of \p object described by \p keys.
+ *
+ * \param object \c JsonObject.
+ * \param keys Array of \ref cc_oci_json_key's.
+ * \param base Struct the values are decoded into.
+ * \param required If \c true, all members must be present.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+decode_state_keys (JsonObject *object, const struct cc_oci_json_key *keys,
+		gpointer base, gboolean required)
+{
+	const struct cc_oci_json_key *key;
+	JsonNode *node;
+
+	for (key = keys; key->name; key++) {
+		node = json_object_get_member (object, key->name);
+		if (! node) {
+			if (required) {
+				return false;
+			}
+			continue;
+		}
+
+		if (! cc_oci_json_decode_value (node, key, base)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * Read the parts of the state file needed to list a container: its
+ * id, pid, status, bundle path, creation time, VM details (pid and
+ * paths) and whether it is a pod sandbox.
+ *
+ * The rest of the file (mounts, namespaces, process, ...) is skipped.
+ * Unlike cc_oci_state_file_read(), this function may be called from
+ * several threads at once.
+ *
+ * \param file Full path to \ref CC_OCI_STATE_FILE state file.
+ *
+ * \return Newly-allocated \ref oci_state on success, else \c NULL.
+ */
+struct oci_state *
+cc_oci_state_file_read_summary (const char *file)
+{
+	JsonParser  *parser = NULL;
+	JsonNode    *root;
+	JsonNode    *node;
+	JsonObject  *object;
+	const gchar *status;
+	struct oci_state *state = NULL;
+
+	if (! file) {
+		return NULL;
+	}
+
+	parser = cc_oci_json_load (file);
+	if (! parser) {
+		g_critical("failed to parse json file: %s", file);
+		return NULL;
+	}
+
+	root = json_parser_get_root (parser);
+	if (JSON_NODE_TYPE (root) != JSON_NODE_OBJECT) {
+		goto err;
+	}
+
+	object = json_node_get_object (root);
+
+	state = g_new0 (struct oci_state, 1);
+	state->vm = g_new0 (struct cc_oci_vm_cfg, 1);
+
+	if (! decode_state_keys (object, state_summary_keys, state, true)) {
+		goto err;
+	}
+
+	node = json_object_get_member (object, "status");
+	if (! (node && JSON_NODE_HOLDS_VALUE (node) &&
+				json_node_get_value_type (node) == G_TYPE_STRING)) {
+		goto err;
+	}
+
+	status = json_node_get_string (node);
+	state->status = cc_oci_str_to_status (status);
+	if (state->status == OCI_STATUS_INVALID) {
+		goto err;
+	}
+
+	node = json_object_get_member (object, "vm");
+	if (! (node && JSON_NODE_HOLDS_OBJECT (node))) {
+		goto err;
+	}
+
+	if (! decode_state_keys (json_node_get_object (node),
+				state_summary_vm_keys, state->vm, true)) {
+		goto err;
+	}
+
+	node = json_object_get_member (object, "pod");
+	if (node && JSON_NODE_HOLDS_OBJECT (node)) {
+		state->pod = g_new0 (struct cc_pod, 1);
+
+		if (! decode_state_keys (json_node_get_object (node),
+					state_summary_pod_keys,
+					state->pod, false)) {
+			goto err;
+		}
+	}
+
+	g_object_unref (parser);
+
 	return state;
+
+err:
+	g_critical("invalid state file: %s", file);
+	cc_oci_state_free (state);
+	g_object_unref (parser);
+
+	return NULL;
 }
 
 /*!
@@ -910,6 +1221,204 @@ cc_oci_state_free (struct oci_state *state)
 	g_free (state);
 }
 
+/*!
+ * Write the state file for the specified \p config.
+ *
+ * The data is written to a uniquely-named temporary file in the same
+ * directory which then replaces the state file, so readers see either
+ * the old or the new contents, even if several runtime processes update
+ * the state of the container at once. The file (and directory) are
+ * flushed according to \ref cc_oci_container_state.sync.
+ *
+ * \param config \ref cc_oci_config.
+ * \param str Data to write.
+ * \param len Length of \p str.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_state_file_write (const struct cc_oci_config *config,
+		const gchar *str, gsize len)
+{
+	g_autofree gchar *tmp = NULL;
+	const gchar      *path = config->state.state_file_path;
+	enum cc_oci_state_sync sync = config->state.sync;
+	gint64    start = g_get_monotonic_time ();
+	gsize     done = 0;
+	ssize_t   bytes;
+	int       fd = -1;
+	int       dir_fd = -1;
+
+	tmp = g_strdup_printf ("%s.XXXXXX", path);
+
+	fd = g_mkstemp_full (tmp, O_WRONLY | O_CLOEXEC,
+			CC_OCI_STATE_FILE_MODE);
+	if (fd < 0) {
+		g_critical ("failed to open %s: %s", tmp, strerror (errno));
+		return false;
+	}
+
+	while (done < len) {
+		bytes = write (fd, str + done, len - done);
+		if (bytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			g_critical ("failed to write %s: %s",
+					tmp, strerror (errno));
+			goto out;
+		}
+		done += (gsize)bytes;
+	}
+
+	if (sync != CC_OCI_STATE_SYNC_NONE && fsync (fd) < 0) {
+		g_critical ("failed to sync %s: %s", tmp, strerror (errno));
+		goto out;
+	}
+
+	if (close (fd) < 0) {
+		fd = -1;
+		g_critical ("failed to close %s: %s", tmp, strerror (errno));
+		goto out;
+	}
+	fd = -1;
+
+	if (rename (tmp, path) < 0) {
+		g_critical ("failed to rename %s to %s: %s",
+				tmp, path, strerror (errno));
+		goto out;
+	}
+
+	if (sync == CC_OCI_STATE_SYNC_FULL) {
+		dir_fd = open (config->state.runtime_path,
+				O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dir_fd < 0 || fsync (dir_fd) < 0) {
+			g_critical ("failed to sync %s: %s",
+					config->state.runtime_path,
+					strerror (errno));
+			close_if_set (dir_fd);
+			return false;
+		}
+		close (dir_fd);
+	}
+
+	g_debug ("wrote %lu bytes to %s in %ldus",
+			(unsigned long int)len, path,
+			(long int)(g_get_monotonic_time () - start));
+
+	return true;
+
+out:
+	close_if_set (fd);
+	(void)g_unlink (tmp);
+
+	return false;
+}
+
+/*!
+ * Rewrite selected fields of an existing state file, leaving the
+ * rest of its contents as-is.
+ *
+ * Used for lifecycle transitions which only change the status (or
+ * workload details) of a container, avoiding recreating the whole
+ * state from \p config.
+ *
+ * \param config \ref cc_oci_config.
+ * \param fields Bitmask of \c CC_OCI_STATE_UPDATE_* values specifying
+ *   which fields of \p config to write.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_state_file_update (struct cc_oci_config *config, guint fields)
+{
+	JsonParser  *parser = NULL;
+	JsonNode    *root;
+	JsonObject  *obj;
+	JsonObject  *process;
+	const gchar *status;
+	const gchar *created;
+	gchar       *str = NULL;
+	gsize        str_len = 0;
+	gboolean     result = false;
+
+	if (! (config && fields)) {
+		return false;
+	}
+
+	if (! config->state.state_file_path[0] &&
+			! cc_oci_state_file_get (config)) {
+		return false;
+	}
+
+	parser = cc_oci_json_load (config->state.state_file_path);
+	if (! parser) {
+		g_critical ("failed to read state file %s",
+				config->state.state_file_path);
+		return false;
+	}
+
+	root = json_parser_get_root (parser);
+	if (! JSON_NODE_HOLDS_OBJECT (root)) {
+		g_critical ("invalid state file %s",
+				config->state.state_file_path);
+		goto out;
+	}
+
+	obj = json_node_get_object (root);
+
+	if (fields & CC_OCI_STATE_UPDATE_STATUS) {
+		status = cc_oci_status_get (config);
+		if (! status) {
+			goto out;
+		}
+
+		json_object_set_string_member (obj, "status", status);
+	}
+
+	if (fields & CC_OCI_STATE_UPDATE_PID) {
+		json_object_set_int_member (obj, "pid",
+				(unsigned)config->state.workload_pid);
+	}
+
+	if (fields & CC_OCI_STATE_UPDATE_PROCESS) {
+		process = cc_oci_process_to_json (&config->oci.process);
+		if (! process) {
+			goto out;
+		}
+
+		json_object_set_object_member (obj, "process", process);
+	}
+
+	str = cc_oci_json_obj_to_string (obj, false, &str_len);
+	if (! str) {
+		goto out;
+	}
+
+	if (! cc_oci_state_file_write (config, str, str_len)) {
+		g_critical ("failed to update state file %s",
+				config->state.state_file_path);
+		goto out;
+	}
+
+	result = true;
+
+	created = json_object_has_member (obj, "created")
+		? json_object_get_string_member (obj, "created")
+		: NULL;
+
+	/* not fatal: "list" falls back to the state file */
+	(void)cc_oci_state_index_update (config, created);
+
+	g_debug ("updated state file %s", config->state.state_file_path);
+
+out:
+	g_object_unref (parser);
+	g_free_if_set (str);
+
+	return result;
+}
+
 /*!
  * Create the state file for the specified \p config.
  *
@@ -936,9 +1445,7 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 	JsonObject  *pod = NULL;
 	gchar       *str = NULL;
 	gsize        str_len = 0;
-	GError      *err = NULL;
 	const gchar *status;
-	gboolean     ret;
 	gboolean     result = false;
 
 	if (! (config && created_timestamp)) {
@@ -1149,22 +1656,23 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 	}
 
 	/* convert JSON to string */
-	str = cc_oci_json_obj_to_string (obj, true, &str_len);
+	str = cc_oci_json_obj_to_string (obj, false, &str_len);
 	if (! str) {
 		goto out;
 	}
 
 	/* Create state file */
-	ret = g_file_set_contents (config->state.state_file_path,
-			str, (gssize)str_len, &err);
-	if (ret) {
-		result = true;
-	} else {
-		g_critical ("failed to create state file %s: %s",
-				config->state.state_file_path, err->message);
-		g_error_free (err);
+	if (! cc_oci_state_file_write (config, str, str_len)) {
+		g_critical ("failed to create state file %s",
+				config->state.state_file_path);
+		goto out;
 	}
 
+	result = true;
+
+	/* not fatal: "list" falls back to the state file */
+	(void)cc_oci_state_index_update (config, created_timestamp);
+
 	g_debug ("created state file %s", config->state.state_file_path);
 
 out:
@@ -1191,7 +1699,13 @@ cc_oci_state_file_delete (const struct cc_oci_config *config)
 
 	g_debug ("deleting state file %s", config->state.state_file_path);
 
-	return g_unlink (config->state.state_file_path) == 0;
+	if (g_unlink (config->state.state_file_path) < 0) {
+		return false;
+	}
+
+	(void)cc_oci_state_index_remove (config);
+
+	return true;
 }
 
 /**
@@ -1257,3 +1771,30 @@ cc_oci_str_to_status (const char *str)
 
 	return OCI_STATUS_INVALID;
 }
+
+/**
+ * Convert a string into a \ref cc_oci_state_sync value.
+ *
+ * \param str One of "file", "none" or "full".
+ * \param[out] sync \ref cc_oci_state_sync.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_state_sync_from_str (const gchar *str, enum cc_oci_state_sync *sync)
+{
+	struct cc_oci_map  *p;
+
+	if (! (str && sync)) {
+		return false;
+	}
+
+	for (p = oci_state_sync_map; p && p->name; p++) {
+		if (! g_strcmp0 (str, p->name)) {
+			*sync = (enum cc_oci_state_sync)p->num;
+			return true;
+		}
+	}
+
+	return false;
+}
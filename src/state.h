@@ -21,15 +21,25 @@
 #ifndef _CC_OCI_STATE_H
 #define _CC_OCI_STATE_H
 
+/** Fields rewritten by cc_oci_state_file_update(). */
+#define CC_OCI_STATE_UPDATE_STATUS	(1 << 0)
+#define CC_OCI_STATE_UPDATE_PID		(1 << 1)
+#define CC_OCI_STATE_UPDATE_PROCESS	(1 << 2)
+
 gboolean cc_oci_state_file_get (struct cc_oci_config *config);
 struct oci_state *cc_oci_state_file_read (const char *file);
+struct oci_state *cc_oci_state_file_read_summary (const char *file);
 void cc_oci_state_free (struct oci_state *state);
 gboolean cc_oci_state_file_create (struct cc_oci_config *config,
 		const char *created_timestamp);
+gboolean cc_oci_state_file_update (struct cc_oci_config *config,
+		guint fields);
 gboolean cc_oci_state_file_delete (const struct cc_oci_config *config);
 gboolean cc_oci_state_file_exists (struct cc_oci_config *config);
 const char *cc_oci_status_to_str (enum oci_status status);
 enum oci_status cc_oci_str_to_status (const char *str);
 int cc_oci_status_length (void);
+gboolean cc_oci_state_sync_from_str (const gchar *str,
+		enum cc_oci_state_sync *sync);
 
 #endif /* _CC_OCI_STATE_H */
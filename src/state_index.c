@@ -0,0 +1,856 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Index of the containers below a runtime root directory.
+ *
+ * \ref CC_OCI_STATE_INDEX_FILE starts with a
+ * \ref cc_oci_state_index_header followed by one fixed-size
+ * \ref cc_oci_state_index_record per container, holding the values
+ * displayed by "list". Records are updated in place whenever a state
+ * file is written or deleted.
+ *
+ * The index is only an optimisation: each record stores the mtime and
+ * size of the state file it was built from, and containers whose
+ * record is missing or doesn't match their state file are read from
+ * \ref CC_OCI_STATE_FILE, after which the index is rewritten.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "common.h"
+#include "oci.h"
+#include "util.h"
+#include "state.h"
+#include "state_index.h"
+
+/** "CCSI" */
+#define CC_OCI_STATE_INDEX_MAGIC	0x43435349
+
+/** Bump whenever \ref cc_oci_state_index_record changes. */
+#define CC_OCI_STATE_INDEX_VERSION	1
+
+/** Record values did not fit, the state file must be read. */
+#define CC_OCI_STATE_INDEX_INCOMPLETE	(1 << 0)
+
+/** Container is part of a pod. */
+#define CC_OCI_STATE_INDEX_POD		(1 << 1)
+
+/** Container is a pod sandbox. */
+#define CC_OCI_STATE_INDEX_SANDBOX	(1 << 2)
+
+/** Container has a VM. */
+#define CC_OCI_STATE_INDEX_VM		(1 << 3)
+
+/** Number of records read at once when searching the index. */
+#define CC_OCI_STATE_INDEX_CHUNK	64
+
+/** Minimum number of directory entries for which
+ * cc_oci_state_index_list() uses a thread pool.
+ */
+#define CC_OCI_STATE_INDEX_PARALLEL_MIN	64
+
+struct cc_oci_state_index_header {
+	guint32  magic;
+	guint32  version;
+	guint32  record_size;
+	guint32  count;
+};
+
+struct cc_oci_state_index_record {
+	gchar    id[128];
+	gchar    bundle_path[512];
+	gchar    create_time[64];
+	gchar    hypervisor_path[256];
+	gchar    kernel_path[256];
+	gchar    image_path[256];
+	gint32   pid;
+	gint32   vm_pid;
+	gint32   status;
+	guint32  flags;
+
+	/** mtime and size of the state file the record matches */
+	gint64   state_mtime_sec;
+	gint64   state_mtime_nsec;
+	gint64   state_size;
+};
+
+/** Containers being listed by cc_oci_state_index_list(). */
+struct cc_oci_state_index_scan {
+	/** Runtime root directory. */
+	const gchar *root_dir;
+
+	/** Names of the entries of \ref root_dir. */
+	GPtrArray *names;
+
+	/** Copies of the index records by container id (read-only
+	 * during the scan).
+	 */
+	GHashTable *records;
+
+	/** State of each entry of \ref names (\c NULL if not a
+	 * container).
+	 */
+	struct oci_state **states;
+
+	/** Status of the state file of each entry of \ref states, from
+	 * before it was read.
+	 */
+	struct stat *stats;
+
+	/** Number of index records used. */
+	gint used;
+
+	/** Set if the index needs to be rebuilt. */
+	gint stale;
+};
+
+/*!
+ * Determine the root directory of the container described by
+ * \p config.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated root directory on success, else \c NULL.
+ */
+static gchar *
+cc_oci_state_index_root (const struct cc_oci_config *config)
+{
+	if (! (config && config->optarg_container_id &&
+				config->state.runtime_path[0])) {
+		return NULL;
+	}
+
+	return g_path_get_dirname (config->state.runtime_path);
+}
+
+/*!
+ * Take the index lock.
+ *
+ * \param root_dir Runtime root directory.
+ * \param operation \c LOCK_SH or \c LOCK_EX.
+ *
+ * \return Lock file descriptor on success, else \c -1.
+ */
+static int
+cc_oci_state_index_lock (const gchar *root_dir, int operation)
+{
+	g_autofree gchar *path = NULL;
+	int fd;
+
+	path = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_LOCK_FILE,
+			NULL);
+
+	fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC,
+			CC_OCI_STATE_INDEX_MODE);
+	if (fd < 0) {
+		g_debug ("failed to open %s: %s", path, strerror (errno));
+		return -1;
+	}
+
+	while (flock (fd, operation) < 0) {
+		if (errno != EINTR) {
+			g_debug ("failed to lock %s: %s", path,
+					strerror (errno));
+			close (fd);
+			return -1;
+		}
+	}
+
+	return fd;
+}
+
+/*!
+ * Copy \p src into a record field.
+ *
+ * \return \c true if \p src fits, else \c false.
+ */
+static gboolean
+cc_oci_state_index_copy (gchar *dest, gsize size, const gchar *src)
+{
+	if (! src) {
+		*dest = '\0';
+		return true;
+	}
+
+	return g_strlcpy (dest, src, size) < size;
+}
+
+/*!
+ * Fill an index record.
+ *
+ * \param[out] rec \ref cc_oci_state_index_record.
+ * \param st Status of the containers state file, from before the
+ *   other values were read from it.
+ * \param id Container id.
+ * \param pid Workload PID.
+ * \param status Container status.
+ * \param bundle_path Bundle path.
+ * \param create_time ISO 8601 creation timestamp.
+ * \param vm \ref cc_oci_vm_cfg.
+ * \param pod \ref cc_pod, or \c NULL.
+ *
+ * \return \c true on success, \c false if the container cannot
+ * be indexed.
+ */
+static gboolean
+cc_oci_state_index_record_fill (struct cc_oci_state_index_record *rec,
+		const struct stat *st,
+		const gchar *id,
+		GPid pid,
+		enum oci_status status,
+		const gchar *bundle_path,
+		const gchar *create_time,
+		const struct cc_oci_vm_cfg *vm,
+		const struct cc_pod *pod)
+{
+	gboolean complete;
+
+	memset (rec, 0, sizeof (*rec));
+
+	if (! (id && *id && cc_oci_state_index_copy (rec->id,
+					sizeof (rec->id), id))) {
+		return false;
+	}
+
+	rec->state_mtime_sec = (gint64)st->st_mtim.tv_sec;
+	rec->state_mtime_nsec = (gint64)st->st_mtim.tv_nsec;
+	rec->state_size = (gint64)st->st_size;
+
+	rec->pid = (gint32)pid;
+	rec->status = (gint32)status;
+
+	complete = cc_oci_state_index_copy (rec->bundle_path,
+			sizeof (rec->bundle_path), bundle_path);
+	complete &= cc_oci_state_index_copy (rec->create_time,
+			sizeof (rec->create_time), create_time);
+
+	if (vm) {
+		rec->flags |= CC_OCI_STATE_INDEX_VM;
+		rec->vm_pid = (gint32)vm->pid;
+		complete &= cc_oci_state_index_copy (rec->hypervisor_path,
+				sizeof (rec->hypervisor_path),
+				vm->hypervisor_path);
+		complete &= cc_oci_state_index_copy (rec->kernel_path,
+				sizeof (rec->kernel_path),
+				vm->kernel_path);
+		complete &= cc_oci_state_index_copy (rec->image_path,
+				sizeof (rec->image_path),
+				vm->image_path);
+	}
+
+	if (! complete) {
+		rec->flags |= CC_OCI_STATE_INDEX_INCOMPLETE;
+	}
+
+	if (pod) {
+		rec->flags |= CC_OCI_STATE_INDEX_POD;
+		if (pod->sandbox) {
+			rec->flags |= CC_OCI_STATE_INDEX_SANDBOX;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * Determine if \p hdr is a valid header for an index of \p size bytes.
+ *
+ * \return \c true if valid, else \c false.
+ */
+static gboolean
+cc_oci_state_index_header_valid (const struct cc_oci_state_index_header *hdr,
+		gsize size)
+{
+	return hdr->magic == CC_OCI_STATE_INDEX_MAGIC &&
+		hdr->version == CC_OCI_STATE_INDEX_VERSION &&
+		hdr->record_size == sizeof (struct cc_oci_state_index_record) &&
+		size == sizeof (*hdr) +
+			(gsize)hdr->count * sizeof (struct cc_oci_state_index_record);
+}
+
+/*!
+ * Offset of record \p i in the index.
+ */
+static off_t
+cc_oci_state_index_offset (guint32 i)
+{
+	return (off_t)(sizeof (struct cc_oci_state_index_header) +
+		(gsize)i * sizeof (struct cc_oci_state_index_record));
+}
+
+/*!
+ * Find the record for container \p id.
+ *
+ * \param fd Index file descriptor.
+ * \param count Number of records.
+ * \param id Container id.
+ *
+ * \return Record number if found, else \c -1.
+ */
+static gint64
+cc_oci_state_index_find (int fd, guint32 count, const gchar *id)
+{
+	struct cc_oci_state_index_record recs[CC_OCI_STATE_INDEX_CHUNK];
+	guint32  i;
+	guint32  n;
+	ssize_t  bytes;
+
+	for (i = 0; i < count; i += n) {
+		n = MIN (count - i, CC_OCI_STATE_INDEX_CHUNK);
+
+		bytes = pread (fd, recs, n * sizeof (recs[0]),
+				cc_oci_state_index_offset (i));
+		if (bytes != (ssize_t)(n * sizeof (recs[0]))) {
+			return -1;
+		}
+
+		for (guint32 j = 0; j < n; j++) {
+			if (! strncmp (recs[j].id, id, sizeof (recs[j].id))) {
+				return (gint64)(i + j);
+			}
+		}
+	}
+
+	return -1;
+}
+
+/*!
+ * Add, replace or remove the record of a container.
+ *
+ * \param root_dir Runtime root directory.
+ * \param id Container id.
+ * \param rec Record to store, or \c NULL to remove the container.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_state_index_write (const gchar *root_dir, const gchar *id,
+		const struct cc_oci_state_index_record *rec)
+{
+	g_autofree gchar *path = NULL;
+	struct cc_oci_state_index_header  hdr = { 0 };
+	struct cc_oci_state_index_record  last;
+	struct stat  st;
+	gint64       i;
+	int          lock_fd;
+	int          fd = -1;
+	gboolean     ret = false;
+
+	if (! root_dir) {
+		return false;
+	}
+
+	lock_fd = cc_oci_state_index_lock (root_dir, LOCK_EX);
+	if (lock_fd < 0) {
+		return false;
+	}
+
+	path = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_FILE, NULL);
+
+	fd = open (path, O_RDWR | O_CLOEXEC | (rec ? O_CREAT : 0),
+			CC_OCI_STATE_INDEX_MODE);
+	if (fd < 0 && ! rec && errno == ENOENT) {
+		/* nothing to remove */
+		ret = true;
+		goto out;
+	}
+
+	if (fd < 0 || fstat (fd, &st) < 0) {
+		goto out;
+	}
+
+	if (pread (fd, &hdr, sizeof (hdr), 0) != sizeof (hdr) ||
+			! cc_oci_state_index_header_valid (&hdr,
+				(gsize)st.st_size)) {
+		/* new or damaged index: start again, "list" will add
+		 * the missing containers.
+		 */
+		hdr.magic = CC_OCI_STATE_INDEX_MAGIC;
+		hdr.version = CC_OCI_STATE_INDEX_VERSION;
+		hdr.record_size = sizeof (struct cc_oci_state_index_record);
+		hdr.count = 0;
+
+		if (ftruncate (fd, cc_oci_state_index_offset (0)) < 0) {
+			goto out;
+		}
+	}
+
+	i = cc_oci_state_index_find (fd, hdr.count, id);
+
+	if (rec) {
+		if (i < 0) {
+			i = hdr.count++;
+		}
+
+		if (pwrite (fd, rec, sizeof (*rec),
+				cc_oci_state_index_offset ((guint32)i))
+				!= sizeof (*rec)) {
+			goto out;
+		}
+	} else if (i >= 0) {
+		/* move the last record into the free slot */
+		if ((guint32)i != hdr.count - 1) {
+			if (pread (fd, &last, sizeof (last),
+					cc_oci_state_index_offset (hdr.count - 1))
+					!= sizeof (last)) {
+				goto out;
+			}
+			if (pwrite (fd, &last, sizeof (last),
+					cc_oci_state_index_offset ((guint32)i))
+					!= sizeof (last)) {
+				goto out;
+			}
+		}
+
+		hdr.count--;
+	}
+
+	if (pwrite (fd, &hdr, sizeof (hdr), 0) != sizeof (hdr)) {
+		goto out;
+	}
+
+	if (ftruncate (fd, cc_oci_state_index_offset (hdr.count)) < 0) {
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	if (! ret) {
+		g_warning ("failed to update state index %s: %s",
+				path, strerror (errno));
+	}
+
+	close_if_set (fd);
+	close (lock_fd);
+
+	return ret;
+}
+
+/*!
+ * Add or update the index record for the container described by
+ * \p config, after its state file has been written.
+ *
+ * \param config \ref cc_oci_config.
+ * \param created_timestamp ISO 8601 timestamp for when VM Was created.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_state_index_update (const struct cc_oci_config *config,
+		const gchar *created_timestamp)
+{
+	g_autofree gchar *root_dir = NULL;
+	struct cc_oci_state_index_record rec;
+	struct stat st;
+
+	root_dir = cc_oci_state_index_root (config);
+	if (! root_dir) {
+		return false;
+	}
+
+	if (stat (config->state.state_file_path, &st) < 0 ||
+			! cc_oci_state_index_record_fill (&rec, &st,
+				config->optarg_container_id,
+				config->state.workload_pid,
+				config->state.status,
+				config->bundle_path,
+				created_timestamp,
+				config->vm,
+				config->pod)) {
+		/* make sure an out of date record isn't used */
+		return cc_oci_state_index_remove (config);
+	}
+
+	return cc_oci_state_index_write (root_dir,
+			config->optarg_container_id, &rec);
+}
+
+/*!
+ * Remove the index record for the container described by \p config.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_state_index_remove (const struct cc_oci_config *config)
+{
+	g_autofree gchar *root_dir = NULL;
+
+	root_dir = cc_oci_state_index_root (config);
+	if (! root_dir) {
+		return false;
+	}
+
+	return cc_oci_state_index_write (root_dir,
+			config->optarg_container_id, NULL);
+}
+
+/*!
+ * Rewrite the index from the specified states.
+ *
+ * The index lock is not held while the states are read, so a state
+ * file may have been rewritten since. Such states are left out of
+ * the index, and will be read from their state file next time.
+ *
+ * \param root_dir Runtime root directory.
+ * \param states Array of \ref oci_state's (entries may be \c NULL).
+ * \param stats Status of the state file of each entry of \p states,
+ *   from before it was read.
+ * \param count Number of entries in \p states and \p stats.
+ *
+ * \return \c true on success, else \c false.
+ */
+private gboolean
+cc_oci_state_index_rebuild (const gchar *root_dir,
+		struct oci_state **states,
+		const struct stat *stats,
+		guint count)
+{
+	g_autofree gchar *path = NULL;
+	struct cc_oci_state_index_header  hdr = { 0 };
+	struct cc_oci_state_index_record  rec;
+	GByteArray  *data;
+	GError      *err = NULL;
+	struct stat  st;
+	int          lock_fd;
+	gboolean     ret;
+
+	if (! (root_dir && states && stats)) {
+		return false;
+	}
+
+	lock_fd = cc_oci_state_index_lock (root_dir, LOCK_EX);
+	if (lock_fd < 0) {
+		return false;
+	}
+
+	hdr.magic = CC_OCI_STATE_INDEX_MAGIC;
+	hdr.version = CC_OCI_STATE_INDEX_VERSION;
+	hdr.record_size = sizeof (struct cc_oci_state_index_record);
+
+	data = g_byte_array_new ();
+	g_byte_array_append (data, (const guint8 *)&hdr, sizeof (hdr));
+
+	for (guint i = 0; i < count; i++) {
+		const struct oci_state *state = states[i];
+		g_autofree gchar *state_file = NULL;
+
+		if (! state) {
+			continue;
+		}
+
+		state_file = g_build_path ("/", root_dir, state->id,
+				CC_OCI_STATE_FILE, NULL);
+
+		/* rewritten since it was read */
+		if (stat (state_file, &st) < 0 ||
+				st.st_mtim.tv_sec != stats[i].st_mtim.tv_sec ||
+				st.st_mtim.tv_nsec != stats[i].st_mtim.tv_nsec ||
+				st.st_size != stats[i].st_size) {
+			g_debug ("not indexing container %s: "
+					"state file has changed", state->id);
+			continue;
+		}
+
+		if (! cc_oci_state_index_record_fill (&rec, &st,
+					state->id, state->pid,
+					state->status,
+					state->bundle_path,
+					state->create_time,
+					state->vm, state->pod)) {
+			continue;
+		}
+
+		g_byte_array_append (data, (const guint8 *)&rec, sizeof (rec));
+		hdr.count++;
+	}
+
+	memcpy (data->data, &hdr, sizeof (hdr));
+
+	path = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_FILE, NULL);
+
+	ret = g_file_set_contents (path, (const gchar *)data->data,
+			(gssize)data->len, &err);
+	if (! ret) {
+		g_warning ("failed to write state index %s: %s",
+				path, err->message);
+		g_error_free (err);
+	} else {
+		g_debug ("rebuilt state index %s (%u containers)",
+				path, hdr.count);
+	}
+
+	g_byte_array_free (data, true);
+	close (lock_fd);
+
+	return ret;
+}
+
+/*!
+ * Create a \ref oci_state from an index record.
+ *
+ * \param rec \ref cc_oci_state_index_record.
+ *
+ * \return Newly-allocated \ref oci_state.
+ */
+static struct oci_state *
+cc_oci_state_index_record_to_state (const struct cc_oci_state_index_record *rec)
+{
+	struct oci_state *state;
+
+	state = g_new0 (struct oci_state, 1);
+
+	state->id = g_strndup (rec->id, sizeof (rec->id));
+	state->pid = (GPid)rec->pid;
+	state->status = (enum oci_status)rec->status;
+	state->bundle_path = g_strndup (rec->bundle_path,
+			sizeof (rec->bundle_path));
+	state->create_time = g_strndup (rec->create_time,
+			sizeof (rec->create_time));
+
+	if (rec->flags & CC_OCI_STATE_INDEX_VM) {
+		state->vm = g_new0 (struct cc_oci_vm_cfg, 1);
+		state->vm->pid = (GPid)rec->vm_pid;
+		g_strlcpy (state->vm->hypervisor_path, rec->hypervisor_path,
+				sizeof (state->vm->hypervisor_path));
+		g_strlcpy (state->vm->kernel_path, rec->kernel_path,
+				sizeof (state->vm->kernel_path));
+		g_strlcpy (state->vm->image_path, rec->image_path,
+				sizeof (state->vm->image_path));
+	}
+
+	if (rec->flags & CC_OCI_STATE_INDEX_POD) {
+		state->pod = g_new0 (struct cc_pod, 1);
+		state->pod->sandbox =
+			(rec->flags & CC_OCI_STATE_INDEX_SANDBOX) != 0;
+	}
+
+	return state;
+}
+
+/*!
+ * Get the state of a single container for cc_oci_state_index_list(),
+ * from its index record if that is up to date, else from its state
+ * file.
+ *
+ * Run from a thread pool when there are many containers.
+ *
+ * \param data Index of the container in
+ *   \ref cc_oci_state_index_scan.names, plus one.
+ * \param user_data \ref cc_oci_state_index_scan.
+ */
+static void
+cc_oci_state_index_scan_one (gpointer data, gpointer user_data)
+{
+	struct cc_oci_state_index_scan *scan = user_data;
+	const struct cc_oci_state_index_record *rec;
+	g_autofree gchar *state_file = NULL;
+	guint        i = GPOINTER_TO_UINT (data) - 1;
+	const gchar *name = g_ptr_array_index (scan->names, i);
+	struct stat  st;
+
+	state_file = g_build_path ("/", scan->root_dir, name,
+			CC_OCI_STATE_FILE, NULL);
+
+	/* not a container */
+	if (stat (state_file, &st) < 0) {
+		return;
+	}
+
+	rec = g_hash_table_lookup (scan->records, name);
+	if (rec &&
+			! (rec->flags & CC_OCI_STATE_INDEX_INCOMPLETE) &&
+			rec->state_mtime_sec == (gint64)st.st_mtim.tv_sec &&
+			rec->state_mtime_nsec == (gint64)st.st_mtim.tv_nsec &&
+			rec->state_size == (gint64)st.st_size) {
+		scan->states[i] = cc_oci_state_index_record_to_state (rec);
+		scan->stats[i] = st;
+		g_atomic_int_inc (&scan->used);
+		return;
+	}
+
+	scan->states[i] = cc_oci_state_file_read_summary (state_file);
+	if (scan->states[i]) {
+		scan->stats[i] = st;
+		g_atomic_int_set (&scan->stale, true);
+	}
+}
+
+/*!
+ * Get the state of all containers below \p root_dir.
+ *
+ * Containers with an up to date index record are listed from the
+ * index; only the fields needed to list the others are read from
+ * their state file, and the index is then rewritten. Directories are
+ * scanned by a pool of threads when there are many of them.
+ *
+ * Note that error checking has to be lax here since containers may
+ * be destroyed as this function runs.
+ *
+ * \param root_dir Runtime root directory.
+ *
+ * \return \c GSList of newly-allocated \ref oci_state's (may be
+ * \c NULL if there are no containers).
+ */
+GSList *
+cc_oci_state_index_list (const gchar *root_dir)
+{
+	g_autofree gchar *path = NULL;
+	const struct cc_oci_state_index_header *hdr = NULL;
+	const struct cc_oci_state_index_record *recs = NULL;
+	struct cc_oci_state_index_record *rec;
+	struct cc_oci_state_index_scan scan = { 0 };
+	GMappedFile  *map = NULL;
+	GThreadPool  *pool = NULL;
+	GDir         *dir = NULL;
+	GSList       *states = NULL;
+	const gchar  *name;
+	gboolean      indexed = false;
+	guint32       count = 0;
+	gint          threads;
+	int           lock_fd;
+
+	if (! root_dir) {
+		return NULL;
+	}
+
+	dir = g_dir_open (root_dir, 0x0, NULL);
+	if (! dir) {
+		/* No containers yet */
+		return NULL;
+	}
+
+	scan.root_dir = root_dir;
+	scan.names = g_ptr_array_new_with_free_func (g_free);
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		g_ptr_array_add (scan.names, g_strdup (name));
+	}
+
+	g_dir_close (dir);
+
+	/* keys point into the values, so must be replaced with them */
+	scan.records = g_hash_table_new_full (g_str_hash, g_str_equal,
+			NULL, g_free);
+	scan.states = g_new0 (struct oci_state *, scan.names->len);
+	scan.stats = g_new0 (struct stat, scan.names->len);
+
+	/* Records may be updated in place, so copy them under the lock.
+	 * It is released before scanning as reading the state files can
+	 * be slow, and updates would otherwise wait for it.
+	 */
+	lock_fd = cc_oci_state_index_lock (root_dir, LOCK_SH);
+
+	path = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_FILE, NULL);
+
+	map = lock_fd < 0 ? NULL : g_mapped_file_new (path, false, NULL);
+	if (map && g_mapped_file_get_length (map) >= sizeof (*hdr)) {
+		hdr = (const struct cc_oci_state_index_header *)
+			g_mapped_file_get_contents (map);
+
+		if (cc_oci_state_index_header_valid (hdr,
+					g_mapped_file_get_length (map))) {
+			recs = (const struct cc_oci_state_index_record *)(hdr + 1);
+			count = hdr->count;
+			indexed = true;
+
+			for (guint32 i = 0; i < count; i++) {
+				/* ids are nul terminated by record_fill */
+				if (recs[i].id[sizeof (recs[i].id) - 1]) {
+					continue;
+				}
+				rec = g_memdup (&recs[i], (guint)sizeof (*rec));
+				g_hash_table_replace (scan.records,
+						rec->id, rec);
+			}
+		}
+	}
+
+	if (map) {
+		g_mapped_file_unref (map);
+	}
+	if (lock_fd >= 0) {
+		close (lock_fd);
+	}
+
+	if (! indexed) {
+		scan.stale = true;
+	}
+
+	threads = (gint)g_get_num_processors ();
+
+	if (scan.names->len >= CC_OCI_STATE_INDEX_PARALLEL_MIN &&
+			threads > 1) {
+		pool = g_thread_pool_new (cc_oci_state_index_scan_one,
+				&scan, threads, false, NULL);
+	}
+
+	for (guint i = 0; i < scan.names->len; i++) {
+		gpointer data = GUINT_TO_POINTER (i + 1);
+
+		if (! (pool && g_thread_pool_push (pool, data, NULL))) {
+			cc_oci_state_index_scan_one (data, &scan);
+		}
+	}
+
+	if (pool) {
+		/* wait for all entries to be handled */
+		g_thread_pool_free (pool, false, true);
+	}
+
+	/* records of deleted containers */
+	if (indexed && (guint32)scan.used != count) {
+		scan.stale = true;
+	}
+
+	g_hash_table_destroy (scan.records);
+
+	if (scan.stale) {
+		(void)cc_oci_state_index_rebuild (root_dir, scan.states,
+				scan.stats, scan.names->len);
+	}
+
+	/* keep the directory order */
+	for (guint i = scan.names->len; i > 0; i--) {
+		if (scan.states[i - 1]) {
+			states = g_slist_prepend (states, scan.states[i - 1]);
+		}
+	}
+
+	g_free (scan.states);
+	g_free (scan.stats);
+	g_ptr_array_free (scan.names, true);
+
+	return states;
+}
@@ -0,0 +1,45 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_STATE_INDEX_H
+#define _CC_OCI_STATE_INDEX_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** File below the runtime root directory holding one fixed-size
+ * record per container, used to list containers without parsing
+ * every \ref CC_OCI_STATE_FILE.
+ */
+#define CC_OCI_STATE_INDEX_FILE		"state.index"
+
+/** Lock file serialising access to \ref CC_OCI_STATE_INDEX_FILE. */
+#define CC_OCI_STATE_INDEX_LOCK_FILE	".state.index.lock"
+
+/** Mode for \ref CC_OCI_STATE_INDEX_FILE. */
+#define CC_OCI_STATE_INDEX_MODE		0640
+
+gboolean cc_oci_state_index_update (const struct cc_oci_config *config,
+		const gchar *created_timestamp);
+gboolean cc_oci_state_index_remove (const struct cc_oci_config *config);
+GSList *cc_oci_state_index_list (const gchar *root_dir);
+
+#endif /* _CC_OCI_STATE_INDEX_H */
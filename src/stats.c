@@ -0,0 +1,1229 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Container resource usage statistics.
+ *
+ * Since a container runs in its own VM, the host can only account for
+ * the hypervisor process (its CPU time, memory, block I/O and the
+ * network interfaces of its namespace), plus the memory cgroup limit
+ * the container was created with. Where the agent in the VM allows
+ * the container's own cgroup files to be read, its values replace
+ * the host's approximations.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "oci.h"
+#include "util.h"
+#include "common.h"
+#include "pod.h"
+#include "proxy.h"
+#include "stats.h"
+
+/** Directory of the container's cgroups in the VM. */
+#define CC_OCI_STATS_GUEST_CGROUP_DIR "/sys/fs/cgroup"
+
+/** Names of \ref cc_oci_stat values. */
+static const gchar *cc_oci_stat_names[CC_OCI_STAT_COUNT] = {
+	[CC_OCI_STAT_CPU_TOTAL]          = "cpu_total",
+	[CC_OCI_STAT_CPU_KERNEL]         = "cpu_kernel",
+	[CC_OCI_STAT_CPU_USER]           = "cpu_user",
+	[CC_OCI_STAT_MEM_USAGE]          = "mem_usage",
+	[CC_OCI_STAT_MEM_MAX_USAGE]      = "mem_max_usage",
+	[CC_OCI_STAT_MEM_LIMIT]          = "mem_limit",
+	[CC_OCI_STAT_MEM_CACHE]          = "mem_cache",
+	[CC_OCI_STAT_MEM_FAILCNT]        = "mem_failcnt",
+	[CC_OCI_STAT_MEM_OOM_KILLS]      = "mem_oom_kills",
+	[CC_OCI_STAT_PIDS]               = "pids",
+	[CC_OCI_STAT_BLKIO_READ_BYTES]   = "blkio_read_bytes",
+	[CC_OCI_STAT_BLKIO_WRITE_BYTES]  = "blkio_write_bytes",
+	[CC_OCI_STAT_BLKIO_READS]        = "blkio_reads",
+	[CC_OCI_STAT_BLKIO_WRITES]       = "blkio_writes",
+	[CC_OCI_STAT_RESTORE_PAGES_FAULTED] = "restore_pages_faulted",
+	[CC_OCI_STAT_RESTORE_PAGES_TOTAL] = "restore_pages_total",
+};
+
+/** Names of \ref cc_oci_net_stat values (as used by Docker). */
+static const gchar *cc_oci_net_stat_names[CC_OCI_NET_STAT_COUNT] = {
+	[CC_OCI_NET_STAT_RX_BYTES]    = "rx_bytes",
+	[CC_OCI_NET_STAT_RX_PACKETS]  = "rx_packets",
+	[CC_OCI_NET_STAT_RX_ERRORS]   = "rx_errors",
+	[CC_OCI_NET_STAT_RX_DROPPED]  = "rx_dropped",
+	[CC_OCI_NET_STAT_TX_BYTES]    = "tx_bytes",
+	[CC_OCI_NET_STAT_TX_PACKETS]  = "tx_packets",
+	[CC_OCI_NET_STAT_TX_ERRORS]   = "tx_errors",
+	[CC_OCI_NET_STAT_TX_DROPPED]  = "tx_dropped",
+};
+
+/** Files read from the container's cgroups in the VM. */
+enum cc_oci_stats_guest_file {
+	GUEST_CPUACCT_USAGE,
+	GUEST_CPUACCT_STAT,
+	GUEST_MEMORY_USAGE,
+	GUEST_MEMORY_MAX_USAGE,
+	GUEST_MEMORY_FAILCNT,
+	GUEST_MEMORY_STAT,
+	GUEST_MEMORY_OOM_CONTROL,
+	GUEST_PIDS_CURRENT,
+
+	GUEST_FILE_COUNT
+};
+
+static const gchar *cc_oci_stats_guest_files[GUEST_FILE_COUNT + 1] = {
+	[GUEST_CPUACCT_USAGE]    = CC_OCI_STATS_GUEST_CGROUP_DIR "/cpuacct/cpuacct.usage",
+	[GUEST_CPUACCT_STAT]     = CC_OCI_STATS_GUEST_CGROUP_DIR "/cpuacct/cpuacct.stat",
+	[GUEST_MEMORY_USAGE]     = CC_OCI_STATS_GUEST_CGROUP_DIR "/memory/memory.usage_in_bytes",
+	[GUEST_MEMORY_MAX_USAGE] = CC_OCI_STATS_GUEST_CGROUP_DIR "/memory/memory.max_usage_in_bytes",
+	[GUEST_MEMORY_FAILCNT]   = CC_OCI_STATS_GUEST_CGROUP_DIR "/memory/memory.failcnt",
+	[GUEST_MEMORY_STAT]      = CC_OCI_STATS_GUEST_CGROUP_DIR "/memory/memory.stat",
+	[GUEST_MEMORY_OOM_CONTROL] = CC_OCI_STATS_GUEST_CGROUP_DIR "/memory/memory.oom_control",
+	[GUEST_PIDS_CURRENT]     = CC_OCI_STATS_GUEST_CGROUP_DIR "/pids/pids.current",
+
+	/* terminator */
+	[GUEST_FILE_COUNT]       = NULL
+};
+
+/*!
+ * Initialise \p stats.
+ *
+ * \param stats \ref cc_oci_stats.
+ */
+void
+cc_oci_stats_init (struct cc_oci_stats *stats)
+{
+	g_assert (stats);
+
+	memset (stats, 0, sizeof (*stats));
+
+	stats->percpu = g_array_new (false, true, sizeof (guint64));
+	stats->interfaces = g_array_new (false, true,
+			sizeof (struct cc_oci_net_stats));
+}
+
+/*!
+ * Free the resources held by \p stats.
+ *
+ * \param stats \ref cc_oci_stats.
+ */
+void
+cc_oci_stats_clear (struct cc_oci_stats *stats)
+{
+	if (! stats) {
+		return;
+	}
+
+	if (stats->percpu) {
+		g_array_free (stats->percpu, true);
+	}
+
+	if (stats->interfaces) {
+		g_array_free (stats->interfaces, true);
+	}
+
+	if (stats->memory_stat) {
+		g_hash_table_destroy (stats->memory_stat);
+	}
+
+	memset (stats, 0, sizeof (*stats));
+}
+
+/*!
+ * Get the name of \p stat.
+ *
+ * \param stat \ref cc_oci_stat.
+ *
+ * \return Name, or \c NULL if \p stat is invalid.
+ */
+const gchar *
+cc_oci_stat_name (enum cc_oci_stat stat)
+{
+	if (stat >= CC_OCI_STAT_COUNT) {
+		return NULL;
+	}
+
+	return cc_oci_stat_names[stat];
+}
+
+/*!
+ * Get the name of \p stat.
+ *
+ * \param stat \ref cc_oci_net_stat.
+ *
+ * \return Name, or \c NULL if \p stat is invalid.
+ */
+const gchar *
+cc_oci_net_stat_name (enum cc_oci_net_stat stat)
+{
+	if (stat >= CC_OCI_NET_STAT_COUNT) {
+		return NULL;
+	}
+
+	return cc_oci_net_stat_names[stat];
+}
+
+/*!
+ * Parse lines of the form "key value" or "key: value [kB]", as found
+ * in many /proc and cgroup files.
+ *
+ * \param contents Contents of file.
+ *
+ * \return Hash of keys to newly-allocated \c guint64 values (in bytes
+ * where a unit is specified).
+ */
+private GHashTable *
+cc_oci_stats_parse_keys (const gchar *contents)
+{
+	GHashTable  *table;
+	gchar      **lines;
+
+	table = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, g_free);
+
+	if (! contents) {
+		return table;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	for (gchar **line = lines; *line; line++) {
+		gchar    **fields;
+		gchar     *tokens[3] = { NULL };
+		guint      count = 0;
+		guint64   *value;
+		gsize      len;
+
+		fields = g_strsplit_set (*line, " \t", -1);
+
+		/* ignore the empty fields of repeated separators */
+		for (gchar **f = fields; *f && count < 3; f++) {
+			if (**f) {
+				tokens[count++] = *f;
+			}
+		}
+
+		if (count < 2) {
+			g_strfreev (fields);
+			continue;
+		}
+
+		len = strlen (tokens[0]);
+		if (tokens[0][len-1] == ':') {
+			tokens[0][len-1] = '\0';
+		}
+
+		value = g_new (guint64, 1);
+		*value = g_ascii_strtoull (tokens[1], NULL, 10);
+
+		if (! g_strcmp0 (tokens[2], "kB")) {
+			*value *= 1024;
+		}
+
+		g_hash_table_replace (table, g_strdup (tokens[0]), value);
+
+		g_strfreev (fields);
+	}
+
+	g_strfreev (lines);
+
+	return table;
+}
+
+/*!
+ * Look up \p key in a table created by cc_oci_stats_parse_keys().
+ *
+ * \param table \c GHashTable.
+ * \param key Name of value.
+ * \param[out] value Value of \p key.
+ *
+ * \return \c true if \p key exists, else \c false.
+ */
+static gboolean
+cc_oci_stats_lookup (GHashTable *table, const gchar *key, guint64 *value)
+{
+	guint64 *v;
+
+	v = g_hash_table_lookup (table, key);
+	if (! v) {
+		return false;
+	}
+
+	*value = *v;
+
+	return true;
+}
+
+/*!
+ * Read a /proc or cgroup file.
+ *
+ * \param path Full path to file.
+ *
+ * \return Newly-allocated contents, or \c NULL on error.
+ */
+static gchar *
+cc_oci_stats_read (const gchar *path)
+{
+	gchar *contents = NULL;
+
+	if (! g_file_get_contents (path, &contents, NULL, NULL)) {
+		return NULL;
+	}
+
+	return contents;
+}
+
+/*!
+ * Parse the contents of /proc/&lt;pid&gt;/smaps for the mappings of
+ * guest memory loaded on demand from a checkpoint image
+ * (\ref CC_OCI_CHECKPOINT_RAM_FILE).
+ *
+ * The pages of those mappings that are resident are the ones the
+ * guest has touched since the container was restored.
+ *
+ * \param contents Contents of file.
+ * \param[out] faulted Number of pages faulted in.
+ * \param[out] total Number of pages mapped.
+ *
+ * \return \c true if guest memory is mapped from a checkpoint image,
+ * else \c false.
+ */
+private gboolean
+cc_oci_stats_parse_restore_smaps (const gchar *contents,
+		guint64 *faulted, guint64 *total)
+{
+	gchar    **lines;
+	gboolean   found = false;
+	gboolean   mapping = false;
+	guint64    rss = 0;
+	guint64    size = 0;
+	long       page_size;
+
+	if (! (contents && faulted && total)) {
+		return false;
+	}
+
+	page_size = sysconf (_SC_PAGESIZE);
+	if (page_size <= 0) {
+		return false;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	for (gchar **line = lines; *line; line++) {
+		gchar  **fields;
+		gchar   *key;
+		gchar   *path;
+
+		fields = g_strsplit_set (*line, " \t", 2);
+		key = fields[0];
+
+		if (! (key && *key)) {
+			g_strfreev (fields);
+			continue;
+		}
+
+		if (! g_str_has_suffix (key, ":")) {
+			/* "start-end perms offset dev inode [path]" starts
+			 * a new mapping.
+			 */
+			const gchar *deleted = " (deleted)";
+
+			path = strchr (*line, '/');
+			if (path && g_str_has_suffix (path, deleted)) {
+				path[strlen (path) - strlen (deleted)] = '\0';
+			}
+
+			mapping = path && g_str_has_suffix (path,
+					"/" CC_OCI_CHECKPOINT_RAM_FILE);
+			found = found || mapping;
+		} else if (mapping && fields[1]) {
+			guint64 value = g_ascii_strtoull (g_strchug (fields[1]),
+					NULL, 10) * 1024;
+
+			if (! g_strcmp0 (key, "Size:")) {
+				size += value;
+			} else if (! g_strcmp0 (key, "Rss:")) {
+				rss += value;
+			}
+		}
+
+		g_strfreev (fields);
+	}
+
+	g_strfreev (lines);
+
+	if (! found) {
+		return false;
+	}
+
+	*faulted = rss / (guint64)page_size;
+	*total = size / (guint64)page_size;
+
+	return true;
+}
+
+/*!
+ * Parse the contents of /proc/&lt;pid&gt;/stat.
+ *
+ * \param contents Contents of file.
+ * \param[out] utime User-mode CPU time (ns).
+ * \param[out] stime Kernel-mode CPU time (ns).
+ * \param[out] threads Number of threads.
+ *
+ * \return \c true on success, else \c false.
+ */
+private gboolean
+cc_oci_stats_parse_proc_stat (const gchar *contents, guint64 *utime,
+		guint64 *stime, guint64 *threads)
+{
+	/* fields after the command name (which may contain spaces),
+	 * counting from "state" (field 3 in proc(5)).
+	 */
+	const guint   utime_field = 14 - 3;
+	const guint   stime_field = 15 - 3;
+	const guint   threads_field = 20 - 3;
+	const gchar  *p;
+	gchar       **fields;
+	gboolean      ret = false;
+	guint64       ns_per_tick;
+	long          ticks;
+
+	if (! contents) {
+		return false;
+	}
+
+	p = strrchr (contents, ')');
+	if (! p || p[1] != ' ') {
+		return false;
+	}
+
+	ticks = sysconf (_SC_CLK_TCK);
+	if (ticks <= 0) {
+		return false;
+	}
+
+	ns_per_tick = (guint64)(G_USEC_PER_SEC * 1000 / ticks);
+
+	fields = g_strsplit (p + 2, " ", -1);
+
+	if (g_strv_length (fields) <= threads_field) {
+		goto out;
+	}
+
+	*utime = g_ascii_strtoull (fields[utime_field], NULL, 10) * ns_per_tick;
+	*stime = g_ascii_strtoull (fields[stime_field], NULL, 10) * ns_per_tick;
+	*threads = g_ascii_strtoull (fields[threads_field], NULL, 10);
+
+	ret = true;
+
+out:
+	g_strfreev (fields);
+
+	return ret;
+}
+
+/*!
+ * Collect the CPU time of each virtual CPU thread of the hypervisor
+ * (named "CPU &lt;n&gt;/KVM" by QEMU).
+ *
+ * \param pid Process ID of hypervisor.
+ * \param stats \ref cc_oci_stats.
+ */
+static void
+cc_oci_stats_get_percpu (GPid pid, struct cc_oci_stats *stats)
+{
+	g_autofree gchar *task_dir = NULL;
+	const gchar      *name;
+	GDir             *dir;
+
+	task_dir = g_strdup_printf ("/proc/%d/task", (int)pid);
+
+	dir = g_dir_open (task_dir, 0, NULL);
+	if (! dir) {
+		return;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *comm_path = NULL;
+		g_autofree gchar *comm = NULL;
+		g_autofree gchar *stat_path = NULL;
+		g_autofree gchar *stat = NULL;
+		guint64           cpu;
+		guint64           utime;
+		guint64           stime;
+		guint64           threads;
+		guint64           total;
+		gchar            *end;
+
+		comm_path = g_strdup_printf ("%s/%s/comm", task_dir, name);
+		comm = cc_oci_stats_read (comm_path);
+		if (! (comm && g_str_has_prefix (comm, "CPU "))) {
+			continue;
+		}
+
+		cpu = g_ascii_strtoull (comm + strlen ("CPU "), &end, 10);
+		if (end == comm + strlen ("CPU ") || *end != '/') {
+			continue;
+		}
+
+		stat_path = g_strdup_printf ("%s/%s/stat", task_dir, name);
+		stat = cc_oci_stats_read (stat_path);
+		if (! cc_oci_stats_parse_proc_stat (stat, &utime, &stime,
+					&threads)) {
+			continue;
+		}
+
+		if (cpu >= stats->percpu->len) {
+			g_array_set_size (stats->percpu, (guint)cpu + 1);
+		}
+
+		total = utime + stime;
+		g_array_index (stats->percpu, guint64, cpu) = total;
+	}
+
+	g_dir_close (dir);
+}
+
+/*!
+ * Parse the contents of /proc/&lt;pid&gt;/net/dev.
+ *
+ * \param contents Contents of file.
+ * \param stats \ref cc_oci_stats.
+ */
+private void
+cc_oci_stats_parse_net_dev (const gchar *contents,
+		struct cc_oci_stats *stats)
+{
+	/* columns of /proc/net/dev for each \ref cc_oci_net_stat */
+	const guint columns[CC_OCI_NET_STAT_COUNT] = {
+		[CC_OCI_NET_STAT_RX_BYTES]    = 0,
+		[CC_OCI_NET_STAT_RX_PACKETS]  = 1,
+		[CC_OCI_NET_STAT_RX_ERRORS]   = 2,
+		[CC_OCI_NET_STAT_RX_DROPPED]  = 3,
+		[CC_OCI_NET_STAT_TX_BYTES]    = 8,
+		[CC_OCI_NET_STAT_TX_PACKETS]  = 9,
+		[CC_OCI_NET_STAT_TX_ERRORS]   = 10,
+		[CC_OCI_NET_STAT_TX_DROPPED]  = 11,
+	};
+	gchar **lines;
+
+	if (! contents) {
+		return;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	for (gchar **line = lines; *line; line++) {
+		struct cc_oci_net_stats   iface = { { 0 } };
+		gchar                   **fields;
+		gchar                    *sep;
+		guint                     count = 0;
+		guint64                   values[16] = { 0 };
+
+		/* header lines don't contain "<name>:" */
+		sep = strchr (*line, ':');
+		if (! sep) {
+			continue;
+		}
+
+		*sep = '\0';
+		g_strlcpy (iface.name, g_strstrip (*line), sizeof (iface.name));
+
+		if (! g_strcmp0 (iface.name, "lo")) {
+			continue;
+		}
+
+		fields = g_strsplit_set (sep + 1, " \t", -1);
+
+		for (gchar **f = fields; *f && count < G_N_ELEMENTS (values); f++) {
+			if (**f) {
+				values[count++] = g_ascii_strtoull (*f, NULL, 10);
+			}
+		}
+
+		g_strfreev (fields);
+
+		if (count <= columns[CC_OCI_NET_STAT_TX_DROPPED]) {
+			continue;
+		}
+
+		for (guint i = 0; i < CC_OCI_NET_STAT_COUNT; i++) {
+			iface.values[i] = values[columns[i]];
+		}
+
+		g_array_append_val (stats->interfaces, iface);
+	}
+
+	g_strfreev (lines);
+}
+
+/*!
+ * Collect host-side statistics for the hypervisor process.
+ *
+ * \param pid Process ID of hypervisor.
+ * \param cgroups_path Path of the container's cgroups below
+ *   \ref CGROUP_MEM_DIR (or \c NULL).
+ * \param stats \ref cc_oci_stats to update.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_stats_get_host (GPid pid, const gchar *cgroups_path,
+		struct cc_oci_stats *stats)
+{
+	g_autofree gchar *path = NULL;
+	g_autofree gchar *contents = NULL;
+	GHashTable       *table;
+	guint64           utime = 0;
+	guint64           stime = 0;
+	guint64           value;
+	guint64          *values;
+
+	if (! (pid > 0 && stats)) {
+		return false;
+	}
+
+	values = stats->values;
+
+	path = g_strdup_printf ("/proc/%d/stat", (int)pid);
+	contents = cc_oci_stats_read (path);
+	if (! cc_oci_stats_parse_proc_stat (contents, &utime, &stime,
+				&values[CC_OCI_STAT_PIDS])) {
+		g_critical ("failed to read stats for pid %d", (int)pid);
+		return false;
+	}
+
+	values[CC_OCI_STAT_CPU_USER] = utime;
+	values[CC_OCI_STAT_CPU_KERNEL] = stime;
+	values[CC_OCI_STAT_CPU_TOTAL] = utime + stime;
+
+	cc_oci_stats_get_percpu (pid, stats);
+
+	/* memory: smaps_rollup is much cheaper than smaps, but only
+	 * available on newer kernels.
+	 */
+	g_free (path);
+	g_free (contents);
+	path = g_strdup_printf ("/proc/%d/smaps_rollup", (int)pid);
+	contents = cc_oci_stats_read (path);
+	if (contents) {
+		guint64 anonymous = 0;
+
+		table = cc_oci_stats_parse_keys (contents);
+
+		if (cc_oci_stats_lookup (table, "Rss", &value)) {
+			values[CC_OCI_STAT_MEM_USAGE] = value;
+		}
+
+		if (cc_oci_stats_lookup (table, "Anonymous", &anonymous) &&
+				anonymous <= values[CC_OCI_STAT_MEM_USAGE]) {
+			values[CC_OCI_STAT_MEM_CACHE] =
+				values[CC_OCI_STAT_MEM_USAGE] - anonymous;
+		}
+
+		g_hash_table_destroy (table);
+	}
+
+	g_free (path);
+	g_free (contents);
+	path = g_strdup_printf ("/proc/%d/status", (int)pid);
+	contents = cc_oci_stats_read (path);
+	if (contents) {
+		table = cc_oci_stats_parse_keys (contents);
+
+		if (! values[CC_OCI_STAT_MEM_USAGE] &&
+				cc_oci_stats_lookup (table, "VmRSS", &value)) {
+			values[CC_OCI_STAT_MEM_USAGE] = value;
+		}
+
+		if (cc_oci_stats_lookup (table, "VmHWM", &value)) {
+			values[CC_OCI_STAT_MEM_MAX_USAGE] = value;
+		}
+
+		g_hash_table_destroy (table);
+	}
+
+	/* guest memory loaded on demand (smaps is only read when the
+	 * much smaller maps shows it is needed)
+	 */
+	g_free (path);
+	g_free (contents);
+	path = g_strdup_printf ("/proc/%d/maps", (int)pid);
+	contents = cc_oci_stats_read (path);
+	if (contents && strstr (contents, "/" CC_OCI_CHECKPOINT_RAM_FILE)) {
+		g_free (path);
+		g_free (contents);
+		path = g_strdup_printf ("/proc/%d/smaps", (int)pid);
+		contents = cc_oci_stats_read (path);
+		(void)cc_oci_stats_parse_restore_smaps (contents,
+				&values[CC_OCI_STAT_RESTORE_PAGES_FAULTED],
+				&values[CC_OCI_STAT_RESTORE_PAGES_TOTAL]);
+	}
+
+	/* block I/O */
+	g_free (path);
+	g_free (contents);
+	path = g_strdup_printf ("/proc/%d/io", (int)pid);
+	contents = cc_oci_stats_read (path);
+	if (contents) {
+		table = cc_oci_stats_parse_keys (contents);
+
+		(void)cc_oci_stats_lookup (table, "read_bytes",
+				&values[CC_OCI_STAT_BLKIO_READ_BYTES]);
+		(void)cc_oci_stats_lookup (table, "write_bytes",
+				&values[CC_OCI_STAT_BLKIO_WRITE_BYTES]);
+		(void)cc_oci_stats_lookup (table, "syscr",
+				&values[CC_OCI_STAT_BLKIO_READS]);
+		(void)cc_oci_stats_lookup (table, "syscw",
+				&values[CC_OCI_STAT_BLKIO_WRITES]);
+
+		g_hash_table_destroy (table);
+	}
+
+	/* network interfaces of the hypervisor's namespace */
+	g_free (path);
+	g_free (contents);
+	path = g_strdup_printf ("/proc/%d/net/dev", (int)pid);
+	contents = cc_oci_stats_read (path);
+	cc_oci_stats_parse_net_dev (contents, stats);
+
+	/* the limit the container was created with */
+	if (cgroups_path) {
+		g_free (path);
+		g_free (contents);
+		path = g_strdup_printf ("%s/%s/memory.limit_in_bytes",
+				CGROUP_MEM_DIR, cgroups_path);
+		contents = cc_oci_stats_read (path);
+		if (contents) {
+			values[CC_OCI_STAT_MEM_LIMIT] =
+				g_ascii_strtoull (contents, NULL, 10);
+		}
+
+		g_free (path);
+		g_free (contents);
+		path = g_strdup_printf ("%s/%s/memory.failcnt",
+				CGROUP_MEM_DIR, cgroups_path);
+		contents = cc_oci_stats_read (path);
+		if (contents) {
+			values[CC_OCI_STAT_MEM_FAILCNT] =
+				g_ascii_strtoull (contents, NULL, 10);
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * Collect statistics for the container's cgroups in the VM,
+ * replacing the host-side values.
+ *
+ * \param config \ref cc_oci_config.
+ * \param stats \ref cc_oci_stats to update.
+ *
+ * \return \c true if any guest statistics were available,
+ * else \c false.
+ */
+gboolean
+cc_oci_stats_get_guest (struct cc_oci_config *config,
+		struct cc_oci_stats *stats)
+{
+	gchar     *contents[GUEST_FILE_COUNT] = { NULL };
+	guint64   *values;
+	gboolean   ret = false;
+	guint64    value;
+
+	if (! (config && stats)) {
+		return false;
+	}
+
+	values = stats->values;
+
+	if (! cc_proxy_hyper_read_files (config,
+				cc_oci_stats_guest_files, contents)) {
+		return false;
+	}
+
+	if (contents[GUEST_CPUACCT_USAGE]) {
+		values[CC_OCI_STAT_CPU_TOTAL] =
+			g_ascii_strtoull (contents[GUEST_CPUACCT_USAGE],
+					NULL, 10);
+		ret = true;
+	}
+
+	if (contents[GUEST_CPUACCT_STAT]) {
+		GHashTable *table;
+		long        ticks = sysconf (_SC_CLK_TCK);
+		guint64     ns_per_tick;
+
+		ns_per_tick = ticks > 0 ?
+			(guint64)(G_USEC_PER_SEC * 1000 / ticks) : 0;
+
+		table = cc_oci_stats_parse_keys (contents[GUEST_CPUACCT_STAT]);
+
+		if (cc_oci_stats_lookup (table, "user", &value)) {
+			values[CC_OCI_STAT_CPU_USER] = value * ns_per_tick;
+		}
+
+		if (cc_oci_stats_lookup (table, "system", &value)) {
+			values[CC_OCI_STAT_CPU_KERNEL] = value * ns_per_tick;
+		}
+
+		g_hash_table_destroy (table);
+		ret = true;
+	}
+
+	if (contents[GUEST_MEMORY_USAGE]) {
+		values[CC_OCI_STAT_MEM_USAGE] =
+			g_ascii_strtoull (contents[GUEST_MEMORY_USAGE],
+					NULL, 10);
+		ret = true;
+	}
+
+	if (contents[GUEST_MEMORY_MAX_USAGE]) {
+		values[CC_OCI_STAT_MEM_MAX_USAGE] =
+			g_ascii_strtoull (contents[GUEST_MEMORY_MAX_USAGE],
+					NULL, 10);
+	}
+
+	if (contents[GUEST_MEMORY_FAILCNT]) {
+		values[CC_OCI_STAT_MEM_FAILCNT] =
+			g_ascii_strtoull (contents[GUEST_MEMORY_FAILCNT],
+					NULL, 10);
+	}
+
+	if (contents[GUEST_MEMORY_STAT]) {
+		if (stats->memory_stat) {
+			g_hash_table_destroy (stats->memory_stat);
+		}
+
+		stats->memory_stat =
+			cc_oci_stats_parse_keys (contents[GUEST_MEMORY_STAT]);
+
+		(void)cc_oci_stats_lookup (stats->memory_stat, "cache",
+				&values[CC_OCI_STAT_MEM_CACHE]);
+		ret = true;
+	}
+
+	/* "oom_kill" is only reported by newer kernels */
+	if (contents[GUEST_MEMORY_OOM_CONTROL]) {
+		GHashTable *table;
+
+		table = cc_oci_stats_parse_keys (
+				contents[GUEST_MEMORY_OOM_CONTROL]);
+
+		(void)cc_oci_stats_lookup (table, "oom_kill",
+				&values[CC_OCI_STAT_MEM_OOM_KILLS]);
+
+		g_hash_table_destroy (table);
+	}
+
+	if (contents[GUEST_PIDS_CURRENT]) {
+		values[CC_OCI_STAT_PIDS] =
+			g_ascii_strtoull (contents[GUEST_PIDS_CURRENT],
+					NULL, 10);
+	}
+
+	for (guint i = 0; i < GUEST_FILE_COUNT; i++) {
+		g_free_if_set (contents[i]);
+	}
+
+	return ret;
+}
+
+/*!
+ * Collect the statistics of a running container.
+ *
+ * \param config \ref cc_oci_config.
+ * \param state \ref oci_state.
+ * \param stats \ref cc_oci_stats (initialised by
+ *   cc_oci_stats_init()).
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_stats_get (struct cc_oci_config *config,
+		const struct oci_state *state, struct cc_oci_stats *stats)
+{
+	static gboolean  warned = false;
+	gboolean         have_host = false;
+	gboolean         have_guest = false;
+
+	if (! (config && state && stats)) {
+		return false;
+	}
+
+	/* Containers sharing a pod VM have no hypervisor of their own,
+	 * so only the guest can account for them.
+	 */
+	if (state->vm && state->vm->pid > 0) {
+		have_host = cc_oci_stats_get_host (state->vm->pid,
+				config->oci.oci_linux.cgroupsPath, stats);
+	}
+
+	if (config->proxy) {
+		have_guest = cc_oci_stats_get_guest (config, stats);
+	}
+
+	/* The guest files are read as optional so that stats keep
+	 * working with agents and proxies (older than protocol version 5)
+	 * that cannot return them, but the host values are only
+	 * approximations so say so, once per process rather than for
+	 * each sample.
+	 */
+	if (config->proxy && ! have_guest) {
+		if (! warned) {
+			g_warning ("no guest stats for container %s, "
+					"reporting host approximations",
+					config->optarg_container_id);
+			warned = true;
+		} else {
+			g_debug ("no guest stats for container %s",
+					config->optarg_container_id);
+		}
+	}
+
+	return have_host || have_guest;
+}
+
+/*!
+ * Convert \p stats to the format used by "runc events --stats"
+ * (a libcontainer \c Stats object).
+ *
+ * \param stats \ref cc_oci_stats.
+ *
+ * \return Newly-allocated \c JsonObject.
+ */
+JsonObject *
+cc_oci_stats_to_json (const struct cc_oci_stats *stats)
+{
+	const guint64  *values;
+	JsonObject     *data;
+	JsonObject     *cgroup_stats;
+	JsonObject     *cpu_stats;
+	JsonObject     *cpu_usage;
+	JsonObject     *memory_stats;
+	JsonObject     *memory_usage;
+	JsonObject     *memory_stat;
+	JsonObject     *pids_stats;
+	JsonObject     *blkio_stats;
+	JsonArray      *percpu;
+	JsonArray      *service_bytes;
+	JsonArray      *serviced;
+	JsonArray      *interfaces;
+
+	g_assert (stats);
+
+	values = stats->values;
+
+	data = json_object_new ();
+	cgroup_stats = json_object_new ();
+
+	/* cpu */
+	cpu_stats = json_object_new ();
+	cpu_usage = json_object_new ();
+	percpu = json_array_new ();
+
+	json_object_set_int_member (cpu_usage, "total_usage",
+			(gint64)values[CC_OCI_STAT_CPU_TOTAL]);
+
+	for (guint i = 0; stats->percpu && i < stats->percpu->len; i++) {
+		json_array_add_int_element (percpu,
+			(gint64)g_array_index (stats->percpu, guint64, i));
+	}
+
+	json_object_set_array_member (cpu_usage, "percpu_usage", percpu);
+	json_object_set_int_member (cpu_usage, "usage_in_kernelmode",
+			(gint64)values[CC_OCI_STAT_CPU_KERNEL]);
+	json_object_set_int_member (cpu_usage, "usage_in_usermode",
+			(gint64)values[CC_OCI_STAT_CPU_USER]);
+	json_object_set_object_member (cpu_stats, "cpu_usage", cpu_usage);
+	json_object_set_object_member (cgroup_stats, "cpu_stats", cpu_stats);
+
+	/* memory */
+	memory_stats = json_object_new ();
+	memory_usage = json_object_new ();
+	memory_stat = json_object_new ();
+
+	json_object_set_int_member (memory_usage, "usage",
+			(gint64)values[CC_OCI_STAT_MEM_USAGE]);
+	json_object_set_int_member (memory_usage, "max_usage",
+			(gint64)values[CC_OCI_STAT_MEM_MAX_USAGE]);
+	json_object_set_int_member (memory_usage, "failcnt",
+			(gint64)values[CC_OCI_STAT_MEM_FAILCNT]);
+	json_object_set_int_member (memory_usage, "limit",
+			(gint64)values[CC_OCI_STAT_MEM_LIMIT]);
+
+	if (stats->memory_stat) {
+		GHashTableIter  iter;
+		gpointer        key;
+		gpointer        value;
+
+		g_hash_table_iter_init (&iter, stats->memory_stat);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			json_object_set_int_member (memory_stat, key,
+					(gint64)*(guint64 *)value);
+		}
+	}
+
+	/* not part of the libcontainer format, so only shown when set */
+	if (values[CC_OCI_STAT_RESTORE_PAGES_TOTAL]) {
+		json_object_set_int_member (memory_stat,
+				"restore_pages_faulted",
+				(gint64)values[CC_OCI_STAT_RESTORE_PAGES_FAULTED]);
+		json_object_set_int_member (memory_stat,
+				"restore_pages_total",
+				(gint64)values[CC_OCI_STAT_RESTORE_PAGES_TOTAL]);
+	}
+
+	json_object_set_int_member (memory_stats, "cache",
+			(gint64)values[CC_OCI_STAT_MEM_CACHE]);
+	json_object_set_object_member (memory_stats, "usage", memory_usage);
+	json_object_set_object_member (memory_stats, "stats", memory_stat);
+	json_object_set_object_member (cgroup_stats, "memory_stats",
+			memory_stats);
+
+	/* pids */
+	pids_stats = json_object_new ();
+	json_object_set_int_member (pids_stats, "current",
+			(gint64)values[CC_OCI_STAT_PIDS]);
+	json_object_set_object_member (cgroup_stats, "pids_stats", pids_stats);
+
+	/* blkio: the hypervisor's I/O isn't attributed to a device */
+	blkio_stats = json_object_new ();
+	service_bytes = json_array_new ();
+	serviced = json_array_new ();
+
+	for (guint i = 0; i < 2; i++) {
+		const gchar  *op = i ? "Write" : "Read";
+		JsonObject   *bytes = json_object_new ();
+		JsonObject   *ops = json_object_new ();
+
+		json_object_set_int_member (bytes, "major", 0);
+		json_object_set_int_member (bytes, "minor", 0);
+		json_object_set_string_member (bytes, "op", op);
+		json_object_set_int_member (bytes, "value", (gint64)(i ?
+				values[CC_OCI_STAT_BLKIO_WRITE_BYTES] :
+				values[CC_OCI_STAT_BLKIO_READ_BYTES]));
+		json_array_add_object_element (service_bytes, bytes);
+
+		json_object_set_int_member (ops, "major", 0);
+		json_object_set_int_member (ops, "minor", 0);
+		json_object_set_string_member (ops, "op", op);
+		json_object_set_int_member (ops, "value", (gint64)(i ?
+				values[CC_OCI_STAT_BLKIO_WRITES] :
+				values[CC_OCI_STAT_BLKIO_READS]));
+		json_array_add_object_element (serviced, ops);
+	}
+
+	json_object_set_array_member (blkio_stats,
+			"io_service_bytes_recursive", service_bytes);
+	json_object_set_array_member (blkio_stats,
+			"io_serviced_recursive", serviced);
+	json_object_set_object_member (cgroup_stats, "blkio_stats",
+			blkio_stats);
+
+	json_object_set_object_member (data, "CgroupStats", cgroup_stats);
+
+	/* network */
+	interfaces = json_array_new ();
+
+	for (guint i = 0; stats->interfaces && i < stats->interfaces->len; i++) {
+		const struct cc_oci_net_stats *iface;
+		JsonObject *obj = json_object_new ();
+
+		iface = &g_array_index (stats->interfaces,
+				struct cc_oci_net_stats, i);
+
+		json_object_set_string_member (obj, "name", iface->name);
+
+		for (guint j = 0; j < CC_OCI_NET_STAT_COUNT; j++) {
+			json_object_set_int_member (obj,
+					cc_oci_net_stat_names[j],
+					(gint64)iface->values[j]);
+		}
+
+		json_array_add_object_element (interfaces, obj);
+	}
+
+	json_object_set_array_member (data, "Interfaces", interfaces);
+
+	return data;
+}
+
+/*!
+ * Add the change of a counter to a delta record.
+ *
+ * \param delta \c JsonObject to add to.
+ * \param name Name of counter.
+ * \param prev Previous value.
+ * \param value Current value.
+ *
+ * \return \c 1 if the counter changed, else \c 0.
+ */
+static guint
+cc_oci_stats_delta_add (JsonObject *delta, const gchar *name,
+		guint64 prev, guint64 value)
+{
+	if (value == prev) {
+		return 0;
+	}
+
+	/* gauges such as memory usage can go down */
+	json_object_set_int_member (delta, name, (gint64)(value - prev));
+
+	return 1;
+}
+
+/*!
+ * Find the counters of the network interface \p name.
+ *
+ * \param stats \ref cc_oci_stats.
+ * \param name Interface name.
+ *
+ * \return \ref cc_oci_net_stats, or \c NULL if not found.
+ */
+static const struct cc_oci_net_stats *
+cc_oci_stats_find_interface (const struct cc_oci_stats *stats,
+		const gchar *name)
+{
+	for (guint i = 0; stats->interfaces && i < stats->interfaces->len; i++) {
+		const struct cc_oci_net_stats *iface;
+
+		iface = &g_array_index (stats->interfaces,
+				struct cc_oci_net_stats, i);
+
+		if (! g_strcmp0 (iface->name, name)) {
+			return iface;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * Add the counters that changed between \p prev and \p stats to
+ * \p delta, each as the difference between the two values.
+ *
+ * Counters are named by cc_oci_stat_name(), "percpu.&lt;cpu&gt;",
+ * "net.&lt;interface&gt;.&lt;counter&gt;" and "memory_stat.&lt;key&gt;".
+ * Adding each delta to the previous value of the counter (\c 0 if it
+ * has not been seen before) gives its current value.
+ *
+ * \param prev Previous \ref cc_oci_stats, or \c NULL to add all
+ *   non-zero counters of \p stats.
+ * \param stats Current \ref cc_oci_stats.
+ * \param delta \c JsonObject to add to.
+ *
+ * \return Number of counters added.
+ */
+guint
+cc_oci_stats_delta (const struct cc_oci_stats *prev,
+		const struct cc_oci_stats *stats, JsonObject *delta)
+{
+	guint count = 0;
+
+	g_assert (stats);
+	g_assert (delta);
+
+	for (guint i = 0; i < CC_OCI_STAT_COUNT; i++) {
+		count += cc_oci_stats_delta_add (delta, cc_oci_stat_names[i],
+				prev ? prev->values[i] : 0,
+				stats->values[i]);
+	}
+
+	for (guint i = 0; stats->percpu && i < stats->percpu->len; i++) {
+		g_autofree gchar *name = NULL;
+		guint64           old = 0;
+		guint64           value;
+
+		if (prev && prev->percpu && i < prev->percpu->len) {
+			old = g_array_index (prev->percpu, guint64, i);
+		}
+
+		value = g_array_index (stats->percpu, guint64, i);
+		if (value == old) {
+			continue;
+		}
+
+		name = g_strdup_printf ("percpu.%u", i);
+		count += cc_oci_stats_delta_add (delta, name, old, value);
+	}
+
+	for (guint i = 0; stats->interfaces && i < stats->interfaces->len; i++) {
+		const struct cc_oci_net_stats *iface;
+		const struct cc_oci_net_stats *old = NULL;
+
+		iface = &g_array_index (stats->interfaces,
+				struct cc_oci_net_stats, i);
+
+		if (prev) {
+			old = cc_oci_stats_find_interface (prev, iface->name);
+		}
+
+		for (guint j = 0; j < CC_OCI_NET_STAT_COUNT; j++) {
+			g_autofree gchar *name = NULL;
+			guint64           value = old ? old->values[j] : 0;
+
+			if (iface->values[j] == value) {
+				continue;
+			}
+
+			name = g_strdup_printf ("net.%s.%s", iface->name,
+					cc_oci_net_stat_names[j]);
+			count += cc_oci_stats_delta_add (delta, name, value,
+					iface->values[j]);
+		}
+	}
+
+	if (stats->memory_stat) {
+		GHashTableIter  iter;
+		gpointer        key;
+		gpointer        value;
+
+		g_hash_table_iter_init (&iter, stats->memory_stat);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			g_autofree gchar *name = NULL;
+			guint64           old = 0;
+
+			if (prev && prev->memory_stat) {
+				(void)cc_oci_stats_lookup (prev->memory_stat,
+						key, &old);
+			}
+
+			if (*(guint64 *)value == old) {
+				continue;
+			}
+
+			name = g_strdup_printf ("memory_stat.%s",
+					(const gchar *)key);
+			count += cc_oci_stats_delta_add (delta, name, old,
+					*(guint64 *)value);
+		}
+	}
+
+	return count;
+}
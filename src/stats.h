@@ -0,0 +1,142 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_STATS_H
+#define _CC_OCI_STATS_H
+
+#include <net/if.h>
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "oci.h"
+
+/** Container counters, reported as Docker-compatible "CgroupStats". */
+enum cc_oci_stat {
+	/** Total CPU time consumed (ns). */
+	CC_OCI_STAT_CPU_TOTAL,
+
+	/** CPU time consumed in kernel mode (ns). */
+	CC_OCI_STAT_CPU_KERNEL,
+
+	/** CPU time consumed in user mode (ns). */
+	CC_OCI_STAT_CPU_USER,
+
+	/** Memory in use (bytes). */
+	CC_OCI_STAT_MEM_USAGE,
+
+	/** Maximum memory used (bytes). */
+	CC_OCI_STAT_MEM_MAX_USAGE,
+
+	/** Memory limit (bytes, 0 if unknown). */
+	CC_OCI_STAT_MEM_LIMIT,
+
+	/** Page cache memory (bytes). */
+	CC_OCI_STAT_MEM_CACHE,
+
+	/** Number of times the memory limit was hit. */
+	CC_OCI_STAT_MEM_FAILCNT,
+
+	/** Number of processes killed by the OOM killer (guest only). */
+	CC_OCI_STAT_MEM_OOM_KILLS,
+
+	/** Number of tasks. */
+	CC_OCI_STAT_PIDS,
+
+	/** Bytes read from block devices. */
+	CC_OCI_STAT_BLKIO_READ_BYTES,
+
+	/** Bytes written to block devices. */
+	CC_OCI_STAT_BLKIO_WRITE_BYTES,
+
+	/** Read operations. */
+	CC_OCI_STAT_BLKIO_READS,
+
+	/** Write operations. */
+	CC_OCI_STAT_BLKIO_WRITES,
+
+	/** Pages of guest memory loaded on demand from a checkpoint
+	 * image that the guest has touched.
+	 */
+	CC_OCI_STAT_RESTORE_PAGES_FAULTED,
+
+	/** Pages of guest memory loaded on demand from a checkpoint
+	 * image (0 unless restored with lazy pages).
+	 */
+	CC_OCI_STAT_RESTORE_PAGES_TOTAL,
+
+	CC_OCI_STAT_COUNT
+};
+
+/** Network interface counters. */
+enum cc_oci_net_stat {
+	CC_OCI_NET_STAT_RX_BYTES,
+	CC_OCI_NET_STAT_RX_PACKETS,
+	CC_OCI_NET_STAT_RX_ERRORS,
+	CC_OCI_NET_STAT_RX_DROPPED,
+	CC_OCI_NET_STAT_TX_BYTES,
+	CC_OCI_NET_STAT_TX_PACKETS,
+	CC_OCI_NET_STAT_TX_ERRORS,
+	CC_OCI_NET_STAT_TX_DROPPED,
+
+	CC_OCI_NET_STAT_COUNT
+};
+
+/** Counters of a network interface. */
+struct cc_oci_net_stats {
+	/** Interface name. */
+	gchar    name[IFNAMSIZ];
+
+	/** Values, indexed by \ref cc_oci_net_stat. */
+	guint64  values[CC_OCI_NET_STAT_COUNT];
+};
+
+/** Resource usage of a container. */
+struct cc_oci_stats {
+	/** Values, indexed by \ref cc_oci_stat. */
+	guint64    values[CC_OCI_STAT_COUNT];
+
+	/** CPU time consumed by each virtual CPU (ns, \c guint64). */
+	GArray    *percpu;
+
+	/** Network interfaces (\ref cc_oci_net_stats). */
+	GArray    *interfaces;
+
+	/** Guest memory statistics ("memory.stat" key/value pairs of
+	 * \c guint64), or \c NULL if not available.
+	 */
+	GHashTable *memory_stat;
+};
+
+void cc_oci_stats_init (struct cc_oci_stats *stats);
+void cc_oci_stats_clear (struct cc_oci_stats *stats);
+const gchar *cc_oci_stat_name (enum cc_oci_stat stat);
+const gchar *cc_oci_net_stat_name (enum cc_oci_net_stat stat);
+gboolean cc_oci_stats_get_host (GPid pid, const gchar *cgroups_path,
+		struct cc_oci_stats *stats);
+gboolean cc_oci_stats_get_guest (struct cc_oci_config *config,
+		struct cc_oci_stats *stats);
+gboolean cc_oci_stats_get (struct cc_oci_config *config,
+		const struct oci_state *state, struct cc_oci_stats *stats);
+JsonObject *cc_oci_stats_to_json (const struct cc_oci_stats *stats);
+guint cc_oci_stats_delta (const struct cc_oci_stats *prev,
+		const struct cc_oci_stats *stats, JsonObject *delta);
+
+#endif /* _CC_OCI_STATS_H */
@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <dirent.h>
 
 #include <glib.h>
 #include <glib/gprintf.h>
@@ -38,8 +39,10 @@
  */
 #define DISK_NAME_LEN 32
 
-/** Full path to \c rm(1) command. */
-#define CC_OCI_RM_CMD "/bin/rm"
+/** Minimum number of directories below the directory being removed
+ * by cc_oci_rm_rf() for them to be removed concurrently.
+ */
+#define CC_OCI_RM_RF_PARALLEL_MIN 4
 
 #define make_table_entry(value) \
 { value, #value }
@@ -148,45 +151,118 @@ cc_oci_get_signame (int signum)
 	return NULL;
 }
 
+/*!
+ * Parse a duration such as "5", "1.5s", "250ms" or "2m".
+ *
+ * A number without a unit is in seconds.
+ *
+ * \param str String to parse.
+ * \param[out] msecs Duration in milliseconds.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_parse_duration (const gchar *str, guint *msecs)
+{
+	gdouble  value;
+	gdouble  scale;
+	gchar   *end = NULL;
+
+	if (! (str && *str && msecs)) {
+		return false;
+	}
+
+	value = g_ascii_strtod (str, &end);
+	if (end == str || ! (value >= 0)) {
+		return false;
+	}
+
+	if (! *end || ! g_strcmp0 (end, "s")) {
+		scale = 1000;
+	} else if (! g_strcmp0 (end, "ms")) {
+		scale = 1;
+	} else if (! g_strcmp0 (end, "m")) {
+		scale = 60 * 1000;
+	} else {
+		return false;
+	}
+
+	value *= scale;
+	if (value > G_MAXUINT) {
+		return false;
+	}
+
+	*msecs = (guint)value;
+
+	return true;
+}
+
 /*!
  * Create an ISO-8601-formatted timestamp.
  *
+ * Since the runtime logs many messages per second, everything but the
+ * fractional part is only calculated once per second.
+ *
  * \return Newly-allocated string.
  */
 gchar *
 cc_oci_get_iso8601_timestamp (void)
 {
-	GTimeVal   tv;
-	GDateTime *dt = NULL;
-	gchar     *timestamp = NULL;
+	static GMutex   lock;
+	static gint64   cached_sec = -1;
+	static gchar   *cached = NULL;
+	gchar          *timestamp = NULL;
+	gint64          now;
+	gint64          sec;
+	glong           usec;
+
+	now = g_get_real_time ();
+	sec = now / G_USEC_PER_SEC;
+	usec = (glong)(now % G_USEC_PER_SEC);
+
+	g_mutex_lock (&lock);
+
+	if (sec != cached_sec) {
+		GDateTime *dt;
+		GTimeVal   tv = { 0 };
+		gchar     *str;
+
+		dt = g_date_time_new_from_unix_local (sec);
+		if (! dt) {
+			goto out;
+		}
 
-	dt = g_date_time_new_now_local ();
-	if (! dt) {
-		return NULL;
-	}
+		tv.tv_sec = (glong)sec;
 
-	if (g_date_time_is_daylight_savings (dt)) {
-		GDateTime *dt2 = NULL;
+		if (g_date_time_is_daylight_savings (dt)) {
+			tv.tv_sec += 60 * 60;
+		}
+
+		g_date_time_unref (dt);
 
-		dt2 = g_date_time_add_hours (dt, 1);
-		if (! dt2) {
+		/* "YYYY-MM-DDTHH:MM:SSZ" */
+		str = g_time_val_to_iso8601 (&tv);
+		if (! str) {
 			goto out;
 		}
 
-		g_date_time_unref (dt);
-		dt = dt2;
-	}
+		/* remove the "Z" so the fraction can be appended */
+		str[strlen (str) - 1] = '\0';
 
-	if (! g_date_time_to_timeval (dt, &tv)) {
-		goto out;
+		g_free_if_set (cached);
+		cached = str;
+		cached_sec = sec;
 	}
 
-	timestamp = g_time_val_to_iso8601 (&tv);
+	/* same format as g_time_val_to_iso8601() */
+	if (usec) {
+		timestamp = g_strdup_printf ("%s.%06ldZ", cached, usec);
+	} else {
+		timestamp = g_strdup_printf ("%sZ", cached);
+	}
 
 out:
-	if (dt) {
-		g_date_time_unref (dt);
-	}
+	g_mutex_unlock (&lock);
 
 	return timestamp;
 }
@@ -242,9 +318,112 @@ out:
 	return ret;
 }
 
+/*!
+ * Remove \p name below the directory open as \p parent_fd and, if it
+ * is a directory, everything below it.
+ *
+ * Symbolic links are removed rather than followed, and directories
+ * on a different filesystem to \p dev (such as a mount point that
+ * failed to unmount) are not descended into.
+ *
+ * \param parent_fd Directory containing \p name.
+ * \param name Name of entry to remove.
+ * \param dev Device of the directory being removed.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_rm_rf_at (int parent_fd, const gchar *name, dev_t dev)
+{
+	struct stat     st;
+	struct dirent  *ent;
+	DIR            *dir;
+	int             fd;
+	gboolean        ret = true;
+
+	if (fstatat (parent_fd, name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+		return errno == ENOENT;
+	}
+
+	if (! S_ISDIR (st.st_mode)) {
+		return ! unlinkat (parent_fd, name, 0) || errno == ENOENT;
+	}
+
+	if (st.st_dev != dev) {
+		g_critical ("not removing %s: on a different filesystem",
+				name);
+		return false;
+	}
+
+	fd = openat (parent_fd, name,
+			O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		return errno == ENOENT;
+	}
+
+	dir = fdopendir (fd);
+	if (! dir) {
+		close (fd);
+		return false;
+	}
+
+	while ((ent = readdir (dir)) != NULL) {
+		if (! g_strcmp0 (ent->d_name, ".") ||
+				! g_strcmp0 (ent->d_name, "..")) {
+			continue;
+		}
+
+		if (! cc_oci_rm_rf_at (dirfd (dir), ent->d_name, dev)) {
+			ret = false;
+		}
+	}
+
+	closedir (dir);
+
+	if (unlinkat (parent_fd, name, AT_REMOVEDIR) < 0 && errno != ENOENT) {
+		ret = false;
+	}
+
+	return ret;
+}
+
+/** Directory being removed concurrently by cc_oci_rm_rf(). */
+struct cc_oci_rm_rf_data {
+	/** Directory being removed. */
+	int       fd;
+
+	/** Device of \ref fd. */
+	dev_t     dev;
+
+	/** Set if any entry could not be removed. */
+	gint      failed;
+};
+
+/*!
+ * Remove an entry of a directory being removed by cc_oci_rm_rf().
+ *
+ * \param data Newly-allocated name of the entry.
+ * \param user_data \ref cc_oci_rm_rf_data.
+ */
+static void
+cc_oci_rm_rf_one (gpointer data, gpointer user_data)
+{
+	struct cc_oci_rm_rf_data *rm = user_data;
+	gchar *name = data;
+
+	if (! cc_oci_rm_rf_at (rm->fd, name, rm->dev)) {
+		g_atomic_int_set (&rm->failed, true);
+	}
+
+	g_free (name);
+}
+
 /*!
  * Recursively delete a directory.
  *
+ * Files are removed directly, but when there are many directories
+ * below \p path they are removed concurrently by a pool of threads.
+ *
  * \param path Full path to directory to delete.
  *
  * \return \c true on success, else \c false.
@@ -252,26 +431,87 @@ out:
 gboolean
 cc_oci_rm_rf (const gchar *path)
 {
-	gchar *cmd;
-	gboolean ret = false;
+	struct cc_oci_rm_rf_data  rm = { 0 };
+	struct stat               st;
+	struct dirent            *ent;
+	GPtrArray                *dirs = NULL;
+	GThreadPool              *pool = NULL;
+	DIR                      *dir = NULL;
+	gboolean                  ret = false;
+	guint                     threads;
 
 	if (! path || ! *path) {
 		return false;
 	}
 
-	cmd = g_strdup_printf ("%s -rf \"%s\" >/dev/null 2>&1",
-			CC_OCI_RM_CMD, path);
-	if (! cmd) {
-		return false;
+	if (lstat (path, &st) < 0) {
+		/* nothing to do */
+		return errno == ENOENT;
 	}
 
-	if (system (cmd)) {
-		g_critical ("failed to remove directory %s", path);
-	} else {
-		ret = true;
+	if (! S_ISDIR (st.st_mode)) {
+		ret = ! unlink (path);
+		goto out;
+	}
+
+	rm.fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (rm.fd < 0) {
+		goto out;
+	}
+
+	rm.dev = st.st_dev;
+
+	dir = fdopendir (rm.fd);
+	if (! dir) {
+		close (rm.fd);
+		goto out;
+	}
+
+	dirs = g_ptr_array_new ();
+
+	while ((ent = readdir (dir)) != NULL) {
+		if (! g_strcmp0 (ent->d_name, ".") ||
+				! g_strcmp0 (ent->d_name, "..")) {
+			continue;
+		}
+
+		if (ent->d_type == DT_DIR || ent->d_type == DT_UNKNOWN) {
+			g_ptr_array_add (dirs, g_strdup (ent->d_name));
+		} else if (unlinkat (rm.fd, ent->d_name, 0) < 0 &&
+				errno != ENOENT) {
+			rm.failed = true;
+		}
 	}
 
-	g_free (cmd);
+	threads = MIN (g_get_num_processors (), dirs->len);
+
+	if (dirs->len >= CC_OCI_RM_RF_PARALLEL_MIN && threads > 1) {
+		pool = g_thread_pool_new (cc_oci_rm_rf_one, &rm,
+				(gint)threads, false, NULL);
+	}
+
+	for (guint i = 0; i < dirs->len; i++) {
+		gpointer name = g_ptr_array_index (dirs, i);
+
+		if (! (pool && g_thread_pool_push (pool, name, NULL))) {
+			cc_oci_rm_rf_one (name, &rm);
+		}
+	}
+
+	if (pool) {
+		/* wait for all directories to be removed */
+		g_thread_pool_free (pool, false, true);
+	}
+
+	g_ptr_array_free (dirs, true);
+	closedir (dir);
+
+	ret = ! rm.failed && ! rmdir (path);
+
+out:
+	if (! ret) {
+		g_critical ("failed to remove directory %s", path);
+	}
 
 	return ret;
 }
@@ -819,7 +1059,7 @@ cc_oci_node_dump_aux(GNode* node, gpointer data) {
 
 void
 cc_oci_node_dump(GNode* node) {
-	if (!node) {
+	if (!node || !cc_oci_log_debug_enabled ()) {
 		return;
 	}
 	g_message("debug: " "======== Dumping GNode: ========");
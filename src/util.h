@@ -30,6 +30,28 @@
 
 #include "config.h"
 
+gboolean cc_oci_log_debug_enabled (void);
+
+/* Replace g_debug() so that messages which will not be logged are not
+ * formatted, and so that they can be compiled out altogether.
+ */
+#undef g_debug
+#ifdef CC_OCI_DISABLE_DEBUG_LOGGING
+#define g_debug(...) \
+	do { \
+		if (0) { \
+			g_log (G_LOG_DOMAIN, G_LOG_LEVEL_DEBUG, __VA_ARGS__); \
+		} \
+	} while (0)
+#else
+#define g_debug(...) \
+	do { \
+		if (cc_oci_log_debug_enabled ()) { \
+			g_log (G_LOG_DOMAIN, G_LOG_LEVEL_DEBUG, __VA_ARGS__); \
+		} \
+	} while (0)
+#endif /* CC_OCI_DISABLE_DEBUG_LOGGING */
+
 /** Calculate size of array specified by \a x. */
 #define CC_OCI_ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
@@ -89,6 +111,7 @@ char** node_to_strv(GNode* root);
 gboolean gnode_free(GNode* node, gpointer data);
 int cc_oci_get_signum (const gchar *signame);
 const char* cc_oci_get_signame (int signum);
+gboolean cc_oci_parse_duration (const gchar *str, guint *msecs);
 gchar *cc_oci_resolve_path (const gchar *path);
 gboolean cc_oci_fd_toggle_cloexec (int fd, gboolean set);
 gboolean cc_oci_enable_networking (void);
@@ -0,0 +1,488 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Cache of the VM configuration read from \ref CC_OCI_VM_CONFIG.
+ *
+ * Every command that needs the VM configuration would otherwise parse
+ * \ref CC_OCI_VM_CONFIG, resolve the hypervisor, image and kernel
+ * paths it references and check they exist. The result is saved to
+ * \ref CC_OCI_VM_CACHE_FILE below the runtime root directory in a
+ * compact binary form.
+ *
+ * The cache records the mtime and size of \ref CC_OCI_VM_CONFIG and
+ * of each (resolved) file it references. If any of them has changed
+ * or no longer exists, the cache is ignored and \ref CC_OCI_VM_CONFIG
+ * is parsed as usual.
+ *
+ * The paths in \ref CC_OCI_VM_CONFIG are usually symbolic links to
+ * versioned files, so the unresolved paths are recorded too: if one
+ * of them now resolves to a different file (for example after a
+ * package upgrade), the cache is also ignored.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "oci.h"
+#include "util.h"
+#include "vm_cache.h"
+
+/** "CCVM" */
+#define CC_OCI_VM_CACHE_MAGIC		0x4343564d
+
+/** Bump whenever the payload format changes. */
+#define CC_OCI_VM_CACHE_VERSION		2
+
+/** Length recorded for a \c NULL string. */
+#define CC_OCI_VM_CACHE_NULL		G_MAXUINT32
+
+struct cc_oci_vm_cache_header {
+	guint32  magic;
+	guint32  version;
+
+	/** size and checksum of the payload following the header */
+	guint32  payload_size;
+	guint32  checksum;
+};
+
+/** Position in the payload being decoded. */
+struct cc_oci_vm_cache_reader {
+	const guint8  *p;
+	gsize          left;
+};
+
+/*!
+ * Calculate the checksum (32-bit FNV-1a) of \p data.
+ *
+ * \param data Data to checksum.
+ * \param len Length of \p data.
+ *
+ * \return Checksum.
+ */
+static guint32
+cc_oci_vm_cache_checksum (const guint8 *data, gsize len)
+{
+	guint32 hash = 2166136261U;
+
+	for (gsize i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/*!
+ * Determine the full path to \ref CC_OCI_VM_CACHE_FILE.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated path.
+ */
+static gchar *
+cc_oci_vm_cache_path (const struct cc_oci_config *config)
+{
+	return g_build_path ("/",
+			config->root_dir ? config->root_dir
+			: CC_OCI_RUNTIME_DIR_PREFIX,
+			CC_OCI_VM_CACHE_FILE, NULL);
+}
+
+static void
+put_u32 (GByteArray *buf, guint32 value)
+{
+	g_byte_array_append (buf, (const guint8 *)&value, sizeof (value));
+}
+
+static void
+put_i64 (GByteArray *buf, gint64 value)
+{
+	g_byte_array_append (buf, (const guint8 *)&value, sizeof (value));
+}
+
+static void
+put_str (GByteArray *buf, const gchar *str)
+{
+	gsize len;
+
+	if (! str) {
+		put_u32 (buf, CC_OCI_VM_CACHE_NULL);
+		return;
+	}
+
+	len = strlen (str);
+
+	put_u32 (buf, (guint32)len);
+	g_byte_array_append (buf, (const guint8 *)str, (guint)len);
+}
+
+/*!
+ * Check that \p config_path still resolves to \p path.
+ *
+ * \param config_path Path as specified in \ref CC_OCI_VM_CONFIG
+ *   (may be \c NULL or empty if unknown).
+ * \param path Resolved path.
+ *
+ * \return \c true if \p config_path is unknown or resolves to
+ * \p path, else \c false.
+ */
+gboolean
+cc_oci_vm_cache_path_resolves (const gchar *config_path,
+		const gchar *path)
+{
+	char resolved[PATH_MAX];
+
+	if (! (config_path && *config_path)) {
+		return true;
+	}
+
+	if (! (path && realpath (config_path, resolved))) {
+		return false;
+	}
+
+	if (g_strcmp0 (resolved, path)) {
+		g_debug ("VM cache: %s now resolves to %s, not %s",
+				config_path, resolved, path);
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Record \p config_path, \p path and the identity of the file it
+ * refers to.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+put_file (GByteArray *buf, const gchar *config_path,
+		const gchar *path, const struct stat *st)
+{
+	struct stat file_st;
+
+	if (! st) {
+		if (stat (path, &file_st) < 0) {
+			return false;
+		}
+		st = &file_st;
+	}
+
+	put_str (buf, config_path && *config_path ? config_path : NULL);
+	put_str (buf, path);
+	put_i64 (buf, (gint64)st->st_mtim.tv_sec);
+	put_i64 (buf, (gint64)st->st_mtim.tv_nsec);
+	put_i64 (buf, (gint64)st->st_size);
+
+	return true;
+}
+
+static gboolean
+get_u32 (struct cc_oci_vm_cache_reader *r, guint32 *value)
+{
+	if (r->left < sizeof (*value)) {
+		return false;
+	}
+
+	memcpy (value, r->p, sizeof (*value));
+	r->p += sizeof (*value);
+	r->left -= sizeof (*value);
+
+	return true;
+}
+
+static gboolean
+get_i64 (struct cc_oci_vm_cache_reader *r, gint64 *value)
+{
+	if (r->left < sizeof (*value)) {
+		return false;
+	}
+
+	memcpy (value, r->p, sizeof (*value));
+	r->p += sizeof (*value);
+	r->left -= sizeof (*value);
+
+	return true;
+}
+
+static gboolean
+get_str (struct cc_oci_vm_cache_reader *r, gchar **str)
+{
+	guint32 len;
+
+	if (! get_u32 (r, &len)) {
+		return false;
+	}
+
+	if (len == CC_OCI_VM_CACHE_NULL) {
+		*str = NULL;
+		return true;
+	}
+
+	if (r->left < len) {
+		return false;
+	}
+
+	*str = g_strndup ((const gchar *)r->p, len);
+	r->p += len;
+	r->left -= len;
+
+	return true;
+}
+
+/*!
+ * Read a file recorded by put_file() and check it is unchanged.
+ *
+ * \param r \ref cc_oci_vm_cache_reader.
+ * \param[out] config_buffer Buffer to copy the unresolved path of
+ *   the file to.
+ * \param[out] buffer Buffer to copy the path of the file to.
+ * \param size Size of \p config_buffer and \p buffer.
+ *
+ * \return \c true if the file is unchanged, else \c false.
+ */
+static gboolean
+get_file (struct cc_oci_vm_cache_reader *r, gchar *config_buffer,
+		gchar *buffer, gsize size)
+{
+	g_autofree gchar  *config_path = NULL;
+	g_autofree gchar  *path = NULL;
+	gint64             mtime_sec;
+	gint64             mtime_nsec;
+	gint64             file_size;
+	struct stat        st;
+
+	if (! (get_str (r, &config_path) &&
+				get_str (r, &path) && path &&
+				get_i64 (r, &mtime_sec) &&
+				get_i64 (r, &mtime_nsec) &&
+				get_i64 (r, &file_size))) {
+		return false;
+	}
+
+	if (stat (path, &st) < 0) {
+		g_debug ("VM cache: %s no longer exists", path);
+		return false;
+	}
+
+	if (mtime_sec != (gint64)st.st_mtim.tv_sec ||
+			mtime_nsec != (gint64)st.st_mtim.tv_nsec ||
+			file_size != (gint64)st.st_size) {
+		g_debug ("VM cache: %s has changed", path);
+		return false;
+	}
+
+	if (! cc_oci_vm_cache_path_resolves (config_path, path)) {
+		return false;
+	}
+
+	if (buffer && g_strlcpy (buffer, path, size) >= size) {
+		return false;
+	}
+
+	if (config_buffer && config_path &&
+			g_strlcpy (config_buffer, config_path, size) >= size) {
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Save the VM configuration of \p config to \ref CC_OCI_VM_CACHE_FILE.
+ *
+ * \param config \ref cc_oci_config whose \c vm has been set by
+ * parsing \p vm_config_file.
+ * \param vm_config_file Full path to \ref CC_OCI_VM_CONFIG.
+ * \param st Status of \p vm_config_file before it was parsed.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_vm_cache_save (const struct cc_oci_config *config,
+		const gchar *vm_config_file, const struct stat *st)
+{
+	struct cc_oci_vm_cache_header  header = { 0 };
+	g_autofree gchar              *path = NULL;
+	g_autoptr(GError)              err = NULL;
+	GByteArray                    *buf;
+	gboolean                       ret = false;
+
+	if (! (config && config->vm && vm_config_file && st)) {
+		return false;
+	}
+
+	path = cc_oci_vm_cache_path (config);
+
+	/* reserve space for the header */
+	buf = g_byte_array_sized_new (1024);
+	g_byte_array_append (buf, (const guint8 *)&header, sizeof (header));
+
+	if (! (put_file (buf, NULL, vm_config_file, st) &&
+			put_file (buf, config->vm->hypervisor_config_path,
+				config->vm->hypervisor_path, NULL) &&
+			put_file (buf, config->vm->image_config_path,
+				config->vm->image_path, NULL) &&
+			put_file (buf, config->vm->kernel_config_path,
+				config->vm->kernel_path, NULL))) {
+		goto out;
+	}
+
+	put_str (buf, config->vm->kernel_params);
+
+	header.magic = CC_OCI_VM_CACHE_MAGIC;
+	header.version = CC_OCI_VM_CACHE_VERSION;
+	header.payload_size = (guint32)(buf->len - sizeof (header));
+	header.checksum = cc_oci_vm_cache_checksum (
+			buf->data + sizeof (header), header.payload_size);
+
+	memcpy (buf->data, &header, sizeof (header));
+
+	/* Not fatal: the runtime root may not exist yet or may not be
+	 * writable by the caller.
+	 */
+	if (! g_file_set_contents (path, (const gchar *)buf->data,
+				(gssize)buf->len, &err)) {
+		g_debug ("failed to save VM cache %s: %s",
+				path, err->message);
+		goto out;
+	}
+
+	g_debug ("saved VM cache %s (%u bytes)", path, buf->len);
+
+	ret = true;
+
+out:
+	g_byte_array_free (buf, true);
+
+	return ret;
+}
+
+/*!
+ * Set the VM configuration of \p config from \ref CC_OCI_VM_CACHE_FILE,
+ * as if \p vm_config_file had been parsed by the "vm" spec handler.
+ *
+ * If the cache doesn't exist, is damaged, was built from a different
+ * \p vm_config_file or any of the files recorded in it have changed,
+ * \p config is not modified.
+ *
+ * \param[in,out] config \ref cc_oci_config.
+ * \param vm_config_file Full path to \ref CC_OCI_VM_CONFIG.
+ *
+ * \return \c true if \p config was updated from the cache, else
+ * \c false.
+ */
+gboolean
+cc_oci_vm_cache_load (struct cc_oci_config *config,
+		const gchar *vm_config_file)
+{
+	struct cc_oci_vm_cache_header  header;
+	struct cc_oci_vm_cache_reader  r;
+	struct cc_oci_vm_cfg          *vm = NULL;
+	g_autofree gchar              *path = NULL;
+	g_autofree gchar              *contents = NULL;
+	g_autofree gchar              *file = NULL;
+	gsize                          len = 0;
+
+	if (! (config && vm_config_file) || config->vm) {
+		return false;
+	}
+
+	path = cc_oci_vm_cache_path (config);
+
+	if (! g_file_get_contents (path, &contents, &len, NULL)) {
+		return false;
+	}
+
+	if (len < sizeof (header)) {
+		goto out;
+	}
+
+	memcpy (&header, contents, sizeof (header));
+
+	if (header.magic != CC_OCI_VM_CACHE_MAGIC ||
+			header.version != CC_OCI_VM_CACHE_VERSION ||
+			header.payload_size != len - sizeof (header)) {
+		goto out;
+	}
+
+	r.p = (const guint8 *)contents + sizeof (header);
+	r.left = header.payload_size;
+
+	if (header.checksum != cc_oci_vm_cache_checksum (r.p, r.left)) {
+		goto out;
+	}
+
+	/* the cache must have been built from the same file (which is
+	 * recorded without an unresolved path).
+	 */
+	if (! (get_str (&r, &file) && ! file &&
+				get_str (&r, &file) && file &&
+				! g_strcmp0 (file, vm_config_file))) {
+		goto out;
+	}
+
+	/* rewind to validate it along with the referenced files */
+	r.p = (const guint8 *)contents + sizeof (header);
+	r.left = header.payload_size;
+
+	vm = g_new0 (struct cc_oci_vm_cfg, 1);
+
+	if (! (get_file (&r, NULL, NULL, 0) &&
+			get_file (&r, vm->hypervisor_config_path,
+				vm->hypervisor_path,
+				sizeof (vm->hypervisor_path)) &&
+			get_file (&r, vm->image_config_path,
+				vm->image_path,
+				sizeof (vm->image_path)) &&
+			get_file (&r, vm->kernel_config_path,
+				vm->kernel_path,
+				sizeof (vm->kernel_path)) &&
+			get_str (&r, &vm->kernel_params) &&
+			! r.left)) {
+		goto out;
+	}
+
+	config->vm = vm;
+
+	g_debug ("VM cache hit: using %s for %s", path, vm_config_file);
+
+	return true;
+
+out:
+	g_debug ("ignoring VM cache %s", path);
+
+	if (vm) {
+		g_free_if_set (vm->kernel_params);
+		g_free (vm);
+	}
+
+	return false;
+}
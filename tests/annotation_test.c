@@ -27,9 +27,9 @@
 #include "test_common.h"
 #include "../src/oci.h"
 #include "../src/logging.h"
+#include "../src/annotation.h"
 
 void cc_oci_annotation_free (struct oci_cfg_annotation *a);
-void cc_oci_annotations_free_all (GSList *annotations);
 
 START_TEST(test_cc_oci_annotation_free) {
 	struct oci_cfg_annotation* a;
@@ -71,11 +71,148 @@ START_TEST(test_cc_oci_annotations_free_all) {
 
 } END_TEST
 
+static GSList *
+add_annotation (GSList *list, const gchar *key, const gchar *value)
+{
+	struct oci_cfg_annotation* a;
+
+	a = g_new0(struct oci_cfg_annotation, 1);
+	a->key = g_strdup(key);
+	a->value = g_strdup(value);
+
+	return g_slist_prepend(list, a);
+}
+
+START_TEST(test_cc_oci_annotation_get) {
+	GSList* list = NULL;
+
+	ck_assert (! cc_oci_annotation_get (NULL, NULL));
+	ck_assert (! cc_oci_annotation_get (NULL, "foo"));
+
+	list = add_annotation (list, "foo", "bar");
+	list = add_annotation (list, "novalue", NULL);
+
+	ck_assert (! cc_oci_annotation_get (list, NULL));
+	ck_assert (! cc_oci_annotation_get (list, "baz"));
+	ck_assert (! cc_oci_annotation_get (list, "novalue"));
+	ck_assert_str_eq (cc_oci_annotation_get (list, "foo"), "bar");
+
+	cc_oci_annotations_free_all(list);
+} END_TEST
+
+START_TEST(test_cc_oci_annotations_get_shim_log_options) {
+	GSList* list = NULL;
+	struct cc_oci_shim_log_options options;
+
+	ck_assert (! cc_oci_annotations_get_shim_log_options (NULL, NULL));
+	ck_assert (! cc_oci_annotations_get_shim_log_options (NULL, &options));
+
+	/* no path, no log capture */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_FORMAT, "raw");
+	ck_assert (! cc_oci_annotations_get_shim_log_options (list, &options));
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	/* relative path */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_PATH, "foo.log");
+	ck_assert (! cc_oci_annotations_get_shim_log_options (list, &options));
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	/* path only */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_PATH,
+			"/var/log/foo.log");
+	ck_assert (cc_oci_annotations_get_shim_log_options (list, &options));
+	ck_assert_str_eq (options.path, "/var/log/foo.log");
+	ck_assert (! options.format);
+	ck_assert (! options.max_size);
+	ck_assert (! options.max_files);
+	ck_assert (! options.max_buffer);
+
+	/* invalid values are ignored */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_FORMAT, "xml");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_SIZE, "10M");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_FILES, "-1");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_BUFFER, "0");
+	ck_assert (cc_oci_annotations_get_shim_log_options (list, &options));
+	ck_assert_str_eq (options.path, "/var/log/foo.log");
+	ck_assert (! options.format);
+	ck_assert (! options.max_size);
+	ck_assert (! options.max_files);
+	ck_assert (! options.max_buffer);
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	/* all options */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_PATH,
+			"/var/log/foo.log");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_FORMAT, "raw");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_SIZE, "1048576");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_FILES, "0");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_BUFFER, "65536");
+	ck_assert (cc_oci_annotations_get_shim_log_options (list, &options));
+	ck_assert_str_eq (options.path, "/var/log/foo.log");
+	ck_assert_str_eq (options.format, "raw");
+	ck_assert_str_eq (options.max_size, "1048576");
+	ck_assert_str_eq (options.max_files, "0");
+	ck_assert_str_eq (options.max_buffer, "65536");
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	/* values the shim would reject are ignored */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_PATH,
+			"/var/log/foo.log");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_SIZE,
+			"9223372036854775808");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_FILES,
+			"4294967296");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_BUFFER,
+			"18446744073709551615");
+	ck_assert (cc_oci_annotations_get_shim_log_options (list, &options));
+	ck_assert (! options.max_size);
+	ck_assert (! options.max_files);
+	ck_assert (! options.max_buffer);
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	/* largest number of files the shim accepts */
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_PATH,
+			"/var/log/foo.log");
+	list = add_annotation (list, CC_OCI_ANNOTATION_SHIM_LOG_MAX_FILES,
+			"4294967295");
+	ck_assert (cc_oci_annotations_get_shim_log_options (list, &options));
+	ck_assert_str_eq (options.max_files, "4294967295");
+	cc_oci_annotations_free_all(list);
+} END_TEST
+
+START_TEST(test_cc_oci_annotations_get_hooks_async) {
+	GSList* list = NULL;
+
+	ck_assert (! cc_oci_annotations_get_hooks_async (NULL));
+
+	list = add_annotation (list, CC_OCI_ANNOTATION_HOOKS_ASYNC, "yes");
+	ck_assert (! cc_oci_annotations_get_hooks_async (list));
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	list = add_annotation (list, CC_OCI_ANNOTATION_HOOKS_ASYNC, "false");
+	ck_assert (! cc_oci_annotations_get_hooks_async (list));
+	cc_oci_annotations_free_all(list);
+	list = NULL;
+
+	list = add_annotation (list, CC_OCI_ANNOTATION_HOOKS_ASYNC, "true");
+	ck_assert (cc_oci_annotations_get_hooks_async (list));
+	cc_oci_annotations_free_all(list);
+} END_TEST
+
 Suite* make_annotation_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_annotation_free, s);
 	ADD_TEST(test_cc_oci_annotations_free_all, s);
+	ADD_TEST(test_cc_oci_annotation_get, s);
+	ADD_TEST(test_cc_oci_annotations_get_shim_log_options, s);
+	ADD_TEST(test_cc_oci_annotations_get_hooks_async, s);
 
 	return s;
 }
@@ -0,0 +1,203 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/batch.h"
+
+GSList *cc_oci_batch_unique_ids (GSList *ids);
+
+static struct oci_cfg_annotation *
+make_annotation (const gchar *key, const gchar *value)
+{
+	struct oci_cfg_annotation *a = g_new0 (struct oci_cfg_annotation, 1);
+
+	a->key = g_strdup (key);
+	a->value = g_strdup (value);
+
+	return a;
+}
+
+static void
+free_annotation (struct oci_cfg_annotation *a)
+{
+	g_free (a->key);
+	g_free (a->value);
+	g_free (a);
+}
+
+START_TEST(test_cc_oci_batch_label_matches) {
+	GSList *annotations = NULL;
+
+	ck_assert (! cc_oci_batch_label_matches (NULL, NULL));
+	ck_assert (! cc_oci_batch_label_matches (NULL, "pod"));
+
+	annotations = g_slist_append (annotations,
+			make_annotation ("pod", "web"));
+	annotations = g_slist_append (annotations,
+			make_annotation ("tier", ""));
+
+	ck_assert (! cc_oci_batch_label_matches (annotations, NULL));
+	ck_assert (! cc_oci_batch_label_matches (annotations, ""));
+
+	ck_assert (cc_oci_batch_label_matches (annotations, "pod"));
+	ck_assert (cc_oci_batch_label_matches (annotations, "pod=web"));
+	ck_assert (! cc_oci_batch_label_matches (annotations, "pod=db"));
+	ck_assert (! cc_oci_batch_label_matches (annotations, "po"));
+	ck_assert (! cc_oci_batch_label_matches (annotations, "pod=we"));
+
+	ck_assert (cc_oci_batch_label_matches (annotations, "tier"));
+	ck_assert (cc_oci_batch_label_matches (annotations, "tier="));
+	ck_assert (! cc_oci_batch_label_matches (annotations, "tier=x"));
+
+	g_slist_free_full (annotations, (GDestroyNotify)free_annotation);
+} END_TEST
+
+/* Succeeds for containers whose id starts with "ok". */
+static gboolean
+test_func (struct cc_oci_config *config, gpointer user_data)
+{
+	ck_assert (config);
+	ck_assert (! g_strcmp0 (config->root_dir, user_data));
+
+	return g_str_has_prefix (config->optarg_container_id, "ok");
+}
+
+START_TEST(test_cc_oci_batch_run) {
+	struct cc_oci_config *config;
+	GSList *ids = NULL;
+	pid_t pid;
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+	config->root_dir = g_strdup ("/tmp/batch");
+
+	ck_assert (! cc_oci_batch_run (NULL, NULL, 0, test_func, NULL));
+	ck_assert (! cc_oci_batch_run (config, NULL, 0, NULL, NULL));
+
+	/* nothing to do */
+	ck_assert (cc_oci_batch_run (config, NULL, 0, test_func,
+				config->root_dir));
+
+	for (int i = 0; i < 20; i++) {
+		ids = g_slist_append (ids, g_strdup_printf ("ok%d", i));
+	}
+
+	ck_assert (cc_oci_batch_run (config, ids, 0, test_func,
+				config->root_dir));
+	ck_assert (cc_oci_batch_run (config, ids, 1, test_func,
+				config->root_dir));
+	ck_assert (cc_oci_batch_run (config, ids, 3, test_func,
+				config->root_dir));
+
+	/* children which are not workers don't count as jobs */
+	pid = fork ();
+	ck_assert (pid >= 0);
+	if (! pid) {
+		_exit (EXIT_FAILURE);
+	}
+
+	ck_assert (cc_oci_batch_run (config, ids, 1, test_func,
+				config->root_dir));
+	(void)waitpid (pid, NULL, 0);
+
+	ids = g_slist_append (ids, g_strdup ("bad"));
+
+	ck_assert (! cc_oci_batch_run (config, ids, 4, test_func,
+				config->root_dir));
+
+	g_slist_free_full (ids, g_free);
+	cc_oci_config_free (config);
+} END_TEST
+
+START_TEST(test_cc_oci_batch_unique_ids) {
+	GSList *ids = NULL;
+	GSList *unique;
+
+	ck_assert (! cc_oci_batch_unique_ids (NULL));
+
+	ids = g_slist_append (ids, "foo");
+	ids = g_slist_append (ids, "bar");
+	ids = g_slist_append (ids, "foo");
+	ids = g_slist_append (ids, "baz");
+	ids = g_slist_append (ids, "bar");
+
+	unique = cc_oci_batch_unique_ids (ids);
+	ck_assert (g_slist_length (unique) == 3);
+	ck_assert_str_eq (g_slist_nth_data (unique, 0), "foo");
+	ck_assert_str_eq (g_slist_nth_data (unique, 1), "bar");
+	ck_assert_str_eq (g_slist_nth_data (unique, 2), "baz");
+
+	g_slist_free (unique);
+	g_slist_free (ids);
+} END_TEST
+
+START_TEST(test_cc_oci_batch_ids_matching) {
+	ck_assert (! cc_oci_batch_ids_matching (NULL, NULL));
+	ck_assert (! cc_oci_batch_ids_matching ("/tmp", NULL));
+	ck_assert (! cc_oci_batch_ids_matching (NULL, "pod"));
+
+	/* no containers */
+	ck_assert (! cc_oci_batch_ids_matching ("/this/does/not/exist",
+				"pod"));
+} END_TEST
+
+Suite* make_batch_suite(void) {
+	Suite* s = suite_create(__FILE__);
+	ADD_TEST(test_cc_oci_batch_label_matches, s);
+	ADD_TEST(test_cc_oci_batch_run, s);
+	ADD_TEST(test_cc_oci_batch_unique_ids, s);
+	ADD_TEST(test_cc_oci_batch_ids_matching, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("batch_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_batch_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
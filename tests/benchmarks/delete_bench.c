@@ -0,0 +1,173 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark for the removal of a container's runtime directory by
+ * "delete".
+ *
+ * A directory resembling a runtime directory with the specified
+ * numbers of volume directories, each containing a few files, is
+ * removed by cc_oci_rm_rf() and, for comparison, by "rm -rf" which it
+ * replaced.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./delete_bench [iterations] [volumes ...]
+ *
+ * By default directories with 10 and 100 volumes are used.
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../../src/util.h"
+
+#define DEFAULT_ITERATIONS 20
+
+/* Files created in each volume directory. */
+#define FILES_PER_VOLUME 8
+
+/*!
+ * Create \p dir containing \p volumes volume directories.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+make_tree (const gchar *dir, guint volumes)
+{
+	if (g_mkdir_with_parents (dir, 0750) < 0) {
+		return false;
+	}
+
+	for (guint i = 0; i < volumes; i++) {
+		g_autofree gchar *volume = NULL;
+
+		volume = g_strdup_printf ("%s/volume%u/data", dir, i);
+		if (g_mkdir_with_parents (volume, 0750) < 0) {
+			return false;
+		}
+
+		for (guint j = 0; j < FILES_PER_VOLUME; j++) {
+			g_autofree gchar *file = NULL;
+
+			file = g_strdup_printf ("%s/file%u", volume, j);
+			if (! g_file_set_contents (file, "data", -1, NULL)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static gboolean
+rm_rf_system (const gchar *dir)
+{
+	g_autofree gchar *cmd = NULL;
+
+	cmd = g_strdup_printf ("/bin/rm -rf \"%s\"", dir);
+
+	return system (cmd) == 0;
+}
+
+/*!
+ * Time removing \p dir with \p volumes volumes using \p func.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+run (const gchar *name, const gchar *dir, guint volumes,
+	guint iterations, gboolean (*func) (const gchar *))
+{
+	gint64 elapsed = 0;
+
+	for (guint i = 0; i < iterations; i++) {
+		gint64 start;
+
+		/* only the removal is timed */
+		if (! make_tree (dir, volumes)) {
+			g_printerr ("failed to create %u volumes\n", volumes);
+			return false;
+		}
+
+		start = g_get_monotonic_time ();
+
+		if (! func (dir)) {
+			g_printerr ("failed to remove %s\n", dir);
+			return false;
+		}
+
+		elapsed += g_get_monotonic_time () - start;
+	}
+
+	g_print ("%-16s %6u volumes %10.2f us\n", name, volumes,
+		(double)elapsed / iterations);
+
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	const gchar *default_volumes[] = { "10", "100", NULL };
+	const gchar **volumes = default_volumes;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *dir = NULL;
+	guint iterations = DEFAULT_ITERATIONS;
+	gboolean ret = true;
+
+	if (argc > 1) {
+		iterations = (guint)g_ascii_strtoull (argv[1], NULL, 10);
+		if (! iterations) {
+			g_printerr ("usage: %s [iterations] [volumes ...]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc > 2) {
+		volumes = (const gchar **)argv + 2;
+	}
+
+	tmpdir = g_dir_make_tmp ("delete_bench.XXXXXX", NULL);
+	if (! tmpdir) {
+		g_printerr ("failed to create directory\n");
+		return EXIT_FAILURE;
+	}
+
+	dir = g_build_path ("/", tmpdir, "runtime", NULL);
+
+	for (const gchar **v = volumes; ret && *v; v++) {
+		guint count = (guint)g_ascii_strtoull (*v, NULL, 10);
+
+		ret = run ("cc_oci_rm_rf", dir, count, iterations,
+				cc_oci_rm_rf) &&
+			run ("rm -rf", dir, count, iterations,
+				rm_rf_system);
+	}
+
+	(void)rm_rf_system (tmpdir);
+
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
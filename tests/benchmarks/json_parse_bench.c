@@ -0,0 +1,198 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark comparing the GNode based parsing of config.json and
+ * state.json with the direct decoding path.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./json_parse_bench [iterations] [config.json ...]
+ *
+ * By default the Docker and CRI-O configs from tests/data are used.
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include "../../src/oci.h"
+#include "../../src/json.h"
+#include "../../src/util.h"
+#include "../../src/state.h"
+#include "../../src/oci-config.h"
+#include "../../src/spec_handler.h"
+
+#define DEFAULT_ITERATIONS 1000
+
+/* handlers run by "start" that don't depend on the host */
+static struct spec_handler *start_handlers[] = {
+	&annotations_spec_handler,
+	&hooks_spec_handler,
+	&mounts_spec_handler,
+	&platform_spec_handler,
+	&process_spec_handler,
+	&linux_spec_handler,
+	NULL
+};
+
+/* handlers run by "stop" */
+static struct spec_handler *stop_handlers[] = {
+	&hooks_spec_handler,
+	&linux_spec_handler,
+	NULL
+};
+
+static gboolean
+parse_gnode (const gchar *file, struct spec_handler **handlers)
+{
+	struct cc_oci_config *config = cc_oci_config_create ();
+	GNode *root = NULL;
+	gboolean ret;
+
+	ret = cc_oci_json_parse (&root, file) &&
+		cc_oci_process_config (root, config, handlers);
+
+	g_free_node (root);
+	cc_oci_config_free (config);
+
+	return ret;
+}
+
+static gboolean
+parse_direct (const gchar *file, struct spec_handler **handlers)
+{
+	struct cc_oci_config *config = cc_oci_config_create ();
+	gboolean ret;
+
+	ret = cc_oci_process_config_file (file, config, handlers);
+
+	cc_oci_config_free (config);
+
+	return ret;
+}
+
+static gboolean
+parse_state_gnode (const gchar *file, struct spec_handler **handlers)
+{
+	GNode *root = NULL;
+	gboolean ret;
+
+	(void)handlers;
+
+	ret = cc_oci_json_parse (&root, file);
+	g_free_node (root);
+
+	return ret;
+}
+
+static gboolean
+parse_state_direct (const gchar *file, struct spec_handler **handlers)
+{
+	struct oci_state *state;
+
+	(void)handlers;
+
+	state = cc_oci_state_file_read (file);
+	cc_oci_state_free (state);
+
+	return state != NULL;
+}
+
+/*!
+ * Run \p func \p iterations times and print the average time per
+ * call.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+run (const gchar *name, const gchar *file, guint iterations,
+	gboolean (*func) (const gchar *, struct spec_handler **),
+	struct spec_handler **handlers)
+{
+	g_autofree gchar *basename = g_path_get_basename (file);
+	gint64 start;
+	gint64 elapsed;
+
+	/* warm up the page cache */
+	if (! func (file, handlers)) {
+		g_printerr ("failed to parse %s\n", file);
+		return false;
+	}
+
+	start = g_get_monotonic_time ();
+
+	for (guint i = 0; i < iterations; i++) {
+		(void)func (file, handlers);
+	}
+
+	elapsed = g_get_monotonic_time () - start;
+
+	g_print ("%-24s %-24s %10.2f us\n", name, basename,
+		(double)elapsed / iterations);
+
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	const gchar *default_files[] = {
+		TEST_DATA_DIR "/config-docker.json",
+		TEST_DATA_DIR "/config-crio.json",
+		NULL
+	};
+	const gchar **files = default_files;
+	guint iterations = DEFAULT_ITERATIONS;
+	gboolean ret = true;
+
+	if (argc > 1) {
+		iterations = (guint)g_ascii_strtoull (argv[1], NULL, 10);
+		if (! iterations) {
+			g_printerr ("usage: %s [iterations] [config.json ...]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc > 2) {
+		files = (const gchar **)argv + 2;
+	}
+
+	for (const gchar **f = files; *f; f++) {
+		ret &= run ("start gnode", *f, iterations,
+			parse_gnode, start_handlers);
+		ret &= run ("start direct", *f, iterations,
+			parse_direct, start_handlers);
+		ret &= run ("stop gnode", *f, iterations,
+			parse_gnode, stop_handlers);
+		ret &= run ("stop direct", *f, iterations,
+			parse_direct, stop_handlers);
+	}
+
+	ret &= run ("state gnode tree only", TEST_DATA_DIR "/state.json",
+		iterations, parse_state_gnode, NULL);
+	ret &= run ("state read", TEST_DATA_DIR "/state.json",
+		iterations, parse_state_direct, NULL);
+
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
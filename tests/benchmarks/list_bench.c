@@ -0,0 +1,243 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark for the ways "list" can gather the containers below a
+ * root directory:
+ *
+ * - "read all": full parse of every state file (the original "list").
+ * - "index cold": no index, so every state file is read (only the
+ *   fields "list" needs, in parallel) and the index is rebuilt.
+ * - "index warm": all containers listed from the index.
+ * - "ids only": "list --quiet", state files are not opened.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./list_bench [containers ...]
+ *
+ * By default, root directories holding 1000 and 10000 containers are
+ * measured.
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../../src/oci.h"
+#include "../../src/util.h"
+#include "../../src/state.h"
+#include "../../src/runtime.h"
+#include "../../src/state_index.h"
+
+/* Runs of each method (after a warm up run). */
+#define ITERATIONS 5
+
+/* State file as written by cc_oci_state_file_create() */
+#define STATE_FILE_TEMPLATE \
+	"{\"ociVersion\":\"1.0.0-rc1\",\"id\":\"%s\",\"pid\":%u," \
+	"\"bundlePath\":\"/var/lib/docker/containers/%s\"," \
+	"\"commsPath\":\"%s/hypervisor.sock\"," \
+	"\"processPath\":\"%s/process.sock\"," \
+	"\"workloadDir\":\"%s/workload\"," \
+	"\"status\":\"running\",\"created\":\"2017-01-01T00:00:00.000000Z\"," \
+	"\"mounts\":[{\"destination\":\"/etc/hostname\"," \
+	"\"directory_created\":\"\"},{\"destination\":\"/etc/hosts\"," \
+	"\"directory_created\":\"\"},{\"destination\":\"/etc/resolv.conf\"," \
+	"\"directory_created\":\"\"}]," \
+	"\"namespaces\":[{\"type\":\"network\",\"path\":\"\"}," \
+	"{\"type\":\"mount\",\"path\":\"\"}]," \
+	"\"process\":{\"terminal\":false,\"user\":{\"uid\":0,\"gid\":0}," \
+	"\"args\":[\"sh\",\"-c\",\"sleep 1000\"],\"env\":[\"PATH=/usr/bin\"," \
+	"\"HOSTNAME=%s\"],\"cwd\":\"/\"}," \
+	"\"console\":null," \
+	"\"vm\":{\"pid\":%u," \
+	"\"hypervisor_path\":\"/usr/bin/qemu-lite-system-x86_64\"," \
+	"\"image_path\":\"/usr/share/clear-containers/clear-containers.img\"," \
+	"\"kernel_path\":\"/usr/share/clear-containers/vmlinux.container\"," \
+	"\"workload_path\":\"/workload\"," \
+	"\"kernel_params\":\"root=/dev/pmem0p1 rw quiet\"}," \
+	"\"proxy\":{\"ctlSocket\":\"%s/ga-ctl.sock\"," \
+	"\"ioSocket\":\"%s/ga-tty.sock\",\"consoleSocket\":\"\"}}"
+
+static gboolean
+create_containers (const gchar *root_dir, guint count)
+{
+	for (guint i = 0; i < count; i++) {
+		g_autofree gchar *id = NULL;
+		g_autofree gchar *dir = NULL;
+		g_autofree gchar *file = NULL;
+		g_autofree gchar *contents = NULL;
+
+		id = g_strdup_printf ("%064x", i);
+		dir = g_build_path ("/", root_dir, id, NULL);
+		file = g_build_path ("/", dir, CC_OCI_STATE_FILE, NULL);
+
+		contents = g_strdup_printf (STATE_FILE_TEMPLATE,
+				id, 1000 + i, id, dir, dir, dir, id,
+				2000 + i, dir, dir);
+
+		if (g_mkdir (dir, CC_OCI_DIR_MODE) < 0 ||
+				! g_file_set_contents (file, contents, -1, NULL)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static guint
+read_all (const gchar *root_dir)
+{
+	GSList *ids = cc_oci_runtime_container_ids (root_dir);
+	GSList *l;
+	guint   count = 0;
+
+	for (l = ids; l; l = g_slist_next (l)) {
+		g_autofree gchar *file = NULL;
+		struct oci_state *state;
+
+		file = g_build_path ("/", root_dir, l->data,
+				CC_OCI_STATE_FILE, NULL);
+
+		state = cc_oci_state_file_read (file);
+		if (state) {
+			count++;
+		}
+		cc_oci_state_free (state);
+	}
+
+	g_slist_free_full (ids, g_free);
+
+	return count;
+}
+
+static guint
+index_list (const gchar *root_dir)
+{
+	GSList *states = cc_oci_state_index_list (root_dir);
+	guint   count = g_slist_length (states);
+
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	return count;
+}
+
+static guint
+index_cold (const gchar *root_dir)
+{
+	g_autofree gchar *index = NULL;
+
+	index = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_FILE, NULL);
+	(void)g_remove (index);
+
+	return index_list (root_dir);
+}
+
+static guint
+ids_only (const gchar *root_dir)
+{
+	GSList *ids = cc_oci_runtime_container_ids (root_dir);
+	guint   count = g_slist_length (ids);
+
+	g_slist_free_full (ids, g_free);
+
+	return count;
+}
+
+/*!
+ * Run \p func \ref ITERATIONS times and print the average time per
+ * call.
+ *
+ * \return \c true if \p func found all \p count containers, else
+ * \c false.
+ */
+static gboolean
+run (const gchar *name, const gchar *root_dir, guint count,
+	guint (*func) (const gchar *))
+{
+	gint64 start;
+	gint64 elapsed;
+
+	/* warm up the page and dentry caches */
+	if (func (root_dir) != count) {
+		g_printerr ("%s: failed to list %u containers\n", name, count);
+		return false;
+	}
+
+	start = g_get_monotonic_time ();
+
+	for (guint i = 0; i < ITERATIONS; i++) {
+		(void)func (root_dir);
+	}
+
+	elapsed = g_get_monotonic_time () - start;
+
+	g_print ("%-12s %8u %12.2f ms %10.2f us/container\n", name, count,
+		(double)elapsed / ITERATIONS / 1000,
+		(double)elapsed / ITERATIONS / count);
+
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	const gchar *default_counts[] = { "1000", "10000", NULL };
+	const gchar **counts = default_counts;
+	gboolean ret = true;
+
+	if (argc > 1) {
+		counts = (const gchar **)argv + 1;
+	}
+
+	for (const gchar **c = counts; ret && *c; c++) {
+		g_autofree gchar *root_dir = NULL;
+		guint count;
+
+		count = (guint)g_ascii_strtoull (*c, NULL, 10);
+		if (! count) {
+			g_printerr ("usage: %s [containers ...]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		root_dir = g_dir_make_tmp ("list_bench.XXXXXX", NULL);
+		if (! root_dir) {
+			g_printerr ("failed to create directory\n");
+			return EXIT_FAILURE;
+		}
+
+		ret = create_containers (root_dir, count);
+		if (! ret) {
+			g_printerr ("failed to create containers\n");
+		}
+
+		ret = ret && run ("read all", root_dir, count, read_all);
+		ret = ret && run ("index cold", root_dir, count, index_cold);
+		ret = ret && run ("index warm", root_dir, count, index_list);
+		ret = ret && run ("ids only", root_dir, count, ids_only);
+
+		(void)cc_oci_rm_rf (root_dir);
+	}
+
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,174 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark for the cost of debug logging on the "create" path.
+ *
+ * The host-independent part of "create" (processing the Docker config
+ * from tests/data with the "start" spec handlers and dumping a
+ * hypervisor command-line as cc_oci_vm_launch() does) is timed with
+ * logging disabled, with only a global logfile (the default for
+ * Docker), and with --debug.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./log_bench [iterations]
+ *
+ * Configuring with --disable-debug-logging compiles the debug messages
+ * out altogether, which gives the same result as "disabled".
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../../src/oci.h"
+#include "../../src/util.h"
+#include "../../src/logging.h"
+#include "../../src/oci-config.h"
+#include "../../src/spec_handler.h"
+
+#define DEFAULT_ITERATIONS 1000
+
+/* Number of hypervisor arguments dumped per iteration. */
+#define HYPERVISOR_ARGS 40
+
+/* handlers run by "create" that don't depend on the host */
+static struct spec_handler *start_handlers[] = {
+	&annotations_spec_handler,
+	&hooks_spec_handler,
+	&mounts_spec_handler,
+	&platform_spec_handler,
+	&process_spec_handler,
+	&linux_spec_handler,
+	NULL
+};
+
+static gboolean
+create (void)
+{
+	struct cc_oci_config *config = cc_oci_config_create ();
+	gboolean ret;
+
+	ret = cc_oci_process_config_file (TEST_DATA_DIR "/config-docker.json",
+			config, start_handlers);
+
+	g_debug ("running command:");
+	for (guint i = 0; i < HYPERVISOR_ARGS; i++) {
+		g_debug ("arg: '-device virtio-9p-pci,fsdev=extra-%u-9p'", i);
+	}
+
+	cc_oci_config_free (config);
+
+	return ret;
+}
+
+/*!
+ * Time \p iterations calls to create() with logging configured by
+ * \p options.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+run (const gchar *name, struct cc_log_options *options, guint iterations)
+{
+	gint64 start;
+	gint64 elapsed;
+
+	if (! cc_oci_log_init (options)) {
+		g_printerr ("failed to initialise logging\n");
+		return false;
+	}
+
+	/* warm up the page cache */
+	if (! create ()) {
+		g_printerr ("failed to process config\n");
+		return false;
+	}
+
+	start = g_get_monotonic_time ();
+
+	for (guint i = 0; i < iterations; i++) {
+		(void)create ();
+	}
+
+	cc_oci_log_flush ();
+
+	elapsed = g_get_monotonic_time () - start;
+
+	g_print ("%-16s %10.2f us\n", name, (double)elapsed / iterations);
+
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	struct cc_log_options options = { 0 };
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *logfile = NULL;
+	g_autofree gchar *global_logfile = NULL;
+	guint iterations = DEFAULT_ITERATIONS;
+	gboolean ret;
+
+	if (argc > 1) {
+		iterations = (guint)g_ascii_strtoull (argv[1], NULL, 10);
+		if (! iterations) {
+			g_printerr ("usage: %s [iterations]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	tmpdir = g_dir_make_tmp ("log_bench.XXXXXX", NULL);
+	if (! tmpdir) {
+		g_printerr ("failed to create directory\n");
+		return EXIT_FAILURE;
+	}
+
+	logfile = g_build_path ("/", tmpdir, "container.log", NULL);
+	global_logfile = g_build_path ("/", tmpdir, "global.log", NULL);
+
+	ret = run ("disabled", &options, iterations);
+
+	if (ret) {
+		options.global_logfile = global_logfile;
+		ret = run ("global log", &options, iterations);
+	}
+
+	if (ret) {
+		options.filename = logfile;
+		options.enable_debug = true;
+		ret = run ("--debug", &options, iterations);
+	}
+
+	/* close the logfiles */
+	options.filename = NULL;
+	options.global_logfile = NULL;
+	(void)cc_oci_log_init (&options);
+
+	(void)g_remove (logfile);
+	(void)g_remove (global_logfile);
+	(void)g_remove (tmpdir);
+
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
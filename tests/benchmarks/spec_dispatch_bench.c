@@ -0,0 +1,257 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark for the dispatch of config.json and state.json sections
+ * to their handlers.
+ *
+ * The Docker config from tests/data is extended with the specified
+ * numbers of extra mounts and environment variables and parsed with
+ * the "start" spec handlers. Section lookup by perfect hash is also
+ * compared with the linear search it replaced.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./spec_dispatch_bench [iterations] [entries ...]
+ *
+ * By default configs with 100 and 1000 extra entries are used.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../../src/oci.h"
+#include "../../src/json.h"
+#include "../../src/util.h"
+#include "../../src/section.h"
+#include "../../src/oci-config.h"
+#include "../../src/spec_handler.h"
+
+#define DEFAULT_ITERATIONS 100
+
+/* Section lookups per iteration. */
+#define LOOKUPS 100000
+
+/* handlers run by "start" that don't depend on the host */
+static struct spec_handler *start_handlers[] = {
+	&annotations_spec_handler,
+	&hooks_spec_handler,
+	&mounts_spec_handler,
+	&platform_spec_handler,
+	&process_spec_handler,
+	&linux_spec_handler,
+	NULL
+};
+
+/* top-level members of the state file, in the order written */
+static const gchar *state_members[] = {
+	"ociVersion", "id", "pid", "bundlePath", "commsPath",
+	"processPath", "workloadDir", "status", "created", "mounts",
+	"namespaces", "process", "console", "vm", "proxy", "annotations",
+};
+
+/*!
+ * Write a copy of the Docker config with \p entries extra mounts and
+ * environment variables to \p file.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+make_config (const gchar *file, guint entries)
+{
+	JsonParser  *parser;
+	JsonObject  *root;
+	JsonArray   *mounts;
+	JsonArray   *env;
+	gchar       *str;
+	gsize        len = 0;
+	gboolean     ret;
+
+	parser = cc_oci_json_load (TEST_DATA_DIR "/config-docker.json");
+	if (! parser) {
+		return false;
+	}
+
+	root = json_node_get_object (json_parser_get_root (parser));
+	mounts = json_object_get_array_member (root, "mounts");
+	env = json_object_get_array_member (
+			json_object_get_object_member (root, "process"), "env");
+
+	for (guint i = 0; i < entries; i++) {
+		JsonObject *mount = json_object_new ();
+		JsonArray  *options = json_array_new ();
+		g_autofree gchar *destination = NULL;
+		g_autofree gchar *var = NULL;
+
+		destination = g_strdup_printf ("/mnt/volume%u", i);
+		json_object_set_string_member (mount, "destination",
+				destination);
+		json_object_set_string_member (mount, "type", "tmpfs");
+		json_object_set_string_member (mount, "source", "tmpfs");
+		json_array_add_string_element (options, "nosuid");
+		json_array_add_string_element (options, "nodev");
+		json_object_set_array_member (mount, "options", options);
+		json_array_add_object_element (mounts, mount);
+
+		var = g_strdup_printf ("VARIABLE_%u=value %u", i, i);
+		json_array_add_string_element (env, var);
+	}
+
+	str = cc_oci_json_obj_to_string (root, false, &len);
+	ret = str && g_file_set_contents (file, str, (gssize)len, NULL);
+
+	g_free (str);
+	g_object_unref (parser);
+
+	return ret;
+}
+
+static gboolean
+parse_config (const gchar *file)
+{
+	struct cc_oci_config *config = cc_oci_config_create ();
+	gboolean ret;
+
+	ret = cc_oci_process_config_file (file, config, start_handlers);
+
+	cc_oci_config_free (config);
+
+	return ret;
+}
+
+static enum cc_oci_section
+lookup_linear (const gchar *name)
+{
+	for (gint s = CC_OCI_SECTION_UNKNOWN + 1;
+			s < CC_OCI_SECTION_COUNT; s++) {
+		if (! g_strcmp0 (cc_oci_section_name (s), name)) {
+			return s;
+		}
+	}
+
+	return CC_OCI_SECTION_UNKNOWN;
+}
+
+/*!
+ * Time \ref LOOKUPS lookups of the state file members using \p func.
+ */
+static void
+run_lookup (const gchar *name, guint iterations,
+	enum cc_oci_section (*func) (const gchar *))
+{
+	volatile guint  sink = 0;
+	gint64          start;
+	gint64          elapsed;
+
+	start = g_get_monotonic_time ();
+
+	for (guint i = 0; i < iterations; i++) {
+		for (guint j = 0; j < LOOKUPS; j++) {
+			sink += func (state_members[j %
+					G_N_ELEMENTS (state_members)]);
+		}
+	}
+
+	elapsed = g_get_monotonic_time () - start;
+
+	g_print ("%-24s %10.2f ns/lookup\n", name,
+		(double)elapsed * 1000 / ((double)iterations * LOOKUPS));
+}
+
+int
+main (int argc, char *argv[])
+{
+	const gchar *default_entries[] = { "100", "1000", NULL };
+	const gchar **entries = default_entries;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *file = NULL;
+	guint iterations = DEFAULT_ITERATIONS;
+	gboolean ret = true;
+
+	if (argc > 1) {
+		iterations = (guint)g_ascii_strtoull (argv[1], NULL, 10);
+		if (! iterations) {
+			g_printerr ("usage: %s [iterations] [entries ...]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc > 2) {
+		entries = (const gchar **)argv + 2;
+	}
+
+	tmpdir = g_dir_make_tmp ("spec_dispatch_bench.XXXXXX", NULL);
+	if (! tmpdir) {
+		g_printerr ("failed to create directory\n");
+		return EXIT_FAILURE;
+	}
+
+	file = g_build_path ("/", tmpdir, CC_OCI_CONFIG_FILE, NULL);
+
+	for (const gchar **e = entries; ret && *e; e++) {
+		guint   count = (guint)g_ascii_strtoull (*e, NULL, 10);
+		gint64  start;
+		gint64  elapsed;
+
+		if (! make_config (file, count)) {
+			g_printerr ("failed to create config with %u entries\n",
+					count);
+			ret = false;
+			break;
+		}
+
+		/* warm up the page cache */
+		if (! parse_config (file)) {
+			g_printerr ("failed to parse config with %u entries\n",
+					count);
+			ret = false;
+			break;
+		}
+
+		start = g_get_monotonic_time ();
+
+		for (guint i = 0; i < iterations; i++) {
+			(void)parse_config (file);
+		}
+
+		elapsed = g_get_monotonic_time () - start;
+
+		g_print ("%-16s %6u entries %10.2f us\n", "start config",
+			count, (double)elapsed / iterations);
+	}
+
+	if (ret) {
+		run_lookup ("section perfect hash", iterations,
+				cc_oci_section_from_name);
+		run_lookup ("section linear search", iterations,
+				lookup_linear);
+	}
+
+	(void)g_remove (file);
+	(void)g_remove (tmpdir);
+
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,296 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark measuring the state file writes made over a container
+ * lifecycle (create, start, pause, resume, kill), comparing
+ * recreating the state file on every transition with only updating
+ * the fields that change, for each \ref cc_oci_state_sync mode.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./state_update_bench [iterations] [directory]
+ *
+ * The directory (by default a new one below $TMPDIR) determines the
+ * file system used, which matters when flushing is enabled.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "../../src/oci.h"
+#include "../../src/util.h"
+#include "../../src/json.h"
+#include "../../src/state.h"
+#include "../../src/runtime.h"
+#include "../../src/oci-config.h"
+
+#define DEFAULT_ITERATIONS 100
+
+static const gchar *timestamp = "2017-01-01T00:00:00.000000Z";
+
+/* status after each transition following create */
+static const enum oci_status transitions[] = {
+	OCI_STATUS_RUNNING,     /* start */
+	OCI_STATUS_PAUSED,      /* pause */
+	OCI_STATUS_RUNNING,     /* resume */
+	OCI_STATUS_STOPPED,     /* kill */
+};
+
+struct bench_result {
+	gint64 usecs;
+	gint64 bytes;
+	guint  writes;
+};
+
+static struct cc_oci_config *
+setup_config (const gchar *root_dir)
+{
+	struct cc_oci_config *config = cc_oci_config_create ();
+
+	config->optarg_container_id = "bench";
+	config->root_dir = g_strdup (root_dir);
+	config->bundle_path = g_strdup ("/tmp/bundle-for-bench");
+	config->console = g_strdup ("/dev/pts/0");
+	config->state.workload_pid = getpid ();
+
+	if (! cc_oci_runtime_dir_setup (config)) {
+		cc_oci_config_free (config);
+		return NULL;
+	}
+
+	g_strlcpy (config->oci.process.cwd, "/",
+			sizeof (config->oci.process.cwd));
+	config->oci.process.args = g_strsplit ("/bin/sh -c true", " ", -1);
+	config->oci.process.env = g_strsplit ("PATH=/usr/bin:/bin "
+			"TERM=xterm HOME=/root", " ", -1);
+
+	config->vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	config->vm->pid = getpid ();
+	g_strlcpy (config->vm->hypervisor_path,
+			"/usr/bin/qemu-lite-system-x86_64",
+			sizeof (config->vm->hypervisor_path));
+	g_strlcpy (config->vm->image_path,
+			"/usr/share/clear-containers/clear-containers.img",
+			sizeof (config->vm->image_path));
+	g_strlcpy (config->vm->kernel_path,
+			"/usr/share/clear-containers/vmlinux.container",
+			sizeof (config->vm->kernel_path));
+	g_strlcpy (config->vm->workload_path, "/workload",
+			sizeof (config->vm->workload_path));
+	config->vm->kernel_params = g_strdup ("root=/dev/pmem0p1 "
+			"rootflags=dax,data=ordered,errors=remount-ro rw "
+			"rootfstype=ext4 tsc=reliable no_timer_check "
+			"rcupdate.rcu_expedited=1 i8042.direct=1 "
+			"i8042.dumbkbd=1 i8042.nopnp=1 i8042.noaux=1 "
+			"noreplace-smp reboot=k panic=1 console=hvc0 "
+			"console=hvc1 initcall_debug iommu=off quiet "
+			"cryptomgr.notests net.ifnames=0");
+
+	config->proxy->agent_ctl_socket = g_strdup ("/run/cc-oci-runtime/"
+			"bench/ga-ctl.sock");
+	config->proxy->agent_tty_socket = g_strdup ("/run/cc-oci-runtime/"
+			"bench/ga-tty.sock");
+	config->proxy->vm_console_socket = g_strdup ("/run/cc-oci-runtime/"
+			"bench/console.sock");
+
+	return config;
+}
+
+static gint64
+state_file_size (const struct cc_oci_config *config)
+{
+	struct stat st;
+
+	return stat (config->state.state_file_path, &st) < 0
+		? 0 : (gint64)st.st_size;
+}
+
+/*!
+ * Write the state file as done over a container lifecycle.
+ *
+ * \param config \ref cc_oci_config.
+ * \param update If \c true, use cc_oci_state_file_update() for
+ *   transitions after "create", else recreate the state file.
+ * \param[out] result \ref bench_result to add to.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+lifecycle (struct cc_oci_config *config, gboolean update,
+		struct bench_result *result)
+{
+	gint64 start = g_get_monotonic_time ();
+	gint64 bytes = 0;
+
+	config->state.status = OCI_STATUS_CREATED;
+
+	/* "create" writes the state file twice: before the hooks run
+	 * and once the proxy details are known.
+	 */
+	for (int i = 0; i < 2; i++) {
+		if (! cc_oci_state_file_create (config, timestamp)) {
+			return false;
+		}
+		bytes += state_file_size (config);
+	}
+
+	for (gsize i = 0; i < G_N_ELEMENTS (transitions); i++) {
+		gboolean ret;
+
+		config->state.status = transitions[i];
+
+		ret = update
+			? cc_oci_state_file_update (config,
+					CC_OCI_STATE_UPDATE_STATUS)
+			: cc_oci_state_file_create (config, timestamp);
+		if (! ret) {
+			return false;
+		}
+		bytes += state_file_size (config);
+	}
+
+	result->usecs += g_get_monotonic_time () - start;
+	result->bytes += bytes;
+	result->writes += (guint)(2 + G_N_ELEMENTS (transitions));
+
+	return true;
+}
+
+/*!
+ * Display the size of the state file when pretty-printed and
+ * compactly encoded.
+ */
+static gboolean
+show_encoding (const struct cc_oci_config *config)
+{
+	JsonParser *parser;
+	JsonObject *obj;
+	gchar      *str;
+	gsize       pretty_len = 0;
+	gsize       compact_len = 0;
+
+	parser = cc_oci_json_load (config->state.state_file_path);
+	if (! parser) {
+		return false;
+	}
+
+	obj = json_node_get_object (json_parser_get_root (parser));
+
+	str = cc_oci_json_obj_to_string (obj, true, &pretty_len);
+	g_free (str);
+
+	str = cc_oci_json_obj_to_string (obj, false, &compact_len);
+	g_free (str);
+
+	g_object_unref (parser);
+
+	g_print ("state file size: %lu bytes pretty, %lu bytes compact\n\n",
+			(unsigned long int)pretty_len,
+			(unsigned long int)compact_len);
+
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	const struct {
+		const gchar *name;
+		enum cc_oci_state_sync sync;
+	} modes[] = {
+		{ "none", CC_OCI_STATE_SYNC_NONE },
+		{ "file", CC_OCI_STATE_SYNC_FILE },
+		{ "full", CC_OCI_STATE_SYNC_FULL },
+	};
+	struct cc_oci_config *config;
+	g_autofree gchar *root_dir = NULL;
+	guint iterations = DEFAULT_ITERATIONS;
+	gboolean ret = true;
+
+	if (argc > 1) {
+		iterations = (guint)g_ascii_strtoull (argv[1], NULL, 10);
+		if (! iterations) {
+			g_printerr ("usage: %s [iterations] [directory]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	root_dir = argc > 2
+		? g_build_path ("/", argv[2], "state_update_bench.XXXXXX", NULL)
+		: g_build_path ("/", g_get_tmp_dir (),
+				"state_update_bench.XXXXXX", NULL);
+
+	if (! g_mkdtemp (root_dir)) {
+		g_printerr ("failed to create directory %s\n", root_dir);
+		return EXIT_FAILURE;
+	}
+
+	config = setup_config (root_dir);
+	if (! config) {
+		g_printerr ("failed to setup runtime directory\n");
+		(void)cc_oci_rm_rf (root_dir);
+		return EXIT_FAILURE;
+	}
+
+	g_print ("%-6s %-8s %14s %14s %14s\n", "sync", "method",
+			"us/lifecycle", "us/write", "bytes/lifecycle");
+
+	for (gsize m = 0; ret && m < G_N_ELEMENTS (modes); m++) {
+		config->state.sync = modes[m].sync;
+
+		for (int update = 0; ret && update < 2; update++) {
+			struct bench_result result = { 0 };
+
+			for (guint i = 0; ret && i < iterations; i++) {
+				ret = lifecycle (config, update, &result);
+			}
+
+			if (! ret) {
+				g_printerr ("failed to write state file\n");
+				break;
+			}
+
+			g_print ("%-6s %-8s %14.2f %14.2f %14.0f\n",
+					modes[m].name,
+					update ? "update" : "recreate",
+					(double)result.usecs / iterations,
+					(double)result.usecs / result.writes,
+					(double)result.bytes / iterations);
+		}
+	}
+
+	if (ret) {
+		g_print ("\n");
+		ret = show_encoding (config);
+	}
+
+	cc_oci_config_free (config);
+	(void)cc_oci_rm_rf (root_dir);
+
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
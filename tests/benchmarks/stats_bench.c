@@ -0,0 +1,129 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Benchmark for the per-container cost of "events --stats".
+ *
+ * The host-side stats of a process (by default the benchmark itself,
+ * standing in for a hypervisor) are sampled repeatedly, and each
+ * sample is encoded both as a full stats record and as a delta
+ * against the previous sample. The time taken and the size of the
+ * records are shown per sample.
+ *
+ * Built by "make check" but not run as part of the test suite:
+ *
+ *     $ ./stats_bench [iterations] [pid]
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "../../src/oci.h"
+#include "../../src/util.h"
+#include "../../src/stats.h"
+
+#define DEFAULT_ITERATIONS 1000
+
+int
+main (int argc, char *argv[])
+{
+	struct cc_oci_stats  prev;
+	struct cc_oci_stats  stats;
+	guint                iterations = DEFAULT_ITERATIONS;
+	GPid                 pid = getpid ();
+	gint64               sample_time = 0;
+	gint64               full_time = 0;
+	gint64               delta_time = 0;
+	guint64              full_bytes = 0;
+	guint64              delta_bytes = 0;
+
+	if (argc > 1) {
+		iterations = (guint)g_ascii_strtoull (argv[1], NULL, 10);
+	}
+
+	if (argc > 2) {
+		pid = (GPid)g_ascii_strtoll (argv[2], NULL, 10);
+	}
+
+	if (! iterations || pid <= 0 || argc > 3) {
+		g_printerr ("usage: %s [iterations] [pid]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	cc_oci_stats_init (&prev);
+
+	for (guint i = 0; i < iterations; i++) {
+		JsonObject  *obj;
+		gchar       *str;
+		gsize        len = 0;
+		gint64       start;
+
+		cc_oci_stats_init (&stats);
+
+		start = g_get_monotonic_time ();
+		if (! cc_oci_stats_get_host (pid, NULL, &stats)) {
+			g_printerr ("failed to get stats for pid %d\n",
+					(int)pid);
+			return EXIT_FAILURE;
+		}
+		sample_time += g_get_monotonic_time () - start;
+
+		start = g_get_monotonic_time ();
+		obj = cc_oci_stats_to_json (&stats);
+		str = cc_oci_json_obj_to_string (obj, false, &len);
+		full_time += g_get_monotonic_time () - start;
+		full_bytes += len;
+		json_object_unref (obj);
+		g_free (str);
+
+		start = g_get_monotonic_time ();
+		obj = json_object_new ();
+		(void)cc_oci_stats_delta (i ? &prev : NULL, &stats, obj);
+		str = cc_oci_json_obj_to_string (obj, false, &len);
+		delta_time += g_get_monotonic_time () - start;
+		delta_bytes += len;
+		json_object_unref (obj);
+		g_free (str);
+
+		cc_oci_stats_clear (&prev);
+		prev = stats;
+
+		/* let the counters move */
+		g_usleep (1000);
+	}
+
+	cc_oci_stats_clear (&prev);
+
+	g_print ("%-16s %10.2f us\n", "sample",
+			(double)sample_time / iterations);
+	g_print ("%-16s %10.2f us %10.2f bytes\n", "full record",
+			(double)full_time / iterations,
+			(double)full_bytes / iterations);
+	g_print ("%-16s %10.2f us %10.2f bytes\n", "delta record",
+			(double)delta_time / iterations,
+			(double)delta_bytes / iterations);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/oci-config.h"
+#include "../src/state.h"
+#include "../src/util.h"
+#include "../src/checkpoint.h"
+
+gchar *cc_oci_checkpoint_uri (const gchar *vm_file);
+struct oci_state *cc_oci_checkpoint_state_read (const gchar *image_path,
+		const gchar *container_id);
+
+START_TEST(test_cc_oci_checkpoint_uri) {
+	gchar *uri;
+
+	ck_assert (! cc_oci_checkpoint_uri (NULL));
+
+	uri = cc_oci_checkpoint_uri ("/tmp/image/vm.img");
+	ck_assert_str_eq (uri, "exec:cat > '/tmp/image/vm.img'");
+	g_free (uri);
+
+	/* the path is quoted for the shell */
+	uri = cc_oci_checkpoint_uri ("/tmp/it's here/vm.img");
+	ck_assert_str_eq (uri, "exec:cat > '/tmp/it'\\''s here/vm.img'");
+	g_free (uri);
+
+} END_TEST
+
+START_TEST(test_cc_oci_checkpoint_state_read) {
+	struct cc_oci_config *config = NULL;
+	struct oci_state *state;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *image_path = NULL;
+	g_autofree gchar *state_file = NULL;
+	g_autofree gchar *vm_file = NULL;
+	gchar *contents = NULL;
+	gsize len = 0;
+
+	ck_assert (tmpdir);
+
+	image_path = g_build_path ("/", tmpdir, "image", NULL);
+	state_file = g_build_path ("/", image_path, CC_OCI_STATE_FILE, NULL);
+	vm_file = g_build_path ("/", image_path,
+			CC_OCI_CHECKPOINT_VM_FILE, NULL);
+
+	ck_assert (! cc_oci_checkpoint_state_read (NULL, NULL));
+	ck_assert (! cc_oci_checkpoint_state_read (image_path, NULL));
+	ck_assert (! cc_oci_checkpoint_state_read (NULL, "foo"));
+
+	/* no image */
+	ck_assert (! cc_oci_checkpoint_state_read (image_path, "foo"));
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	config->oci.process.stdio_stream = 3;
+	config->oci.process.stderr_stream = 4;
+
+	ck_assert (test_helper_create_state_file ("foo", tmpdir, config));
+
+	ck_assert (g_mkdir (image_path, 0700) == 0);
+	ck_assert (g_file_get_contents (config->state.state_file_path,
+				&contents, &len, NULL));
+	ck_assert (g_file_set_contents (state_file, contents,
+				(gssize)len, NULL));
+	g_free (contents);
+
+	/* incomplete image */
+	ck_assert (! cc_oci_checkpoint_state_read (image_path, "foo"));
+
+	ck_assert (g_file_set_contents (vm_file, "QEVM", -1, NULL));
+
+	/* image of another container */
+	ck_assert (! cc_oci_checkpoint_state_read (image_path, "bar"));
+
+	state = cc_oci_checkpoint_state_read (image_path, "foo");
+	ck_assert (state);
+	ck_assert (! g_strcmp0 (state->id, "foo"));
+	ck_assert (state->process);
+	ck_assert (state->process->stdio_stream == 3);
+	cc_oci_state_free (state);
+
+	cc_oci_config_free (config);
+	ck_assert (cc_oci_rm_rf (tmpdir));
+
+} END_TEST
+
+START_TEST(test_cc_oci_checkpoint) {
+	struct cc_oci_config *config = NULL;
+	struct oci_state state = { 0 };
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	ck_assert (! cc_oci_checkpoint (NULL, NULL, NULL, false, false));
+	ck_assert (! cc_oci_checkpoint (config, NULL, NULL, false, false));
+	ck_assert (! cc_oci_checkpoint (config, &state, NULL, false, false));
+	ck_assert (! cc_oci_checkpoint (NULL, &state, "image", false, false));
+
+	config->vm = g_malloc0 (sizeof (struct cc_oci_vm_cfg));
+	ck_assert (config->vm);
+
+	/* only running containers can be checkpointed */
+	state.status = OCI_STATUS_CREATED;
+	ck_assert (! cc_oci_checkpoint (config, &state, "image", false, false));
+
+	state.status = OCI_STATUS_STOPPED;
+	ck_assert (! cc_oci_checkpoint (config, &state, "image", true, false));
+	ck_assert (! cc_oci_checkpoint (config, &state, "image", false, true));
+
+	/* a 9p rootfs cannot be migrated */
+	state.status = OCI_STATUS_RUNNING;
+	ck_assert (! config->device_name);
+	ck_assert (! config->state.block_fstype);
+	ck_assert (! cc_oci_checkpoint (config, &state, "image", false, false));
+	ck_assert (! g_file_test ("image", G_FILE_TEST_EXISTS));
+
+	state.status = OCI_STATUS_PAUSED;
+	ck_assert (! cc_oci_checkpoint (config, &state, "image", false, false));
+	ck_assert (! g_file_test ("image", G_FILE_TEST_EXISTS));
+
+	cc_oci_config_free (config);
+
+} END_TEST
+
+START_TEST(test_cc_oci_restore) {
+	struct cc_oci_config *config = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+
+	ck_assert (tmpdir);
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	config->optarg_container_id = "foo";
+
+	ck_assert (! cc_oci_restore (NULL, NULL));
+	ck_assert (! cc_oci_restore (config, NULL));
+	ck_assert (! cc_oci_restore (NULL, tmpdir));
+
+	/* no image */
+	ck_assert (! cc_oci_restore (config, tmpdir));
+	ck_assert (! config->restore_path);
+
+	cc_oci_config_free (config);
+	ck_assert (cc_oci_rm_rf (tmpdir));
+
+} END_TEST
+
+Suite* make_checkpoint_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_checkpoint_uri, s);
+	ADD_TEST(test_cc_oci_checkpoint_state_read, s);
+	ADD_TEST(test_cc_oci_checkpoint, s);
+	ADD_TEST(test_cc_oci_restore, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("checkpoint_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_checkpoint_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,227 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/util.h"
+#include "../src/oci-config.h"
+#include "../src/config_cache.h"
+
+static struct oci_cfg_hook *
+make_hook (const gchar *path, const gchar *args, gint timeout)
+{
+	struct oci_cfg_hook *hook = g_new0 (struct oci_cfg_hook, 1);
+
+	g_strlcpy (hook->path, path, sizeof (hook->path));
+	hook->args = args ? g_strsplit (args, " ", -1) : NULL;
+	hook->env = g_strsplit ("FOO=bar HOME=/", " ", -1);
+	hook->timeout = timeout;
+
+	return hook;
+}
+
+static void
+check_strv (gchar **a, gchar **b)
+{
+	if (! a || ! b) {
+		ck_assert (a == b);
+		return;
+	}
+
+	ck_assert (g_strv_length (a) == g_strv_length (b));
+
+	for (guint i = 0; a[i]; i++) {
+		ck_assert (! g_strcmp0 (a[i], b[i]));
+	}
+}
+
+static void
+check_hooks (GSList *a, GSList *b)
+{
+	ck_assert (g_slist_length (a) == g_slist_length (b));
+
+	for (; a && b; a = g_slist_next (a), b = g_slist_next (b)) {
+		struct oci_cfg_hook *ha = a->data;
+		struct oci_cfg_hook *hb = b->data;
+
+		ck_assert (! g_strcmp0 (ha->path, hb->path));
+		check_strv (ha->args, hb->args);
+		check_strv (ha->env, hb->env);
+		ck_assert (ha->timeout == hb->timeout);
+	}
+}
+
+START_TEST(test_cc_oci_config_cache) {
+	struct cc_oci_config *config = NULL;
+	struct cc_oci_config *loaded = NULL;
+	struct oci_cfg_namespace *ns;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *config_file = NULL;
+	g_autofree gchar *cache_file = NULL;
+	g_autofree gchar *contents = NULL;
+	gsize len;
+
+	ck_assert (! cc_oci_config_cache_save (NULL));
+	ck_assert (! cc_oci_config_cache_load (NULL, NULL));
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	config_file = g_build_path ("/", tmpdir, CC_OCI_CONFIG_FILE, NULL);
+
+	/* no bundle or runtime path */
+	ck_assert (! cc_oci_config_cache_save (config));
+	ck_assert (! cc_oci_config_cache_load (config, config_file));
+
+	config->bundle_path = g_strdup (tmpdir);
+	g_strlcpy (config->state.runtime_path, tmpdir,
+			sizeof (config->state.runtime_path));
+
+	/* no config file */
+	ck_assert (! cc_oci_config_cache_save (config));
+
+	ck_assert (g_file_set_contents (config_file, "{}", -1, NULL));
+
+	config->oci.hooks.prestart = g_slist_append (NULL,
+			make_hook ("/bin/true", "true --foo", 0));
+	config->oci.hooks.prestart = g_slist_append
+		(config->oci.hooks.prestart,
+		 make_hook ("/bin/echo", NULL, 5));
+	config->oci.hooks.poststop = g_slist_append (NULL,
+			make_hook ("/bin/false", "false", 10));
+
+	ns = g_new0 (struct oci_cfg_namespace, 1);
+	ns->type = OCI_NS_NET;
+	ns->path = g_strdup ("/proc/1/ns/net");
+	config->oci.oci_linux.namespaces = g_slist_append (NULL, ns);
+
+	ns = g_new0 (struct oci_cfg_namespace, 1);
+	ns->type = OCI_NS_MOUNT;
+	config->oci.oci_linux.namespaces = g_slist_append
+		(config->oci.oci_linux.namespaces, ns);
+
+	config->oci.oci_linux.cgroupsPath = g_strdup ("/docker/foo");
+
+	ck_assert (cc_oci_config_cache_save (config));
+
+	cache_file = g_build_path ("/", tmpdir,
+			CC_OCI_CONFIG_CACHE_FILE, NULL);
+	ck_assert (g_file_test (cache_file, G_FILE_TEST_EXISTS));
+
+	/* restore */
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	g_strlcpy (loaded->state.runtime_path, tmpdir,
+			sizeof (loaded->state.runtime_path));
+
+	ck_assert (cc_oci_config_cache_load (loaded, config_file));
+
+	check_hooks (loaded->oci.hooks.prestart,
+			config->oci.hooks.prestart);
+	check_hooks (loaded->oci.hooks.poststart,
+			config->oci.hooks.poststart);
+	check_hooks (loaded->oci.hooks.poststop,
+			config->oci.hooks.poststop);
+
+	ck_assert (g_slist_length (loaded->oci.oci_linux.namespaces) == 2);
+	ns = loaded->oci.oci_linux.namespaces->data;
+	ck_assert (ns->type == OCI_NS_NET);
+	ck_assert (! g_strcmp0 (ns->path, "/proc/1/ns/net"));
+	ns = loaded->oci.oci_linux.namespaces->next->data;
+	ck_assert (ns->type == OCI_NS_MOUNT);
+	ck_assert (! ns->path);
+
+	ck_assert (! g_strcmp0 (loaded->oci.oci_linux.cgroupsPath,
+				"/docker/foo"));
+
+	cc_oci_config_free (loaded);
+
+	/* a damaged cache is ignored and the config left untouched */
+	ck_assert (g_file_get_contents (cache_file, &contents, &len, NULL));
+	contents[len - 1] ^= 0xff;
+	ck_assert (g_file_set_contents (cache_file, contents, (gssize)len,
+				NULL));
+
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	g_strlcpy (loaded->state.runtime_path, tmpdir,
+			sizeof (loaded->state.runtime_path));
+
+	ck_assert (! cc_oci_config_cache_load (loaded, config_file));
+	ck_assert (! loaded->oci.hooks.prestart);
+	ck_assert (! loaded->oci.oci_linux.namespaces);
+	ck_assert (! loaded->oci.oci_linux.cgroupsPath);
+
+	/* a truncated cache is ignored */
+	ck_assert (g_file_set_contents (cache_file, contents, 8, NULL));
+	ck_assert (! cc_oci_config_cache_load (loaded, config_file));
+
+	/* a cache for a different config file is ignored */
+	ck_assert (cc_oci_config_cache_save (config));
+	ck_assert (cc_oci_config_cache_load (loaded, config_file));
+	ck_assert (g_file_set_contents (config_file, "{ }", -1, NULL));
+	ck_assert (! cc_oci_config_cache_load (loaded, config_file));
+
+	/* clean up */
+	ck_assert (! g_remove (cache_file));
+	ck_assert (! g_remove (config_file));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (loaded);
+	cc_oci_config_free (config);
+} END_TEST
+
+Suite* make_config_cache_suite(void) {
+	Suite* s = suite_create(__FILE__);
+	ADD_TEST(test_cc_oci_config_cache, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("config_cache_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_config_cache_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,289 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/daemon.h"
+#include "../src/daemon_client.h"
+
+static void
+make_request (struct cc_oci_daemon_request *request,
+		gsize size, guint32 argc, guint32 envc)
+{
+	request->magic = CC_OCI_DAEMON_MAGIC;
+	request->version = CC_OCI_DAEMON_VERSION;
+	request->argc = argc;
+	request->envc = envc;
+	request->size = (guint32)size;
+}
+
+START_TEST(test_cc_oci_daemon_request_parse) {
+	struct cc_oci_daemon_request request = { 0 };
+	const gchar payload[] = "/tmp\0prog\0list\0A=b\0C=d";
+	const gchar *cwd = NULL;
+	gchar **argv = NULL;
+	gchar **envp = NULL;
+
+	ck_assert (! cc_oci_daemon_request_parse (NULL, NULL,
+				NULL, NULL, NULL));
+
+	make_request (&request, sizeof (payload), 2, 2);
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				NULL, &argv, &envp));
+
+	/* bad magic */
+	request.magic = 0;
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	/* bad version */
+	make_request (&request, sizeof (payload), 2, 2);
+	request.version = CC_OCI_DAEMON_VERSION + 1;
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	/* no arguments */
+	make_request (&request, sizeof (payload), 0, 4);
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	/* too many strings */
+	make_request (&request, sizeof (payload), 3, 2);
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	/* too few strings */
+	make_request (&request, sizeof (payload), 1, 2);
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	/* not terminated */
+	make_request (&request, sizeof (payload) - 1, 2, 2);
+	ck_assert (! cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	make_request (&request, sizeof (payload), 2, 2);
+	ck_assert (cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+
+	ck_assert_str_eq (cwd, "/tmp");
+	ck_assert (g_strv_length (argv) == 2);
+	ck_assert_str_eq (argv[0], "prog");
+	ck_assert_str_eq (argv[1], "list");
+	ck_assert (g_strv_length (envp) == 2);
+	ck_assert_str_eq (envp[0], "A=b");
+	ck_assert_str_eq (envp[1], "C=d");
+
+	g_free (argv);
+	g_free (envp);
+
+	/* no environment */
+	make_request (&request, 15, 2, 0);
+	ck_assert (cc_oci_daemon_request_parse (payload, &request,
+				&cwd, &argv, &envp));
+	ck_assert (g_strv_length (argv) == 2);
+	ck_assert (! envp[0]);
+
+	g_free (argv);
+	g_free (envp);
+} END_TEST
+
+/* Prints the arguments and the value of $TEST_VAR, failing if the
+ * first argument is "fail" (and refusing the commands the daemon
+ * refuses).
+ */
+static gboolean
+test_handler (int argc, char **argv)
+{
+	g_autofree gchar *cwd = g_get_current_dir ();
+
+	if (cc_oci_daemon_refuse_command (argv[1])) {
+		return false;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		printf ("%s ", argv[i]);
+	}
+
+	printf ("%s %s", g_getenv ("TEST_VAR"), cwd);
+
+	return g_strcmp0 (argv[1], "fail") != 0;
+}
+
+/*!
+ * Run a command through the daemon, returning its exit status and
+ * output.
+ */
+static int
+run_client (const gchar *socket_path, const gchar *arg,
+		gchar **output)
+{
+	char *argv[] = { "cc-oci-runtime", (char *)arg, NULL };
+	char *envp[] = { "TEST_VAR=hello", NULL };
+	char buffer[LINE_MAX] = { 0 };
+	int pipefd[2];
+	int fds[CC_OCI_DAEMON_FDS];
+	int status = -1;
+	ssize_t len;
+
+	ck_assert (! pipe (pipefd));
+
+	fds[0] = STDIN_FILENO;
+	fds[1] = pipefd[1];
+	fds[2] = STDERR_FILENO;
+
+	/* wait for the daemon to start */
+	for (int i = 0; i < 100 && status < 0; i++) {
+		status = cc_oci_daemon_client_run (socket_path, 2, argv,
+				envp, fds);
+		if (status < 0) {
+			g_usleep (G_USEC_PER_SEC / 20);
+		}
+	}
+
+	close (pipefd[1]);
+
+	len = read (pipefd[0], buffer, sizeof (buffer) - 1);
+	ck_assert (len >= 0);
+	close (pipefd[0]);
+
+	*output = g_strdup (buffer);
+
+	return status;
+}
+
+START_TEST(test_cc_oci_daemon_run) {
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *socket_path = NULL;
+	g_autofree gchar *expected = NULL;
+	g_autofree gchar *cwd = g_get_current_dir ();
+	gchar *output = NULL;
+	char *argv[] = { "cc-oci-runtime", "list", NULL };
+	int fds[CC_OCI_DAEMON_FDS] = { 0, 1, 2 };
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int stalled;
+	int status;
+	pid_t pid;
+
+	socket_path = g_build_path ("/", tmpdir, "daemon.sock", NULL);
+
+	/* no handler */
+	ck_assert (! cc_oci_daemon_run (socket_path));
+
+	/* no daemon */
+	ck_assert (cc_oci_daemon_client_run (socket_path, 2, argv,
+				NULL, fds) == -1);
+
+	cc_oci_daemon_set_handler (test_handler);
+
+	pid = fork ();
+	ck_assert (pid >= 0);
+
+	if (! pid) {
+		_exit (cc_oci_daemon_run (socket_path)
+				? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	expected = g_strdup_printf ("list hello %s", cwd);
+	ck_assert (run_client (socket_path, "list", &output) == 0);
+	ck_assert_str_eq (output, expected);
+	g_free (output);
+
+	ck_assert (run_client (socket_path, "fail", &output) == 1);
+	g_free (output);
+
+	/* commands the client must run itself */
+	argv[1] = "create";
+	ck_assert (cc_oci_daemon_client_run (socket_path, 2, argv,
+				NULL, fds) == -1);
+	argv[1] = "exec";
+	ck_assert (cc_oci_daemon_client_run (socket_path, 2, argv,
+				NULL, fds) == -1);
+
+	/* a client that never sends its request doesn't block others */
+	stalled = socket (AF_UNIX, SOCK_STREAM, 0);
+	ck_assert (stalled >= 0);
+	g_strlcpy (addr.sun_path, socket_path, sizeof (addr.sun_path));
+	ck_assert (! connect (stalled, (struct sockaddr *)&addr,
+				sizeof (addr)));
+
+	ck_assert (run_client (socket_path, "list", &output) == 0);
+	ck_assert_str_eq (output, expected);
+	g_free (output);
+
+	close (stalled);
+
+	/* only one daemon per socket */
+	ck_assert (! cc_oci_daemon_run (socket_path));
+
+	ck_assert (! kill (pid, SIGTERM));
+	ck_assert (waitpid (pid, &status, 0) == pid);
+	ck_assert (WIFEXITED (status));
+	ck_assert (WEXITSTATUS (status) == EXIT_SUCCESS);
+
+	/* socket removed on exit */
+	ck_assert (! g_file_test (socket_path, G_FILE_TEST_EXISTS));
+
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+Suite* make_daemon_suite(void) {
+	Suite* s = suite_create(__FILE__);
+	ADD_TEST(test_cc_oci_daemon_request_parse, s);
+	ADD_TEST(test_cc_oci_daemon_run, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("daemon_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_daemon_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -56,10 +56,169 @@ START_TEST(test_cc_oci_json_parse) {
 	g_free_node(node);
 } END_TEST
 
+START_TEST(test_cc_oci_json_load) {
+	JsonParser* parser = NULL;
+
+	ck_assert(! cc_oci_json_load(NULL));
+	ck_assert(! cc_oci_json_load(""));
+	ck_assert(! cc_oci_json_load(TEST_DATA_DIR "/empty.json"));
+	ck_assert(! cc_oci_json_load(TEST_DATA_DIR "/non-json.json"));
+
+	parser = cc_oci_json_load(TEST_DATA_DIR "/node.json");
+	ck_assert(parser);
+	ck_assert(json_parser_get_root(parser));
+	g_object_unref(parser);
+} END_TEST
+
+START_TEST(test_cc_oci_json_member_to_node) {
+	JsonParser* parser = NULL;
+	JsonObject* object;
+	GNode* root = NULL;
+	GNode* node = NULL;
+	GNode* expected;
+
+	ck_assert(! cc_oci_json_member_to_node(NULL, NULL));
+	ck_assert(! cc_oci_json_member_to_node("foo", NULL));
+
+	parser = cc_oci_json_load(TEST_DATA_DIR "/process.json");
+	ck_assert(parser);
+	object = json_node_get_object(json_parser_get_root(parser));
+
+	ck_assert(! cc_oci_json_member_to_node(NULL,
+		json_object_get_member(object, "process")));
+
+	node = cc_oci_json_member_to_node("process",
+		json_object_get_member(object, "process"));
+	ck_assert(node);
+
+	/* the tree must be the one built for the whole file */
+	ck_assert(cc_oci_json_parse(&root, TEST_DATA_DIR "/process.json"));
+	expected = g_node_find_child(root, G_TRAVERSE_ALL, NULL);
+	ck_assert(expected);
+	expected = g_node_next_sibling(expected);
+	ck_assert(! g_strcmp0(expected->data, node->data));
+	ck_assert(g_node_n_nodes(expected, G_TRAVERSE_ALL) ==
+		g_node_n_nodes(node, G_TRAVERSE_ALL));
+
+	g_free_node(root);
+	g_free_node(node);
+	g_object_unref(parser);
+} END_TEST
+
+struct test_json_data {
+	gchar    *str;
+	gchar     buf[8];
+	gint      number;
+	gboolean  flag;
+};
+
+static const struct cc_oci_json_key test_json_keys[] = {
+	CC_OCI_JSON_KEY("str"    , CC_OCI_JSON_STRING  , struct test_json_data, str),
+	CC_OCI_JSON_KEY("buf"    , CC_OCI_JSON_STRBUF  , struct test_json_data, buf),
+	CC_OCI_JSON_KEY("number" , CC_OCI_JSON_INT     , struct test_json_data, number),
+	CC_OCI_JSON_KEY("flag"   , CC_OCI_JSON_BOOLEAN , struct test_json_data, flag),
+	{ NULL }
+};
+
+static const struct cc_oci_json_key test_json_value_key[] = {
+	CC_OCI_JSON_KEY(NULL, CC_OCI_JSON_INT, struct test_json_data, number),
+};
+
+static JsonNode *
+test_json_node(JsonParser* parser, const gchar* json) {
+	ck_assert(json_parser_load_from_data(parser, json, -1, NULL));
+	return json_parser_get_root(parser);
+}
+
+/* parse "[json]" since not all json-glib versions accept scalar roots */
+static JsonNode *
+test_json_value(JsonParser* parser, const gchar* json) {
+	g_autofree gchar* array = g_strdup_printf("[%s]", json);
+	JsonNode* root = test_json_node(parser, array);
+
+	return json_array_get_element(json_node_get_array(root), 0);
+}
+
+START_TEST(test_cc_oci_json_decode) {
+	JsonParser* parser = json_parser_new();
+	struct test_json_data data = { 0 };
+	JsonNode* node;
+
+	node = test_json_node(parser, "{\"str\":\"foo\"}");
+	ck_assert(cc_oci_json_decode(NULL, test_json_keys, &data) == -1);
+	ck_assert(cc_oci_json_decode(node, NULL, &data) == -1);
+	ck_assert(cc_oci_json_decode(node, test_json_keys, NULL) == -1);
+
+	node = test_json_node(parser, "{\"str\":\"foo\",\"buf\":\"bar\","
+		"\"number\":42,\"flag\":true}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == 4);
+	ck_assert(! g_strcmp0(data.str, "foo"));
+	ck_assert(! g_strcmp0(data.buf, "bar"));
+	ck_assert(data.number == 42);
+	ck_assert(data.flag);
+
+	/* numbers stored as strings are accepted */
+	node = test_json_node(parser, "{\"number\":\"-7\",\"str\":\"baz\"}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == 2);
+	ck_assert(data.number == -7);
+	ck_assert(! g_strcmp0(data.str, "baz"));
+
+	/* null objects decode nothing */
+	node = test_json_value(parser, "null");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == 0);
+
+	/* errors leave the struct untouched */
+	node = test_json_node(parser, "{\"number\":1,\"unknown\":\"x\"}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == -1);
+	ck_assert(data.number == -7);
+
+	node = test_json_node(parser, "{\"number\":1,\"flag\":\"no\"}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == -1);
+	ck_assert(data.number == -7);
+
+	node = test_json_node(parser, "{\"number\":1,\"buf\":\"too long\"}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == -1);
+	ck_assert(data.number == -7);
+
+	node = test_json_node(parser, "{\"number\":\"1x\"}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == -1);
+
+	node = test_json_node(parser, "{\"number\":99999999999}");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == -1);
+
+	node = test_json_node(parser, "[1, 2]");
+	ck_assert(cc_oci_json_decode(node, test_json_keys, &data) == -1);
+
+	/* single values */
+	node = test_json_value(parser, "123");
+	ck_assert(cc_oci_json_decode(node, test_json_value_key, &data) == 1);
+	ck_assert(data.number == 123);
+
+	node = test_json_value(parser, "\"abc\"");
+	ck_assert(cc_oci_json_decode(node, test_json_value_key, &data) == -1);
+	ck_assert(data.number == 123);
+
+	ck_assert(! cc_oci_json_decode_value(NULL, &test_json_keys[0], &data));
+	node = test_json_value(parser, "true");
+	ck_assert(cc_oci_json_decode_value(node, &test_json_keys[3], &data));
+	ck_assert(! cc_oci_json_decode_value(node, &test_json_keys[0], &data));
+
+	ck_assert(! cc_oci_json_key_find(NULL, "str"));
+	ck_assert(! cc_oci_json_key_find(test_json_keys, NULL));
+	ck_assert(! cc_oci_json_key_find(test_json_keys, "foo"));
+	ck_assert(cc_oci_json_key_find(test_json_keys, "flag") == &test_json_keys[3]);
+
+	g_free(data.str);
+	g_object_unref(parser);
+} END_TEST
+
 Suite* make_json_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_json_parse, s);
+	ADD_TEST(test_cc_oci_json_load, s);
+	ADD_TEST(test_cc_oci_json_member_to_node, s);
+	ADD_TEST(test_cc_oci_json_decode, s);
 
 	return s;
 }
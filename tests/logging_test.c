@@ -29,6 +29,7 @@
 
 #include "test_common.h"
 #include "logging.h"
+#include "util.h"
 #include "oci.h"
 
 void
@@ -112,9 +113,13 @@ START_TEST(test_cc_oci_log_init) {
 	/************************************************************/
 	/* Now, test g_debug() handling */
 
+	ck_assert (cc_oci_log_debug_enabled ());
+
 	/* Disable g_debug () messages */
 	options.enable_debug = false;
 
+	ck_assert (! cc_oci_log_debug_enabled ());
+
 	g_debug ("WILL NOT BE LOGGED");
 
 	ck_assert (! g_file_test (options.filename, G_FILE_TEST_EXISTS));
@@ -124,6 +129,11 @@ START_TEST(test_cc_oci_log_init) {
 
 	g_debug ("G_LOG_LEVEL_DEBUG: %s (int=%d)", "!de bug, da bug!", 13);
 
+	/* non-critical messages are buffered until flushed */
+	ck_assert (! g_file_test (options.filename, G_FILE_TEST_EXISTS));
+
+	cc_oci_log_flush ();
+
 	ret = g_file_get_contents (options.filename, &contents, NULL, &error);
 	ck_assert (ret);
 	ck_assert (! error);
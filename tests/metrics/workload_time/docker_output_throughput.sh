@@ -0,0 +1,95 @@
+#!/bin/bash
+
+#  This file is part of cc-oci-runtime.
+#
+#  Copyright (C) 2017 Intel Corporation
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#  Description of the test:
+#  This test measures the throughput of bulk output produced by a
+#  container workload (like cat of a big file), as read through
+#  docker exec and docker run. The data goes through the proxy and
+#  shim I/O streams, so this measure is a good indicator of the I/O
+#  frame size overhead.
+#  This measure is available for COR and runc
+
+set -e
+
+[ $# -ne 3 ] && ( echo >&2 "Usage: $0 <runtime> <size in MiB> <times to run>"; exit 1 )
+
+SCRIPT_PATH=$(dirname "$(readlink -f "$0")")
+source "${SCRIPT_PATH}/../../lib/test-common.bash"
+
+IMAGE='ubuntu'
+RUNTIME="$1"
+SIZE="$2"
+TIMES="$3"
+TEST_ARGS="image=${IMAGE} runtime=${RUNTIME} size=${SIZE}MiB units=MiB/s"
+TMP_FILE=$(mktemp outputThroughput.XXXXXXXXXX || true)
+
+# Run the specified command, writing the throughput to the result file
+function measure_output(){
+	test_name="$1"
+	result_file="$2"
+	shift 2
+
+	(time -p "$@" > /dev/null) &> "$TMP_FILE"
+	if [ $? -eq 0 ]; then
+		seconds=$(grep ^real "$TMP_FILE" | cut -f2 -d' ')
+		test_data=$(echo "scale=2; $SIZE / $seconds" | bc)
+		write_result_to_file "$test_name" "$TEST_ARGS" "$test_data" "$result_file"
+	fi
+	rm -f $TMP_FILE
+}
+
+if [[ "$RUNTIME" != 'runc' && "$RUNTIME" != 'cor' ]]; then
+	die "Runtime ${RUNTIME} is not valid"
+fi
+
+# docker exec: the output is forwarded while the command runs
+TEST_NAME="docker exec output throughput"
+TEST_RESULT_FILE=$(echo "${RESULT_DIR}/${TEST_NAME}-${RUNTIME}" | sed 's| |-|g')
+
+contname=$(random_name)
+$DOCKER_EXE run --name ${contname} -tid --runtime "$RUNTIME" "$IMAGE" sh > /dev/null
+$DOCKER_EXE exec ${contname} sh -c "head -c ${SIZE}M /dev/urandom > /bigfile"
+
+echo "Executing test: ${TEST_NAME} ${TEST_ARGS}"
+backup_old_file "$TEST_RESULT_FILE"
+write_csv_header "$TEST_RESULT_FILE"
+for i in $(seq 1 "$TIMES"); do
+	measure_output "$TEST_NAME" "$TEST_RESULT_FILE" \
+		$DOCKER_EXE exec ${contname} cat /bigfile
+done
+get_average "$TEST_RESULT_FILE"
+
+$DOCKER_EXE rm -f ${contname} > /dev/null
+
+# docker run: the output of the workload is forwarded to the attached client
+TEST_NAME="docker run output throughput"
+TEST_RESULT_FILE=$(echo "${RESULT_DIR}/${TEST_NAME}-${RUNTIME}" | sed 's| |-|g')
+
+echo "Executing test: ${TEST_NAME} ${TEST_ARGS}"
+backup_old_file "$TEST_RESULT_FILE"
+write_csv_header "$TEST_RESULT_FILE"
+for i in $(seq 1 "$TIMES"); do
+	contname=$(random_name)
+	measure_output "$TEST_NAME" "$TEST_RESULT_FILE" \
+		$DOCKER_EXE run --name ${contname} --runtime "$RUNTIME" "$IMAGE" \
+		sh -c "head -c ${SIZE}M /dev/zero | base64"
+	$DOCKER_EXE rm -f ${contname} > /dev/null
+done
+get_average "$TEST_RESULT_FILE"
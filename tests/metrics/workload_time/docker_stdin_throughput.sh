@@ -0,0 +1,75 @@
+#!/bin/bash
+
+#  This file is part of cc-oci-runtime.
+#
+#  Copyright (C) 2017 Intel Corporation
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#  Description of the test:
+#  This test measures the throughput of piping bulk data into a
+#  container through stdin using docker exec -i. The data goes through
+#  the shim and proxy I/O streams, so this measure is a good indicator
+#  of the stdin framing overhead.
+#  This measure is available for COR and runc
+
+set -e
+
+[ $# -ne 3 ] && ( echo >&2 "Usage: $0 <runtime> <size in MiB> <times to run>"; exit 1 )
+
+SCRIPT_PATH=$(dirname "$(readlink -f "$0")")
+source "${SCRIPT_PATH}/../../lib/test-common.bash"
+
+CMD='sh'
+IMAGE='ubuntu'
+RUNTIME="$1"
+SIZE="$2"
+TIMES="$3"
+TEST_NAME="docker exec stdin throughput"
+TEST_ARGS="image=${IMAGE} runtime=${RUNTIME} size=${SIZE}MiB units=MiB/s"
+TEST_RESULT_FILE=$(echo "${RESULT_DIR}/${TEST_NAME}-${RUNTIME}" | sed 's| |-|g')
+TMP_FILE=$(mktemp stdinThroughput.XXXXXXXXXX || true)
+DATA_FILE=$(mktemp stdinData.XXXXXXXXXX || true)
+
+function pipe_stdin(){
+	contname="$1"
+	(time -p $DOCKER_EXE exec -i ${contname} sh -c 'cat > /dev/null' < "$DATA_FILE") &> "$TMP_FILE"
+	if [ $? -eq 0 ]; then
+		seconds=$(grep ^real "$TMP_FILE" | cut -f2 -d' ')
+		test_data=$(echo "scale=2; $SIZE / $seconds" | bc)
+		write_result_to_file "$TEST_NAME" "$TEST_ARGS" "$test_data" "$TEST_RESULT_FILE"
+	fi
+	rm -f $TMP_FILE
+}
+
+if [[ "$RUNTIME" != 'runc' && "$RUNTIME" != 'cor' ]]; then
+	die "Runtime ${RUNTIME} is not valid"
+fi
+
+head -c "${SIZE}M" /dev/urandom > "$DATA_FILE"
+
+contname=$(random_name)
+$DOCKER_EXE run --name ${contname} -tid --runtime "$RUNTIME" "$IMAGE" "$CMD" > /dev/null
+
+echo "Executing test: ${TEST_NAME} ${TEST_ARGS}"
+backup_old_file "$TEST_RESULT_FILE"
+write_csv_header "$TEST_RESULT_FILE"
+for i in $(seq 1 "$TIMES"); do
+	pipe_stdin "$contname"
+done
+get_average "$TEST_RESULT_FILE"
+
+$DOCKER_EXE rm -f ${contname} > /dev/null
+rm -f "$DATA_FILE"
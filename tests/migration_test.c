@@ -0,0 +1,322 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/util.h"
+#include "../src/migration.h"
+
+#define PAGE_SIZE CC_OCI_MIGRATION_PAGE_SIZE
+
+static void
+put_u8 (GByteArray *stream, guint8 value)
+{
+	g_byte_array_append (stream, &value, sizeof (value));
+}
+
+static void
+put_be32 (GByteArray *stream, guint32 value)
+{
+	guint32 be = GUINT32_TO_BE (value);
+
+	g_byte_array_append (stream, (guint8 *)&be, sizeof (be));
+}
+
+static void
+put_be64 (GByteArray *stream, guint64 value)
+{
+	guint64 be = GUINT64_TO_BE (value);
+
+	g_byte_array_append (stream, (guint8 *)&be, sizeof (be));
+}
+
+static void
+put_string (GByteArray *stream, const gchar *str)
+{
+	put_u8 (stream, (guint8)strlen (str));
+	g_byte_array_append (stream, (const guint8 *)str,
+			(guint)strlen (str));
+}
+
+/* A zero page (or one filled with \p fill) */
+static void
+put_zero_page (GByteArray *stream, guint64 addr, const gchar *block,
+		guint8 fill)
+{
+	put_be64 (stream, addr | 0x02 | (block ? 0 : 0x20));
+	if (block) {
+		put_string (stream, block);
+	}
+	put_u8 (stream, fill);
+}
+
+/* A page with every byte set to \p value */
+static void
+put_page (GByteArray *stream, guint64 addr, const gchar *block,
+		guint8 value)
+{
+	guint8 page[PAGE_SIZE];
+
+	memset (page, value, sizeof (page));
+
+	put_be64 (stream, addr | 0x08 | (block ? 0 : 0x20));
+	if (block) {
+		put_string (stream, block);
+	}
+	g_byte_array_append (stream, page, sizeof (page));
+}
+
+static void
+put_header (GByteArray *stream)
+{
+	put_be32 (stream, 0x5145564d);
+	put_be32 (stream, 3);
+
+	/* configuration */
+	put_u8 (stream, 0x07);
+	put_be32 (stream, 7);
+	g_byte_array_append (stream, (const guint8 *)"pc-lite", 7);
+	put_u8 (stream, 0x05);
+	put_string (stream, "configuration/target-page-bits");
+	put_be32 (stream, 1);
+	put_be32 (stream, 12);
+}
+
+static void
+put_ram_start (GByteArray *stream, guint32 section_id)
+{
+	put_u8 (stream, 0x01);
+	put_be32 (stream, section_id);
+	put_string (stream, "ram");
+	put_be32 (stream, 0);
+	put_be32 (stream, 4);
+
+	put_be64 (stream, (5 * PAGE_SIZE) | 0x04);
+	put_string (stream, CC_OCI_MIGRATION_RAM_BLOCK);
+	put_be64 (stream, 4 * PAGE_SIZE);
+	put_string (stream, "pc.bios");
+	put_be64 (stream, PAGE_SIZE);
+	put_be64 (stream, 0x10);
+}
+
+static void
+put_footer (GByteArray *stream, guint32 section_id)
+{
+	put_u8 (stream, 0x7e);
+	put_be32 (stream, section_id);
+}
+
+static gboolean
+write_stream (const gchar *path, GByteArray *stream)
+{
+	return g_file_set_contents (path, (const gchar *)stream->data,
+			(gssize)stream->len, NULL);
+}
+
+START_TEST(test_cc_oci_migration_split_ram) {
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *stream_file = NULL;
+	g_autofree gchar *out_file = NULL;
+	g_autofree gchar *ram_file = NULL;
+	g_autofree gchar *contents = NULL;
+	GByteArray *stream;
+	GByteArray *expected;
+	guint64 pages_total = 0;
+	guint64 pages_saved = 0;
+	guint8 page[PAGE_SIZE];
+	const gchar *devices = "\x04 device state\x00";
+	gsize len = 0;
+
+	ck_assert (tmpdir);
+
+	stream_file = g_build_path ("/", tmpdir, "vm.img", NULL);
+	out_file = g_build_path ("/", tmpdir, "vm.img.tmp", NULL);
+	ram_file = g_build_path ("/", tmpdir, "ram.img", NULL);
+
+	ck_assert (! cc_oci_migration_split_ram (NULL, NULL, NULL,
+				NULL, NULL));
+	ck_assert (! cc_oci_migration_split_ram (stream_file, NULL, NULL,
+				NULL, NULL));
+	ck_assert (! cc_oci_migration_split_ram (stream_file, out_file,
+				NULL, NULL, NULL));
+
+	/* no stream */
+	ck_assert (! cc_oci_migration_split_ram (stream_file, out_file,
+				ram_file, NULL, NULL));
+
+	/* not a stream */
+	ck_assert (g_file_set_contents (stream_file, "hello world", -1,
+				NULL));
+	ck_assert (! cc_oci_migration_split_ram (stream_file, out_file,
+				ram_file, NULL, NULL));
+	ck_assert (! g_file_test (out_file, G_FILE_TEST_EXISTS));
+	ck_assert (! g_file_test (ram_file, G_FILE_TEST_EXISTS));
+
+	/* a stream with pages of main memory and firmware */
+	stream = g_byte_array_new ();
+	expected = g_byte_array_new ();
+
+	put_header (stream);
+	put_header (expected);
+
+	put_ram_start (stream, 2);
+	put_footer (stream, 2);
+	put_ram_start (expected, 2);
+	put_footer (expected, 2);
+
+	put_u8 (stream, 0x02);
+	put_be32 (stream, 2);
+	put_page (stream, 0, CC_OCI_MIGRATION_RAM_BLOCK, 0x11);
+	put_zero_page (stream, PAGE_SIZE, NULL, 0);
+	put_page (stream, 2 * PAGE_SIZE, NULL, 0x5a);
+	put_page (stream, 0, "pc.bios", 0xb1);
+	put_zero_page (stream, 3 * PAGE_SIZE,
+			CC_OCI_MIGRATION_RAM_BLOCK, 0xaa);
+	put_be64 (stream, 0x10);
+	put_footer (stream, 2);
+
+	/* only the firmware page remains */
+	put_u8 (expected, 0x02);
+	put_be32 (expected, 2);
+	put_page (expected, 0, "pc.bios", 0xb1);
+	put_be64 (expected, 0x10);
+	put_footer (expected, 2);
+
+	/* the first page is zero after all */
+	put_u8 (stream, 0x03);
+	put_be32 (stream, 2);
+	put_zero_page (stream, 0, CC_OCI_MIGRATION_RAM_BLOCK, 0);
+	put_be64 (stream, 0x10);
+	put_footer (stream, 2);
+
+	put_u8 (expected, 0x03);
+	put_be32 (expected, 2);
+	put_be64 (expected, 0x10);
+	put_footer (expected, 2);
+
+	/* device state is copied as it is */
+	g_byte_array_append (stream, (const guint8 *)devices, 16);
+	g_byte_array_append (expected, (const guint8 *)devices, 16);
+
+	ck_assert (write_stream (stream_file, stream));
+
+	ck_assert (cc_oci_migration_split_ram (stream_file, out_file,
+				ram_file, &pages_total, &pages_saved));
+	ck_assert (pages_total == 4);
+	ck_assert (pages_saved == 2);
+
+	ck_assert (g_file_get_contents (out_file, &contents, &len, NULL));
+	ck_assert (len == expected->len);
+	ck_assert (! memcmp (contents, expected->data, len));
+	g_free (contents);
+
+	ck_assert (g_file_get_contents (ram_file, &contents, &len, NULL));
+	ck_assert (len == 4 * PAGE_SIZE);
+
+	memset (page, 0, sizeof (page));
+	ck_assert (! memcmp (contents, page, PAGE_SIZE));
+	ck_assert (! memcmp (contents + PAGE_SIZE, page, PAGE_SIZE));
+	memset (page, 0x5a, sizeof (page));
+	ck_assert (! memcmp (contents + 2 * PAGE_SIZE, page, PAGE_SIZE));
+	memset (page, 0xaa, sizeof (page));
+	ck_assert (! memcmp (contents + 3 * PAGE_SIZE, page, PAGE_SIZE));
+
+	/* a page beyond the end of main memory */
+	g_byte_array_set_size (stream, 0);
+	put_header (stream);
+	put_ram_start (stream, 2);
+	put_u8 (stream, 0x02);
+	put_be32 (stream, 2);
+	put_page (stream, 4 * PAGE_SIZE, CC_OCI_MIGRATION_RAM_BLOCK, 0x11);
+	put_be64 (stream, 0x10);
+	ck_assert (write_stream (stream_file, stream));
+	ck_assert (! cc_oci_migration_split_ram (stream_file, out_file,
+				ram_file, NULL, NULL));
+
+	/* other live sections are not supported */
+	g_byte_array_set_size (stream, 0);
+	put_header (stream);
+	put_u8 (stream, 0x01);
+	put_be32 (stream, 1);
+	put_string (stream, "block");
+	put_be32 (stream, 0);
+	put_be32 (stream, 1);
+	ck_assert (write_stream (stream_file, stream));
+	ck_assert (! cc_oci_migration_split_ram (stream_file, out_file,
+				ram_file, NULL, NULL));
+
+	/* nor are compressed pages */
+	g_byte_array_set_size (stream, 0);
+	put_header (stream);
+	put_ram_start (stream, 2);
+	put_u8 (stream, 0x02);
+	put_be32 (stream, 2);
+	put_be64 (stream, 0x100);
+	ck_assert (write_stream (stream_file, stream));
+	ck_assert (! cc_oci_migration_split_ram (stream_file, out_file,
+				ram_file, NULL, NULL));
+	ck_assert (! g_file_test (out_file, G_FILE_TEST_EXISTS));
+	ck_assert (! g_file_test (ram_file, G_FILE_TEST_EXISTS));
+
+	g_byte_array_free (stream, true);
+	g_byte_array_free (expected, true);
+	ck_assert (cc_oci_rm_rf (tmpdir));
+
+} END_TEST
+
+Suite* make_migration_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_migration_split_ram, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("migration_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_migration_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -22,6 +22,7 @@
 
 #include <check.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include "../src/mount.h"
 #include "../src/logging.h"
@@ -97,6 +98,19 @@ START_TEST(test_cc_oci_perform_unmount) {
 	ck_assert(! cc_oci_perform_unmount(NULL));
 
 	ck_assert(! cc_oci_perform_unmount(&m));
+
+	if (! getuid ()) {
+		/* only root gets past the permission check */
+		g_snprintf(m.dest, PATH_MAX, "/tmp/.cc-oci-runtime-unmounted");
+
+		/* destination removed by a previous attempt */
+		ck_assert(cc_oci_perform_unmount(&m));
+
+		/* destination unmounted by a previous attempt */
+		ck_assert(! g_mkdir(m.dest, 0700));
+		ck_assert(cc_oci_perform_unmount(&m));
+		ck_assert(! g_rmdir(m.dest));
+	}
 } END_TEST
 
 START_TEST(test_cc_oci_handle_umounts) {
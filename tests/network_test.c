@@ -20,6 +20,8 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <check.h>
 #include <glib.h>
@@ -85,11 +87,94 @@ START_TEST(test_cc_oci_vm_resume) {
 	g_free(diname);
 } END_TEST
 
+START_TEST(test_cc_oci_vm_migrate) {
+	char *socket_path = NULL;
+	pid_t pid = 0;
+	char *diname = NULL;
+	char *vm_file = NULL;
+	char *uri = NULL;
+	struct stat st;
+
+	pid = run_qmp_vm (&socket_path);
+	ck_assert (pid > 0);
+	ck_assert (socket_path != NULL);
+
+	diname = g_path_get_dirname (socket_path);
+	vm_file = g_build_path ("/", diname, "vm.img", NULL);
+	uri = g_strdup_printf ("exec:cat > %s", vm_file);
+
+	ck_assert (! cc_oci_vm_migrate (NULL, -1, NULL));
+	ck_assert (! cc_oci_vm_migrate (socket_path, pid, NULL));
+	ck_assert (! cc_oci_vm_migrate (NULL, pid, uri));
+	ck_assert (! cc_oci_vm_migrate (socket_path, 0, uri));
+	ck_assert (! cc_oci_vm_migrate ("/path/to/nothingness", pid, uri));
+
+	ck_assert (cc_oci_vm_pause (socket_path, pid));
+	ck_assert (cc_oci_vm_migrate (socket_path, pid, uri));
+
+	ck_assert (! stat (vm_file, &st));
+	ck_assert (st.st_size > 0);
+
+	/* the VM can still be resumed */
+	ck_assert (cc_oci_vm_resume (socket_path, pid));
+
+	kill (pid, SIGTERM);
+
+	cc_oci_rm_rf(diname);
+
+	g_free(socket_path);
+	g_free(diname);
+	g_free(vm_file);
+	g_free(uri);
+} END_TEST
+
+START_TEST(test_cc_oci_vm_incoming_wait) {
+	ck_assert (! cc_oci_vm_incoming_wait (NULL, -1));
+	ck_assert (! cc_oci_vm_incoming_wait (NULL, getpid ()));
+	ck_assert (! cc_oci_vm_incoming_wait ("/path/to/nothingness", 0));
+} END_TEST
+
+START_TEST(test_cc_oci_qmp_events_parse) {
+	GString *received;
+	GSList *events;
+
+	ck_assert (! cc_oci_qmp_events_parse (NULL));
+
+	received = g_string_new ("{\"QMP\": {\"version\": {}}}\r\n"
+			"{\"return\": {}}\r\n"
+			"{\"timestamp\": {\"seconds\": 1, \"microseconds\": 2}, "
+			"\"event\": \"STOP\"}\r\n"
+			"invalid\r\n"
+			"{\"event\": \"RESUME\"}\r\n"
+			"{\"event\": \"SHUT");
+
+	events = cc_oci_qmp_events_parse (received);
+	ck_assert (g_slist_length (events) == 2);
+	ck_assert (! g_strcmp0 (g_slist_nth_data (events, 0), "STOP"));
+	ck_assert (! g_strcmp0 (g_slist_nth_data (events, 1), "RESUME"));
+	g_slist_free_full (events, g_free);
+
+	/* the partial message is kept */
+	ck_assert (! g_strcmp0 (received->str, "{\"event\": \"SHUT"));
+
+	g_string_append (received, "DOWN\"}\r\n");
+	events = cc_oci_qmp_events_parse (received);
+	ck_assert (g_slist_length (events) == 1);
+	ck_assert (! g_strcmp0 (events->data, "SHUTDOWN"));
+	ck_assert (! received->len);
+	g_slist_free_full (events, g_free);
+
+	g_string_free (received, true);
+} END_TEST
+
 Suite* make_oci_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST_TIMEOUT (test_cc_oci_vm_pause, s, 10);
 	ADD_TEST_TIMEOUT (test_cc_oci_vm_resume, s, 10);
+	ADD_TEST_TIMEOUT (test_cc_oci_vm_migrate, s, 30);
+	ADD_TEST (test_cc_oci_vm_incoming_wait, s);
+	ADD_TEST (test_cc_oci_qmp_events_parse, s);
 
 	return s;
 }
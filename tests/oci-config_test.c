@@ -28,6 +28,18 @@
 #include "oci.h"
 #include "logging.h"
 #include "oci-config.h"
+#include "json.h"
+
+/* handlers that don't depend on the host (rootfs, vm.json) */
+static struct spec_handler *test_spec_handlers[] = {
+	&annotations_spec_handler,
+	&hooks_spec_handler,
+	&mounts_spec_handler,
+	&platform_spec_handler,
+	&process_spec_handler,
+	&linux_spec_handler,
+	NULL
+};
 
 START_TEST(test_cc_oci_config_check) {
 	struct cc_oci_config *config = NULL;
@@ -75,11 +87,84 @@ START_TEST(test_cc_oci_config_file_path) {
 
 } END_TEST
 
+START_TEST(test_cc_oci_process_config_file) {
+	const gchar *files[] = {
+		TEST_DATA_DIR "/config-docker.json",
+		TEST_DATA_DIR "/config-crio.json",
+		NULL
+	};
+	struct spec_handler *no_handlers[] = { NULL };
+	struct cc_oci_config *config;
+	struct cc_oci_config *expected;
+	GNode *root;
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	ck_assert (! cc_oci_process_config_file (NULL, config,
+				test_spec_handlers));
+	ck_assert (! cc_oci_process_config_file (files[0], NULL,
+				test_spec_handlers));
+	ck_assert (! cc_oci_process_config_file (files[0], config, NULL));
+	ck_assert (! cc_oci_process_config_file (TEST_DATA_DIR "/empty.json",
+				config, test_spec_handlers));
+
+	/* top-level values are decoded without any handler */
+	ck_assert (cc_oci_process_config_file (files[0], config,
+				no_handlers));
+	ck_assert (! g_strcmp0 (config->oci.oci_version, "1.0.0-rc1"));
+	ck_assert (! g_strcmp0 (config->oci.hostname, "3f4e1c2a9b7d"));
+	ck_assert (! config->oci.process.args);
+	ck_assert (! config->oci.mounts);
+	cc_oci_config_free (config);
+
+	/* the result must match the GNode path */
+	for (const gchar **f = files; *f; f++) {
+		config = cc_oci_config_create ();
+		expected = cc_oci_config_create ();
+		root = NULL;
+
+		ck_assert (cc_oci_process_config_file (*f, config,
+					test_spec_handlers));
+
+		ck_assert (cc_oci_json_parse (&root, *f));
+		ck_assert (cc_oci_process_config (root, expected,
+					test_spec_handlers));
+		g_free_node (root);
+
+		ck_assert (! g_strcmp0 (config->oci.oci_version,
+					expected->oci.oci_version));
+		ck_assert (! g_strcmp0 (config->oci.hostname,
+					expected->oci.hostname));
+		ck_assert (! g_strcmp0 (config->oci.process.cwd,
+					expected->oci.process.cwd));
+		ck_assert (g_strv_length (config->oci.process.args) ==
+				g_strv_length (expected->oci.process.args));
+		ck_assert (g_strv_length (config->oci.process.env) ==
+				g_strv_length (expected->oci.process.env));
+		ck_assert (g_slist_length (config->oci.mounts) ==
+				g_slist_length (expected->oci.mounts));
+		ck_assert (g_slist_length (config->oci.annotations) ==
+				g_slist_length (expected->oci.annotations));
+		ck_assert (g_slist_length (config->oci.hooks.prestart) ==
+				g_slist_length (expected->oci.hooks.prestart));
+		ck_assert (g_slist_length (config->oci.oci_linux.namespaces) ==
+				g_slist_length (expected->oci.oci_linux.namespaces));
+		ck_assert (! g_strcmp0 (config->oci.oci_linux.cgroupsPath,
+					expected->oci.oci_linux.cgroupsPath));
+
+		cc_oci_config_free (config);
+		cc_oci_config_free (expected);
+	}
+
+} END_TEST
+
 Suite* make_runtime_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_config_check, s);
 	ADD_TEST(test_cc_oci_config_file_path, s);
+	ADD_TEST(test_cc_oci_process_config_file, s);
 
 	return s;
 }
@@ -39,6 +39,7 @@
 #include "../src/state.h"
 #include "../src/oci.h"
 #include "../src/util.h"
+#include "../src/annotation.h"
 
 gboolean cc_oci_container_running (const struct oci_state *state);
 gboolean cc_oci_create_container_workload (struct cc_oci_config *config);
@@ -573,6 +574,7 @@ START_TEST(test_cc_oci_list) {
 	ck_assert (! g_remove (vm1_config->state.state_file_path));
 	ck_assert (! g_remove (vm1_config->state.runtime_path));
 
+	ck_assert (test_helper_remove_state_index (tmpdir));
 	ck_assert (! g_remove (tmpdir));
 	g_free (tmpdir);
 	cc_oci_config_free (vm1_config);
@@ -620,6 +622,7 @@ START_TEST(test_cc_oci_config_update) {
 	struct oci_state *state;
 	struct cc_oci_mount *m;
 	struct cc_oci_vm_cfg *vm;
+	struct oci_cfg_annotation *a;
 	state = g_malloc0 (sizeof (struct oci_state));
 	ck_assert (state);
 
@@ -663,18 +666,29 @@ START_TEST(test_cc_oci_config_update) {
 	/* add vm object to state */
 	state->vm = vm;
 
+	/* add an annotation to state */
+	a = g_new0 (struct oci_cfg_annotation, 1);
+	a->key = g_strdup ("key");
+	a->value = g_strdup ("value");
+	state->annotations = g_slist_append (state->annotations, a);
+
 	/* perform the transfer */
 	ck_assert (cc_oci_config_update (config, state));
 
 	ck_assert (! state->mounts);
 	ck_assert (! state->console);
 	ck_assert (! state->vm);
+	ck_assert (! state->annotations);
 
 	ck_assert (config->oci.mounts);
 	ck_assert (config->console);
 
 	ck_assert (config->vm);
 
+	/* check annotations */
+	ck_assert (! g_strcmp0 (cc_oci_annotation_get (config->oci.annotations,
+					"key"), "value"));
+
 	ck_assert (g_slist_length (config->oci.mounts) == 1);
 
 	/* check mount object */
@@ -783,6 +797,7 @@ START_TEST(test_cc_oci_get_config_and_state) {
 	ck_assert (! g_remove (vm1_config->state.state_file_path));
 	ck_assert (! g_remove (vm1_config->state.runtime_path));
 
+	ck_assert (test_helper_remove_state_index (tmpdir));
 	ck_assert (! g_remove (tmpdir));
 	g_free (tmpdir);
 	cc_oci_config_free (vm1_config);
@@ -792,6 +807,64 @@ START_TEST(test_cc_oci_get_config_and_state) {
 
 } END_TEST
 
+START_TEST(test_cc_oci_get_exec_state) {
+	struct cc_oci_config *config = NULL;
+	struct cc_oci_config *vm1_config = NULL;
+	struct oci_state *state = NULL;
+	gchar *tmpdir;
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	vm1_config = cc_oci_config_create ();
+	ck_assert (vm1_config);
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	ck_assert (! cc_oci_get_exec_state (NULL, NULL));
+	ck_assert (! cc_oci_get_exec_state (config, NULL));
+	ck_assert (! cc_oci_get_exec_state (NULL, &state));
+
+	/* no container id */
+	ck_assert (! cc_oci_get_exec_state (config, &state));
+
+	ck_assert (test_helper_create_state_file ("vm1", tmpdir, vm1_config));
+
+	config->optarg_container_id = "vm1";
+	config->root_dir = g_strdup (tmpdir);
+	ck_assert (config->root_dir);
+
+	ck_assert (cc_oci_get_exec_state (config, &state));
+
+	ck_assert (! g_strcmp0 (config->state.runtime_path, vm1_config->state.runtime_path));
+	ck_assert (! g_strcmp0 (config->state.state_file_path, vm1_config->state.state_file_path));
+	ck_assert (config->state.workload_pid == vm1_config->state.workload_pid);
+	ck_assert (config->state.status == OCI_STATUS_CREATED);
+
+	/* only the state summary is loaded */
+	ck_assert (! config->bundle_path);
+	ck_assert (! config->state.procsock_path[0]);
+
+	ck_assert (state);
+	ck_assert (! g_strcmp0 (state->id, config->optarg_container_id));
+	ck_assert (state->pid == config->state.workload_pid);
+	ck_assert (! state->console);
+	ck_assert (! state->mounts);
+
+	/* clean up */
+	ck_assert (! g_remove (vm1_config->state.state_file_path));
+	ck_assert (! g_remove (vm1_config->state.runtime_path));
+
+	ck_assert (test_helper_remove_state_index (tmpdir));
+	ck_assert (! g_remove (tmpdir));
+	g_free (tmpdir);
+	cc_oci_config_free (vm1_config);
+	cc_oci_config_free (config);
+	cc_oci_state_free (state);
+
+} END_TEST
+
 START_TEST(test_cc_oci_vm_running) {
 	struct oci_state state = {0};
 
@@ -1014,6 +1087,7 @@ START_TEST(test_cc_oci_kill) {
 	cc_oci_config_free (config);
 	cc_oci_config_free (config_new);
 
+	ck_assert (test_helper_remove_state_index (tmpdir));
 	ck_assert (! g_remove (tmpdir));
 
 } END_TEST
@@ -1204,6 +1278,7 @@ Suite* make_oci_suite(void) {
 	ADD_TEST (test_cc_oci_get_bundle_path, s);
 	ADD_TEST (test_cc_oci_config_update, s);
 	ADD_TEST (test_cc_oci_get_config_and_state, s);
+	ADD_TEST (test_cc_oci_get_exec_state, s);
 	ADD_TEST (test_cc_oci_vm_running, s);
 	ADD_TEST (test_cc_oci_kill, s);
 	ADD_TEST (test_get_user_home_dir, s);
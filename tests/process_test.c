@@ -34,11 +34,15 @@
 #include "../src/process.h"
 #include "../src/netlink.h"
 #include "../src/util.h"
+#include "../src/command.h"
+
+extern struct start_data start_data;
 
 gboolean cc_oci_cmd_is_shell (const char *cmd);
 gboolean cc_run_hook (struct oci_cfg_hook* hook,
 		const gchar* state,
-		gsize state_length);
+		gsize state_length,
+		gboolean capture_output);
 gboolean cc_oci_setup_shim (struct cc_oci_config *config,
 		int proxy_fd,
 		int proxy_io_fd,
@@ -50,6 +54,9 @@ gboolean cc_oci_vm_netcfg_get (struct cc_oci_config *config,
 gboolean
 cc_shim_launch (struct cc_oci_config *config, int *child_err_fd,
 		int *shim_args_fd, int *shim_socket_fd, gboolean initial_workload);
+gchar **cc_shim_args (struct cc_oci_config *config, int proxy_socket_fd,
+		int proxy_io_fd, int proxy_io_base, guint32 max_frame_size,
+		gboolean initial_workload);
 
 
 START_TEST(test_cc_run_hook) {
@@ -75,7 +82,7 @@ START_TEST(test_cc_run_hook) {
 	g_strlcpy (hook->path, "dd", sizeof (hook->path));
 
 	/* fails since full path not specified */
-	ck_assert (! cc_run_hook (hook, "", 1));
+	ck_assert (! cc_run_hook (hook, "", 1, false));
 
 	cc_oci_hook_free (hook);
 
@@ -87,7 +94,7 @@ START_TEST(test_cc_run_hook) {
 
 	g_strlcpy (hook->path, cmd, sizeof (hook->path));
 
-	ck_assert (cc_run_hook (hook, "", 1));
+	ck_assert (cc_run_hook (hook, "", 1, false));
 
 	cc_oci_hook_free (hook);
 
@@ -103,7 +110,7 @@ START_TEST(test_cc_run_hook) {
 	ck_assert (hook->args);
 	hook->args[0] = g_strdup (cmd);
 
-	ck_assert (cc_run_hook (hook, "", 1));
+	ck_assert (cc_run_hook (hook, "", 1, false));
 
 	cc_oci_hook_free (hook);
 
@@ -120,7 +127,7 @@ START_TEST(test_cc_run_hook) {
 	hook->args[0] = g_strdup (cmd);
 	hook->args[1] = g_strdup ("bs=1");
 
-	ck_assert (cc_run_hook (hook, "", 1));
+	ck_assert (cc_run_hook (hook, "", 1, false));
 
 	cc_oci_hook_free (hook);
 
@@ -138,7 +145,7 @@ START_TEST(test_cc_run_hook) {
 	hook->args[1] = g_strdup ("bs=1");
 	hook->args[2] = g_strdup ("bs=1");
 
-	ck_assert (cc_run_hook (hook, "", 1));
+	ck_assert (cc_run_hook (hook, "", 1, false));
 
 	cc_oci_hook_free (hook);
 
@@ -157,7 +164,19 @@ START_TEST(test_cc_run_hook) {
 	hook->args[2] = g_strdup ("bs=1");
 	hook->args[3] = g_strdup ("bs=1");
 
-	ck_assert (cc_run_hook (hook, "", 1));
+	ck_assert (cc_run_hook (hook, "", 1, false));
+
+	cc_oci_hook_free (hook);
+
+	/*******************************/
+	/* output captured (dd reports to stderr) */
+
+	hook = g_new0 (struct oci_cfg_hook, 1);
+	ck_assert (hook);
+
+	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+
+	ck_assert (cc_run_hook (hook, "", 1, true));
 
 	cc_oci_hook_free (hook);
 
@@ -165,6 +184,104 @@ START_TEST(test_cc_run_hook) {
 
 } END_TEST
 
+START_TEST(test_cc_run_hook_timeout) {
+	struct oci_cfg_hook *hook = NULL;
+	g_autofree gchar *cmd = NULL;
+	gint64 start;
+
+	cmd = g_find_program_in_path ("sleep");
+	ck_assert (cmd);
+
+	hook = g_new0 (struct oci_cfg_hook, 1);
+	ck_assert (hook);
+
+	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+
+	hook->args = g_new0 (gchar *, 3);
+	ck_assert (hook->args);
+	hook->args[0] = g_strdup (cmd);
+	hook->args[1] = g_strdup ("30");
+
+	/* hook is killed once it exceeds its timeout */
+	hook->timeout = 1;
+
+	start = g_get_monotonic_time ();
+	ck_assert (! cc_run_hook (hook, "", 1, false));
+	ck_assert (g_get_monotonic_time () - start < 10 * G_USEC_PER_SEC);
+
+	/* ... also when its output is captured */
+	start = g_get_monotonic_time ();
+	ck_assert (! cc_run_hook (hook, "", 1, true));
+	ck_assert (g_get_monotonic_time () - start < 10 * G_USEC_PER_SEC);
+
+	/* hooks that finish in time are unaffected */
+	g_free (hook->args[1]);
+	hook->args[1] = g_strdup ("0");
+	ck_assert (cc_run_hook (hook, "", 1, false));
+
+	cc_oci_hook_free (hook);
+} END_TEST
+
+START_TEST(test_cc_run_hooks_detached) {
+	struct oci_cfg_hook *hook = NULL;
+	GSList *hooks = NULL;
+	g_autofree gchar *cmd = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *state_file = NULL;
+	g_autofree gchar *out_file = NULL;
+	g_autofree gchar *contents = NULL;
+	gint64 start;
+	int i;
+
+	cmd = g_find_program_in_path ("dd");
+	ck_assert (cmd);
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	state_file = g_build_path ("/", tmpdir, "state.json", NULL);
+	out_file = g_build_path ("/", tmpdir, "out", NULL);
+
+	ck_assert (cc_run_hooks_detached (NULL, state_file));
+
+	/* state file does not exist */
+	hook = g_new0 (struct oci_cfg_hook, 1);
+	ck_assert (hook);
+	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+	hook->args = g_new0 (gchar *, 3);
+	ck_assert (hook->args);
+	hook->args[0] = g_strdup (cmd);
+	hook->args[1] = g_strdup_printf ("of=%s", out_file);
+	hooks = g_slist_append (hooks, hook);
+
+	ck_assert (! cc_run_hooks_detached (hooks, state_file));
+
+	ck_assert (g_file_set_contents (state_file, "{}", -1, NULL));
+
+	start = g_get_monotonic_time ();
+	ck_assert (cc_run_hooks_detached (hooks, state_file));
+	ck_assert (g_get_monotonic_time () - start < 10 * G_USEC_PER_SEC);
+
+	/* state is still passed to the hook if the state file
+	 * is removed before it runs.
+	 */
+	ck_assert (! g_remove (state_file));
+
+	for (i = 0; i < 100; i++) {
+		g_free_if_set (contents);
+		if (g_file_get_contents (out_file, &contents, NULL, NULL)
+				&& ! g_strcmp0 (contents, "{}")) {
+			break;
+		}
+		g_usleep (G_USEC_PER_SEC / 10);
+	}
+	ck_assert_str_eq (contents, "{}");
+
+	g_slist_free_full (hooks, (GDestroyNotify)cc_oci_hook_free);
+	ck_assert (! g_remove (out_file));
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
 START_TEST(test_cc_oci_setup_shim) {
 	struct cc_oci_config config = { { 0 } };
 	char tmpf1[] = "/tmp/.tmpXXXXXX";
@@ -210,6 +327,47 @@ START_TEST(test_cc_oci_setup_shim) {
 
 } END_TEST
 
+START_TEST(test_cc_shim_args) {
+	struct cc_oci_config config = { { 0 } };
+	gchar **args = NULL;
+	g_autofree gchar *joined = NULL;
+
+	ck_assert (! cc_shim_args (NULL, 3, 4, 1, 0, false));
+
+	config.optarg_container_id = "foo";
+	start_data.shim_path = "/path/to/shim";
+
+	/* separate stdout and stderr streams */
+	args = cc_shim_args (&config, 3, 4, 5, 0, false);
+	ck_assert (args);
+	joined = g_strjoinv (" ", args);
+	ck_assert_str_eq (joined,
+			"/path/to/shim -c foo -p 3 -o 4 -s 5 -e 6");
+	g_strfreev (args);
+	g_free (joined);
+
+	/* a terminal only has one stream, frame size negotiated */
+	config.oci.process.terminal = true;
+	args = cc_shim_args (&config, 3, 4, 5, 65536, false);
+	ck_assert (args);
+	joined = g_strjoinv (" ", args);
+	ck_assert_str_eq (joined,
+			"/path/to/shim -c foo -p 3 -o 4 -s 5 -m 65536");
+	g_strfreev (args);
+	g_free (joined);
+
+	/* initial workload */
+	args = cc_shim_args (&config, 3, 4, 5, 0, true);
+	ck_assert (args);
+	joined = g_strjoinv (" ", args);
+	ck_assert_str_eq (joined,
+			"/path/to/shim -c foo -p 3 -o 4 -s 5 -w");
+	g_strfreev (args);
+
+	start_data.shim_path = NULL;
+
+} END_TEST
+
 START_TEST(test_socket_connection_from_fd) {
 	int sockets[2] = { -1, -1 };
 	GSocketConnection *conn = NULL;
@@ -237,7 +395,10 @@ Suite* make_process_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_run_hook, s);
+	ADD_TEST(test_cc_run_hook_timeout, s);
+	ADD_TEST(test_cc_run_hooks_detached, s);
 	ADD_TEST(test_cc_oci_setup_shim, s);
+	ADD_TEST(test_cc_shim_args, s);
 	ADD_TEST(test_socket_connection_from_fd, s);
 	ADD_TEST(test_cc_oci_setup_child, s);
 
@@ -23,6 +23,7 @@
 
 #include <check.h>
 #include <glib.h>
+#include <json-glib/json-glib.h>
 
 #include "test_common.h"
 #include "../src/oci.h"
@@ -31,6 +32,8 @@
 
 gboolean cc_proxy_connect (struct cc_proxy *proxy);
 gboolean cc_proxy_disconnect (struct cc_proxy *proxy);
+JsonObject *cc_proxy_exec_payload (struct cc_oci_config *config);
+gchar *cc_proxy_response_data (const GString *response);
 
 START_TEST(test_cc_proxy_connect) {
 
@@ -56,11 +59,117 @@ START_TEST(test_cc_proxy_disconnect) {
 
 } END_TEST
 
+static gchar *
+response_data (const gchar *response)
+{
+	GString *str = g_string_new (response);
+	gchar   *data = cc_proxy_response_data (str);
+
+	g_string_free (str, true);
+
+	return data;
+}
+
+START_TEST(test_cc_proxy_response_data) {
+	gchar *data;
+
+	ck_assert (! response_data (""));
+	ck_assert (! response_data ("{\"success\":true}"));
+
+	/* no hyperstart reply (older proxies don't return it) */
+	ck_assert (! response_data ("{\"success\":true,\"data\":{}}"));
+	ck_assert (! response_data ("{\"success\":true,\"data\":\"1\"}"));
+	ck_assert (! response_data ("{\"success\":true,"
+				"\"data\":{\"data\":1}}"));
+
+	data = response_data ("{\"success\":true,\"data\":{\"data\":\"\"}}");
+	ck_assert_str_eq (data, "");
+	g_free (data);
+
+	data = response_data ("{\"success\":true,"
+			"\"data\":{\"data\":\"1\\n42\\n\"}}");
+	ck_assert_str_eq (data, "1\n42\n");
+	g_free (data);
+} END_TEST
+
+START_TEST(test_cc_proxy_exec_payload) {
+	struct cc_oci_config config = { { 0 } };
+	JsonObject *payload;
+	JsonObject *process;
+	JsonObject *env;
+	JsonArray *array;
+
+	ck_assert (! cc_proxy_exec_payload (NULL));
+
+	config.optarg_container_id = "foo";
+	config.oci.process.args = g_strsplit ("/bin/echo hello", " ", -1);
+	config.oci.process.env = g_strsplit ("HOME=/root|FOO=bar=baz", "|", -1);
+	config.oci.process.stdio_stream = 1;
+	config.oci.process.stderr_stream = 2;
+	g_strlcpy (config.oci.process.cwd, "/tmp",
+			sizeof (config.oci.process.cwd));
+
+	payload = cc_proxy_exec_payload (&config);
+	ck_assert (payload);
+
+	ck_assert_str_eq (json_object_get_string_member (payload,
+				"container"), "foo");
+
+	process = json_object_get_object_member (payload, "process");
+	ck_assert (process);
+
+	ck_assert (! json_object_get_boolean_member (process, "terminal"));
+	ck_assert (json_object_get_int_member (process, "stdio") == 1);
+	ck_assert (json_object_get_int_member (process, "stderr") == 2);
+	ck_assert_str_eq (json_object_get_string_member (process,
+				"workdir"), "/tmp");
+
+	array = json_object_get_array_member (process, "args");
+	ck_assert (json_array_get_length (array) == 2);
+	ck_assert_str_eq (json_array_get_string_element (array, 1), "hello");
+
+	/* only the first '=' separates the name from the value */
+	array = json_object_get_array_member (process, "envs");
+	ck_assert (json_array_get_length (array) == 2);
+	env = json_array_get_object_element (array, 1);
+	ck_assert_str_eq (json_object_get_string_member (env, "env"), "FOO");
+	ck_assert_str_eq (json_object_get_string_member (env, "value"),
+			"bar=baz");
+
+	json_object_unref (payload);
+	g_strfreev (config.oci.process.env);
+
+	/* invalid environment variable */
+	config.oci.process.env = g_strsplit ("HOME=/root|FOO", "|", -1);
+	ck_assert (! cc_proxy_exec_payload (&config));
+	g_strfreev (config.oci.process.env);
+	g_strfreev (config.oci.process.args);
+
+} END_TEST
+
+START_TEST(test_cc_proxy_cmd_exec) {
+	struct cc_oci_config config = { { 0 } };
+	int proxy_io_fd = -1;
+	int io_base = -1;
+
+	ck_assert (! cc_proxy_cmd_exec (NULL, &proxy_io_fd, &io_base));
+
+	/* no proxy */
+	ck_assert (! cc_proxy_cmd_exec (&config, &proxy_io_fd, &io_base));
+
+	ck_assert (proxy_io_fd == -1);
+	ck_assert (io_base == -1);
+
+} END_TEST
+
 Suite* make_proxy_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST (test_cc_proxy_connect, s);
 	ADD_TEST (test_cc_proxy_disconnect, s);
+	ADD_TEST (test_cc_proxy_response_data, s);
+	ADD_TEST (test_cc_proxy_exec_payload, s);
+	ADD_TEST (test_cc_proxy_cmd_exec, s);
 
 	return s;
 }
@@ -0,0 +1,220 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/ps.h"
+
+GArray *cc_oci_ps_parse_pids (const gchar *contents);
+gboolean cc_oci_ps_parse_stat (const gchar *contents,
+		struct cc_oci_ps_entry *entry);
+gchar *cc_oci_ps_format_time (guint64 ns);
+
+START_TEST(test_cc_oci_ps_parse_pids) {
+	GArray *pids;
+
+	pids = cc_oci_ps_parse_pids (NULL);
+	ck_assert (pids);
+	ck_assert (pids->len == 0);
+	g_array_free (pids, true);
+
+	pids = cc_oci_ps_parse_pids ("");
+	ck_assert (pids);
+	ck_assert (pids->len == 0);
+	g_array_free (pids, true);
+
+	/* unsorted, with duplicates and junk */
+	pids = cc_oci_ps_parse_pids ("12\n3\n\n12\nfoo\n-1\n0\n7x\n 1 \n");
+	ck_assert (pids);
+	ck_assert (pids->len == 3);
+	ck_assert (g_array_index (pids, GPid, 0) == 1);
+	ck_assert (g_array_index (pids, GPid, 1) == 3);
+	ck_assert (g_array_index (pids, GPid, 2) == 12);
+	g_array_free (pids, true);
+
+} END_TEST
+
+START_TEST(test_cc_oci_ps_parse_stat) {
+	struct cc_oci_ps_entry entry;
+	guint64 ns_per_tick = (guint64)(1000000000 / sysconf (_SC_CLK_TCK));
+	guint64 page_size = (guint64)sysconf (_SC_PAGESIZE);
+
+	ck_assert (! cc_oci_ps_parse_stat (NULL, &entry));
+	ck_assert (! cc_oci_ps_parse_stat ("1 (sh) S 0", NULL));
+	ck_assert (! cc_oci_ps_parse_stat ("1 (sh) S 0", &entry));
+	ck_assert (! cc_oci_ps_parse_stat ("", &entry));
+	ck_assert (! cc_oci_ps_parse_stat ("(sh) S 0 1 1 0 -1 4194560 "
+				"1 0 0 0 7 3 0 0 20 0 1 0 100 4096 9",
+				&entry));
+
+	ck_assert (cc_oci_ps_parse_stat ("42 (sh) S 1 42 42 0 -1 "
+				"4194560 1 0 0 0 7 3 0 0 20 0 1 0 100 "
+				"4096 9 18446744073709551615",
+				&entry));
+	ck_assert (entry.pid == 42);
+	ck_assert (entry.ppid == 1);
+	ck_assert (entry.state == 'S');
+	ck_assert (entry.time == 10 * ns_per_tick);
+	ck_assert (entry.rss == 9 * page_size);
+	ck_assert (! g_strcmp0 (entry.cmd, "sh"));
+
+	/* command names may contain spaces and parentheses,
+	 * and are truncated like the kernel does.
+	 */
+	ck_assert (cc_oci_ps_parse_stat ("7 (a (b) c d e f g h i) R 0 7 7 "
+				"0 -1 4194560 1 0 0 0 0 0 0 0 20 0 1 0 "
+				"100 4096 0",
+				&entry));
+	ck_assert (entry.pid == 7);
+	ck_assert (entry.ppid == 0);
+	ck_assert (entry.state == 'R');
+	ck_assert (! g_strcmp0 (entry.cmd, "a (b) c d e f g"));
+
+} END_TEST
+
+START_TEST(test_cc_oci_ps_format_time) {
+	gchar *str;
+
+	str = cc_oci_ps_format_time (0);
+	ck_assert_str_eq (str, "00:00:00");
+	g_free (str);
+
+	/* 1h 2m 3.5s */
+	str = cc_oci_ps_format_time (3723500000000ULL);
+	ck_assert_str_eq (str, "01:02:03");
+	g_free (str);
+
+	/* 2 days, 3s */
+	str = cc_oci_ps_format_time ((2 * 86400 + 3) * 1000000000ULL);
+	ck_assert_str_eq (str, "2-00:00:03");
+	g_free (str);
+
+} END_TEST
+
+START_TEST(test_cc_oci_ps_to_table) {
+	struct cc_oci_ps_entry entry = {
+		.pid = 1, .ppid = 0, .state = 'S',
+		.rss = 2048 * 1024, .time = 61000000000ULL, .cmd = "sh"
+	};
+	GArray *procs;
+	gchar *str;
+
+	ck_assert (! cc_oci_ps_to_table (NULL));
+
+	procs = g_array_new (false, true, sizeof (struct cc_oci_ps_entry));
+
+	str = cc_oci_ps_to_table (procs);
+	ck_assert (str);
+	ck_assert (g_str_has_prefix (str, "    PID    PPID S"));
+	ck_assert (g_strstr_len (str, -1, "\n") == str + strlen (str) - 1);
+	g_free (str);
+
+	g_array_append_val (procs, entry);
+
+	str = cc_oci_ps_to_table (procs);
+	ck_assert (str);
+	ck_assert (g_str_has_suffix (str,
+		"      1       0 S       2048    00:01:01 sh\n"));
+	g_free (str);
+
+	g_array_free (procs, true);
+
+} END_TEST
+
+START_TEST(test_cc_oci_ps_to_json) {
+	struct cc_oci_ps_entry entry = {
+		.pid = 5, .ppid = 1, .state = 'Z',
+		.rss = 4096, .time = 123, .cmd = "defunct"
+	};
+	GArray *procs;
+	JsonArray *array;
+	JsonObject *obj;
+
+	ck_assert (! cc_oci_ps_to_json (NULL));
+
+	procs = g_array_new (false, true, sizeof (struct cc_oci_ps_entry));
+	g_array_append_val (procs, entry);
+
+	array = cc_oci_ps_to_json (procs);
+	ck_assert (array);
+	ck_assert (json_array_get_length (array) == 1);
+
+	obj = json_array_get_object_element (array, 0);
+	ck_assert (json_object_get_int_member (obj, "pid") == 5);
+	ck_assert (json_object_get_int_member (obj, "ppid") == 1);
+	ck_assert_str_eq (json_object_get_string_member (obj, "state"), "Z");
+	ck_assert (json_object_get_int_member (obj, "rss") == 4096);
+	ck_assert (json_object_get_int_member (obj, "cpu_time") == 123);
+	ck_assert_str_eq (json_object_get_string_member (obj, "cmd"),
+			"defunct");
+
+	json_array_unref (array);
+	g_array_free (procs, true);
+
+} END_TEST
+
+START_TEST(test_cc_oci_ps_get) {
+	ck_assert (! cc_oci_ps_get (NULL));
+} END_TEST
+
+Suite* make_ps_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_ps_parse_pids, s);
+	ADD_TEST(test_cc_oci_ps_parse_stat, s);
+	ADD_TEST(test_cc_oci_ps_format_time, s);
+	ADD_TEST(test_cc_oci_ps_to_table, s);
+	ADD_TEST(test_cc_oci_ps_to_json, s);
+	ADD_TEST(test_cc_oci_ps_get, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("ps_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_ps_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
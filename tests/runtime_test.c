@@ -146,12 +146,53 @@ START_TEST(test_cc_oci_runtime_dir_delete) {
 	cc_oci_config_free (config);
 } END_TEST
 
+START_TEST(test_cc_oci_runtime_container_ids) {
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *missing = NULL;
+	g_autofree gchar *vm1_dir = NULL;
+	g_autofree gchar *vm1_state = NULL;
+	g_autofree gchar *other_dir = NULL;
+	GSList *ids;
+
+	ck_assert (! cc_oci_runtime_container_ids (NULL));
+
+	missing = g_build_path ("/", tmpdir, "does-not-exist", NULL);
+	ck_assert (! cc_oci_runtime_container_ids (missing));
+
+	ck_assert (! cc_oci_runtime_container_ids (tmpdir));
+
+	/* directories without a state file are not containers */
+	other_dir = g_build_path ("/", tmpdir, "other", NULL);
+	ck_assert (! g_mkdir (other_dir, 0750));
+
+	vm1_dir = g_build_path ("/", tmpdir, "vm1", NULL);
+	ck_assert (! g_mkdir (vm1_dir, 0750));
+
+	ck_assert (! cc_oci_runtime_container_ids (tmpdir));
+
+	/* the state file is not read */
+	vm1_state = g_build_path ("/", vm1_dir, CC_OCI_STATE_FILE, NULL);
+	ck_assert (g_file_set_contents (vm1_state, "", -1, NULL));
+
+	ids = cc_oci_runtime_container_ids (tmpdir);
+	ck_assert (g_slist_length (ids) == 1);
+	ck_assert (! g_strcmp0 (ids->data, "vm1"));
+	g_slist_free_full (ids, g_free);
+
+	/* clean up */
+	ck_assert (! g_remove (vm1_state));
+	ck_assert (! g_remove (vm1_dir));
+	ck_assert (! g_remove (other_dir));
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
 Suite* make_runtime_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_runtime_path_get, s);
 	ADD_TEST(test_cc_oci_runtime_dir_setup, s);
 	ADD_TEST(test_cc_oci_runtime_dir_delete, s);
+	ADD_TEST(test_cc_oci_runtime_container_ids, s);
 
 	return s;
 }
@@ -0,0 +1,88 @@
+/*
+ * This file is part of cc-oci-runtime.
+ * 
+ * Copyright (C) 2016 Intel Corporation
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/section.h"
+
+START_TEST(test_cc_oci_section_from_name) {
+	ck_assert (cc_oci_section_from_name (NULL) == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("v") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("vmx") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("pids") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("Process") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("ociversion") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("rootfs") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("solaris") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("windows") == CC_OCI_SECTION_UNKNOWN);
+	ck_assert (cc_oci_section_from_name ("workloadDirectory") == CC_OCI_SECTION_UNKNOWN);
+
+	ck_assert (cc_oci_section_from_name ("vm") == CC_OCI_SECTION_VM);
+	ck_assert (cc_oci_section_from_name ("pid") == CC_OCI_SECTION_PID);
+	ck_assert (cc_oci_section_from_name ("pod") == CC_OCI_SECTION_POD);
+	ck_assert (cc_oci_section_from_name ("process") == CC_OCI_SECTION_PROCESS);
+	ck_assert (cc_oci_section_from_name ("processPath") == CC_OCI_SECTION_PROCESS_PATH);
+} END_TEST
+
+START_TEST(test_cc_oci_section_name) {
+	ck_assert (! cc_oci_section_name (CC_OCI_SECTION_UNKNOWN));
+	ck_assert (! cc_oci_section_name (CC_OCI_SECTION_COUNT));
+
+	/* every section must be found from its own name: this fails
+	 * if a new section name collides with an existing one.
+	 */
+	for (gint s = CC_OCI_SECTION_UNKNOWN + 1; s < CC_OCI_SECTION_COUNT; s++) {
+		const gchar *name = cc_oci_section_name (s);
+
+		ck_assert_msg (name, "section %d has no name", s);
+		ck_assert_msg (cc_oci_section_from_name (name) == (enum cc_oci_section)s,
+				"section name %s not found", name);
+	}
+} END_TEST
+
+Suite* make_section_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_section_from_name, s);
+	ADD_TEST(test_cc_oci_section_name, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+
+	s = make_section_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,402 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/state.h"
+#include "../src/state_index.h"
+
+gboolean cc_oci_state_index_rebuild (const gchar *root_dir,
+		struct oci_state **states,
+		const struct stat *stats,
+		guint count);
+
+static goffset
+index_size (const gchar *root_dir)
+{
+	g_autofree gchar *path = NULL;
+	struct stat st;
+
+	path = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_FILE, NULL);
+
+	if (stat (path, &st) < 0) {
+		return -1;
+	}
+
+	return (goffset)st.st_size;
+}
+
+static struct oci_state *
+find_state (GSList *states, const gchar *id)
+{
+	GSList *l;
+
+	for (l = states; l; l = g_slist_next (l)) {
+		struct oci_state *state = l->data;
+
+		if (! g_strcmp0 (state->id, id)) {
+			return state;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+check_state (const struct oci_state *state,
+		const struct cc_oci_config *config)
+{
+	ck_assert (state);
+	ck_assert (! g_strcmp0 (state->id, config->optarg_container_id));
+	ck_assert (state->pid == config->state.workload_pid);
+	ck_assert (state->status == config->state.status);
+	ck_assert (! g_strcmp0 (state->bundle_path, config->bundle_path));
+	ck_assert (! g_strcmp0 (state->create_time, "timestamp for vm1") ||
+			! g_strcmp0 (state->create_time, "timestamp for vm2"));
+
+	ck_assert (state->vm);
+	ck_assert (state->vm->pid == config->vm->pid);
+	ck_assert (! g_strcmp0 (state->vm->hypervisor_path,
+				config->vm->hypervisor_path));
+	ck_assert (! g_strcmp0 (state->vm->kernel_path,
+				config->vm->kernel_path));
+	ck_assert (! g_strcmp0 (state->vm->image_path,
+				config->vm->image_path));
+}
+
+START_TEST(test_cc_oci_state_index_update) {
+	struct cc_oci_config *vm1_config = NULL;
+	struct cc_oci_config *vm2_config = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	goffset size1;
+	goffset size2;
+
+	ck_assert (! cc_oci_state_index_update (NULL, NULL));
+	ck_assert (! cc_oci_state_index_remove (NULL));
+
+	vm1_config = cc_oci_config_create ();
+	ck_assert (vm1_config);
+
+	/* no runtime path */
+	vm1_config->optarg_container_id = "vm1";
+	ck_assert (! cc_oci_state_index_update (vm1_config, "foo"));
+	ck_assert (! cc_oci_state_index_remove (vm1_config));
+
+	vm2_config = cc_oci_config_create ();
+	ck_assert (vm2_config);
+
+	/* creating a state file adds the container to the index */
+	ck_assert (test_helper_create_state_file ("vm1", tmpdir,
+				vm1_config));
+	size1 = index_size (tmpdir);
+	ck_assert (size1 > 0);
+
+	ck_assert (test_helper_create_state_file ("vm2", tmpdir,
+				vm2_config));
+	size2 = index_size (tmpdir);
+	ck_assert (size2 > size1);
+
+	/* updates are made in place */
+	vm1_config->state.status = OCI_STATUS_PAUSED;
+	ck_assert (cc_oci_state_file_create (vm1_config,
+				"timestamp for vm1"));
+	ck_assert (index_size (tmpdir) == size2);
+
+	/* deleting the state file removes the container */
+	ck_assert (cc_oci_state_file_delete (vm1_config));
+	ck_assert (index_size (tmpdir) == size1);
+
+	/* removing an unknown container is not an error */
+	ck_assert (cc_oci_state_index_remove (vm1_config));
+	ck_assert (index_size (tmpdir) == size1);
+
+	ck_assert (cc_oci_state_file_delete (vm2_config));
+	ck_assert (index_size (tmpdir) < size1);
+
+	/* clean up */
+	ck_assert (! g_remove (vm1_config->state.runtime_path));
+	ck_assert (! g_remove (vm2_config->state.runtime_path));
+	ck_assert (test_helper_remove_state_index (tmpdir));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (vm1_config);
+	cc_oci_config_free (vm2_config);
+} END_TEST
+
+START_TEST(test_cc_oci_state_index_list) {
+	struct cc_oci_config *vm1_config = NULL;
+	struct cc_oci_config *vm2_config = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *index = NULL;
+	g_autofree gchar *missing = NULL;
+	GSList *states;
+	goffset size;
+
+	ck_assert (! cc_oci_state_index_list (NULL));
+
+	missing = g_build_path ("/", tmpdir, "does-not-exist", NULL);
+	ck_assert (! cc_oci_state_index_list (missing));
+
+	/* no containers */
+	ck_assert (! cc_oci_state_index_list (tmpdir));
+
+	vm1_config = cc_oci_config_create ();
+	ck_assert (vm1_config);
+
+	vm2_config = cc_oci_config_create ();
+	ck_assert (vm2_config);
+
+	ck_assert (test_helper_create_state_file ("vm1", tmpdir,
+				vm1_config));
+	ck_assert (test_helper_create_state_file ("vm2", tmpdir,
+				vm2_config));
+
+	size = index_size (tmpdir);
+	ck_assert (size > 0);
+
+	/* listed from the index */
+	states = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (states) == 2);
+	check_state (find_state (states, "vm1"), vm1_config);
+	check_state (find_state (states, "vm2"), vm2_config);
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	/* a damaged index is ignored and rebuilt */
+	index = g_build_path ("/", tmpdir, CC_OCI_STATE_INDEX_FILE, NULL);
+	ck_assert (g_file_set_contents (index, "garbage", -1, NULL));
+
+	states = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (states) == 2);
+	check_state (find_state (states, "vm1"), vm1_config);
+	check_state (find_state (states, "vm2"), vm2_config);
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	ck_assert (index_size (tmpdir) == size);
+
+	/* containers missing from the index are read from their
+	 * state file and added back.
+	 */
+	ck_assert (cc_oci_state_index_remove (vm2_config));
+	ck_assert (index_size (tmpdir) < size);
+
+	states = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (states) == 2);
+	check_state (find_state (states, "vm2"), vm2_config);
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	ck_assert (index_size (tmpdir) == size);
+
+	/* records for containers which no longer exist are dropped */
+	ck_assert (! g_remove (vm2_config->state.state_file_path));
+
+	states = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (states) == 1);
+	check_state (find_state (states, "vm1"), vm1_config);
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	ck_assert (index_size (tmpdir) < size);
+
+	/* clean up */
+	ck_assert (! g_remove (vm1_config->state.state_file_path));
+	ck_assert (! g_remove (vm1_config->state.runtime_path));
+	ck_assert (! g_remove (vm2_config->state.runtime_path));
+	ck_assert (test_helper_remove_state_index (tmpdir));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (vm1_config);
+	cc_oci_config_free (vm2_config);
+} END_TEST
+
+START_TEST(test_cc_oci_state_index_rebuild) {
+	struct cc_oci_config *vm1_config = NULL;
+	struct cc_oci_config *vm2_config = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *index = NULL;
+	struct oci_state *states[2] = { NULL };
+	struct stat stats[2];
+	GSList *list;
+	goffset size;
+
+	ck_assert (! cc_oci_state_index_rebuild (NULL, NULL, NULL, 0));
+
+	vm1_config = cc_oci_config_create ();
+	ck_assert (vm1_config);
+	vm1_config->state.status = OCI_STATUS_CREATED;
+
+	vm2_config = cc_oci_config_create ();
+	ck_assert (vm2_config);
+
+	ck_assert (test_helper_create_state_file ("vm1", tmpdir,
+				vm1_config));
+	ck_assert (test_helper_create_state_file ("vm2", tmpdir,
+				vm2_config));
+
+	size = index_size (tmpdir);
+	ck_assert (size > 0);
+
+	index = g_build_path ("/", tmpdir, CC_OCI_STATE_INDEX_FILE, NULL);
+	ck_assert (! g_remove (index));
+
+	/* states read by a scan */
+	ck_assert (! stat (vm1_config->state.state_file_path, &stats[0]));
+	states[0] = cc_oci_state_file_read_summary
+		(vm1_config->state.state_file_path);
+	ck_assert (states[0]);
+	ck_assert (states[0]->status == OCI_STATUS_CREATED);
+
+	ck_assert (! stat (vm2_config->state.state_file_path, &stats[1]));
+	states[1] = cc_oci_state_file_read_summary
+		(vm2_config->state.state_file_path);
+	ck_assert (states[1]);
+
+	/* the container is started before the index is rebuilt: make
+	 * sure the state file gets a different mtime (the size of the
+	 * file doesn't change).
+	 */
+	g_usleep (G_USEC_PER_SEC / 20);
+	vm1_config->state.status = OCI_STATUS_RUNNING;
+	ck_assert (cc_oci_state_file_create (vm1_config,
+				"timestamp for vm1"));
+
+	/* the out of date state isn't indexed */
+	ck_assert (cc_oci_state_index_rebuild (tmpdir, states, stats, 2));
+	ck_assert (index_size (tmpdir) < size);
+
+	list = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (list) == 2);
+	check_state (find_state (list, "vm1"), vm1_config);
+	check_state (find_state (list, "vm2"), vm2_config);
+	ck_assert (find_state (list, "vm1")->status == OCI_STATUS_RUNNING);
+	g_slist_free_full (list, (GDestroyNotify)cc_oci_state_free);
+
+	ck_assert (index_size (tmpdir) == size);
+
+	/* clean up */
+	cc_oci_state_free (states[0]);
+	cc_oci_state_free (states[1]);
+
+	ck_assert (! g_remove (vm1_config->state.state_file_path));
+	ck_assert (! g_remove (vm2_config->state.state_file_path));
+	ck_assert (! g_remove (vm1_config->state.runtime_path));
+	ck_assert (! g_remove (vm2_config->state.runtime_path));
+	ck_assert (test_helper_remove_state_index (tmpdir));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (vm1_config);
+	cc_oci_config_free (vm2_config);
+} END_TEST
+
+/* enough containers for the directory to be scanned by a thread pool */
+#define MANY_CONTAINERS 100
+
+START_TEST(test_cc_oci_state_index_list_many) {
+	struct cc_oci_config *configs[MANY_CONTAINERS] = { NULL };
+	gchar *names[MANY_CONTAINERS] = { NULL };
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *index = NULL;
+	GSList *states;
+	goffset size;
+	int i;
+
+	for (i = 0; i < MANY_CONTAINERS; i++) {
+		names[i] = g_strdup_printf ("vm%d", i);
+		configs[i] = cc_oci_config_create ();
+		ck_assert (configs[i]);
+		ck_assert (test_helper_create_state_file (names[i], tmpdir,
+					configs[i]));
+	}
+
+	size = index_size (tmpdir);
+
+	/* listed from the index */
+	states = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (states) == MANY_CONTAINERS);
+	for (i = 0; i < MANY_CONTAINERS; i++) {
+		ck_assert (find_state (states, names[i]));
+	}
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	/* all read from the state files */
+	index = g_build_path ("/", tmpdir, CC_OCI_STATE_INDEX_FILE, NULL);
+	ck_assert (! g_remove (index));
+
+	states = cc_oci_state_index_list (tmpdir);
+	ck_assert (g_slist_length (states) == MANY_CONTAINERS);
+	for (i = 0; i < MANY_CONTAINERS; i++) {
+		ck_assert (find_state (states, names[i]));
+	}
+	g_slist_free_full (states, (GDestroyNotify)cc_oci_state_free);
+
+	ck_assert (index_size (tmpdir) == size);
+
+	/* clean up */
+	for (i = 0; i < MANY_CONTAINERS; i++) {
+		ck_assert (! g_remove (configs[i]->state.state_file_path));
+		ck_assert (! g_remove (configs[i]->state.runtime_path));
+		cc_oci_config_free (configs[i]);
+		g_free (names[i]);
+	}
+
+	ck_assert (test_helper_remove_state_index (tmpdir));
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+Suite* make_state_index_suite(void) {
+	Suite* s = suite_create(__FILE__);
+	ADD_TEST(test_cc_oci_state_index_update, s);
+	ADD_TEST(test_cc_oci_state_index_list, s);
+	ADD_TEST(test_cc_oci_state_index_rebuild, s);
+	ADD_TEST(test_cc_oci_state_index_list_many, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("state_index_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_state_index_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
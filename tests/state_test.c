@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -143,6 +144,56 @@ START_TEST(test_cc_oci_state_file_read) {
 
 } END_TEST
 
+START_TEST(test_cc_oci_state_file_read_summary) {
+	struct oci_state *state = NULL;
+
+	ck_assert(! cc_oci_state_file_read_summary(NULL));
+
+	ck_assert(! cc_oci_state_file_read_summary("/abc/123/xyz"));
+
+	ck_assert(! cc_oci_state_file_read_summary(TEST_DATA_DIR
+	                "/state-no-bundlePath.json"));
+
+	ck_assert(! cc_oci_state_file_read_summary(TEST_DATA_DIR
+	                "/state-no-id.json"));
+
+	ck_assert(! cc_oci_state_file_read_summary(TEST_DATA_DIR
+	                "/state-no-vm-object.json"));
+
+	ck_assert(! cc_oci_state_file_read_summary(TEST_DATA_DIR
+	                "/state-no-vm-pid.json"));
+
+	/* sections not needed to list containers are not read */
+	state = cc_oci_state_file_read_summary(TEST_DATA_DIR
+	                "/state-no-proxy.json");
+	ck_assert (state);
+	cc_oci_state_free (state);
+
+	state = cc_oci_state_file_read_summary(TEST_DATA_DIR "/state.json");
+	ck_assert(state);
+	ck_assert(! g_strcmp0 (state->id, "foo"));
+	ck_assert(state->pid == 9127);
+	ck_assert(! g_strcmp0 (state->bundle_path, "/tmp/bundle/"));
+	ck_assert(state->status == OCI_STATUS_RUNNING);
+	ck_assert(! g_strcmp0 (state->create_time,
+				"2016-05-18T17:02:55.250085Z"));
+	ck_assert(state->vm);
+	ck_assert(state->vm->pid == 999);
+	ck_assert(! g_strcmp0 (state->vm->hypervisor_path,
+				"/path/to/qemu-system-x86_64"));
+	ck_assert(! g_strcmp0 (state->vm->kernel_path, "/path/to/vmlinux"));
+	ck_assert(! g_strcmp0 (state->vm->image_path,
+				"/path/to/clear-containers.img"));
+	ck_assert(! state->vm->kernel_params);
+	ck_assert(! state->pod);
+	ck_assert(! state->proxy);
+	ck_assert(! state->oci_version);
+	ck_assert(! state->comms_path);
+	ck_assert(! state->mounts);
+	ck_assert(! state->annotations);
+	cc_oci_state_free(state);
+} END_TEST
+
 START_TEST(test_cc_oci_state_free) {
 	struct oci_state *state = g_new0 (struct oci_state, 1);
 	ck_assert(state);
@@ -262,6 +313,7 @@ START_TEST(test_cc_oci_state_file_create) {
 
 	ck_assert (! g_remove (config->state.state_file_path));
 	ck_assert (! g_remove (config->state.runtime_path));
+	ck_assert (test_helper_remove_state_index (tmpdir));
 	ck_assert (! g_remove (tmpdir));
 
 	g_snprintf(config->state.runtime_path, PATH_MAX, "/abc/xyz/123");
@@ -294,6 +346,110 @@ START_TEST(test_cc_oci_state_file_delete) {
 	cc_oci_config_free (config);
 } END_TEST
 
+START_TEST(test_cc_oci_state_file_update) {
+	struct cc_oci_config *config = NULL;
+	struct oci_state *state = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	GDir *dir;
+	gchar *contents = NULL;
+	GPid pid;
+
+	ck_assert (! cc_oci_state_file_update (NULL, 0));
+	ck_assert (! cc_oci_state_file_update (NULL,
+				CC_OCI_STATE_UPDATE_STATUS));
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+
+	/* no state file */
+	ck_assert (! cc_oci_state_file_update (config,
+				CC_OCI_STATE_UPDATE_STATUS));
+
+	ck_assert (test_helper_create_state_file ("foo", tmpdir, config));
+	ck_assert (! cc_oci_state_file_update (config, 0));
+
+	/* state files are written compactly */
+	ck_assert (g_file_get_contents (config->state.state_file_path,
+				&contents, NULL, NULL));
+	ck_assert (! strchr (contents, '\n'));
+	g_free (contents);
+
+	/* only the requested fields are changed */
+	pid = config->state.workload_pid;
+	config->state.workload_pid = pid + 1;
+	config->state.status = OCI_STATUS_PAUSED;
+	ck_assert (cc_oci_state_file_update (config,
+				CC_OCI_STATE_UPDATE_STATUS));
+
+	state = cc_oci_state_file_read (config->state.state_file_path);
+	ck_assert (state);
+	ck_assert (state->status == OCI_STATUS_PAUSED);
+	ck_assert (state->pid == pid);
+	ck_assert (! g_strcmp0 (state->id, "foo"));
+	ck_assert (! g_strcmp0 (state->bundle_path, config->bundle_path));
+	ck_assert (! g_strcmp0 (state->create_time, "timestamp for foo"));
+	ck_assert (! g_strcmp0 (state->vm->kernel_params,
+				config->vm->kernel_params));
+	cc_oci_state_free (state);
+
+	config->state.sync = CC_OCI_STATE_SYNC_FULL;
+	ck_assert (cc_oci_state_file_update (config,
+				CC_OCI_STATE_UPDATE_PID));
+
+	state = cc_oci_state_file_read (config->state.state_file_path);
+	ck_assert (state);
+	ck_assert (state->status == OCI_STATUS_PAUSED);
+	ck_assert (state->pid == pid + 1);
+	cc_oci_state_free (state);
+
+	config->state.sync = CC_OCI_STATE_SYNC_NONE;
+	g_snprintf (config->oci.process.cwd,
+			sizeof (config->oci.process.cwd), "%s", "/new_cwd");
+	ck_assert (cc_oci_state_file_update (config,
+				CC_OCI_STATE_UPDATE_STATUS |
+				CC_OCI_STATE_UPDATE_PROCESS));
+
+	state = cc_oci_state_file_read (config->state.state_file_path);
+	ck_assert (state);
+	ck_assert (state->process);
+	ck_assert (! g_strcmp0 (state->process->cwd, "/new_cwd"));
+	cc_oci_state_free (state);
+
+	/* the temporary files have been renamed */
+	dir = g_dir_open (config->state.runtime_path, 0, NULL);
+	ck_assert (dir);
+	ck_assert_str_eq (g_dir_read_name (dir), CC_OCI_STATE_FILE);
+	ck_assert (! g_dir_read_name (dir));
+	g_dir_close (dir);
+
+	/* clean up */
+	ck_assert (! g_remove (config->state.state_file_path));
+	ck_assert (! g_remove (config->state.runtime_path));
+	ck_assert (test_helper_remove_state_index (tmpdir));
+	ck_assert (! g_remove (tmpdir));
+	cc_oci_config_free (config);
+} END_TEST
+
+START_TEST(test_cc_oci_state_sync_from_str) {
+	enum cc_oci_state_sync sync = CC_OCI_STATE_SYNC_FILE;
+
+	ck_assert (! cc_oci_state_sync_from_str (NULL, NULL));
+	ck_assert (! cc_oci_state_sync_from_str ("none", NULL));
+	ck_assert (! cc_oci_state_sync_from_str (NULL, &sync));
+	ck_assert (! cc_oci_state_sync_from_str ("", &sync));
+	ck_assert (! cc_oci_state_sync_from_str ("always", &sync));
+	ck_assert (sync == CC_OCI_STATE_SYNC_FILE);
+
+	ck_assert (cc_oci_state_sync_from_str ("none", &sync));
+	ck_assert (sync == CC_OCI_STATE_SYNC_NONE);
+
+	ck_assert (cc_oci_state_sync_from_str ("full", &sync));
+	ck_assert (sync == CC_OCI_STATE_SYNC_FULL);
+
+	ck_assert (cc_oci_state_sync_from_str ("file", &sync));
+	ck_assert (sync == CC_OCI_STATE_SYNC_FILE);
+} END_TEST
+
 START_TEST(test_cc_oci_state_file_exists) {
 	struct cc_oci_config *config = NULL;
 
@@ -384,9 +540,12 @@ Suite* make_state_suite(void) {
 	Suite* s = suite_create(__FILE__);
 	ADD_TEST(test_cc_oci_state_file_get, s);
 	ADD_TEST(test_cc_oci_state_file_read, s);
+	ADD_TEST(test_cc_oci_state_file_read_summary, s);
 	ADD_TEST(test_cc_oci_state_free, s);
 	ADD_TEST(test_cc_oci_state_file_create, s);
 	ADD_TEST(test_cc_oci_state_file_delete, s);
+	ADD_TEST(test_cc_oci_state_file_update, s);
+	ADD_TEST(test_cc_oci_state_sync_from_str, s);
 	ADD_TEST(test_cc_oci_state_file_exists, s);
 	ADD_TEST(test_cc_oci_status_get, s);
 	ADD_TEST(test_cc_oci_status_to_str, s);
@@ -0,0 +1,361 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/stats.h"
+
+GHashTable *cc_oci_stats_parse_keys (const gchar *contents);
+gboolean cc_oci_stats_parse_proc_stat (const gchar *contents,
+		guint64 *utime, guint64 *stime, guint64 *threads);
+void cc_oci_stats_parse_net_dev (const gchar *contents,
+		struct cc_oci_stats *stats);
+gboolean cc_oci_stats_parse_restore_smaps (const gchar *contents,
+		guint64 *faulted, guint64 *total);
+
+START_TEST(test_cc_oci_stats_parse_keys) {
+	GHashTable *table;
+	guint64 *value;
+
+	table = cc_oci_stats_parse_keys (NULL);
+	ck_assert (table);
+	ck_assert (! g_hash_table_size (table));
+	g_hash_table_destroy (table);
+
+	table = cc_oci_stats_parse_keys (
+			"Rss:                1024 kB\n"
+			"VmHWM:\t    2 kB\n"
+			"read_bytes: 4096\n"
+			"cache 123\n"
+			"\n"
+			"nothing\n");
+	ck_assert (table);
+	ck_assert (g_hash_table_size (table) == 4);
+
+	value = g_hash_table_lookup (table, "Rss");
+	ck_assert (value && *value == 1024 * 1024);
+
+	value = g_hash_table_lookup (table, "VmHWM");
+	ck_assert (value && *value == 2048);
+
+	value = g_hash_table_lookup (table, "read_bytes");
+	ck_assert (value && *value == 4096);
+
+	value = g_hash_table_lookup (table, "cache");
+	ck_assert (value && *value == 123);
+
+	ck_assert (! g_hash_table_lookup (table, "nothing"));
+
+	g_hash_table_destroy (table);
+
+} END_TEST
+
+START_TEST(test_cc_oci_stats_parse_proc_stat) {
+	guint64 utime = 0;
+	guint64 stime = 0;
+	guint64 threads = 0;
+	guint64 ns_per_tick = (guint64)(1000000000 / sysconf (_SC_CLK_TCK));
+
+	ck_assert (! cc_oci_stats_parse_proc_stat (NULL,
+				&utime, &stime, &threads));
+	ck_assert (! cc_oci_stats_parse_proc_stat ("1 (qemu) S",
+				&utime, &stime, &threads));
+
+	/* command names may contain spaces and parentheses */
+	ck_assert (cc_oci_stats_parse_proc_stat (
+				"1234 (CPU 0/KVM (x)) S 1 1234 1234 0 -1 "
+				"138412352 1 0 0 0 7 3 0 0 20 0 5 0",
+				&utime, &stime, &threads));
+	ck_assert (utime == 7 * ns_per_tick);
+	ck_assert (stime == 3 * ns_per_tick);
+	ck_assert (threads == 5);
+
+} END_TEST
+
+START_TEST(test_cc_oci_stats_parse_net_dev) {
+	struct cc_oci_stats stats;
+	struct cc_oci_net_stats *iface;
+
+	cc_oci_stats_init (&stats);
+
+	cc_oci_stats_parse_net_dev (NULL, &stats);
+	ck_assert (stats.interfaces->len == 0);
+
+	cc_oci_stats_parse_net_dev (
+		"Inter-|   Receive                            "
+		"                    |  Transmit\n"
+		" face |bytes    packets errs drop fifo frame compressed "
+		"multicast|bytes    packets errs drop fifo colls carrier "
+		"compressed\n"
+		"    lo:     100       1    0    0    0     0          0 "
+		"        0      100       1    0    0    0     0       0 "
+		"         0\n"
+		"  eth0:    2000      20    1    2    0     0          0 "
+		"        0     3000      30    3    4    0     0       0 "
+		"         0\n",
+		&stats);
+
+	ck_assert (stats.interfaces->len == 1);
+
+	iface = &g_array_index (stats.interfaces, struct cc_oci_net_stats, 0);
+	ck_assert (! g_strcmp0 (iface->name, "eth0"));
+	ck_assert (iface->values[CC_OCI_NET_STAT_RX_BYTES] == 2000);
+	ck_assert (iface->values[CC_OCI_NET_STAT_RX_PACKETS] == 20);
+	ck_assert (iface->values[CC_OCI_NET_STAT_RX_ERRORS] == 1);
+	ck_assert (iface->values[CC_OCI_NET_STAT_RX_DROPPED] == 2);
+	ck_assert (iface->values[CC_OCI_NET_STAT_TX_BYTES] == 3000);
+	ck_assert (iface->values[CC_OCI_NET_STAT_TX_PACKETS] == 30);
+	ck_assert (iface->values[CC_OCI_NET_STAT_TX_ERRORS] == 3);
+	ck_assert (iface->values[CC_OCI_NET_STAT_TX_DROPPED] == 4);
+
+	cc_oci_stats_clear (&stats);
+
+} END_TEST
+
+START_TEST(test_cc_oci_stats_parse_restore_smaps) {
+	guint64 faulted = 0;
+	guint64 total = 0;
+	guint64 page_kb = (guint64)sysconf (_SC_PAGESIZE) / 1024;
+	g_autofree gchar *smaps = NULL;
+
+	ck_assert (! cc_oci_stats_parse_restore_smaps (NULL,
+				&faulted, &total));
+
+	/* no guest memory mapped from a checkpoint image */
+	ck_assert (! cc_oci_stats_parse_restore_smaps (
+				"00400000-00401000 r-xp 00000000 08:01 12 "
+				"/usr/bin/qemu-lite-system-x86_64\n"
+				"Size:                  4 kB\n"
+				"Rss:                   4 kB\n",
+				&faulted, &total));
+
+	/* two mappings of the image (the second of a replaced file),
+	 * surrounded by others
+	 */
+	smaps = g_strdup_printf (
+			"00400000-00401000 r-xp 00000000 08:01 12 "
+			"/usr/bin/qemu-lite-system-x86_64\n"
+			"Size:                  4 kB\n"
+			"Rss:                   4 kB\n"
+			"VmFlags: rd ex mr mw me dw\n"
+			"7f0000000000-7f0000100000 rw-p 00000000 08:01 34 "
+			"/tmp/image dir/ram.img\n"
+			"Size:               %" G_GUINT64_FORMAT " kB\n"
+			"Rss:                %" G_GUINT64_FORMAT " kB\n"
+			"Anonymous:          %" G_GUINT64_FORMAT " kB\n"
+			"7f0000100000-7f0000200000 rw-p 00100000 08:01 34 "
+			"/tmp/image dir/ram.img (deleted)\n"
+			"Size:               %" G_GUINT64_FORMAT " kB\n"
+			"Rss:                %" G_GUINT64_FORMAT " kB\n"
+			"7f0000200000-7f0000300000 rw-p 00000000 00:00 0 \n"
+			"Size:               %" G_GUINT64_FORMAT " kB\n"
+			"Rss:                %" G_GUINT64_FORMAT " kB\n",
+			100 * page_kb, 10 * page_kb, 2 * page_kb,
+			50 * page_kb, 5 * page_kb,
+			1000 * page_kb, 1000 * page_kb);
+
+	ck_assert (cc_oci_stats_parse_restore_smaps (smaps,
+				&faulted, &total));
+	ck_assert (faulted == 15);
+	ck_assert (total == 150);
+
+} END_TEST
+
+START_TEST(test_cc_oci_stats_get_host) {
+	struct cc_oci_stats stats;
+
+	cc_oci_stats_init (&stats);
+
+	ck_assert (! cc_oci_stats_get_host (0, NULL, &stats));
+	ck_assert (! cc_oci_stats_get_host (getpid (), NULL, NULL));
+
+	/* use the test process in place of a hypervisor */
+	ck_assert (cc_oci_stats_get_host (getpid (), NULL, &stats));
+	ck_assert (stats.values[CC_OCI_STAT_PIDS] >= 1);
+	ck_assert (stats.values[CC_OCI_STAT_MEM_USAGE] > 0);
+	ck_assert (stats.values[CC_OCI_STAT_CPU_TOTAL] ==
+			stats.values[CC_OCI_STAT_CPU_USER] +
+			stats.values[CC_OCI_STAT_CPU_KERNEL]);
+
+	cc_oci_stats_clear (&stats);
+
+} END_TEST
+
+START_TEST(test_cc_oci_stats_to_json) {
+	struct cc_oci_stats stats;
+	struct cc_oci_net_stats iface = { "eth0", { 1, 2, 3, 4, 5, 6, 7, 8 } };
+	guint64 cpu = 42;
+	JsonObject *data;
+	JsonObject *cgroup_stats;
+	JsonObject *obj;
+	JsonArray *array;
+
+	cc_oci_stats_init (&stats);
+
+	stats.values[CC_OCI_STAT_CPU_TOTAL] = 100;
+	stats.values[CC_OCI_STAT_MEM_USAGE] = 200;
+	stats.values[CC_OCI_STAT_MEM_LIMIT] = 300;
+	stats.values[CC_OCI_STAT_BLKIO_WRITE_BYTES] = 400;
+	g_array_append_val (stats.percpu, cpu);
+	g_array_append_val (stats.interfaces, iface);
+
+	data = cc_oci_stats_to_json (&stats);
+	ck_assert (data);
+
+	cgroup_stats = json_object_get_object_member (data, "CgroupStats");
+	ck_assert (cgroup_stats);
+
+	obj = json_object_get_object_member (
+			json_object_get_object_member (cgroup_stats,
+				"cpu_stats"), "cpu_usage");
+	ck_assert (json_object_get_int_member (obj, "total_usage") == 100);
+	array = json_object_get_array_member (obj, "percpu_usage");
+	ck_assert (json_array_get_length (array) == 1);
+	ck_assert (json_array_get_int_element (array, 0) == 42);
+
+	obj = json_object_get_object_member (
+			json_object_get_object_member (cgroup_stats,
+				"memory_stats"), "usage");
+	ck_assert (json_object_get_int_member (obj, "usage") == 200);
+	ck_assert (json_object_get_int_member (obj, "limit") == 300);
+
+	array = json_object_get_array_member (
+			json_object_get_object_member (cgroup_stats,
+				"blkio_stats"), "io_service_bytes_recursive");
+	ck_assert (json_array_get_length (array) == 2);
+	obj = json_array_get_object_element (array, 1);
+	ck_assert (! g_strcmp0 (json_object_get_string_member (obj, "op"),
+				"Write"));
+	ck_assert (json_object_get_int_member (obj, "value") == 400);
+
+	array = json_object_get_array_member (data, "Interfaces");
+	ck_assert (json_array_get_length (array) == 1);
+	obj = json_array_get_object_element (array, 0);
+	ck_assert (! g_strcmp0 (json_object_get_string_member (obj, "name"),
+				"eth0"));
+	ck_assert (json_object_get_int_member (obj, "rx_bytes") == 1);
+	ck_assert (json_object_get_int_member (obj, "tx_dropped") == 8);
+
+	json_object_unref (data);
+	cc_oci_stats_clear (&stats);
+
+} END_TEST
+
+START_TEST(test_cc_oci_stats_delta) {
+	struct cc_oci_stats      prev;
+	struct cc_oci_stats      stats;
+	struct cc_oci_net_stats  iface = { "eth0", { 10 } };
+	JsonObject              *delta;
+	guint64                  cpu = 5;
+
+	cc_oci_stats_init (&prev);
+	cc_oci_stats_init (&stats);
+
+	/* without a previous sample, all non-zero counters are shown */
+	stats.values[CC_OCI_STAT_CPU_TOTAL] = 100;
+	stats.values[CC_OCI_STAT_MEM_USAGE] = 200;
+	g_array_append_val (stats.percpu, cpu);
+	g_array_append_val (stats.interfaces, iface);
+
+	delta = json_object_new ();
+	ck_assert (cc_oci_stats_delta (NULL, &stats, delta) == 4);
+	ck_assert (json_object_get_int_member (delta, "cpu_total") == 100);
+	ck_assert (json_object_get_int_member (delta, "mem_usage") == 200);
+	ck_assert (json_object_get_int_member (delta, "percpu.0") == 5);
+	ck_assert (json_object_get_int_member (delta,
+				"net.eth0.rx_bytes") == 10);
+	ck_assert (! json_object_has_member (delta, "pids"));
+	json_object_unref (delta);
+
+	/* nothing changed */
+	prev.values[CC_OCI_STAT_CPU_TOTAL] = 100;
+	prev.values[CC_OCI_STAT_MEM_USAGE] = 200;
+	g_array_append_val (prev.percpu, cpu);
+	g_array_append_val (prev.interfaces, iface);
+
+	delta = json_object_new ();
+	ck_assert (cc_oci_stats_delta (&prev, &stats, delta) == 0);
+	ck_assert (json_object_get_size (delta) == 0);
+	json_object_unref (delta);
+
+	/* only the differences of changed counters are shown */
+	stats.values[CC_OCI_STAT_CPU_TOTAL] = 150;
+	stats.values[CC_OCI_STAT_MEM_USAGE] = 180;
+	g_array_index (stats.interfaces, struct cc_oci_net_stats,
+			0).values[CC_OCI_NET_STAT_TX_BYTES] = 7;
+
+	delta = json_object_new ();
+	ck_assert (cc_oci_stats_delta (&prev, &stats, delta) == 3);
+	ck_assert (json_object_get_int_member (delta, "cpu_total") == 50);
+	ck_assert (json_object_get_int_member (delta, "mem_usage") == -20);
+	ck_assert (json_object_get_int_member (delta,
+				"net.eth0.tx_bytes") == 7);
+	ck_assert (! json_object_has_member (delta, "percpu.0"));
+	json_object_unref (delta);
+
+	cc_oci_stats_clear (&prev);
+	cc_oci_stats_clear (&stats);
+
+} END_TEST
+
+Suite* make_stats_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_stats_parse_keys, s);
+	ADD_TEST(test_cc_oci_stats_parse_proc_stat, s);
+	ADD_TEST(test_cc_oci_stats_parse_net_dev, s);
+	ADD_TEST(test_cc_oci_stats_parse_restore_smaps, s);
+	ADD_TEST(test_cc_oci_stats_get_host, s);
+	ADD_TEST(test_cc_oci_stats_to_json, s);
+	ADD_TEST(test_cc_oci_stats_delta, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("stats_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_stats_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -32,6 +32,7 @@
 #include "test_common.h"
 #include "../src/util.h"
 #include "../src/oci-config.h"
+#include "../src/state_index.h"
 #include "json.h"
 
 #include "../src/command.h"
@@ -316,6 +317,37 @@ test_helper_create_state_file (const char *name,
 	return true;
 }
 
+/**
+ * Remove the state index files created below \p root_dir
+ * when state files are written or containers listed.
+ *
+ * \param root_dir Root directory to use.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+test_helper_remove_state_index (const char *root_dir)
+{
+	g_autofree gchar *index = NULL;
+	g_autofree gchar *lock = NULL;
+
+	assert (root_dir);
+
+	index = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_FILE, NULL);
+	lock = g_build_path ("/", root_dir, CC_OCI_STATE_INDEX_LOCK_FILE,
+			NULL);
+
+	if (g_remove (index) < 0 && errno != ENOENT) {
+		return false;
+	}
+
+	if (g_remove (lock) < 0 && errno != ENOENT) {
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * Run a VM that can be used to test qmp
  *
@@ -116,6 +116,7 @@ void test_spec_handler(struct spec_handler* handler,
 gboolean test_helper_create_state_file (const char *name,
 		const char *root_dir,
 		struct cc_oci_config *config);
+gboolean test_helper_remove_state_index (const char *root_dir);
 pid_t run_qmp_vm(char **socket_path);
 void create_fake_test_files(void);
 void remove_fake_test_files(void);
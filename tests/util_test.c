@@ -25,6 +25,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "test_common.h"
 #include "../src/util.h"
@@ -42,6 +43,32 @@ START_TEST(test_cc_oci_rm_rf) {
 
 	ck_assert (cc_oci_rm_rf (tmpdir));
 
+	/* nonexistent path */
+	ck_assert (cc_oci_rm_rf (tmpdir));
+
+	g_free (tmpdir);
+
+	/* tree with enough directories to be removed concurrently */
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	for (int i = 0; i < 8; i++) {
+		gchar *dir = g_strdup_printf ("%s/dir%d/sub", tmpdir, i);
+		gchar *file = g_strdup_printf ("%s/file", dir);
+		gchar *link = g_strdup_printf ("%s/link%d", tmpdir, i);
+
+		ck_assert (! g_mkdir_with_parents (dir, 0750));
+		ck_assert (g_file_set_contents (file, "", -1, NULL));
+		ck_assert (! symlink (file, link));
+
+		g_free (dir);
+		g_free (file);
+		g_free (link);
+	}
+
+	ck_assert (cc_oci_rm_rf (tmpdir));
+	ck_assert (! g_file_test (tmpdir, G_FILE_TEST_EXISTS));
+
 	g_free (tmpdir);
 
 } END_TEST
@@ -243,6 +270,14 @@ START_TEST(test_cc_oci_get_iso8601_timestamp) {
 
 	g_free (t);
 
+	/* second call within the same second uses the cached part */
+	t = cc_oci_get_iso8601_timestamp ();
+	ck_assert (t);
+
+	ck_assert (check_timestamp_format (t));
+
+	g_free (t);
+
 } END_TEST
 
 /* FIXME: more tests required for:
@@ -418,6 +453,30 @@ START_TEST(test_cc_oci_get_signame) {
 	ck_assert_str_eq(cc_oci_get_signame(SIGTERM), "SIGTERM");
 } END_TEST
 
+START_TEST(test_cc_oci_parse_duration) {
+	guint msecs = 0;
+
+	ck_assert(! cc_oci_parse_duration(NULL, &msecs));
+	ck_assert(! cc_oci_parse_duration("", &msecs));
+	ck_assert(! cc_oci_parse_duration("1", NULL));
+	ck_assert(! cc_oci_parse_duration("s", &msecs));
+	ck_assert(! cc_oci_parse_duration("-1", &msecs));
+	ck_assert(! cc_oci_parse_duration("1h", &msecs));
+	ck_assert(! cc_oci_parse_duration("nan", &msecs));
+	ck_assert(! cc_oci_parse_duration("99999999999", &msecs));
+
+	ck_assert(cc_oci_parse_duration("5", &msecs));
+	ck_assert(msecs == 5000);
+	ck_assert(cc_oci_parse_duration("1.5s", &msecs));
+	ck_assert(msecs == 1500);
+	ck_assert(cc_oci_parse_duration("250ms", &msecs));
+	ck_assert(msecs == 250);
+	ck_assert(cc_oci_parse_duration("2m", &msecs));
+	ck_assert(msecs == 120000);
+	ck_assert(cc_oci_parse_duration("0", &msecs));
+	ck_assert(msecs == 0);
+} END_TEST
+
 START_TEST(test_cc_oci_node_dump) {
 	GNode* node;
 	cc_oci_node_dump(NULL);
@@ -568,6 +627,7 @@ Suite* make_util_suite(void) {
 	ADD_TEST(test_cc_oci_json_arr_to_string, s);
 	ADD_TEST(test_cc_oci_get_signum, s);
 	ADD_TEST(test_cc_oci_get_signame, s);
+	ADD_TEST(test_cc_oci_parse_duration, s);
 	ADD_TEST(test_cc_oci_node_dump, s);
 	ADD_TEST(test_cc_oci_resolve_path, s);
 	ADD_TEST(test_cc_oci_enable_networking, s);
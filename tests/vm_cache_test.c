@@ -0,0 +1,284 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2017 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/util.h"
+#include "../src/vm_cache.h"
+
+static gchar *
+make_file (const gchar *dir, const gchar *name, const gchar *contents)
+{
+	gchar *path = g_build_path ("/", dir, name, NULL);
+
+	ck_assert (g_file_set_contents (path, contents, -1, NULL));
+
+	return path;
+}
+
+START_TEST(test_cc_oci_vm_cache) {
+	struct cc_oci_config *config = NULL;
+	struct cc_oci_config *loaded = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *vm_file = NULL;
+	g_autofree gchar *hypervisor = NULL;
+	g_autofree gchar *image = NULL;
+	g_autofree gchar *kernel = NULL;
+	g_autofree gchar *cache_file = NULL;
+	g_autofree gchar *contents = NULL;
+	gsize len;
+	struct stat st;
+
+	ck_assert (! cc_oci_vm_cache_save (NULL, NULL, NULL));
+	ck_assert (! cc_oci_vm_cache_load (NULL, NULL));
+
+	vm_file = make_file (tmpdir, CC_OCI_VM_CONFIG, "{}");
+	hypervisor = make_file (tmpdir, "hypervisor", "qemu");
+	image = make_file (tmpdir, "image", "image");
+	kernel = make_file (tmpdir, "kernel", "kernel");
+
+	ck_assert (! stat (vm_file, &st));
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+	config->root_dir = g_strdup (tmpdir);
+
+	/* no vm */
+	ck_assert (! cc_oci_vm_cache_save (config, vm_file, &st));
+
+	config->vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	g_strlcpy (config->vm->hypervisor_path, hypervisor,
+			sizeof (config->vm->hypervisor_path));
+	g_strlcpy (config->vm->image_path, image,
+			sizeof (config->vm->image_path));
+	g_strlcpy (config->vm->kernel_path, kernel,
+			sizeof (config->vm->kernel_path));
+	config->vm->kernel_params = g_strdup ("root=/dev/pmem0p1 rw");
+
+	ck_assert (cc_oci_vm_cache_save (config, vm_file, &st));
+
+	cache_file = g_build_path ("/", tmpdir, CC_OCI_VM_CACHE_FILE, NULL);
+	ck_assert (g_file_test (cache_file, G_FILE_TEST_EXISTS));
+
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	loaded->root_dir = g_strdup (tmpdir);
+
+	/* cache for a different vm config file */
+	ck_assert (! cc_oci_vm_cache_load (loaded, kernel));
+	ck_assert (! loaded->vm);
+
+	ck_assert (cc_oci_vm_cache_load (loaded, vm_file));
+	ck_assert (loaded->vm);
+	ck_assert_str_eq (loaded->vm->hypervisor_path, hypervisor);
+	ck_assert_str_eq (loaded->vm->image_path, image);
+	ck_assert_str_eq (loaded->vm->kernel_path, kernel);
+	ck_assert_str_eq (loaded->vm->kernel_params, "root=/dev/pmem0p1 rw");
+
+	/* vm already set */
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+
+	cc_oci_config_free (loaded);
+
+	/* a changed referenced file invalidates the cache */
+	ck_assert (g_file_set_contents (kernel, "new kernel", -1, NULL));
+
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	loaded->root_dir = g_strdup (tmpdir);
+
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+	ck_assert (! loaded->vm);
+
+	/* as does a missing one */
+	ck_assert (cc_oci_vm_cache_save (config, vm_file, &st));
+	ck_assert (cc_oci_vm_cache_load (loaded, vm_file));
+	cc_oci_config_free (loaded);
+
+	ck_assert (! g_remove (image));
+
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	loaded->root_dir = g_strdup (tmpdir);
+
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+	ck_assert (! loaded->vm);
+
+	ck_assert (g_file_set_contents (image, "image", -1, NULL));
+
+	/* a changed vm config file invalidates the cache */
+	ck_assert (cc_oci_vm_cache_save (config, vm_file, &st));
+	ck_assert (g_file_set_contents (vm_file, "{ }", -1, NULL));
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+
+	ck_assert (! stat (vm_file, &st));
+	ck_assert (cc_oci_vm_cache_save (config, vm_file, &st));
+
+	/* a damaged cache is ignored */
+	ck_assert (g_file_get_contents (cache_file, &contents, &len, NULL));
+	contents[len - 1] ^= 0xff;
+	ck_assert (g_file_set_contents (cache_file, contents, (gssize)len,
+				NULL));
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+
+	/* a truncated cache is ignored */
+	ck_assert (g_file_set_contents (cache_file, contents, 8, NULL));
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+	ck_assert (! loaded->vm);
+
+	/* clean up */
+	ck_assert (! g_remove (cache_file));
+	ck_assert (! g_remove (vm_file));
+	ck_assert (! g_remove (hypervisor));
+	ck_assert (! g_remove (image));
+	ck_assert (! g_remove (kernel));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (loaded);
+	cc_oci_config_free (config);
+} END_TEST
+
+START_TEST(test_cc_oci_vm_cache_symlink) {
+	struct cc_oci_config *config = NULL;
+	struct cc_oci_config *loaded = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
+	g_autofree gchar *vm_file = NULL;
+	g_autofree gchar *hypervisor = NULL;
+	g_autofree gchar *image = NULL;
+	g_autofree gchar *old_image = NULL;
+	g_autofree gchar *new_image = NULL;
+	g_autofree gchar *kernel = NULL;
+	g_autofree gchar *cache_file = NULL;
+	struct stat st;
+
+	vm_file = make_file (tmpdir, CC_OCI_VM_CONFIG, "{}");
+	hypervisor = make_file (tmpdir, "hypervisor", "qemu");
+	old_image = make_file (tmpdir, "image-1", "image");
+	new_image = make_file (tmpdir, "image-2", "image");
+	kernel = make_file (tmpdir, "kernel", "kernel");
+
+	image = g_build_path ("/", tmpdir, "image", NULL);
+	ck_assert (! symlink (old_image, image));
+
+	ck_assert (cc_oci_vm_cache_path_resolves (NULL, old_image));
+	ck_assert (cc_oci_vm_cache_path_resolves ("", old_image));
+	ck_assert (cc_oci_vm_cache_path_resolves (image, old_image));
+	ck_assert (! cc_oci_vm_cache_path_resolves (image, new_image));
+	ck_assert (! cc_oci_vm_cache_path_resolves (image, NULL));
+
+	ck_assert (! stat (vm_file, &st));
+
+	config = cc_oci_config_create ();
+	ck_assert (config);
+	config->root_dir = g_strdup (tmpdir);
+
+	config->vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	g_strlcpy (config->vm->hypervisor_path, hypervisor,
+			sizeof (config->vm->hypervisor_path));
+	g_strlcpy (config->vm->image_config_path, image,
+			sizeof (config->vm->image_config_path));
+	g_strlcpy (config->vm->image_path, old_image,
+			sizeof (config->vm->image_path));
+	g_strlcpy (config->vm->kernel_path, kernel,
+			sizeof (config->vm->kernel_path));
+
+	ck_assert (cc_oci_vm_cache_save (config, vm_file, &st));
+
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	loaded->root_dir = g_strdup (tmpdir);
+
+	ck_assert (cc_oci_vm_cache_load (loaded, vm_file));
+	ck_assert (loaded->vm);
+	ck_assert_str_eq (loaded->vm->image_config_path, image);
+	ck_assert_str_eq (loaded->vm->image_path, old_image);
+	ck_assert (! loaded->vm->hypervisor_config_path[0]);
+	ck_assert (! loaded->vm->kernel_config_path[0]);
+
+	cc_oci_config_free (loaded);
+
+	/* retargeting the symlink invalidates the cache, even though
+	 * the old image is still there and unchanged.
+	 */
+	ck_assert (! g_remove (image));
+	ck_assert (! symlink (new_image, image));
+
+	loaded = cc_oci_config_create ();
+	ck_assert (loaded);
+	loaded->root_dir = g_strdup (tmpdir);
+
+	ck_assert (! cc_oci_vm_cache_load (loaded, vm_file));
+	ck_assert (! loaded->vm);
+
+	/* clean up */
+	cache_file = g_build_path ("/", tmpdir, CC_OCI_VM_CACHE_FILE, NULL);
+	ck_assert (! g_remove (cache_file));
+	ck_assert (! g_remove (vm_file));
+	ck_assert (! g_remove (hypervisor));
+	ck_assert (! g_remove (image));
+	ck_assert (! g_remove (old_image));
+	ck_assert (! g_remove (new_image));
+	ck_assert (! g_remove (kernel));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (loaded);
+	cc_oci_config_free (config);
+} END_TEST
+
+Suite* make_vm_cache_suite(void) {
+	Suite* s = suite_create(__FILE__);
+	ADD_TEST(test_cc_oci_vm_cache, s);
+	ADD_TEST(test_cc_oci_vm_cache_symlink, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("vm_cache_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_vm_cache_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}